@@ -208,7 +208,8 @@ class AnalysisDataHandleImpl;
  * However, normally you should only keep one copy of a handle, i.e., treat
  * this type as movable.
  * Several handles created from the same AnalysisData object can exist
- * concurrently, but must currently operate on separate frames.
+ * concurrently and be used from different threads, but must operate on
+ * separate frames.
  *
  * \inpublicapi
  * \ingroup module_analysisdata
@@ -44,6 +44,8 @@
 #include <limits>
 #include <vector>
 
+#include "thread_mpi/mutex.h"
+
 #include "gromacs/analysisdata/abstractdata.h"
 #include "gromacs/analysisdata/dataframe.h"
 #include "gromacs/analysisdata/paralleloptions.h"
@@ -263,6 +265,13 @@ class AnalysisDataStorage::Impl
          * frame (see \a frames_).
          */
         int                     nextIndex_;
+        /*! \brief
+         * Serializes starting and finishing frames from different threads.
+         *
+         * The frame values are set without locking, since each thread
+         * operates on a separate frame.
+         */
+        tMPI::mutex             mutex_;
 };
 
 AnalysisDataStorage::Impl::Impl()
@@ -559,7 +568,8 @@ AnalysisDataStorageFrame &
 AnalysisDataStorage::startFrame(const AnalysisDataFrameHeader &header)
 {
     GMX_ASSERT(header.isValid(), "Invalid header");
-    Impl::StoredFrame *storedFrame;
+    tMPI::lock_guard<tMPI::mutex> lock(impl_->mutex_);
+    Impl::StoredFrame            *storedFrame;
     if (impl_->storeAll())
     {
         size_t size = header.index() + 1;
@@ -602,6 +612,7 @@ AnalysisDataStorage::startFrame(int index, real x, real dx)
 AnalysisDataStorageFrame &
 AnalysisDataStorage::currentFrame(int index)
 {
+    tMPI::lock_guard<tMPI::mutex> lock(impl_->mutex_);
     int                storageIndex = impl_->computeStorageLocation(index);
     GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
     Impl::StoredFrame &storedFrame = impl_->frames_[storageIndex];
@@ -618,6 +629,7 @@ AnalysisDataStorage::currentFrame(int index)
 void
 AnalysisDataStorage::finishFrame(int index)
 {
+    tMPI::lock_guard<tMPI::mutex> lock(impl_->mutex_);
     int                storageIndex = impl_->computeStorageLocation(index);
     GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
     Impl::StoredFrame &storedFrame = impl_->frames_[storageIndex];
@@ -236,8 +236,11 @@ class AnalysisDataStorageFrame
  * Currently, multipoint data is only supported in serial pass-through mode
  * without any storage.
  *
- * \todo
- * Proper multi-threaded implementation.
+ * startFrame(), currentFrame() and finishFrame() can be called concurrently
+ * from different threads for different frames (up to the parallelization
+ * factor set with setParallelOptions()); notifications are serialized and
+ * always happen in the order of the frames.  Multipoint data can only be
+ * added from a single thread.
  *
  * \inlibraryapi
  * \ingroup module_analysisdata
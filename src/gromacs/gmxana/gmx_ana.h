@@ -75,6 +75,9 @@ gmx_covar(int argc, char *argv[]);
 int
 gmx_current(int argc, char *argv[]);
 
+int
+gmx_ddreplay(int argc, char *argv[]);
+
 int
 gmx_density(int argc, char *argv[]);
 
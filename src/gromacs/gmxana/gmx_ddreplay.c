@@ -0,0 +1,973 @@
+/*
+ *
+ *                This source code is part of
+ *
+ *                 G   R   O   M   A   C   S
+ *
+ *          GROningen MAchine for Chemical Simulations
+ *
+ * Written by David van der Spoel, Erik Lindahl, Berk Hess, and others.
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2013, The GROMACS development team,
+ * check out http://www.gromacs.org for more information.
+
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * If you want to redistribute modifications, please consider that
+ * scientific software is very special. Version control is crucial -
+ * bugs must be traceable. We will be happy to consider code for
+ * inclusion in the official distribution, but derived work must not
+ * be called official GROMACS. Details are found in the README & COPYING
+ * files - if they are missing, get the official version at www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the papers on the package - you can find them in the top README file.
+ *
+ * For more info, check our website at http://www.gromacs.org
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "typedefs.h"
+#include "statutil.h"
+#include "copyrite.h"
+#include "gmx_fatal.h"
+#include "futil.h"
+#include "xvgr.h"
+#include "macros.h"
+#include "smalloc.h"
+#include "vec.h"
+#include "gmx_ana.h"
+
+/* The data of one DD node at one record in an mdrun -ddload file */
+typedef struct
+{
+    int  node;
+    ivec ci;
+    int  nat_home;
+    int  nat_halo;
+    int  nat_send;
+    real f;
+    real step;
+    real ppdpme;
+    real pme;
+    real waitpme;
+    rvec x0;
+    rvec x1;
+} t_ddrnode;
+
+typedef struct
+{
+    gmx_large_int_t step;
+    rvec            box;
+    t_ddrnode      *nd;
+} t_ddrframe;
+
+typedef struct
+{
+    int         nnodes;
+    ivec        nc;
+    int         npme;
+    char        dlb[STRLEN];
+    real        cutoff;
+    real        cellsize_limit_bonded;
+    real        cellsize_limit;
+    int         nframe;
+    t_ddrframe *fr;
+} t_ddrecord;
+
+/* A rectangular block of space with homogeneously distributed load */
+typedef struct
+{
+    rvec x0;
+    rvec x1;
+    real load;
+} t_ddrblock;
+
+/* The prediction for one DD grid */
+typedef struct
+{
+    ivec     nc;
+    gmx_bool bUnresolved;
+    gmx_bool bDLBFeasible;
+    gmx_bool bDLBAuto;
+    ivec     np;
+    rvec     wmin;
+    real     imb_static;
+    real     imb_dlb;
+    real     loss_static;
+    real     loss_dlb;
+    real     time_static;
+    real     time_dlb;
+    real     halo;
+} t_ddrgrid;
+
+/* The number of real values per line after the integer columns */
+#define DDR_NREAL 14
+
+static void read_ddload(const char *fn, t_ddrecord *rec)
+{
+    FILE           *fp;
+    char            line[STRLEN], buf[STEPSTRSIZE], *ptr;
+    t_ddrframe     *fr;
+    t_ddrnode      *nd;
+    gmx_large_int_t step;
+    int             rank, node, nat[3], nframe_alloc, nline, d;
+    ivec            ci;
+    double          v[DDR_NREAL], dval;
+
+    fp = ffopen(fn, "r");
+
+    rec->nnodes                = 0;
+    clear_ivec(rec->nc);
+    rec->npme                  = 0;
+    strcpy(rec->dlb, "unknown");
+    rec->cutoff                = 0;
+    rec->cellsize_limit_bonded = 0;
+    rec->cellsize_limit        = 0;
+    rec->nframe                = 0;
+    rec->fr                    = NULL;
+    nframe_alloc               = 0;
+    fr                         = NULL;
+
+    nline = 0;
+    while (fgets(line, STRLEN, fp) != NULL)
+    {
+        nline++;
+        if (line[0] == '#')
+        {
+            sscanf(line, "# nnodes %d", &rec->nnodes);
+            sscanf(line, "# grid %d %d %d", &rec->nc[XX], &rec->nc[YY], &rec->nc[ZZ]);
+            sscanf(line, "# npme %d", &rec->npme);
+            sscanf(line, "# dlb %s", rec->dlb);
+            if (sscanf(line, "# cutoff %lf", &dval) == 1)
+            {
+                rec->cutoff = dval;
+            }
+            if (sscanf(line, "# cellsize_limit_bonded %lf", &dval) == 1)
+            {
+                rec->cellsize_limit_bonded = dval;
+            }
+            if (sscanf(line, "# cellsize_limit %lf", &dval) == 1)
+            {
+                rec->cellsize_limit = dval;
+            }
+            continue;
+        }
+        /* Skip the step, which we read separately */
+        ptr = line;
+        while (*ptr == ' ')
+        {
+            ptr++;
+        }
+        while (*ptr != ' ' && *ptr != '\0')
+        {
+            ptr++;
+        }
+        if (sscanf(line, gmx_large_int_pfmt, &step) != 1 ||
+            sscanf(ptr, "%d %d %d %d %d %d %d %d"
+                   " %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf",
+                   &rank, &node, &ci[XX], &ci[YY], &ci[ZZ],
+                   &nat[0], &nat[1], &nat[2],
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6],
+                   &v[7], &v[8], &v[9], &v[10], &v[11], &v[12], &v[13]) != 8 + DDR_NREAL)
+        {
+            /* Empty or truncated line, as can occur at the end of a killed run */
+            continue;
+        }
+        if (rec->nnodes <= 0)
+        {
+            gmx_fatal(FARGS, "File %s does not start with an mdrun -ddload header", fn);
+        }
+        if (rank < 0 || rank >= rec->nnodes)
+        {
+            gmx_fatal(FARGS, "Rank %d on line %d of %s is out of range", rank, nline, fn);
+        }
+        if (rank == 0)
+        {
+            if (rec->nframe >= nframe_alloc)
+            {
+                nframe_alloc = over_alloc_small(rec->nframe + 1);
+                srenew(rec->fr, nframe_alloc);
+            }
+            fr       = &rec->fr[rec->nframe++];
+            fr->step = step;
+            for (d = 0; d < DIM; d++)
+            {
+                fr->box[d] = v[11+d];
+            }
+            snew(fr->nd, rec->nnodes);
+        }
+        else if (fr == NULL || step != fr->step)
+        {
+            gmx_fatal(FARGS, "Line %d of %s does not continue the record of step %s",
+                      nline, fn, fr ? gmx_step_str(fr->step, buf) : "-");
+        }
+        nd           = &fr->nd[rank];
+        nd->node     = node;
+        copy_ivec(ci, nd->ci);
+        nd->nat_home = nat[0];
+        nd->nat_halo = nat[1];
+        nd->nat_send = nat[2];
+        nd->f        = v[0];
+        nd->step     = v[1];
+        nd->ppdpme   = v[2];
+        nd->pme      = v[3];
+        nd->waitpme  = v[4];
+        for (d = 0; d < DIM; d++)
+        {
+            nd->x0[d] = v[5+2*d];
+            nd->x1[d] = v[6+2*d];
+        }
+    }
+    ffclose(fp);
+
+    if (rec->nframe == 0)
+    {
+        gmx_fatal(FARGS, "No load records found in %s", fn);
+    }
+    /* The last record might be incomplete when the run was killed */
+    if (rec->fr[rec->nframe-1].nd[rec->nnodes-1].step == 0 &&
+        rec->fr[rec->nframe-1].nd[rec->nnodes-1].nat_home == 0)
+    {
+        rec->nframe--;
+    }
+}
+
+/* Returns the load of the blocks below x along dimension dim */
+static double blocks_load_below(int nblock, const t_ddrblock *block,
+                                int dim, real x)
+{
+    double load, w;
+    int    b;
+
+    load = 0;
+    for (b = 0; b < nblock; b++)
+    {
+        w = block[b].x1[dim] - block[b].x0[dim];
+        if (x >= block[b].x1[dim])
+        {
+            load += block[b].load;
+        }
+        else if (x > block[b].x0[dim] && w > 0)
+        {
+            load += block[b].load*(x - block[b].x0[dim])/w;
+        }
+    }
+
+    return load;
+}
+
+/* Sets the n+1 cell boundaries bound along dim in the range [x0,x1].
+ * Without DLB the cells are uniform, with DLB they have equal load,
+ * but are not smaller than wmin.
+ */
+static void set_cell_bounds(int nblock, const t_ddrblock *block,
+                            int dim, real x0, real x1, int n,
+                            gmx_bool bDLB, real wmin, real *bound)
+{
+    double load_tot, target, lo, hi, mid;
+    int    i, iter;
+
+    bound[0] = x0;
+    bound[n] = x1;
+    for (i = 1; i < n; i++)
+    {
+        bound[i] = x0 + i*(x1 - x0)/n;
+    }
+    if (!bDLB || n == 1)
+    {
+        return;
+    }
+
+    load_tot = blocks_load_below(nblock, block, dim, x1);
+    if (load_tot <= 0)
+    {
+        return;
+    }
+    for (i = 1; i < n; i++)
+    {
+        /* Bisection on the cumulative load, which is piecewise linear */
+        target = i*load_tot/n;
+        lo     = x0;
+        hi     = x1;
+        for (iter = 0; iter < 40; iter++)
+        {
+            mid = 0.5*(lo + hi);
+            if (blocks_load_below(nblock, block, dim, mid) < target)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        bound[i] = 0.5*(lo + hi);
+    }
+    /* Impose the minimum cell size, as the DLB in mdrun does */
+    for (i = 1; i < n; i++)
+    {
+        bound[i] = max(bound[i], bound[i-1] + wmin);
+    }
+    for (i = n-1; i > 0; i--)
+    {
+        bound[i] = min(bound[i], bound[i+1] - wmin);
+    }
+}
+
+/* Returns the estimated number of halo atoms of a cell x0-x1
+ * with atom density rho for an eighth-shell halo of size rc.
+ */
+static real halo_size(const ivec nc, const rvec x0, const rvec x1,
+                      real rc, real rho)
+{
+    real vol, vol_halo;
+    int  d;
+
+    vol      = 1;
+    vol_halo = 1;
+    for (d = 0; d < DIM; d++)
+    {
+        vol      *= x1[d] - x0[d];
+        vol_halo *= x1[d] - x0[d] + (nc[d] > 1 ? rc : 0);
+    }
+
+    return rho*(vol_halo - vol);
+}
+
+/* Recursively partitions the blocks along the DD dimensions
+ * from dim onwards, in the staggered way mdrun does with DLB,
+ * and accumulates the load and halo statistics of the cells.
+ */
+static void partition_blocks(int nblock, const t_ddrblock *block,
+                             int dim, const ivec nc, rvec x0, rvec x1,
+                             gmx_bool bDLB, const rvec wmin,
+                             real rc, real rho,
+                             real *load_max, real *load_sum, real *halo_sum)
+{
+    t_ddrblock *sub;
+    real       *bound, load, w, c0, c1;
+    int         i, b, nsub;
+
+    while (dim < DIM && nc[dim] == 1)
+    {
+        dim++;
+    }
+    if (dim == DIM)
+    {
+        load = 0;
+        for (b = 0; b < nblock; b++)
+        {
+            load += block[b].load;
+        }
+        *load_max  = max(*load_max, load);
+        *load_sum += load;
+        *halo_sum += halo_size(nc, x0, x1, rc, rho);
+
+        return;
+    }
+
+    snew(bound, nc[dim]+1);
+    snew(sub, nblock);
+    set_cell_bounds(nblock, block, dim, x0[dim], x1[dim], nc[dim],
+                    bDLB, wmin[dim], bound);
+    for (i = 0; i < nc[dim]; i++)
+    {
+        nsub = 0;
+        for (b = 0; b < nblock; b++)
+        {
+            c0 = max(block[b].x0[dim], bound[i]);
+            c1 = min(block[b].x1[dim], bound[i+1]);
+            w  = block[b].x1[dim] - block[b].x0[dim];
+            if (c1 > c0 && w > 0)
+            {
+                sub[nsub]          = block[b];
+                sub[nsub].x0[dim]  = c0;
+                sub[nsub].x1[dim]  = c1;
+                sub[nsub].load    *= (c1 - c0)/w;
+                nsub++;
+            }
+        }
+        x0[dim] = bound[i];
+        x1[dim] = bound[i+1];
+        partition_blocks(nsub, sub, dim+1, nc, x0, x1, bDLB, wmin, rc, rho,
+                         load_max, load_sum, halo_sum);
+    }
+    x0[dim] = bound[0];
+    x1[dim] = bound[nc[dim]];
+    sfree(sub);
+    sfree(bound);
+}
+
+/* Determines the number of pulses and the minimum cell sizes with DLB
+ * for grid g, following set_cell_limits_dlb in domdec.c.
+ */
+static void set_grid_limits(t_ddrgrid *g, const rvec box,
+                            real rc, real rdd, real dds)
+{
+    int npulse, npulse_d, npulse_d_max, d;
+
+    if (rdd >= rc)
+    {
+        npulse = 1;
+    }
+    else if (rdd > 0)
+    {
+        npulse = (int)(0.96 + rc/rdd);
+    }
+    else
+    {
+        npulse = max(g->nc[XX]-1, max(g->nc[YY]-1, g->nc[ZZ]-1));
+    }
+    npulse_d_max = 0;
+    for (d = 0; d < DIM; d++)
+    {
+        if (g->nc[d] > 1)
+        {
+            npulse_d     = (int)(1 + g->nc[d]*rc/(box[d]*dds));
+            npulse_d_max = max(npulse_d_max, npulse_d);
+        }
+    }
+    npulse = max(1, min(npulse, npulse_d_max));
+
+    g->bDLBFeasible = TRUE;
+    g->bDLBAuto     = TRUE;
+    for (d = 0; d < DIM; d++)
+    {
+        g->np[d]   = 0;
+        g->wmin[d] = 0;
+        if (g->nc[d] > 1)
+        {
+            g->np[d]   = min(npulse, g->nc[d]-1);
+            g->wmin[d] = max(rdd, rc/g->np[d]);
+            if (g->nc[d]*g->wmin[d] > box[d])
+            {
+                g->bDLBFeasible = FALSE;
+            }
+            /* mdrun only chooses grids where cells can shrink by dds */
+            if (dds*box[d]/g->nc[d] < g->wmin[d])
+            {
+                g->bDLBAuto = FALSE;
+            }
+        }
+    }
+}
+
+static void frame_blocks(const t_ddrecord *rec, int f, t_ddrblock *block)
+{
+    int i;
+
+    for (i = 0; i < rec->nnodes; i++)
+    {
+        copy_rvec(rec->fr[f].nd[i].x0, block[i].x0);
+        copy_rvec(rec->fr[f].nd[i].x1, block[i].x1);
+        block[i].load = rec->fr[f].nd[i].f;
+    }
+}
+
+/* Returns the atom density of frame f */
+static real frame_density(const t_ddrecord *rec, int f)
+{
+    real natoms;
+    int  i;
+
+    natoms = 0;
+    for (i = 0; i < rec->nnodes; i++)
+    {
+        natoms += rec->fr[f].nd[i].nat_home;
+    }
+
+    return natoms/(rec->fr[f].box[XX]*rec->fr[f].box[YY]*rec->fr[f].box[ZZ]);
+}
+
+/* Returns the ratio of the recorded and the estimated number of halo atoms.
+ * This corrects the halo estimates for the pair list buffer,
+ * charge group sizes and bonded communication.
+ */
+static real halo_calibration(const t_ddrecord *rec, int f0, real rc)
+{
+    double nrec, nest;
+    int    f, i;
+    real   rho;
+
+    nrec = 0;
+    nest = 0;
+    for (f = f0; f < rec->nframe; f++)
+    {
+        rho = frame_density(rec, f);
+        for (i = 0; i < rec->nnodes; i++)
+        {
+            nrec += rec->fr[f].nd[i].nat_halo;
+            nest += halo_size(rec->nc, rec->fr[f].nd[i].x0, rec->fr[f].nd[i].x1,
+                              rc, rho);
+        }
+    }
+
+    return (nest > 0 ? nrec/nest : 1);
+}
+
+/* Returns the imbalance, max/average - 1, of the recorded force load
+ * over the physical nodes and the average imbalance within the nodes.
+ */
+static void node_imbalance(const t_ddrecord *rec, int f0,
+                           real *imb_inter, real *imb_intra, int *nphys)
+{
+    int    *node, *nrank, nnode, f, i, j;
+    double *sum, *mx, tot, av_max, sinter, sintra;
+
+    snew(node, rec->nnodes);
+    snew(nrank, rec->nnodes);
+    snew(sum, rec->nnodes);
+    snew(mx, rec->nnodes);
+
+    /* Number the physical nodes consecutively */
+    nnode = 0;
+    for (i = 0; i < rec->nnodes; i++)
+    {
+        for (j = 0; j < nnode; j++)
+        {
+            if (rec->fr[f0].nd[node[j]].node == rec->fr[f0].nd[i].node)
+            {
+                break;
+            }
+        }
+        if (j == nnode)
+        {
+            node[nnode++] = i;
+        }
+        nrank[j]++;
+    }
+
+    sinter = 0;
+    sintra = 0;
+    for (f = f0; f < rec->nframe; f++)
+    {
+        for (j = 0; j < nnode; j++)
+        {
+            sum[j] = 0;
+            mx[j]  = 0;
+        }
+        tot = 0;
+        for (i = 0; i < rec->nnodes; i++)
+        {
+            for (j = 0; rec->fr[f].nd[node[j]].node != rec->fr[f].nd[i].node; j++)
+            {
+                ;
+            }
+            sum[j] += rec->fr[f].nd[i].f;
+            mx[j]   = max(mx[j], rec->fr[f].nd[i].f);
+            tot    += rec->fr[f].nd[i].f;
+        }
+        if (tot <= 0)
+        {
+            continue;
+        }
+        /* Compare the average load per rank between the nodes */
+        av_max = 0;
+        for (j = 0; j < nnode; j++)
+        {
+            av_max = max(av_max, sum[j]/nrank[j]);
+            if (sum[j] > 0)
+            {
+                sintra += (mx[j]*nrank[j]/sum[j] - 1)/nnode;
+            }
+        }
+        sinter += av_max*rec->nnodes/tot - 1;
+    }
+    *imb_inter = sinter/(rec->nframe - f0);
+    *imb_intra = sintra/(rec->nframe - f0);
+    *nphys     = nnode;
+
+    sfree(mx);
+    sfree(sum);
+    sfree(nrank);
+    sfree(node);
+}
+
+/* Returns the force load imbalance of the recorded frame f */
+static real frame_imbalance(const t_ddrecord *rec, int f)
+{
+    real fmax, fsum;
+    int  i;
+
+    fmax = 0;
+    fsum = 0;
+    for (i = 0; i < rec->nnodes; i++)
+    {
+        fmax  = max(fmax, rec->fr[f].nd[i].f);
+        fsum += rec->fr[f].nd[i].f;
+    }
+
+    return (fsum > 0 ? fmax*rec->nnodes/fsum - 1 : 0);
+}
+
+/* Predicts the load imbalance, the performance loss, the step time
+ * relative to the recording and the halo size for grid g.
+ * When imb_static and imb_dlb are not NULL, the imbalance per frame
+ * is returned in them.
+ */
+static void predict_grid(const t_ddrecord *rec, int f0, t_ddrgrid *g,
+                         real rc, real halo_calib,
+                         real *imb_static, real *imb_dlb)
+{
+    t_ddrblock *block;
+    int         f, i, n, dlb, nav;
+    rvec        x0, x1;
+    real        load_max, load_sum, halo_sum, rho;
+    real        t_rec, f_rec, t_pred, imb, loss;
+    double      sum_imb[2], sum_loss[2], sum_time[2], sum_time_rec, sum_halo;
+
+    snew(block, rec->nnodes);
+
+    n = g->nc[XX]*g->nc[YY]*g->nc[ZZ];
+    for (dlb = 0; dlb < 2; dlb++)
+    {
+        sum_imb[dlb]  = 0;
+        sum_loss[dlb] = 0;
+        sum_time[dlb] = 0;
+    }
+    sum_time_rec = 0;
+    sum_halo     = 0;
+    nav          = 0;
+    for (f = f0; f < rec->nframe; f++)
+    {
+        frame_blocks(rec, f, block);
+        rho = frame_density(rec, f);
+
+        /* The recorded step time and the part of it that is not force */
+        t_rec = 0;
+        f_rec = 0;
+        for (i = 0; i < rec->nnodes; i++)
+        {
+            t_rec += rec->fr[f].nd[i].step/rec->nnodes;
+            f_rec  = max(f_rec, rec->fr[f].nd[i].f);
+        }
+        sum_time_rec += t_rec;
+
+        for (dlb = 0; dlb < 2; dlb++)
+        {
+            if (dlb == 1 && !g->bDLBFeasible)
+            {
+                continue;
+            }
+            clear_rvec(x0);
+            copy_rvec(rec->fr[f].box, x1);
+            load_max = 0;
+            load_sum = 0;
+            halo_sum = 0;
+            partition_blocks(rec->nnodes, block, XX, g->nc, x0, x1,
+                             dlb == 1, g->wmin, rc, rho,
+                             &load_max, &load_sum, &halo_sum);
+            imb    = (load_sum > 0 ? load_max*n/load_sum - 1 : 0);
+            t_pred = t_rec - f_rec + load_max;
+            loss   = (t_pred > 0 ? (load_max*n - load_sum)/(t_pred*n) : 0);
+
+            sum_imb[dlb]  += imb;
+            sum_loss[dlb] += loss;
+            sum_time[dlb] += t_pred;
+            if (dlb == 0)
+            {
+                sum_halo += halo_calib*halo_sum/n;
+            }
+            if (dlb == 0 && imb_static != NULL)
+            {
+                imb_static[f-f0] = imb;
+            }
+            if (dlb == 1 && imb_dlb != NULL)
+            {
+                imb_dlb[f-f0] = imb;
+            }
+        }
+        nav++;
+    }
+
+    g->imb_static  = sum_imb[0]/nav;
+    g->loss_static = sum_loss[0]/nav;
+    g->time_static = (sum_time_rec > 0 ? sum_time[0]/sum_time_rec : 0);
+    g->imb_dlb     = sum_imb[1]/nav;
+    g->loss_dlb    = sum_loss[1]/nav;
+    g->time_dlb    = (sum_time_rec > 0 ? sum_time[1]/sum_time_rec : 0);
+    g->halo        = sum_halo/nav;
+
+    sfree(block);
+}
+
+static real grid_time(const t_ddrgrid *g)
+{
+    return (g->bDLBFeasible ? min(g->time_static, g->time_dlb) : g->time_static);
+}
+
+static int grid_comp(const void *a, const void *b)
+{
+    real ta, tb;
+
+    ta = grid_time((const t_ddrgrid *)a);
+    tb = grid_time((const t_ddrgrid *)b);
+
+    return (ta < tb ? -1 : (ta > tb ? 1 : 0));
+}
+
+/* Returns whether mdrun could use grid nc without DLB */
+static gmx_bool grid_possible(const ivec nc, const rvec box, real rc, real rdd)
+{
+    int  d;
+    real w;
+
+    for (d = 0; d < DIM; d++)
+    {
+        if (nc[d] > 1)
+        {
+            w = box[d]/nc[d];
+            if (w < rdd || (nc[d] - 1)*w < rc)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+int gmx_ddreplay(int argc, char *argv[])
+{
+    const char     *desc[] = {
+        "[TT]g_ddreplay[tt] predicts the domain decomposition load imbalance",
+        "for DD grids and dynamic load balancing settings other than those",
+        "of a recorded run. The input is the load statistics file written",
+        "by [TT]mdrun -ddload[tt], which contains per DD node and per",
+        "neighbor search step the force and step cycles, the PME (wait)",
+        "cycles, the atom and halo counts and the cell boundaries.[PAR]",
+        "The force load of each recorded cell is assumed to be",
+        "homogeneously distributed over the cell. For each candidate grid",
+        "this load density is integrated over uniform cells (static load",
+        "balancing) and over cells that are staggered and sized for equal",
+        "load, as dynamic load balancing would converge to.",
+        "With DLB, the cells can not become smaller than the limit",
+        "[TT]mdrun[tt] would impose, which depends on the cut-off,",
+        "the number of communication pulses, [TT]-rdd[tt] and [TT]-dds[tt].",
+        "The step time is predicted by replacing the recorded maximum",
+        "force load by the predicted one, assuming the rest of the step",
+        "does not change. The halo size is estimated from the atom density",
+        "and the cell sizes, calibrated with the recorded halo sizes.",
+        "Note that load variations within the recorded cells are not",
+        "known, so grids that decompose dimensions that were not",
+        "decomposed in the recorded run will look better balanced",
+        "than they are.[PAR]",
+        "By default all grids for the recorded number of PP nodes are",
+        "evaluated, option [TT]-np[tt] sets another number and",
+        "[TT]-grid[tt] a single grid, e.g. [TT]4x2x1[tt].",
+        "The candidates are listed with the fastest predicted step time first.",
+        "Option [TT]-o[tt] writes the recorded and predicted imbalance",
+        "per record for the first candidate.[PAR]",
+        "The physical node numbers in the file are used to report",
+        "the load imbalance between and within nodes of the recorded run."
+    };
+    static const char *grid_str = "";
+    static int         np       = 0, nskip = 1;
+    static real        dds      = 0.8, rdd = 0;
+    t_pargs            pa[]     = {
+        { "-grid", FALSE, etSTR,  {&grid_str},
+          "Only evaluate this DD grid, e.g. 4x2x1" },
+        { "-np",   FALSE, etINT,  {&np},
+          "Number of PP nodes to evaluate grids for, 0 is as recorded" },
+        { "-dds",  FALSE, etREAL, {&dds},
+          "The minimum allowed DLB scaling of the DD cell size, as for mdrun" },
+        { "-rdd",  FALSE, etREAL, {&rdd},
+          "The maximum distance for bonded interactions, 0 is as recorded" },
+        { "-skip", FALSE, etINT,  {&nskip},
+          "Number of initial records to skip" }
+    };
+    t_filenm           fnm[] = {
+        { efDAT, "-f", "ddload",   ffREAD },
+        { efXVG, "-o", "ddreplay", ffOPTWR }
+    };
+#define NFILE asize(fnm)
+    output_env_t       oenv;
+    t_ddrecord         rec;
+    t_ddrgrid         *grid;
+    int                ngrid, ngrid_alloc, nx, ny, f, f0, nrec, i, nphys;
+    ivec               nc;
+    real               rc, calib, imb_rec, halo_rec, wait, step, imb_inter, imb_intra;
+    real              *imb_static, *imb_dlb;
+    FILE              *fp;
+    char               buf[STRLEN];
+    const char        *leg[3];
+
+    parse_common_args(&argc, argv, PCA_CAN_VIEW,
+                      NFILE, fnm, asize(pa), pa, asize(desc), desc, 0, NULL,
+                      &oenv);
+
+    read_ddload(opt2fn("-f", NFILE, fnm), &rec);
+
+    f0 = (nskip < rec.nframe ? max(nskip, 0) : 0);
+    nrec = rec.nframe - f0;
+    rc   = rec.cutoff;
+    if (rdd <= 0)
+    {
+        rdd = rec.cellsize_limit_bonded;
+    }
+    if (np <= 0)
+    {
+        np = rec.nnodes;
+    }
+
+    imb_rec  = 0;
+    halo_rec = 0;
+    wait     = 0;
+    step     = 0;
+    for (f = f0; f < rec.nframe; f++)
+    {
+        imb_rec += frame_imbalance(&rec, f)/nrec;
+        for (i = 0; i < rec.nnodes; i++)
+        {
+            halo_rec += (real)rec.fr[f].nd[i].nat_halo/(nrec*rec.nnodes);
+            wait     += rec.fr[f].nd[i].waitpme;
+            step     += rec.fr[f].nd[i].step;
+        }
+    }
+    calib = halo_calibration(&rec, f0, rc);
+    node_imbalance(&rec, f0, &imb_inter, &imb_intra, &nphys);
+
+    printf("\nRead %d records of %d DD nodes, grid %d x %d x %d, %d separate PME nodes, DLB %s\n",
+           rec.nframe, rec.nnodes, rec.nc[XX], rec.nc[YY], rec.nc[ZZ],
+           rec.npme, rec.dlb);
+    printf("Using %d records, cut-off %.3f nm, bonded distance %.3f nm, -dds %.2f\n\n",
+           nrec, rc, rdd, dds);
+    printf("Recorded average force load imbalance: %.1f %%\n", imb_rec*100);
+    printf("Recorded imbalance between %d physical nodes: %.1f %%, within nodes: %.1f %%\n",
+           nphys, imb_inter*100, imb_intra*100);
+    if (rec.npme > 0 && step > 0)
+    {
+        printf("Recorded PP wait for PME: %.1f %% of the step time\n", wait/step*100);
+    }
+    printf("Recorded average halo size: %.1f atoms, %.2f times the estimate\n\n",
+           halo_rec, calib);
+
+    /* Set up the candidate grids */
+    ngrid       = 0;
+    ngrid_alloc = 0;
+    grid        = NULL;
+    if (grid_str[0] != '\0')
+    {
+        if (sscanf(grid_str, "%dx%dx%d", &nc[XX], &nc[YY], &nc[ZZ]) != 3 ||
+            nc[XX] <= 0 || nc[YY] <= 0 || nc[ZZ] <= 0)
+        {
+            gmx_fatal(FARGS, "Could not parse grid '%s', use e.g. 4x2x1", grid_str);
+        }
+        snew(grid, 1);
+        copy_ivec(nc, grid[ngrid++].nc);
+    }
+    else
+    {
+        for (nx = 1; nx <= np; nx++)
+        {
+            for (ny = 1; nx*ny <= np; ny++)
+            {
+                if (np % (nx*ny) != 0)
+                {
+                    continue;
+                }
+                nc[XX] = nx;
+                nc[YY] = ny;
+                nc[ZZ] = np/(nx*ny);
+                if (!grid_possible(nc, rec.fr[f0].box, rc, rdd))
+                {
+                    continue;
+                }
+                if (ngrid >= ngrid_alloc)
+                {
+                    ngrid_alloc += 16;
+                    srenew(grid, ngrid_alloc);
+                }
+                copy_ivec(nc, grid[ngrid++].nc);
+            }
+        }
+        if (ngrid == 0)
+        {
+            gmx_fatal(FARGS, "No possible DD grid for %d nodes", np);
+        }
+    }
+    for (i = 0; i < ngrid; i++)
+    {
+        grid[i].bUnresolved = ((grid[i].nc[XX] > 1 && rec.nc[XX] == 1) ||
+                               (grid[i].nc[YY] > 1 && rec.nc[YY] == 1) ||
+                               (grid[i].nc[ZZ] > 1 && rec.nc[ZZ] == 1));
+        set_grid_limits(&grid[i], rec.fr[f0].box, rc, rdd, dds);
+        predict_grid(&rec, f0, &grid[i], rc, calib, NULL, NULL);
+    }
+    qsort(grid, ngrid, sizeof(grid[0]), grid_comp);
+
+    printf("              pulses   ---- static load balancing ----   --------- with DLB ----------\n");
+    printf("      grid     x y z   imbalance    loss  rel. time      imbalance    loss  rel. time   halo/node\n");
+    for (i = 0; i < ngrid; i++)
+    {
+        printf("%c %3d x%3d x%3d  %d %d %d   %7.1f %%  %6.1f %%  %9.3f  ",
+               (grid[i].nc[XX] == rec.nc[XX] &&
+                grid[i].nc[YY] == rec.nc[YY] &&
+                grid[i].nc[ZZ] == rec.nc[ZZ]) ? '*' :
+               (grid[i].bUnresolved ? '?' : ' '),
+               grid[i].nc[XX], grid[i].nc[YY], grid[i].nc[ZZ],
+               grid[i].np[XX], grid[i].np[YY], grid[i].np[ZZ],
+               grid[i].imb_static*100, grid[i].loss_static*100,
+               grid[i].time_static);
+        if (grid[i].bDLBFeasible)
+        {
+            printf("%c %7.1f %%  %6.1f %%  %9.3f",
+                   grid[i].bDLBAuto ? ' ' : '!',
+                   grid[i].imb_dlb*100, grid[i].loss_dlb*100,
+                   grid[i].time_dlb);
+        }
+        else
+        {
+            printf("  %7s    %6s    %9s", "-", "-", "-");
+        }
+        printf("   %9.1f\n", grid[i].halo);
+    }
+    printf("\n* the recorded grid, ! mdrun will not choose this grid with this -dds,\n"
+           "- the cut-off and bonded distance do not allow DLB with this grid,\n"
+           "? the load distribution along a dimension not decomposed in the recording is unknown\n"
+           "The time is relative to the recorded step time\n\n");
+
+    if (opt2bSet("-o", NFILE, fnm))
+    {
+        snew(imb_static, nrec);
+        snew(imb_dlb, nrec);
+        predict_grid(&rec, f0, &grid[0], rc, calib, imb_static, imb_dlb);
+        fp = xvgropen(opt2fn("-o", NFILE, fnm), "DD force load imbalance",
+                      "Step", "Imbalance (%)", oenv);
+        sprintf(buf, "%d x %d x %d", grid[0].nc[XX], grid[0].nc[YY], grid[0].nc[ZZ]);
+        leg[0] = "recorded";
+        leg[1] = "static";
+        leg[2] = "DLB";
+        xvgr_subtitle(fp, buf, oenv);
+        xvgr_legend(fp, grid[0].bDLBFeasible ? 3 : 2, leg, oenv);
+        for (f = f0; f < rec.nframe; f++)
+        {
+            fprintf(fp, "%s %8.2f %8.2f", gmx_step_str(rec.fr[f].step, buf),
+                    frame_imbalance(&rec, f)*100, imb_static[f-f0]*100);
+            if (grid[0].bDLBFeasible)
+            {
+                fprintf(fp, " %8.2f", imb_dlb[f-f0]*100);
+            }
+            fprintf(fp, "\n");
+        }
+        ffclose(fp);
+        sfree(imb_dlb);
+        sfree(imb_static);
+
+        do_view(oenv, opt2fn("-o", NFILE, fnm), "-nxy");
+    }
+
+    thanx(stderr);
+
+    return 0;
+}
@@ -57,9 +57,12 @@
 #include "vec.h"
 #include "confio.h"
 #include "gmx_ana.h"
+#include "gmx_omp.h"
 
 
 #define FACTOR  1000.0  /* Convert nm^2/ps to 10e-5 cm^2/s */
+/* The number of frames stored per block for the FFT-based MSD */
+#define MSD_FFT_BLOCK 1024
 /* NORMAL = total diffusion coefficient (default). X,Y,Z is diffusion
    coefficient in X,Y,Z direction. LATERAL is diffusion coefficient in
    plane perpendicular to axis
@@ -94,8 +97,33 @@ typedef struct {
     int          *n_offs;
     int         **ndata;      /* the number of msds (particles/mols) per data
                                  point. */
+    gmx_bool      bFFT;       /* use every frame as restart, computed with FFT */
+    int           nsel;       /* the number of coordinates stored for bFFT */
+    int          *sel;        /* the coordinate index of each stored coordinate */
+    int          *sel_slot;   /* the storage slot of each coordinate, or -1 */
+    int           nblock;     /* the number of allocated frame blocks */
+    rvec        **xblock;     /* stored coordinates, per block of MSD_FFT_BLOCK
+                                 frames, the frames of one coordinate are
+                                 contiguous */
+    rvec         *xcom;       /* center of mass of each stored frame */
 } t_corr;
 
+/* Thread-local work data for the FFT-based MSD calculation */
+typedef struct {
+    real    *x[DIM];          /* the time series of one coordinate */
+    real    *xs;              /* the sum of two dimensions of x */
+    real    *c;               /* FFT in/output */
+    real    *csum, *ctmp;     /* FFT work arrays */
+    double  *acf[DIM];        /* the autocorrelation of each dimension */
+    double  *acfs;            /* the autocorrelation of xs */
+    double  *s1;              /* the square sum term of the MSD */
+    double  *msd;             /* the MSD of one coordinate */
+    double  *sum;             /* the MSD summed over the group */
+    dvec    *sumd;            /* the diagonal tensor elements summed */
+    dvec    *sumo;            /* the yx, zx and zy tensor elements summed */
+    double   wsum;            /* the sum of weights */
+} t_msd_fft;
+
 typedef real t_calc_func (t_corr *, int, atom_id[], int, rvec[], rvec, gmx_bool, matrix,
                           const output_env_t oenv);
 
@@ -111,7 +139,7 @@ static gmx_bool in_data(t_corr *curr, int nx00)
 
 t_corr *init_corr(int nrgrp, int type, int axis, real dim_factor,
                   int nmol, gmx_bool bTen, gmx_bool bMass, real dt, t_topology *top,
-                  real beginfit, real endfit)
+                  real beginfit, real endfit, gmx_bool bFFT)
 {
     t_corr  *curr;
     t_atoms *atoms;
@@ -130,6 +158,7 @@ t_corr *init_corr(int nrgrp, int type, int axis, real dim_factor,
     curr->nframes    = 0;
     curr->nlast      = 0;
     curr->dim_factor = dim_factor;
+    curr->bFFT       = bFFT;
 
     snew(curr->ndata, nrgrp);
     snew(curr->data, nrgrp);
@@ -185,8 +214,16 @@ static void corr_print(t_corr *curr, gmx_bool bTen, const char *fn, const char *
     out = xvgropen(fn, title, output_env_get_xvgr_tlabel(oenv), yaxis, oenv);
     if (DD)
     {
-        fprintf(out, "# MSD gathered over %g %s with %d restarts\n",
-                msdtime, output_env_get_time_unit(oenv), curr->nrestart);
+        if (curr->bFFT)
+        {
+            fprintf(out, "# MSD gathered over %g %s with every frame as restart\n",
+                    msdtime, output_env_get_time_unit(oenv));
+        }
+        else
+        {
+            fprintf(out, "# MSD gathered over %g %s with %d restarts\n",
+                    msdtime, output_env_get_time_unit(oenv), curr->nrestart);
+        }
         fprintf(out, "# Diffusion constants fitted from time %g to %g %s\n",
                 beginfit, endfit, output_env_get_time_unit(oenv));
         for (i = 0; i < curr->ngrp; i++)
@@ -547,6 +584,356 @@ static real calc1_mol(t_corr *curr, int nx, atom_id index[], int nx0, rvec xc[],
     return gtot/nx;
 }
 
+/* select the coordinates to store for the FFT-based msd */
+static void fft_init_sel(t_corr *curr, gmx_bool bMol, int gnx[], atom_id *index[])
+{
+    int i, j, ix;
+
+    snew(curr->sel_slot, curr->ncoords);
+    for (i = 0; i < curr->ncoords; i++)
+    {
+        curr->sel_slot[i] = -1;
+    }
+    curr->nsel = 0;
+    for (j = 0; j < curr->ngrp; j++)
+    {
+        for (i = 0; i < gnx[j]; i++)
+        {
+            ix = bMol ? i : index[j][i];
+            if (curr->sel_slot[ix] < 0)
+            {
+                srenew(curr->sel, curr->nsel+1);
+                curr->sel[curr->nsel] = ix;
+                curr->sel_slot[ix]    = curr->nsel;
+                curr->nsel++;
+            }
+        }
+    }
+    curr->nblock = 0;
+    curr->xblock = NULL;
+    curr->xcom   = NULL;
+}
+
+/* store the current frame for the FFT-based msd */
+static void fft_store_frame(t_corr *curr, rvec xc[], rvec com)
+{
+    int   b, f, s;
+    rvec *xb;
+
+    b = curr->nframes/MSD_FFT_BLOCK;
+    f = curr->nframes - b*MSD_FFT_BLOCK;
+    if (b >= curr->nblock)
+    {
+        curr->nblock++;
+        srenew(curr->xblock, curr->nblock);
+        snew(curr->xblock[b], MSD_FFT_BLOCK*curr->nsel);
+        srenew(curr->xcom, curr->nblock*MSD_FFT_BLOCK);
+    }
+    xb = curr->xblock[b];
+    for (s = 0; s < curr->nsel; s++)
+    {
+        copy_rvec(xc[curr->sel[s]], xb[s*MSD_FFT_BLOCK + f]);
+    }
+    copy_rvec(com, curr->xcom[curr->nframes]);
+}
+
+static void fft_done(t_corr *curr)
+{
+    int b;
+
+    for (b = 0; b < curr->nblock; b++)
+    {
+        sfree(curr->xblock[b]);
+    }
+    sfree(curr->xblock);
+    sfree(curr->xcom);
+    sfree(curr->sel);
+    sfree(curr->sel_slot);
+    curr->nblock = 0;
+}
+
+static void init_msd_fft(t_msd_fft *w, int nframes, int nfour)
+{
+    int d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        snew(w->x[d], nframes);
+        snew(w->acf[d], nframes);
+    }
+    snew(w->xs, nframes);
+    snew(w->acfs, nframes);
+    snew(w->s1, nframes);
+    snew(w->msd, nframes);
+    snew(w->sum, nframes);
+    snew(w->sumd, nframes);
+    snew(w->sumo, nframes);
+    snew(w->c, nfour);
+    snew(w->csum, nfour);
+    snew(w->ctmp, nfour);
+    w->wsum = 0;
+}
+
+static void done_msd_fft(t_msd_fft *w)
+{
+    int d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        sfree(w->x[d]);
+        sfree(w->acf[d]);
+    }
+    sfree(w->xs);
+    sfree(w->acfs);
+    sfree(w->s1);
+    sfree(w->msd);
+    sfree(w->sum);
+    sfree(w->sumd);
+    sfree(w->sumo);
+    sfree(w->c);
+    sfree(w->csum);
+    sfree(w->ctmp);
+}
+
+/* computes the autocorrelation acf[m] = <a(k) a(k+m)>_k using FFT */
+static void msd_fft_acf(t_msd_fft *w, int nframes, int nfour,
+                        const real a[], double acf[])
+{
+    int m;
+
+    for (m = 0; m < nframes; m++)
+    {
+        w->c[m] = a[m];
+    }
+    do_four_core(eacNormal, nfour, nframes, nframes, w->c, w->csum, w->ctmp);
+    for (m = 0; m < nframes; m++)
+    {
+        acf[m] = w->c[m];
+    }
+}
+
+/* computes s1[m] = <a(k+m) b(k+m) + a(k) b(k)>_k with a running sum */
+static void msd_fft_s1(int nframes, const real a[], const real b[], double s1[])
+{
+    int    k, m;
+    double q;
+
+    q = 0;
+    for (k = 0; k < nframes; k++)
+    {
+        q += 2.0*a[k]*b[k];
+    }
+    for (m = 0; m < nframes; m++)
+    {
+        if (m > 0)
+        {
+            q -= (double)a[m-1]*b[m-1] + (double)a[nframes-m]*b[nframes-m];
+        }
+        s1[m] = q/(nframes - m);
+    }
+}
+
+/* computes the msd of one stored coordinate for all time lags,
+ * using every frame as restart, and adds it with weight mm to the sums in w.
+ * The msd is computed as <(r(k+m) - r(k))^2>_k = s1[m] - 2 <r(k) r(k+m)>_k,
+ * where the autocorrelation is computed using FFT.
+ */
+static void calc1_fft(t_corr *curr, t_msd_fft *w, int nfour, int slot, real mm,
+                      gmx_bool bRmCOMM, gmx_bool bTen)
+{
+    int      nframes, b, f, m, d, d2, od;
+    gmx_bool bSel;
+    rvec    *xb;
+    dvec     xav;
+    double   dm;
+
+    nframes = curr->nframes;
+
+    /* Gather the time series. Subtracting the average does not change
+     * the msd, but reduces the loss of precision in the FFT.
+     */
+    clear_dvec(xav);
+    for (f = 0; f < nframes; f++)
+    {
+        b  = f/MSD_FFT_BLOCK;
+        xb = curr->xblock[b] + slot*MSD_FFT_BLOCK;
+        for (d = 0; d < DIM; d++)
+        {
+            w->x[d][f] = xb[f - b*MSD_FFT_BLOCK][d];
+            if (bRmCOMM)
+            {
+                w->x[d][f] -= curr->xcom[f][d];
+            }
+            xav[d] += w->x[d][f];
+        }
+    }
+    for (d = 0; d < DIM; d++)
+    {
+        xav[d] /= nframes;
+        for (f = 0; f < nframes; f++)
+        {
+            w->x[d][f] -= xav[d];
+        }
+    }
+
+    for (m = 0; m < nframes; m++)
+    {
+        w->msd[m] = 0;
+    }
+    for (d = 0; d < DIM; d++)
+    {
+        bSel = ((curr->type == NORMAL) ||
+                (curr->type == LATERAL && d != curr->axis) ||
+                (curr->type == X + d));
+        /* The tensor needs the autocorrelation of all dimensions */
+        if (bSel || bTen)
+        {
+            msd_fft_acf(w, nframes, nfour, w->x[d], w->acf[d]);
+            msd_fft_s1(nframes, w->x[d], w->x[d], w->s1);
+            for (m = 0; m < nframes; m++)
+            {
+                dm = w->s1[m] - 2*w->acf[d][m];
+                if (bSel)
+                {
+                    w->msd[m] += dm;
+                }
+                if (bTen)
+                {
+                    w->sumd[m][d] += mm*dm;
+                }
+            }
+        }
+    }
+    if (bTen)
+    {
+        /* The cross terms <a(k) b(k+m)> + <b(k) a(k+m)> are obtained
+         * from the autocorrelation of a + b, using the autocorrelations
+         * of all dimensions computed above.
+         */
+        od = 0;
+        for (d = 1; d < DIM; d++)
+        {
+            for (d2 = 0; d2 < d; d2++)
+            {
+                for (f = 0; f < nframes; f++)
+                {
+                    w->xs[f] = w->x[d][f] + w->x[d2][f];
+                }
+                msd_fft_acf(w, nframes, nfour, w->xs, w->acfs);
+                msd_fft_s1(nframes, w->x[d], w->x[d2], w->s1);
+                for (m = 0; m < nframes; m++)
+                {
+                    w->sumo[m][od] += mm*(w->s1[m] - (w->acfs[m] - w->acf[d][m] - w->acf[d2][m]));
+                }
+                od++;
+            }
+        }
+    }
+    for (m = 0; m < nframes; m++)
+    {
+        w->sum[m] += mm*w->msd[m];
+    }
+    w->wsum += mm;
+}
+
+/* computes the msd of group nr from the stored frames with FFT,
+ * with the atoms or molecules distributed over the threads
+ */
+static void calc_corr_fft(t_corr *curr, int nr, int nx, atom_id index[],
+                          gmx_bool bMol, gmx_bool bRmCOMM, gmx_bool bTen)
+{
+    int        nthreads, nframes, nfour, t, i, m, d, od;
+    t_msd_fft *work;
+    double     sum, wsum;
+    dvec       sumd, sumo;
+
+    nframes = curr->nframes;
+    nfour   = 1;
+    while (nfour < 2*nframes)
+    {
+        nfour *= 2;
+    }
+
+    nthreads = gmx_omp_get_max_threads();
+    snew(work, nthreads);
+    for (t = 0; t < nthreads; t++)
+    {
+        init_msd_fft(&work[t], nframes, nfour);
+    }
+
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+    for (i = 0; i < nx; i++)
+    {
+        t_msd_fft *w;
+        int        ix, k;
+        real       mm, tt;
+
+        w  = &work[gmx_omp_get_thread_num()];
+        ix = bMol ? i : index[i];
+        mm = (curr->mass != NULL) ? curr->mass[ix] : 1;
+        if (mm == 0)
+        {
+            continue;
+        }
+        calc1_fft(curr, w, nfour, curr->sel_slot[ix], mm, bRmCOMM, bTen);
+        if (bMol)
+        {
+            /* We don't need to normalize as the mass was set to 1 */
+            for (k = 0; k < nframes; k++)
+            {
+                tt = curr->time[k];
+                if (tt >= curr->beginfit && (curr->endfit < 0 || tt <= curr->endfit))
+                {
+                    gmx_stats_add_point(curr->lsq[0][i], tt, w->msd[k], 0, 0);
+                }
+            }
+        }
+    }
+
+    wsum = 0;
+    for (t = 0; t < nthreads; t++)
+    {
+        wsum += work[t].wsum;
+    }
+    for (m = 0; m < nframes; m++)
+    {
+        sum = 0;
+        clear_dvec(sumd);
+        clear_dvec(sumo);
+        for (t = 0; t < nthreads; t++)
+        {
+            sum += work[t].sum[m];
+            dvec_inc(sumd, work[t].sumd[m]);
+            dvec_inc(sumo, work[t].sumo[m]);
+        }
+        curr->data[nr][m]  = sum/wsum;
+        curr->ndata[nr][m] = 1;
+        if (bTen)
+        {
+            clear_mat(curr->datam[nr][m]);
+            od = 0;
+            for (d = 0; d < DIM; d++)
+            {
+                curr->datam[nr][m][d][d] = sumd[d]/wsum;
+                if (d > 0)
+                {
+                    curr->datam[nr][m][d][0] = sumo[od++]/wsum;
+                }
+                if (d > 1)
+                {
+                    curr->datam[nr][m][d][1] = sumo[od++]/wsum;
+                }
+            }
+        }
+    }
+
+    for (t = 0; t < nthreads; t++)
+    {
+        done_msd_fft(&work[t]);
+    }
+    sfree(work);
+}
+
 void printmol(t_corr *curr, const char *fn,
               const char *fn_pdb, int *molindex, t_topology *top,
               rvec *x, int ePBC, matrix box, const output_env_t oenv)
@@ -554,7 +941,7 @@ void printmol(t_corr *curr, const char *fn,
 #define NDIST 100
     FILE       *out;
     gmx_stats_t lsq1;
-    int         i, j;
+    int         i, j, nlsq;
     real        a, b, D, Dav, D2av, VarD, sqrtD, sqrtD_max, scale;
     t_pdbinfo  *pdbinfo = NULL;
     int        *mol2a   = NULL;
@@ -571,12 +958,14 @@ void printmol(t_corr *curr, const char *fn,
         mol2a   = top->mols.index;
     }
 
+    /* With FFT all restarts are collected in a single set */
+    nlsq      = curr->bFFT ? 1 : curr->nrestart;
     Dav       = D2av = 0;
     sqrtD_max = 0;
     for (i = 0; (i < curr->nmol); i++)
     {
         lsq1 = gmx_stats_init();
-        for (j = 0; (j < curr->nrestart); j++)
+        for (j = 0; (j < nlsq); j++)
         {
             real xx, yy, dx, dy;
 
@@ -683,6 +1072,18 @@ int corr_loop(t_corr *curr, const char *fn, t_topology *top, int ePBC,
         xa[1]         = x[1];
     }
 
+    if (curr->bFFT)
+    {
+        fft_init_sel(curr, bMol, gnx, index);
+        curr->nrestart = 1;
+        snew(curr->lsq, 1);
+        snew(curr->lsq[0], curr->nmol);
+        for (i = 0; i < curr->nmol; i++)
+        {
+            curr->lsq[0][i] = gmx_stats_init();
+        }
+    }
+
     bFirst = TRUE;
     t      = curr->t0;
     if (x_pdb)
@@ -716,7 +1117,7 @@ int corr_loop(t_corr *curr, const char *fn, t_topology *top, int ePBC,
 
 
         /* check whether we've reached a restart point */
-        if (bRmod(t, curr->t0, dt))
+        if (!curr->bFFT && bRmod(t, curr->t0, dt))
         {
             curr->nrestart++;
 
@@ -811,12 +1212,20 @@ int corr_loop(t_corr *curr, const char *fn, t_topology *top, int ePBC,
                      &top->atoms, com);
         }
 
-        /* loop over all groups in index file */
-        for (i = 0; (i < curr->ngrp); i++)
+        if (curr->bFFT)
         {
-            /* calculate something useful, like mean square displacements */
-            calc_corr(curr, i, gnx[i], index[i], xa[cur], (gnx_com != NULL), com,
-                      calc1, bTen, oenv);
+            /* store the frame, the msd is computed after reading */
+            fft_store_frame(curr, xa[cur], com);
+        }
+        else
+        {
+            /* loop over all groups in index file */
+            for (i = 0; (i < curr->ngrp); i++)
+            {
+                /* calculate something useful, like mean square displacements */
+                calc_corr(curr, i, gnx[i], index[i], xa[cur], (gnx_com != NULL), com,
+                          calc1, bTen, oenv);
+            }
         }
         cur    = prev;
         t_prev = t;
@@ -824,11 +1233,27 @@ int corr_loop(t_corr *curr, const char *fn, t_topology *top, int ePBC,
         curr->nframes++;
     }
     while (read_next_x(oenv, status, &t, natoms, x[cur], box));
-    fprintf(stderr, "\nUsed %d restart points spaced %g %s over %g %s\n\n",
-            curr->nrestart,
-            output_env_conv_time(oenv, dt), output_env_get_time_unit(oenv),
-            output_env_conv_time(oenv, curr->time[curr->nframes-1]),
-            output_env_get_time_unit(oenv) );
+
+    if (curr->bFFT)
+    {
+        fprintf(stderr, "\nUsing all %d frames as restart points over %g %s\n\n",
+                curr->nframes,
+                output_env_conv_time(oenv, curr->time[curr->nframes-1]),
+                output_env_get_time_unit(oenv) );
+        for (i = 0; (i < curr->ngrp); i++)
+        {
+            calc_corr_fft(curr, i, gnx[i], index[i], bMol, (gnx_com != NULL), bTen);
+        }
+        fft_done(curr);
+    }
+    else
+    {
+        fprintf(stderr, "\nUsed %d restart points spaced %g %s over %g %s\n\n",
+                curr->nrestart,
+                output_env_conv_time(oenv, dt), output_env_get_time_unit(oenv),
+                output_env_conv_time(oenv, curr->time[curr->nframes-1]),
+                output_env_get_time_unit(oenv) );
+    }
 
     if (bMol)
     {
@@ -879,7 +1304,8 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
              int nrgrp, t_topology *top, int ePBC,
              gmx_bool bTen, gmx_bool bMW, gmx_bool bRmCOMM,
              int type, real dim_factor, int axis,
-             real dt, real beginfit, real endfit, const output_env_t oenv)
+             real dt, real beginfit, real endfit, gmx_bool bFFT,
+             const output_env_t oenv)
 {
     t_corr        *msd;
     int           *gnx;   /* the selected groups' sizes */
@@ -917,7 +1343,7 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
 
     msd = init_corr(nrgrp, type, axis, dim_factor,
                     mol_file == NULL ? 0 : gnx[0], bTen, bMW, dt, top,
-                    beginfit, endfit);
+                    beginfit, endfit, bFFT);
 
     nat_trx =
         corr_loop(msd, trx_file, top, ePBC, mol_file ? gnx[0] : 0, gnx, index,
@@ -1034,6 +1460,12 @@ int gmx_msd(int argc, char *argv[])
         "the diffusion constant using the Einstein relation.",
         "The time between the reference points for the MSD calculation",
         "is set with [TT]-trestart[tt].",
+        "With [TT]-fft[tt], every frame is used as a reference point and the",
+        "MSD is computed with FFT autocorrelations, distributed over the",
+        "atoms or molecules with multiple threads. The cost of this scales",
+        "as N log N with the number of frames instead of N times the number",
+        "of reference points, but the coordinates of the selected atoms or",
+        "molecules for all frames are kept in memory.",
         "The diffusion constant is calculated by least squares fitting a",
         "straight line (D*t + c) through the MSD(t) from [TT]-beginfit[tt] to",
         "[TT]-endfit[tt] (note that t is time from the reference positions,",
@@ -1064,6 +1496,7 @@ int gmx_msd(int argc, char *argv[])
         "and when [TT]-endfit[tt]=-1, fitting goes to 90%.",
         "Using this option one also gets an accurate error estimate",
         "based on the statistics between individual molecules.",
+        "With [TT]-fft[tt], all times are weighted equally in these fits.",
         "Note that this diffusion coefficient and error estimate are only",
         "accurate when the MSD is completely linear between",
         "[TT]-beginfit[tt] and [TT]-endfit[tt].[PAR]",
@@ -1082,6 +1515,7 @@ int gmx_msd(int argc, char *argv[])
     static gmx_bool    bTen       = FALSE;
     static gmx_bool    bMW        = TRUE;
     static gmx_bool    bRmCOMM    = FALSE;
+    static gmx_bool    bFFT       = FALSE;
     t_pargs            pa[]       = {
         { "-type",    FALSE, etENUM, {normtype},
           "Compute diffusion coefficient in one direction" },
@@ -1099,6 +1533,8 @@ int gmx_msd(int argc, char *argv[])
           "The frame to use for option [TT]-pdb[tt] (%t)" },
         { "-trestart", FALSE, etTIME, {&dt},
           "Time between restarting points in trajectory (%t)" },
+        { "-fft", FALSE, etBOOL, {&bFFT},
+          "Use every frame as restarting point and compute the MSD with FFT" },
         { "-beginfit", FALSE, etTIME, {&beginfit},
           "Start time for fitting the MSD (%t), -1 is 10%" },
         { "-endfit", FALSE, etTIME, {&endfit},
@@ -1196,7 +1632,7 @@ int gmx_msd(int argc, char *argv[])
 
     do_corr(trx_file, ndx_file, msd_file, mol_file, pdb_file, t_pdb, ngroup,
             &top, ePBC, bTen, bMW, bRmCOMM, type, dim_factor, axis, dt, beginfit, endfit,
-            oenv);
+            bFFT, oenv);
 
     view_all(oenv, NFILE, fnm);
 
@@ -60,6 +60,7 @@
 #include "matio.h"
 #include "gmx_ana.h"
 #include "names.h"
+#include "gmx_omp.h"
 
 static void check_box_c(matrix box)
 {
@@ -173,18 +174,253 @@ static void split_group(int isize, int *index, char *grpname,
     *coi_out = coi;
 }
 
+/* Cell list and per-thread histogram data for the RDF pair loops.
+ *
+ * The positions of the secondary group are sorted into cells and stored
+ * with separate arrays for x, y and z, such that the distances from a
+ * reference position to all positions in a cell can be computed with a
+ * loop that the compiler can vectorize. Cells are only used along
+ * rectangular periodic dimensions with at least three cells of size rmax;
+ * otherwise the dimension has a single cell and all pairs are considered.
+ */
+typedef struct
+{
+    gmx_bool  bRect;         /* Rectangular minimum image in the kernel  */
+    rvec      box;           /* Box diagonal for the minimum image       */
+    rvec      invbox;        /* Inverse box, zero for non-periodic dims  */
+    real      zfac;          /* 0 for xy-RDFs, 1 otherwise               */
+    ivec      ncell;         /* Number of cells along each dimension     */
+    int       ncells;        /* Total number of cells                    */
+    int      *cellstart;     /* Index of the first position in each cell */
+    int       cells_nalloc;
+    int      *cell;          /* Cell of each position in input order     */
+    real     *x[DIM];        /* Cell-sorted coordinates                  */
+    int       nalloc;
+} t_rdf_grid;
+
+typedef struct
+{
+    int     **count;         /* Histograms for each group, nbin+2 bins   */
+    real     *r2;            /* Squared distances for one cell           */
+    int      *bin;           /* Bin index for each distance              */
+} t_rdf_thread;
+
+/* Sets up the grid for the current box. The minimum image convention
+ * in the grid kernel is only applied along the periodic dimensions of
+ * the rectangular pbc set up in pbc. For other pbc types, e.g. triclinic
+ * or screw, or when pbc can not be handled, the kernel uses pbc_dx.
+ */
+static void rdf_grid_set_box(t_rdf_grid *grid, t_pbc *pbc, gmx_bool bPBC,
+                             int ePBCrdf, gmx_bool bXY, matrix box, real rmax2)
+{
+    int  npbcdim, d, d2;
+    real rmax;
+
+    rmax    = sqrt(rmax2);
+    npbcdim = (bPBC ? pbc->ndim_ePBC : 0);
+    if (bPBC)
+    {
+        grid->bRect = ((ePBCrdf == epbcXYZ || ePBCrdf == epbcXY ||
+                        ePBCrdf == epbcNONE) && !pbc->bLimitDistance);
+        for (d = 0; d < npbcdim; d++)
+        {
+            for (d2 = 0; d2 < d; d2++)
+            {
+                if (pbc->box[d][d2] != 0)
+                {
+                    grid->bRect = FALSE;
+                }
+            }
+        }
+    }
+    else
+    {
+        grid->bRect = TRUE;
+    }
+    grid->zfac  = bXY ? 0 : 1;
+    for (d = 0; d < DIM; d++)
+    {
+        grid->box[d]    = (bPBC ? pbc->fbox_diag[d] : box[d][d]);
+        grid->invbox[d] = 0;
+        grid->ncell[d]  = 1;
+        if (grid->bRect && d < npbcdim)
+        {
+            grid->invbox[d] = 1/grid->box[d];
+            grid->ncell[d]  = (int)(grid->box[d]/rmax);
+            if (grid->ncell[d] < 3)
+            {
+                grid->ncell[d] = 1;
+            }
+        }
+    }
+    grid->ncells = grid->ncell[XX]*grid->ncell[YY]*grid->ncell[ZZ];
+    if (grid->ncells + 1 > grid->cells_nalloc)
+    {
+        grid->cells_nalloc = grid->ncells + 1;
+        srenew(grid->cellstart, grid->cells_nalloc);
+    }
+}
+
+static int rdf_grid_cell(const t_rdf_grid *grid, const rvec x, ivec c)
+{
+    int d;
+
+    for (d = 0; d < DIM; d++)
+    {
+        if (grid->ncell[d] > 1)
+        {
+            c[d] = (int)floor(x[d]*grid->invbox[d]*grid->ncell[d]);
+            c[d] = c[d] % grid->ncell[d];
+            if (c[d] < 0)
+            {
+                c[d] += grid->ncell[d];
+            }
+        }
+        else
+        {
+            c[d] = 0;
+        }
+    }
+    return (c[ZZ]*grid->ncell[YY] + c[YY])*grid->ncell[XX] + c[XX];
+}
+
+static void rdf_grid_put(t_rdf_grid *grid, int n, rvec x[])
+{
+    int  i, j, c, d;
+    ivec ci;
+
+    if (n > grid->nalloc)
+    {
+        grid->nalloc = over_alloc_large(n);
+        srenew(grid->cell, grid->nalloc);
+        for (d = 0; d < DIM; d++)
+        {
+            srenew(grid->x[d], grid->nalloc);
+        }
+    }
+    for (c = 0; c <= grid->ncells; c++)
+    {
+        grid->cellstart[c] = 0;
+    }
+    for (i = 0; i < n; i++)
+    {
+        grid->cell[i] = rdf_grid_cell(grid, x[i], ci);
+        grid->cellstart[grid->cell[i] + 1]++;
+    }
+    for (c = 0; c < grid->ncells; c++)
+    {
+        grid->cellstart[c+1] += grid->cellstart[c];
+    }
+    for (i = 0; i < n; i++)
+    {
+        j = grid->cellstart[grid->cell[i]]++;
+        for (d = 0; d < DIM; d++)
+        {
+            grid->x[d][j] = x[i][d];
+        }
+    }
+    for (c = grid->ncells; c > 0; c--)
+    {
+        grid->cellstart[c] = grid->cellstart[c-1];
+    }
+    grid->cellstart[0] = 0;
+}
+
+/* Adds the distances from xi to positions j0 to j1-1 of the grid to the
+ * histogram. Pairs outside (cut2,rmax2] are put in the dummy bin nbin+1.
+ */
+static void rdf_bin_range(const t_rdf_grid *grid, t_pbc *pbc, const rvec xi,
+                          int j0, int j1, real cut2, real rmax2,
+                          real invhbinw, int nbin, t_rdf_thread *th, int *count)
+{
+    const real *gmx_restrict xj = grid->x[XX] + j0;
+    const real *gmx_restrict yj = grid->x[YY] + j0;
+    const real *gmx_restrict zj = grid->x[ZZ] + j0;
+    real       *gmx_restrict r2 = th->r2;
+    int        *gmx_restrict bin = th->bin;
+    int         n = j1 - j0, j;
+    real        dx, dy, dz;
+    rvec        xj_r, dxv;
+
+    if (grid->bRect)
+    {
+        for (j = 0; j < n; j++)
+        {
+            dx    = xi[XX] - xj[j];
+            dy    = xi[YY] - yj[j];
+            dz    = xi[ZZ] - zj[j];
+            dx   -= grid->box[XX]*floor(dx*grid->invbox[XX] + 0.5);
+            dy   -= grid->box[YY]*floor(dy*grid->invbox[YY] + 0.5);
+            dz   -= grid->box[ZZ]*floor(dz*grid->invbox[ZZ] + 0.5);
+            dz   *= grid->zfac;
+            r2[j] = dx*dx + dy*dy + dz*dz;
+        }
+    }
+    else
+    {
+        for (j = 0; j < n; j++)
+        {
+            xj_r[XX] = xj[j];
+            xj_r[YY] = yj[j];
+            xj_r[ZZ] = zj[j];
+            pbc_dx(pbc, xi, xj_r, dxv);
+            dxv[ZZ] *= grid->zfac;
+            r2[j]    = iprod(dxv, dxv);
+        }
+    }
+    for (j = 0; j < n; j++)
+    {
+        bin[j] = (r2[j] > cut2 && r2[j] <= rmax2) ?
+            (int)(sqrt(r2[j])*invhbinw) : nbin + 1;
+    }
+    for (j = 0; j < n; j++)
+    {
+        count[bin[j]]++;
+    }
+}
+
+/* Adds the distances from xi to all positions within rmax in the grid */
+static void rdf_bin_grid(const t_rdf_grid *grid, t_pbc *pbc, const rvec xi,
+                         real cut2, real rmax2, real invhbinw, int nbin,
+                         t_rdf_thread *th, int *count)
+{
+    ivec ci;
+    int  dx, dy, dz, cx, cy, cz, ncx, ncy, ncz, cj;
+
+    rdf_grid_cell(grid, xi, ci);
+    ncx = (grid->ncell[XX] > 1 ? 1 : 0);
+    ncy = (grid->ncell[YY] > 1 ? 1 : 0);
+    ncz = (grid->ncell[ZZ] > 1 ? 1 : 0);
+    for (dz = -ncz; dz <= ncz; dz++)
+    {
+        cz = (ci[ZZ] + dz + grid->ncell[ZZ]) % grid->ncell[ZZ];
+        for (dy = -ncy; dy <= ncy; dy++)
+        {
+            cy = (ci[YY] + dy + grid->ncell[YY]) % grid->ncell[YY];
+            for (dx = -ncx; dx <= ncx; dx++)
+            {
+                cx = (ci[XX] + dx + grid->ncell[XX]) % grid->ncell[XX];
+                cj = (cz*grid->ncell[YY] + cy)*grid->ncell[XX] + cx;
+                rdf_bin_range(grid, pbc, xi,
+                              grid->cellstart[cj], grid->cellstart[cj+1],
+                              cut2, rmax2, invhbinw, nbin, th, count);
+            }
+        }
+    }
+}
+
 static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
                    const char *fnRDF, const char *fnCNRDF, const char *fnHQ,
                    gmx_bool bCM, const char *close,
                    const char **rdft, gmx_bool bXY, gmx_bool bPBC, gmx_bool bNormalize,
-                   real cutoff, real binwidth, real fade, int ng,
+                   real cutoff, real rmax, real binwidth, real fade, int ng,
                    const output_env_t oenv)
 {
     FILE          *fp;
     t_trxstatus   *status;
     char           outf1[STRLEN], outf2[STRLEN];
     char           title[STRLEN], gtitle[STRLEN], refgt[30];
-    int            g, natoms, i, ii, j, k, nbin, j0, j1, n, nframes;
+    int            g, natoms, i, j, k, nbin, j0, j1, n, nframes;
     int          **count;
     char         **grpname;
     int           *isize, isize_cm = 0, nrdf = 0, max_i, isize0, isize_g;
@@ -194,9 +430,9 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
 #else
     double        *sum;
 #endif
-    real           t, rmax2, cut2, r, r2, r2ii, invhbinw, normfac;
+    real           t, rmax2, cut2, r, invhbinw, normfac;
     real           segvol, spherevol, prev_spherevol, **rdf;
-    rvec          *x, dx, *x0 = NULL, *x_i1, xi;
+    rvec          *x, *x0 = NULL, *x_i1;
     real          *inv_segvol, invvol, invvol_sum, rho;
     gmx_bool       bClose, *bExcl, bTop, bNonSelfExcl;
     matrix         box, box_pbc;
@@ -210,6 +446,9 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
     t_pbc          pbc;
     gmx_rmpbc_t    gpbc = NULL;
     int           *is   = NULL, **coi = NULL, cur, mol, i1, res, a;
+    int            nthreads, th, b;
+    t_rdf_thread  *rdfth;
+    t_rdf_grid    *grid;
 
     excl = NULL;
 
@@ -341,6 +580,10 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
     {
         rmax2   = sqr(3*max(box[XX][XX], max(box[YY][YY], box[ZZ][ZZ])));
     }
+    if (rmax > 0 && sqr(rmax) < rmax2)
+    {
+        rmax2 = sqr(rmax);
+    }
     if (debug)
     {
         fprintf(debug, "rmax2 = %g\n", rmax2);
@@ -427,6 +670,24 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
     sfree(bExcl);
 
     snew(x_i1, max_i);
+
+    /* Each thread accumulates its own histograms, with one extra bin
+     * for the pairs outside the range, which are summed at the end.
+     */
+    nthreads = gmx_omp_get_max_threads();
+    snew(rdfth, nthreads);
+    for (th = 0; th < nthreads; th++)
+    {
+        snew(rdfth[th].count, ng);
+        for (g = 0; g < ng; g++)
+        {
+            snew(rdfth[th].count[g], nbin+2);
+        }
+        snew(rdfth[th].r2, max_i+1);
+        snew(rdfth[th].bin, max_i+1);
+    }
+    snew(grid, 1);
+
     nframes    = 0;
     invvol_sum = 0;
     if (bPBC && (NULL != top))
@@ -470,6 +731,8 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
             calc_comg(is[0], coi[0], index[0], rdft[0][6] == 'm', atom, x, x0);
         }
 
+        rdf_grid_set_box(grid, &pbc, bPBC, ePBCrdf, bXY, box, rmax2);
+
         for (g = 0; g < ng; g++)
         {
             if (rdft[0][0] == 'a')
@@ -479,28 +742,34 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
                 {
                     copy_rvec(x[index[g+1][i]], x_i1[i]);
                 }
+                isize_g = isize[g+1];
             }
             else
             {
                 /* Calculate the COMs/COGs and store in x_i1 */
                 calc_comg(is[g+1], coi[g+1], index[g+1], rdft[0][6] == 'm', atom, x, x_i1);
+                isize_g = is[g+1];
+            }
+            if (!bClose)
+            {
+                rdf_grid_put(grid, isize_g, x_i1);
             }
 
+#pragma omp parallel for num_threads(nthreads) schedule(static)
             for (i = 0; i < isize0; i++)
             {
+                t_rdf_thread *rth = &rdfth[gmx_omp_get_thread_num()];
+                int          *cnt = rth->count[g];
+                int           j, ii;
+                atom_id       jx;
+                real          r2, r2ii;
+                rvec          xi, dx;
+
                 if (bClose)
                 {
                     /* Special loop, since we need to determine the minimum distance
                      * over all selected atoms in the reference molecule/residue.
                      */
-                    if (rdft[0][0] == 'a')
-                    {
-                        isize_g = isize[g+1];
-                    }
-                    else
-                    {
-                        isize_g = is[g+1];
-                    }
                     for (j = 0; j < isize_g; j++)
                     {
                         r2 = 1e30;
@@ -530,7 +799,7 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
                         }
                         if (r2 > cut2 && r2 <= rmax2)
                         {
-                            count[g][(int)(sqrt(r2)*invhbinw)]++;
+                            cnt[(int)(sqrt(r2)*invhbinw)]++;
                         }
                     }
                 }
@@ -570,44 +839,15 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
                             }
                             if (r2 > cut2 && r2 <= rmax2)
                             {
-                                count[g][(int)(sqrt(r2)*invhbinw)]++;
+                                cnt[(int)(sqrt(r2)*invhbinw)]++;
                             }
                         }
                     }
                     else
                     {
                         /* Cheaper loop, no exclusions */
-                        if (rdft[0][0] == 'a')
-                        {
-                            isize_g = isize[g+1];
-                        }
-                        else
-                        {
-                            isize_g = is[g+1];
-                        }
-                        for (j = 0; j < isize_g; j++)
-                        {
-                            if (bPBC)
-                            {
-                                pbc_dx(&pbc, xi, x_i1[j], dx);
-                            }
-                            else
-                            {
-                                rvec_sub(xi, x_i1[j], dx);
-                            }
-                            if (bXY)
-                            {
-                                r2 = dx[XX]*dx[XX] + dx[YY]*dx[YY];
-                            }
-                            else
-                            {
-                                r2 = iprod(dx, dx);
-                            }
-                            if (r2 > cut2 && r2 <= rmax2)
-                            {
-                                count[g][(int)(sqrt(r2)*invhbinw)]++;
-                            }
-                        }
+                        rdf_bin_grid(grid, &pbc, xi, cut2, rmax2, invhbinw, nbin,
+                                     rth, cnt);
                     }
                 }
             }
@@ -626,6 +866,30 @@ static void do_rdf(const char *fnNDX, const char *fnTPS, const char *fnTRX,
 
     sfree(x);
 
+    /* Sum the histograms of the threads */
+    for (th = 0; th < nthreads; th++)
+    {
+        for (g = 0; g < ng; g++)
+        {
+            for (b = 0; b <= nbin; b++)
+            {
+                count[g][b] += rdfth[th].count[g][b];
+            }
+            sfree(rdfth[th].count[g]);
+        }
+        sfree(rdfth[th].count);
+        sfree(rdfth[th].r2);
+        sfree(rdfth[th].bin);
+    }
+    sfree(rdfth);
+    sfree(grid->cellstart);
+    sfree(grid->cell);
+    for (i = 0; i < DIM; i++)
+    {
+        sfree(grid->x[i]);
+    }
+    sfree(grid);
+
     /* Average volume */
     invvol = invvol_sum/nframes;
 
@@ -863,10 +1127,15 @@ int gmx_rdf(int argc, char *argv[])
         "Note that all atoms in the selected groups are used, also the ones",
         "that don't have Lennard-Jones interactions.[PAR]",
         "Option [TT]-cn[tt] produces the cumulative number RDF,",
-        "i.e. the average number of particles within a distance r.[PAR]"
+        "i.e. the average number of particles within a distance r.[PAR]",
+        "Option [TT]-rmax[tt] limits the range of the RDF. For large systems,",
+        "a short range makes the calculation much faster, because then only",
+        "the pairs in neighboring cells of a cell list are considered.",
+        "The pair loops are parallelized with OpenMP over the reference",
+        "positions."
     };
     static gmx_bool    bCM     = FALSE, bXY = FALSE, bPBC = TRUE, bNormalize = TRUE;
-    static real        cutoff  = 0, binwidth = 0.002, fade = 0.0;
+    static real        cutoff  = 0, rmax = 0, binwidth = 0.002, fade = 0.0;
     static int         ngroups = 1;
 
     static const char *closet[] = { NULL, "no", "mol", "res", NULL };
@@ -889,6 +1158,8 @@ int gmx_rdf(int argc, char *argv[])
           "Use only the x and y components of the distance" },
         { "-cut",      FALSE, etREAL, {&cutoff},
           "Shortest distance (nm) to be considered"},
+        { "-rmax",     FALSE, etREAL, {&rmax},
+          "Largest distance (nm) to be considered, 0 means the largest distance allowed by the box" },
         { "-ng",       FALSE, etINT, {&ngroups},
           "Number of secondary groups to compute RDFs around a central group" },
         { "-fade",     FALSE, etREAL, {&fade},
@@ -942,7 +1213,7 @@ int gmx_rdf(int argc, char *argv[])
     do_rdf(fnNDX, fnTPS, ftp2fn(efTRX, NFILE, fnm),
            opt2fn("-o", NFILE, fnm), opt2fn_null("-cn", NFILE, fnm),
            opt2fn_null("-hq", NFILE, fnm),
-           bCM, closet[0], rdft, bXY, bPBC, bNormalize, cutoff, binwidth, fade, ngroups,
+           bCM, closet[0], rdft, bXY, bPBC, bNormalize, cutoff, rmax, binwidth, fade, ngroups,
            oenv);
 
     thanx(stderr);
@@ -505,11 +505,11 @@ void do_trunc(const char *fn, real t0)
         while (!bStop && fread_trnheader(in, &sh, &bOK))
         {
             fread_htrn(in, &sh, NULL, NULL, NULL, NULL);
-            fpos = gmx_ftell(fp);
+            fpos = gmx_fio_ftell(in);
             t    = sh.t;
             if (t >= t0)
             {
-                gmx_fseek(fp, fpos, SEEK_SET);
+                gmx_fio_seek(in, fpos);
                 bStop = TRUE;
             }
         }
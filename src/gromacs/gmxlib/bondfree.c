@@ -55,12 +55,30 @@
 #include "orires.h"
 #include "force.h"
 #include "nonbonded.h"
+#include "nrnb.h"
 
 #if !defined GMX_DOUBLE && defined GMX_X86_SSE2
 #include "gmx_x86_simd_single.h"
 #define SSE_PROPER_DIHEDRALS
 #endif
 
+#ifdef GMX_X86_SSE2
+#define BONDED_SIMD
+#include "gmx_simd_widest.h"
+
+/* SIMD inner-product of GMX_SIMD_WIDTH_HERE vectors */
+#define gmx_iprod_pr(ax, ay, az, bx, by, bz)                           \
+    gmx_add_pr(gmx_add_pr(gmx_mul_pr(ax, bx), gmx_mul_pr(ay, by)), gmx_mul_pr(az, bz))
+
+/* SIMD cross-product of GMX_SIMD_WIDTH_HERE vectors */
+#define gmx_cprod_pr(ax, ay, az, bx, by, bz, cx, cy, cz)            \
+    {                                                               \
+        cx = gmx_sub_pr(gmx_mul_pr(ay, bz), gmx_mul_pr(az, by));    \
+        cy = gmx_sub_pr(gmx_mul_pr(az, bx), gmx_mul_pr(ax, bz));    \
+        cz = gmx_sub_pr(gmx_mul_pr(ax, by), gmx_mul_pr(ay, bx));    \
+    }
+#endif
+
 /* Find a better place for this? */
 const int cmap_coeff_matrix[] = {
     1, 0, -3,  2, 0, 0,  0,  0, -3,  0,  9, -6,  2,  0, -6,  4,
@@ -419,6 +437,85 @@ real bonds(int nbonds,
     return vtot;
 }
 
+/* As bonds above, but without energies, shift forces and perturbation */
+void bonds_noener(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[], const t_pbc *pbc)
+{
+#ifdef BONDED_SIMD
+    const int  nfa1 = 3;
+    int        i, iu, s, m, type;
+    int        ai[GMX_SIMD_WIDTH_HERE], aj[GMX_SIMD_WIDTH_HERE];
+    rvec       dx;
+    real       buf_array[5*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    gmx_mm_pr  dx_S[DIM], dr2_S, invdr_S, dr_S, fbond_S;
+    gmx_mm_pr  min_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    min_S = gmx_set1_pr(GMX_REAL_MIN);
+
+    for (i = 0; i < nbonds; i += GMX_SIMD_WIDTH_HERE*nfa1)
+    {
+        /* Collect the distance vectors and parameters of a batch */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            pbc_rvec_sub(pbc, x[ai[s]], x[aj[s]], dx);
+            for (m = 0; m < DIM; m++)
+            {
+                buf[m*GMX_SIMD_WIDTH_HERE+s] = dx[m];
+            }
+            buf[3*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].harmonic.krA;
+            buf[4*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].harmonic.rA;
+            /* At the end fill the batch with copies of the last bond */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        for (m = 0; m < DIM; m++)
+        {
+            dx_S[m] = gmx_load_pr(buf+m*GMX_SIMD_WIDTH_HERE);
+        }
+        /* Avoid division by zero, the force is zero anyhow with dx=0 */
+        dr2_S   = gmx_max_pr(gmx_calc_rsq_pr(dx_S[XX], dx_S[YY], dx_S[ZZ]), min_S);
+        invdr_S = gmx_invsqrt_pr(dr2_S);
+        dr_S    = gmx_mul_pr(dr2_S, invdr_S);
+
+        /* fbond = -k*(dr - b0)/dr */
+        fbond_S = gmx_mul_pr(gmx_mul_pr(gmx_load_pr(buf+3*GMX_SIMD_WIDTH_HERE),
+                                        gmx_sub_pr(gmx_load_pr(buf+4*GMX_SIMD_WIDTH_HERE), dr_S)),
+                             invdr_S);
+
+        for (m = 0; m < DIM; m++)
+        {
+            gmx_store_pr(buf+m*GMX_SIMD_WIDTH_HERE, gmx_mul_pr(fbond_S, dx_S[m]));
+        }
+
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE && i + s*nfa1 < nbonds; s++)
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += buf[m*GMX_SIMD_WIDTH_HERE+s];
+                f[aj[s]][m] -= buf[m*GMX_SIMD_WIDTH_HERE+s];
+            }
+        }
+    }
+#else
+    rvec fshift[SHIFTS];
+    real dvdl = 0;
+
+    clear_rvecs(SHIFTS, fshift);
+    bonds(nbonds, forceatoms, forceparams, x, f, fshift, pbc, NULL,
+          0, &dvdl, NULL, NULL, NULL);
+#endif
+}
+
 real restraint_bonds(int nbonds,
                      const t_iatom forceatoms[], const t_iparams forceparams[],
                      const rvec x[], rvec f[], rvec fshift[],
@@ -956,6 +1053,148 @@ real angles(int nbonds,
     return vtot;
 }
 
+#ifdef BONDED_SIMD
+/* Computes the harmonic angle forces f_i and f_k, f_j = -f_i - f_k,
+ * for a batch of angles. The input buffer contains r_ij, r_kj, k_theta
+ * and theta0 for each lane. On output buf contains f_i and f_k.
+ */
+static void angles_simd_force(real *buf,
+                              gmx_mm_pr *rij_S, gmx_mm_pr *rkj_S,
+                              gmx_mm_pr *fi_S, gmx_mm_pr *fk_S)
+{
+    int        m;
+    gmx_mm_pr  one_S, min_S;
+    gmx_mm_pr  nrij2_S, nrkj2_S, nrij_1_S, nrkj_1_S;
+    gmx_mm_pr  cos_S, cos2_S, theta_S, dVdt_S, st_S, sth_S;
+    gmx_mm_pr  cik_S, cii_S, ckk_S;
+
+    one_S = gmx_set1_pr(1.0);
+    min_S = gmx_set1_pr(GMX_REAL_MIN);
+
+    for (m = 0; m < DIM; m++)
+    {
+        rij_S[m] = gmx_load_pr(buf+m*GMX_SIMD_WIDTH_HERE);
+        rkj_S[m] = gmx_load_pr(buf+(DIM+m)*GMX_SIMD_WIDTH_HERE);
+    }
+
+    nrij2_S  = gmx_max_pr(gmx_calc_rsq_pr(rij_S[XX], rij_S[YY], rij_S[ZZ]), min_S);
+    nrkj2_S  = gmx_max_pr(gmx_calc_rsq_pr(rkj_S[XX], rkj_S[YY], rkj_S[ZZ]), min_S);
+    nrij_1_S = gmx_invsqrt_pr(nrij2_S);
+    nrkj_1_S = gmx_invsqrt_pr(nrkj2_S);
+
+    cos_S    = gmx_mul_pr(gmx_iprod_pr(rij_S[XX], rij_S[YY], rij_S[ZZ],
+                                       rkj_S[XX], rkj_S[YY], rkj_S[ZZ]),
+                          gmx_mul_pr(nrij_1_S, nrkj_1_S));
+    cos_S    = gmx_max_pr(gmx_min_pr(cos_S, one_S), gmx_sub_pr(gmx_setzero_pr(), one_S));
+    theta_S  = gmx_acos_pr(cos_S);
+
+    /* dV/dtheta = -k*(theta - theta0) */
+    dVdt_S   = gmx_mul_pr(gmx_load_pr(buf+2*DIM*GMX_SIMD_WIDTH_HERE),
+                          gmx_sub_pr(gmx_load_pr(buf+(2*DIM+1)*GMX_SIMD_WIDTH_HERE), theta_S));
+
+    /* As in the plain C code, there is no force for linear angles */
+    cos2_S   = gmx_mul_pr(cos_S, cos_S);
+    st_S     = gmx_mul_pr(dVdt_S, gmx_invsqrt_pr(gmx_max_pr(gmx_sub_pr(one_S, cos2_S), min_S)));
+    st_S     = gmx_and_pr(gmx_cmplt_pr(cos2_S, one_S), st_S);
+    sth_S    = gmx_mul_pr(st_S, cos_S);
+
+    cik_S    = gmx_mul_pr(st_S, gmx_mul_pr(nrij_1_S, nrkj_1_S));
+    cii_S    = gmx_mul_pr(sth_S, gmx_mul_pr(nrij_1_S, nrij_1_S));
+    ckk_S    = gmx_mul_pr(sth_S, gmx_mul_pr(nrkj_1_S, nrkj_1_S));
+
+    for (m = 0; m < DIM; m++)
+    {
+        fi_S[m] = gmx_sub_pr(gmx_mul_pr(cii_S, rij_S[m]), gmx_mul_pr(cik_S, rkj_S[m]));
+        fk_S[m] = gmx_sub_pr(gmx_mul_pr(ckk_S, rkj_S[m]), gmx_mul_pr(cik_S, rij_S[m]));
+    }
+}
+
+/* Adds the forces f_i, f_k and f_j = -f_i - f_k stored in buf
+ * for the angles in a batch.
+ */
+static void angles_simd_add_forces(int nlane, const real *buf,
+                                   const int *ai, const int *aj, const int *ak,
+                                   rvec f[])
+{
+    int  s, m;
+    real fi, fk;
+
+    for (s = 0; s < nlane; s++)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            fi           = buf[m*GMX_SIMD_WIDTH_HERE+s];
+            fk           = buf[(DIM+m)*GMX_SIMD_WIDTH_HERE+s];
+            f[ai[s]][m] += fi;
+            f[aj[s]][m] -= fi + fk;
+            f[ak[s]][m] += fk;
+        }
+    }
+}
+#endif
+
+/* As angles above, but without energies, shift forces and perturbation */
+void angles_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[], const t_pbc *pbc)
+{
+#ifdef BONDED_SIMD
+    const int  nfa1 = 4;
+    int        i, iu, s, m, type;
+    int        ai[GMX_SIMD_WIDTH_HERE], aj[GMX_SIMD_WIDTH_HERE], ak[GMX_SIMD_WIDTH_HERE];
+    rvec       r_ij, r_kj;
+    real       buf_array[8*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    gmx_mm_pr  rij_S[DIM], rkj_S[DIM], fi_S[DIM], fk_S[DIM];
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (i = 0; i < nbonds; i += GMX_SIMD_WIDTH_HERE*nfa1)
+    {
+        /* Collect the bond vectors and parameters of a batch */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            pbc_rvec_sub(pbc, x[ai[s]], x[aj[s]], r_ij);
+            pbc_rvec_sub(pbc, x[ak[s]], x[aj[s]], r_kj);
+            for (m = 0; m < DIM; m++)
+            {
+                buf[m*GMX_SIMD_WIDTH_HERE+s]       = r_ij[m];
+                buf[(DIM+m)*GMX_SIMD_WIDTH_HERE+s] = r_kj[m];
+            }
+            buf[2*DIM*GMX_SIMD_WIDTH_HERE+s]     = forceparams[type].harmonic.krA;
+            buf[(2*DIM+1)*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].harmonic.rA*DEG2RAD;
+            /* At the end fill the batch with copies of the last angle */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        angles_simd_force(buf, rij_S, rkj_S, fi_S, fk_S);
+
+        for (m = 0; m < DIM; m++)
+        {
+            gmx_store_pr(buf+m*GMX_SIMD_WIDTH_HERE, fi_S[m]);
+            gmx_store_pr(buf+(DIM+m)*GMX_SIMD_WIDTH_HERE, fk_S[m]);
+        }
+
+        angles_simd_add_forces(min(GMX_SIMD_WIDTH_HERE, (nbonds - i)/nfa1),
+                               buf, ai, aj, ak, f);
+    }
+#else
+    rvec fshift[SHIFTS];
+    real dvdl = 0;
+
+    clear_rvecs(SHIFTS, fshift);
+    angles(nbonds, forceatoms, forceparams, x, f, fshift, pbc, NULL,
+           0, &dvdl, NULL, NULL, NULL);
+#endif
+}
+
 real linear_angles(int nbonds,
                    const t_iatom forceatoms[], const t_iparams forceparams[],
                    const rvec x[], rvec f[], rvec fshift[],
@@ -1141,6 +1380,91 @@ real urey_bradley(int nbonds,
     return vtot;
 }
 
+/* As urey_bradley above, but without energies, shift forces and perturbation */
+void urey_bradley_noener(int nbonds,
+                         const t_iatom forceatoms[], const t_iparams forceparams[],
+                         const rvec x[], rvec f[], const t_pbc *pbc)
+{
+#ifdef BONDED_SIMD
+    const int  nfa1 = 4;
+    int        i, iu, s, m, type;
+    int        ai[GMX_SIMD_WIDTH_HERE], aj[GMX_SIMD_WIDTH_HERE], ak[GMX_SIMD_WIDTH_HERE];
+    rvec       r_ij, r_kj, r_ik;
+    real       buf_array[13*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    gmx_mm_pr  rij_S[DIM], rkj_S[DIM], rik_S[DIM], fi_S[DIM], fk_S[DIM];
+    gmx_mm_pr  dr2_S, invdr_S, dr_S, fbond_S, fik_S;
+    gmx_mm_pr  min_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    min_S = gmx_set1_pr(GMX_REAL_MIN);
+
+    for (i = 0; i < nbonds; i += GMX_SIMD_WIDTH_HERE*nfa1)
+    {
+        /* Collect the bond vectors and parameters of a batch,
+         * the angle part uses the same layout as in angles_noener.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            pbc_rvec_sub(pbc, x[ai[s]], x[aj[s]], r_ij);
+            pbc_rvec_sub(pbc, x[ak[s]], x[aj[s]], r_kj);
+            pbc_rvec_sub(pbc, x[ai[s]], x[ak[s]], r_ik);
+            for (m = 0; m < DIM; m++)
+            {
+                buf[m*GMX_SIMD_WIDTH_HERE+s]           = r_ij[m];
+                buf[(DIM+m)*GMX_SIMD_WIDTH_HERE+s]     = r_kj[m];
+                buf[(2*DIM+2+m)*GMX_SIMD_WIDTH_HERE+s] = r_ik[m];
+            }
+            buf[2*DIM*GMX_SIMD_WIDTH_HERE+s]     = forceparams[type].u_b.kthetaA;
+            buf[(2*DIM+1)*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].u_b.thetaA*DEG2RAD;
+            buf[(3*DIM+2)*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].u_b.kUBA;
+            buf[(3*DIM+3)*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].u_b.r13A;
+            /* At the end fill the batch with copies of the last angle */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        angles_simd_force(buf, rij_S, rkj_S, fi_S, fk_S);
+
+        /* The Urey-Bradley bond between atoms i and k */
+        for (m = 0; m < DIM; m++)
+        {
+            rik_S[m] = gmx_load_pr(buf+(2*DIM+2+m)*GMX_SIMD_WIDTH_HERE);
+        }
+        dr2_S   = gmx_max_pr(gmx_calc_rsq_pr(rik_S[XX], rik_S[YY], rik_S[ZZ]), min_S);
+        invdr_S = gmx_invsqrt_pr(dr2_S);
+        dr_S    = gmx_mul_pr(dr2_S, invdr_S);
+        fbond_S = gmx_mul_pr(gmx_mul_pr(gmx_load_pr(buf+(3*DIM+2)*GMX_SIMD_WIDTH_HERE),
+                                        gmx_sub_pr(gmx_load_pr(buf+(3*DIM+3)*GMX_SIMD_WIDTH_HERE), dr_S)),
+                             invdr_S);
+
+        for (m = 0; m < DIM; m++)
+        {
+            fik_S = gmx_mul_pr(fbond_S, rik_S[m]);
+            gmx_store_pr(buf+m*GMX_SIMD_WIDTH_HERE, gmx_add_pr(fi_S[m], fik_S));
+            gmx_store_pr(buf+(DIM+m)*GMX_SIMD_WIDTH_HERE, gmx_sub_pr(fk_S[m], fik_S));
+        }
+
+        angles_simd_add_forces(min(GMX_SIMD_WIDTH_HERE, (nbonds - i)/nfa1),
+                               buf, ai, aj, ak, f);
+    }
+#else
+    rvec fshift[SHIFTS];
+    real dvdl = 0;
+
+    clear_rvecs(SHIFTS, fshift);
+    urey_bradley(nbonds, forceatoms, forceparams, x, f, fshift, pbc, NULL,
+                 0, &dvdl, NULL, NULL, NULL);
+#endif
+}
+
 real quartic_angles(int nbonds,
                     const t_iatom forceatoms[], const t_iparams forceparams[],
                     const rvec x[], rvec f[], rvec fshift[],
@@ -2505,6 +2829,171 @@ real rbdihs(int nbonds,
     return vtot;
 }
 
+/* As rbdihs above, but without energies, shift forces and perturbation */
+void rbdihs_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[], const t_pbc *pbc)
+{
+#ifdef BONDED_SIMD
+    const int  nfa1 = 5;
+    int        i, iu, s, m, j, type;
+    int        ai[GMX_SIMD_WIDTH_HERE], aj[GMX_SIMD_WIDTH_HERE];
+    int        ak[GMX_SIMD_WIDTH_HERE], al[GMX_SIMD_WIDTH_HERE];
+    rvec       r_ij, r_kj, r_kl;
+    real       buf_array[14*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    gmx_mm_pr  rij_S[DIM], rkj_S[DIM], rkl_S[DIM];
+    gmx_mm_pr  m_S[DIM], n_S[DIM], c_S[DIM];
+    gmx_mm_pr  fi_S[DIM], fl_S[DIM], svec_S;
+    gmx_mm_pr  one_S, min_S, eps_S;
+    gmx_mm_pr  iprm_S, iprn_S, invm_S, invn_S, cn2_S;
+    gmx_mm_pr  cos_S, sin_S, sign_S, ddV_S, ddphi_S;
+    gmx_mm_pr  nrkj2_S, nrkj_1_S, nrkj_S, nrkj_2_S, a_S, b_S, p_S, q_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    one_S = gmx_set1_pr(1.0);
+    min_S = gmx_set1_pr(GMX_REAL_MIN);
+    eps_S = gmx_set1_pr(GMX_REAL_EPS);
+
+    for (i = 0; i < nbonds; i += GMX_SIMD_WIDTH_HERE*nfa1)
+    {
+        /* Collect the bond vectors and parameters of a batch */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+            pbc_rvec_sub(pbc, x[ai[s]], x[aj[s]], r_ij);
+            pbc_rvec_sub(pbc, x[ak[s]], x[aj[s]], r_kj);
+            pbc_rvec_sub(pbc, x[ak[s]], x[al[s]], r_kl);
+            for (m = 0; m < DIM; m++)
+            {
+                buf[m*GMX_SIMD_WIDTH_HERE+s]         = r_ij[m];
+                buf[(DIM+m)*GMX_SIMD_WIDTH_HERE+s]   = r_kj[m];
+                buf[(2*DIM+m)*GMX_SIMD_WIDTH_HERE+s] = r_kl[m];
+            }
+            /* The constant term does not contribute to the force */
+            for (j = 1; j < NR_RBDIHS; j++)
+            {
+                buf[(3*DIM+j-1)*GMX_SIMD_WIDTH_HERE+s] = forceparams[type].rbdihs.rbcA[j];
+            }
+            /* At the end fill the batch with copies of the last dihedral */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        for (m = 0; m < DIM; m++)
+        {
+            rij_S[m] = gmx_load_pr(buf+m*GMX_SIMD_WIDTH_HERE);
+            rkj_S[m] = gmx_load_pr(buf+(DIM+m)*GMX_SIMD_WIDTH_HERE);
+            rkl_S[m] = gmx_load_pr(buf+(2*DIM+m)*GMX_SIMD_WIDTH_HERE);
+        }
+
+        gmx_cprod_pr(rij_S[XX], rij_S[YY], rij_S[ZZ],
+                     rkj_S[XX], rkj_S[YY], rkj_S[ZZ],
+                     m_S[XX], m_S[YY], m_S[ZZ]);
+        gmx_cprod_pr(rkj_S[XX], rkj_S[YY], rkj_S[ZZ],
+                     rkl_S[XX], rkl_S[YY], rkl_S[ZZ],
+                     n_S[XX], n_S[YY], n_S[ZZ]);
+        gmx_cprod_pr(m_S[XX], m_S[YY], m_S[ZZ],
+                     n_S[XX], n_S[YY], n_S[ZZ],
+                     c_S[XX], c_S[YY], c_S[ZZ]);
+
+        /* Avoid division by zero. When zero, the force is set to zero
+         * by the tolerance check below, as in do_dih_fup.
+         */
+        iprm_S  = gmx_max_pr(gmx_calc_rsq_pr(m_S[XX], m_S[YY], m_S[ZZ]), min_S);
+        iprn_S  = gmx_max_pr(gmx_calc_rsq_pr(n_S[XX], n_S[YY], n_S[ZZ]), min_S);
+        invm_S  = gmx_invsqrt_pr(iprm_S);
+        invn_S  = gmx_invsqrt_pr(iprn_S);
+
+        /* cos(phi) = m.n/(|m||n|), sin(phi) = sign*|m x n|/(|m||n|),
+         * with the sign of phi given by the sign of r_ij.n as in dih_angle.
+         */
+        cos_S   = gmx_mul_pr(gmx_iprod_pr(m_S[XX], m_S[YY], m_S[ZZ],
+                                          n_S[XX], n_S[YY], n_S[ZZ]),
+                             gmx_mul_pr(invm_S, invn_S));
+        cn2_S   = gmx_calc_rsq_pr(c_S[XX], c_S[YY], c_S[ZZ]);
+        sin_S   = gmx_mul_pr(gmx_mul_pr(cn2_S, gmx_invsqrt_pr(gmx_max_pr(cn2_S, min_S))),
+                             gmx_mul_pr(invm_S, invn_S));
+        sign_S  = gmx_cmplt_pr(gmx_iprod_pr(rij_S[XX], rij_S[YY], rij_S[ZZ],
+                                            n_S[XX], n_S[YY], n_S[ZZ]),
+                               gmx_setzero_pr());
+        sin_S   = gmx_or_pr(gmx_and_pr(sign_S, gmx_sub_pr(gmx_setzero_pr(), sin_S)),
+                            gmx_andnot_pr(sign_S, sin_S));
+
+        /* In the polymer convention psi = phi - 180, so cos(psi) = -cos(phi)
+         * and dV/dphi = -dV/dcos(psi)*sin(psi) = dV/dcos(psi)*sin(phi).
+         */
+        cos_S   = gmx_sub_pr(gmx_setzero_pr(), cos_S);
+        ddV_S   = gmx_mul_pr(gmx_set1_pr(5.0), gmx_load_pr(buf+(3*DIM+4)*GMX_SIMD_WIDTH_HERE));
+        for (j = NR_RBDIHS - 2; j >= 1; j--)
+        {
+            ddV_S = gmx_add_pr(gmx_mul_pr(ddV_S, cos_S),
+                               gmx_mul_pr(gmx_set1_pr(j),
+                                          gmx_load_pr(buf+(3*DIM+j-1)*GMX_SIMD_WIDTH_HERE)));
+        }
+        ddphi_S = gmx_mul_pr(ddV_S, sin_S);
+
+        /* The force distribution of do_dih_fup */
+        nrkj2_S  = gmx_max_pr(gmx_calc_rsq_pr(rkj_S[XX], rkj_S[YY], rkj_S[ZZ]), min_S);
+        ddphi_S  = gmx_and_pr(gmx_and_pr(gmx_cmplt_pr(gmx_mul_pr(nrkj2_S, eps_S), iprm_S),
+                                         gmx_cmplt_pr(gmx_mul_pr(nrkj2_S, eps_S), iprn_S)),
+                              ddphi_S);
+        nrkj_1_S = gmx_invsqrt_pr(nrkj2_S);
+        nrkj_2_S = gmx_mul_pr(nrkj_1_S, nrkj_1_S);
+        nrkj_S   = gmx_mul_pr(nrkj2_S, nrkj_1_S);
+        a_S      = gmx_mul_pr(gmx_sub_pr(gmx_setzero_pr(), ddphi_S),
+                              gmx_mul_pr(nrkj_S, gmx_mul_pr(invm_S, invm_S)));
+        b_S      = gmx_mul_pr(ddphi_S,
+                              gmx_mul_pr(nrkj_S, gmx_mul_pr(invn_S, invn_S)));
+        p_S      = gmx_mul_pr(gmx_iprod_pr(rij_S[XX], rij_S[YY], rij_S[ZZ],
+                                           rkj_S[XX], rkj_S[YY], rkj_S[ZZ]),
+                              nrkj_2_S);
+        q_S      = gmx_mul_pr(gmx_iprod_pr(rkl_S[XX], rkl_S[YY], rkl_S[ZZ],
+                                           rkj_S[XX], rkj_S[YY], rkj_S[ZZ]),
+                              nrkj_2_S);
+
+        /* Store f_i, f_j, f_k and f_l, which are added to f[i], -f[j],
+         * -f[k] and f[l].
+         */
+        for (m = 0; m < DIM; m++)
+        {
+            fi_S[m] = gmx_mul_pr(a_S, m_S[m]);
+            fl_S[m] = gmx_mul_pr(b_S, n_S[m]);
+            svec_S  = gmx_sub_pr(gmx_mul_pr(p_S, fi_S[m]), gmx_mul_pr(q_S, fl_S[m]));
+            gmx_store_pr(buf+m*GMX_SIMD_WIDTH_HERE, fi_S[m]);
+            gmx_store_pr(buf+(DIM+m)*GMX_SIMD_WIDTH_HERE, gmx_sub_pr(fi_S[m], svec_S));
+            gmx_store_pr(buf+(2*DIM+m)*GMX_SIMD_WIDTH_HERE, gmx_add_pr(fl_S[m], svec_S));
+            gmx_store_pr(buf+(3*DIM+m)*GMX_SIMD_WIDTH_HERE, fl_S[m]);
+        }
+
+        for (s = 0; s < GMX_SIMD_WIDTH_HERE && i + s*nfa1 < nbonds; s++)
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += buf[m*GMX_SIMD_WIDTH_HERE+s];
+                f[aj[s]][m] -= buf[(DIM+m)*GMX_SIMD_WIDTH_HERE+s];
+                f[ak[s]][m] -= buf[(2*DIM+m)*GMX_SIMD_WIDTH_HERE+s];
+                f[al[s]][m] += buf[(3*DIM+m)*GMX_SIMD_WIDTH_HERE+s];
+            }
+        }
+    }
+#else
+    rvec fshift[SHIFTS];
+    real dvdl = 0;
+
+    clear_rvecs(SHIFTS, fshift);
+    rbdihs(nbonds, forceatoms, forceparams, x, f, fshift, pbc, NULL,
+           0, &dvdl, NULL, NULL, NULL);
+#endif
+}
+
 int cmap_setup_grid_index(int ip, int grid_spacing, int *ipm1, int *ipp1, int *ipp2)
 {
     int im1, ip1, ip2;
@@ -3519,39 +4008,164 @@ real tab_dihs(int nbonds,
     return vtot;
 }
 
+/* Returns whether ftype is a bonded potential computed by calc_bonds */
+static gmx_bool ftype_is_bonded_potential(int ftype)
+{
+    return (interaction_function[ftype].flags & IF_BOND) &&
+           !(ftype == F_CONNBONDS || ftype == F_POSRES) &&
+           (ftype < F_GB12 || ftype > F_GB14);
+}
+
+/* Divides the bonded interactions over the threads, balancing the cost
+ * estimated from the flop counts. Types with many interactions are
+ * divided in equal parts, in multiples of the SIMD batch size.
+ * Types with few interactions are assigned as a whole, most expensive
+ * first, to the thread with the lowest load; this avoids partial SIMD
+ * batches and reduces the number of force blocks a thread touches.
+ * As the even division loads all threads equally, ties go to thread 0,
+ * which does not need a force buffer reduction.
+ */
+static void divide_bondeds_over_threads(t_forcerec *fr, const t_idef *idef)
+{
+    int     nt, batch, ftype, nat1, nb, ind, t, tmin, nsmall, i, j;
+    int    *div;
+    int     small[F_NRE];
+    double  cost[F_NRE], *load;
+
+    nt = fr->nthreads;
+
+    if (fr->il_thread_division == NULL)
+    {
+        snew(fr->il_thread_division, F_NRE*(nt+1));
+    }
+    snew(load, nt);
+
+#ifdef BONDED_SIMD
+    batch = GMX_SIMD_WIDTH_HERE;
+#else
+    batch = 1;
+#endif
+
+    nsmall = 0;
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        div  = fr->il_thread_division + ftype*(nt+1);
+        nat1 = interaction_function[ftype].nratoms + 1;
+        nb   = 0;
+        if (ftype_is_bonded_potential(ftype))
+        {
+            nb = idef->il[ftype].nr/nat1;
+        }
+        ind         = interaction_function[ftype].nrnb_ind;
+        cost[ftype] = (ind != -1 ? max(cost_nrnb(ind), 1) : 1);
+
+        if (nb > 0 && nb < nt*batch)
+        {
+            small[nsmall++] = ftype;
+        }
+        else
+        {
+            for (t = 0; t < nt; t++)
+            {
+                div[t] = (((nb*t)/nt)/batch)*batch*nat1;
+            }
+            div[nt] = nb*nat1;
+            for (t = 0; t < nt; t++)
+            {
+                load[t] += cost[ftype]*(div[t+1] - div[t])/nat1;
+            }
+        }
+        cost[ftype] *= nb;
+    }
+
+    /* Sort the small types on decreasing cost */
+    for (i = 1; i < nsmall; i++)
+    {
+        ftype = small[i];
+        for (j = i; j > 0 && cost[small[j-1]] < cost[ftype]; j--)
+        {
+            small[j] = small[j-1];
+        }
+        small[j] = ftype;
+    }
+
+    for (i = 0; i < nsmall; i++)
+    {
+        ftype = small[i];
+        div   = fr->il_thread_division + ftype*(nt+1);
+        nat1  = interaction_function[ftype].nratoms + 1;
+
+        tmin = 0;
+        for (t = 1; t < nt; t++)
+        {
+            if (load[t] < load[tmin])
+            {
+                tmin = t;
+            }
+        }
+        for (t = 0; t <= nt; t++)
+        {
+            div[t] = (t <= tmin ? 0 : idef->il[ftype].nr);
+        }
+        load[tmin] += cost[ftype];
+    }
+
+    if (debug)
+    {
+        for (t = 0; t < nt; t++)
+        {
+            fprintf(debug, "bonded thread %d estimated cost %g\n", t, load[t]);
+        }
+    }
+
+    sfree(load);
+}
+
+/* Returns the range of iatoms of ftype computed by thread,
+ * as set up by divide_bondeds_over_threads.
+ */
+static void bonded_thread_range(const t_forcerec *fr, const t_idef *idef,
+                                int ftype, int thread, int *nb0, int *nb1)
+{
+    int nat1, nbonds;
+
+    if (fr->il_thread_division != NULL)
+    {
+        *nb0 = fr->il_thread_division[ftype*(fr->nthreads+1)+thread];
+        *nb1 = fr->il_thread_division[ftype*(fr->nthreads+1)+thread+1];
+    }
+    else
+    {
+        /* No set up was done, divide equally over the threads */
+        nat1   = interaction_function[ftype].nratoms + 1;
+        nbonds = idef->il[ftype].nr/nat1;
+        *nb0   = ((nbonds* thread   )/fr->nthreads)*nat1;
+        *nb1   = ((nbonds*(thread+1))/fr->nthreads)*nat1;
+    }
+}
+
 static unsigned
-calc_bonded_reduction_mask(const t_idef *idef,
-                           int shift,
-                           int t, int nt)
+calc_bonded_reduction_mask(const t_forcerec *fr, const t_idef *idef,
+                           int shift, int t)
 {
     unsigned mask;
-    int      ftype, nb, nat1, nb0, nb1, i, a;
+    int      ftype, nat1, nb0, nb1, i, a;
 
     mask = 0;
 
     for (ftype = 0; ftype < F_NRE; ftype++)
     {
-        if (interaction_function[ftype].flags & IF_BOND &&
-            !(ftype == F_CONNBONDS || ftype == F_POSRES) &&
-            (ftype<F_GB12 || ftype>F_GB14))
+        if (ftype_is_bonded_potential(ftype) && idef->il[ftype].nr > 0)
         {
-            nb = idef->il[ftype].nr;
-            if (nb > 0)
-            {
-                nat1 = interaction_function[ftype].nratoms + 1;
+            nat1 = interaction_function[ftype].nratoms + 1;
 
-                /* Divide this interaction equally over the threads.
-                 * This is not stored: should match division in calc_bonds.
-                 */
-                nb0 = (((nb/nat1)* t   )/nt)*nat1;
-                nb1 = (((nb/nat1)*(t+1))/nt)*nat1;
+            bonded_thread_range(fr, idef, ftype, t, &nb0, &nb1);
 
-                for (i = nb0; i < nb1; i += nat1)
+            for (i = nb0; i < nb1; i += nat1)
+            {
+                for (a = 1; a < nat1; a++)
                 {
-                    for (a = 1; a < nat1; a++)
-                    {
-                        mask |= (1U << (idef->il[ftype].iatoms[i+a]>>shift));
-                    }
+                    mask |= (1U << (idef->il[ftype].iatoms[i+a]>>shift));
                 }
             }
         }
@@ -3567,6 +4181,8 @@ void init_bonded_thread_force_reduction(t_forcerec   *fr,
     int t;
     int ctot, c, b;
 
+    divide_bondeds_over_threads(fr, idef);
+
     if (fr->nthreads <= 1)
     {
         fr->red_nblock = 0;
@@ -3595,7 +4211,7 @@ void init_bonded_thread_force_reduction(t_forcerec   *fr,
     for (t = 1; t < fr->nthreads; t++)
     {
         fr->f_t[t].red_mask =
-            calc_bonded_reduction_mask(idef, fr->red_ashift, t, fr->nthreads);
+            calc_bonded_reduction_mask(fr, idef, fr->red_ashift, t);
     }
 
     /* Determine the maximum number of blocks we need to reduce over */
@@ -3644,7 +4260,7 @@ static void zero_thread_forces(f_thread_t *f_t, int n,
     {
         for (b = 0; b < nblock; b++)
         {
-            if (f_t->red_mask && (1U<<b))
+            if (f_t->red_mask & (1U<<b))
             {
                 a0 = b*blocksize;
                 a1 = min((b+1)*blocksize, n);
@@ -3820,8 +4436,8 @@ static real calc_one_bond(FILE *fplog, int thread,
         nbonds    = idef->il[ftype].nr/nat1;
         iatoms    = idef->il[ftype].iatoms;
 
-        nb0 = ((nbonds* thread   )/(fr->nthreads))*nat1;
-        nbn = ((nbonds*(thread+1))/(fr->nthreads))*nat1 - nb0;
+        bonded_thread_range(fr, idef, ftype, thread, &nb0, &nbn);
+        nbn -= nb0;
 
         if (!IS_LISTED_LJ_C(ftype))
         {
@@ -3849,6 +4465,36 @@ static real calc_one_bond(FILE *fplog, int thread,
                     global_atom_index);
                 v = 0;
             }
+#ifdef BONDED_SIMD
+            else if (!bCalcEnerVir && fr->efep == efepNO &&
+                     (ftype == F_BONDS || ftype == F_HARMONIC))
+            {
+                bonds_noener(nbn, iatoms+nb0, idef->iparams,
+                             (const rvec*)x, f, pbc);
+                v = 0;
+            }
+            else if (!bCalcEnerVir && fr->efep == efepNO &&
+                     ftype == F_ANGLES)
+            {
+                angles_noener(nbn, iatoms+nb0, idef->iparams,
+                              (const rvec*)x, f, pbc);
+                v = 0;
+            }
+            else if (!bCalcEnerVir && fr->efep == efepNO &&
+                     ftype == F_UREY_BRADLEY)
+            {
+                urey_bradley_noener(nbn, iatoms+nb0, idef->iparams,
+                                    (const rvec*)x, f, pbc);
+                v = 0;
+            }
+            else if (!bCalcEnerVir && fr->efep == efepNO &&
+                     ftype == F_RBDIHS)
+            {
+                rbdihs_noener(nbn, iatoms+nb0, idef->iparams,
+                              (const rvec*)x, f, pbc);
+                v = 0;
+            }
+#endif
             else
             {
                 v = interaction_function[ftype].ifunc(nbn, iatoms+nb0,
@@ -4067,10 +4713,7 @@ void calc_bonds(FILE *fplog, const gmx_multisim_t *ms,
         /* Loop over all bonded force types to calculate the bonded forces */
         for (ftype = 0; (ftype < F_NRE); ftype++)
         {
-            if (idef->il[ftype].nr > 0 &&
-                (interaction_function[ftype].flags & IF_BOND) &&
-                (ftype < F_GB12 || ftype > F_GB14) &&
-                !(ftype == F_CONNBONDS || ftype == F_POSRES))
+            if (idef->il[ftype].nr > 0 && ftype_is_bonded_potential(ftype))
             {
                 v = calc_one_bond(fplog, thread, ftype, idef, x,
                                   ft, fshift, fr, pbc_null, g, enerd, grpp,
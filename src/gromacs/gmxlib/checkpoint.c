@@ -86,7 +86,19 @@ gmx_ctime_r(const time_t *clock, char *buf, int n);
  * But old code can not read a new entry that is present in the file
  * (but can read a new format when new entries are not present).
  */
-static const int cpt_version = 15;
+static const int cpt_version = 16;
+
+/* The per-atom state entries that are stored in separate part files,
+ * one per PP node, with distributed checkpointing.
+ */
+#define CPT_PART_FLAGS ((1<<estX) | (1<<estV) | (1<<estSDX))
+
+/* The state entries that are no longer written, but that can be present
+ * in old checkpoint files. These are skipped on reading.
+ * The LD random state is no longer needed since the random numbers
+ * for SD, BD and temperature coupling are now counter based.
+ */
+#define CPT_OBSOLETE_FLAGS ((1<<estLD_RNG) | (1<<estLD_RNGI))
 
 
 const char *est_names[estNR] =
@@ -797,7 +809,7 @@ static void do_cpt_header(XDR *xd, gmx_bool bRead, int *file_version,
                           int *natoms, int *ngtc, int *nnhpres, int *nhchainlength,
                           int *nlambda, int *flags_state,
                           int *flags_eks, int *flags_enh, int *flags_dfh,
-                          int *nED,
+                          int *nED, int *nparts, char **partbase,
                           FILE *list)
 {
     bool_t res = 0;
@@ -947,6 +959,23 @@ static void do_cpt_header(XDR *xd, gmx_bool bRead, int *file_version,
     {
         *nED = 0;
     }
+
+    if (*file_version >= 16)
+    {
+        do_cpt_int_err(xd, "#state parts", nparts, list);
+    }
+    else
+    {
+        *nparts = 0;
+    }
+    if (*nparts > 0)
+    {
+        do_cpt_string_err(xd, bRead, "state part base name", partbase, list);
+    }
+    else if (bRead)
+    {
+        *partbase = NULL;
+    }
 }
 
 static int do_cpt_footer(XDR *xd, gmx_bool bRead, int file_version)
@@ -973,10 +1002,9 @@ static int do_cpt_footer(XDR *xd, gmx_bool bRead, int file_version)
 
 static int do_cpt_state(XDR *xd, gmx_bool bRead,
                         int fflags, t_state *state,
-                        gmx_bool bReadRNG, FILE *list)
+                        FILE *list)
 {
     int    sflags;
-    int  **rng_p, **rngi_p;
     int    i;
     int    ret;
     int    nnht, nnhtp;
@@ -986,17 +1014,6 @@ static int do_cpt_state(XDR *xd, gmx_bool bRead,
     nnht  = state->nhchainlength*state->ngtc;
     nnhtp = state->nhchainlength*state->nnhpres;
 
-    if (bReadRNG)
-    {
-        rng_p  = (int **)&state->ld_rng;
-        rngi_p = &state->ld_rngi;
-    }
-    else
-    {
-        /* Do not read the RNG data */
-        rng_p  = NULL;
-        rngi_p = NULL;
-    }
     /* We want the MC_RNG the same across all the notes for now -- lambda MC is global */
 
     sflags = state->flags;
@@ -1024,8 +1041,9 @@ static int do_cpt_state(XDR *xd, gmx_bool bRead,
                 case estX:       ret      = do_cpte_rvecs(xd, cptpEST, i, sflags, state->natoms, &state->x, list); break;
                 case estV:       ret      = do_cpte_rvecs(xd, cptpEST, i, sflags, state->natoms, &state->v, list); break;
                 case estSDX:     ret      = do_cpte_rvecs(xd, cptpEST, i, sflags, state->natoms, &state->sd_X, list); break;
-                case estLD_RNG:  ret      = do_cpte_ints(xd, cptpEST, i, sflags, state->nrng, rng_p, list); break;
-                case estLD_RNGI: ret      = do_cpte_ints(xd, cptpEST, i, sflags, state->nrngi, rngi_p, list); break;
+                /* Obsolete entries, the contents are skipped */
+                case estLD_RNG:
+                case estLD_RNGI: ret      = do_cpte_ints(xd, cptpEST, i, sflags, 0, NULL, list); break;
                 case estMC_RNG:  ret      = do_cpte_ints(xd, cptpEST, i, sflags, state->nmcrng, (int **)&state->mc_rng, list); break;
                 case estMC_RNGI: ret      = do_cpte_ints(xd, cptpEST, i, sflags, 1, &state->mc_rngi, list); break;
                 case estDISRE_INITF:  ret = do_cpte_real (xd, cptpEST, i, sflags, &state->hist.disre_initf, list); break;
@@ -1382,11 +1400,227 @@ static int do_cpt_files(XDR *xd, gmx_bool bRead,
 }
 
 
-void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
-                      FILE *fplog, t_commrec *cr,
-                      int eIntegrator, int simulation_part,
-                      gmx_bool bExpanded, int elamstats,
-                      gmx_large_int_t step, double t, t_state *state)
+/* Reads or writes the contents of a state part file of a distributed
+ * checkpoint: the global indices of the nhome atoms of one node
+ * followed by their per-atom state entries.
+ */
+static void do_cpt_part(XDR *xd, gmx_bool bRead, const char *fn,
+                        gmx_large_int_t *step, int *part, int *nparts,
+                        int *natoms, int *flags, int *nhome, int **index,
+                        rvec **x, rvec **v, rvec **sd_X)
+{
+    int    magic, file_version;
+    bool_t res;
+
+    magic = CPT_MAGIC1;
+    do_cpt_int_err(xd, "magic number", &magic, NULL);
+    if (magic != CPT_MAGIC1)
+    {
+        gmx_fatal(FARGS, "Start of file magic number mismatch in checkpoint part file %s", fn);
+    }
+    file_version = cpt_version;
+    do_cpt_int_err(xd, "checkpoint file version", &file_version, NULL);
+    if (file_version > cpt_version)
+    {
+        gmx_fatal(FARGS, "Attempting to read a checkpoint part file of version %d with code of version %d\n", file_version, cpt_version);
+    }
+    do_cpt_step_err(xd, "step", step, NULL);
+    do_cpt_int_err(xd, "part", part, NULL);
+    do_cpt_int_err(xd, "#state parts", nparts, NULL);
+    do_cpt_int_err(xd, "#atoms", natoms, NULL);
+    do_cpt_int_err(xd, "state flags", flags, NULL);
+    do_cpt_int_err(xd, "#home atoms", nhome, NULL);
+    if (bRead)
+    {
+        snew(*index, *nhome);
+    }
+    res = xdr_vector(xd, (char *)*index, *nhome,
+                     (unsigned int)sizeof(int), (xdrproc_t)xdr_int);
+    if (res == 0 ||
+        ((*flags & (1<<estX)) &&
+         do_cpte_rvecs(xd, cptpEST, estX, *flags, *nhome, x, NULL) < 0) ||
+        ((*flags & (1<<estV)) &&
+         do_cpte_rvecs(xd, cptpEST, estV, *flags, *nhome, v, NULL) < 0) ||
+        ((*flags & (1<<estSDX)) &&
+         do_cpte_rvecs(xd, cptpEST, estSDX, *flags, *nhome, sd_X, NULL) < 0))
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+    magic = CPT_MAGIC2;
+    do_cpt_int_err(xd, "magic number", &magic, NULL);
+    if (magic != CPT_MAGIC2)
+    {
+        gmx_fatal(FARGS, "End of file magic number mismatch in checkpoint part file %s", fn);
+    }
+}
+
+/* Returns in buf the checkpoint file name without extension
+ * with _step<step> appended, which is the base of the part file names.
+ */
+static void cpt_part_base(const char *fn, gmx_large_int_t step, char *buf)
+{
+    char sbuf[STEPSTRSIZE];
+
+    strcpy(buf, fn);
+    buf[strlen(fn) - strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
+    sprintf(buf+strlen(buf), "_step%s", gmx_step_str(step, sbuf));
+}
+
+static void cpt_part_filename(const char *fn, gmx_large_int_t step, int part,
+                              char *buf)
+{
+    cpt_part_base(fn, step, buf);
+    sprintf(buf+strlen(buf), "_part%d%s",
+            part, fn+strlen(fn) - strlen(ftp2ext(fn2ftp(fn))) - 1);
+}
+
+void write_checkpoint_part(const char *fn, gmx_large_int_t step,
+                           int part, int nparts, int natoms,
+                           int nhome, int *index, t_state *state)
+{
+    char      buf[CPTSTRLEN];
+    t_fileio *fp;
+    int       flags;
+
+    cpt_part_filename(fn, step, part, buf);
+
+    flags = (state->flags & CPT_PART_FLAGS);
+
+    fp = gmx_fio_open(buf, "w");
+    do_cpt_part(gmx_fio_getxdr(fp), FALSE, buf, &step, &part, &nparts,
+                &natoms, &flags, &nhome, &index,
+                &state->x, &state->v, &state->sd_X);
+    if (gmx_fio_fsync(fp) != 0 && getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == NULL)
+    {
+        gmx_file("Cannot fsync checkpoint part file; maybe you are out of disk space?");
+    }
+    if (gmx_fio_close(fp) != 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+}
+
+void remove_checkpoint_part(const char *fn, gmx_large_int_t step, int part)
+{
+    char buf[CPTSTRLEN];
+
+    cpt_part_filename(fn, step, part, buf);
+    if (gmx_fexist(buf))
+    {
+        remove(buf);
+    }
+}
+
+/* Reads the part files of the distributed checkpoint fn and scatters
+ * the per-atom entries present in both fflags and state->flags over state.
+ * Missing arrays in state are allocated.
+ */
+static void read_checkpoint_parts(const char *fn, const char *partbase,
+                                  gmx_large_int_t step, int nparts,
+                                  int fflags, t_state *state)
+{
+    char             dir[CPTSTRLEN], buf[CPTSTRLEN], *ptr;
+    t_fileio        *fp;
+    gmx_large_int_t  step_p;
+    int              part_p, nparts_p, natoms_p, flags_p, nhome, nset;
+    int              p, i, a, *index;
+    rvec            *x, *v, *sd_X;
+    gmx_bool        *bSet;
+    int              flags;
+
+    /* The part files are in the same directory as the checkpoint file */
+    strcpy(dir, fn);
+    ptr = strrchr(dir, DIR_SEPARATOR);
+    if (ptr != NULL)
+    {
+        ptr[1] = '\0';
+    }
+    else
+    {
+        dir[0] = '\0';
+    }
+
+    flags = (fflags & state->flags & CPT_PART_FLAGS);
+    if ((flags & (1<<estX)) && state->x == NULL)
+    {
+        snew(state->x, state->natoms);
+    }
+    if ((flags & (1<<estV)) && state->v == NULL)
+    {
+        snew(state->v, state->natoms);
+    }
+    if ((flags & (1<<estSDX)) && state->sd_X == NULL)
+    {
+        snew(state->sd_X, state->natoms);
+    }
+
+    snew(bSet, state->natoms);
+    nset = 0;
+    for (p = 0; p < nparts; p++)
+    {
+        sprintf(buf, "%s%s_part%d%s", dir, partbase, p,
+                fn+strlen(fn) - strlen(ftp2ext(fn2ftp(fn))) - 1);
+        if (!gmx_fexist(buf))
+        {
+            gmx_fatal(FARGS, "Part file %s of checkpoint file %s is missing", buf, fn);
+        }
+        index = NULL;
+        x     = NULL;
+        v     = NULL;
+        sd_X  = NULL;
+        fp    = gmx_fio_open(buf, "r");
+        do_cpt_part(gmx_fio_getxdr(fp), TRUE, buf, &step_p, &part_p, &nparts_p,
+                    &natoms_p, &flags_p, &nhome, &index, &x, &v, &sd_X);
+        if (gmx_fio_close(fp) != 0)
+        {
+            gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        }
+        if (step_p != step || part_p != p || nparts_p != nparts ||
+            natoms_p != state->natoms || flags_p != (fflags & CPT_PART_FLAGS))
+        {
+            gmx_fatal(FARGS, "Checkpoint part file %s does not belong to checkpoint file %s", buf, fn);
+        }
+        for (i = 0; i < nhome; i++)
+        {
+            a = index[i];
+            if (a < 0 || a >= state->natoms || bSet[a])
+            {
+                gmx_fatal(FARGS, "Checkpoint part file %s contains an invalid or duplicate atom index %d", buf, a);
+            }
+            bSet[a] = TRUE;
+            if (flags & (1<<estX))
+            {
+                copy_rvec(x[i], state->x[a]);
+            }
+            if (flags & (1<<estV))
+            {
+                copy_rvec(v[i], state->v[a]);
+            }
+            if (flags & (1<<estSDX))
+            {
+                copy_rvec(sd_X[i], state->sd_X[a]);
+            }
+        }
+        nset += nhome;
+        sfree(index);
+        sfree(x);
+        sfree(v);
+        sfree(sd_X);
+    }
+    sfree(bSet);
+
+    if (nset != state->natoms)
+    {
+        gmx_fatal(FARGS, "The part files of checkpoint file %s contain %d atoms, while the system has %d atoms", fn, nset, state->natoms);
+    }
+}
+
+t_fileio *write_checkpoint_data(const char *fn,
+                                FILE *fplog, t_commrec *cr,
+                                int eIntegrator, int simulation_part,
+                                gmx_bool bExpanded, int elamstats,
+                                gmx_large_int_t step, double t, t_state *state,
+                                int nparts, char **fntemp_out)
 {
     t_fileio            *fp;
     int                  file_version;
@@ -1405,7 +1639,7 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     int                  noutputfiles;
     char                *ftime;
     int                  flags_eks, flags_enh, flags_dfh, i;
-    t_fileio            *ret;
+    char                 pbase[CPTSTRLEN], *partbase;
 
     if (PAR(cr))
     {
@@ -1517,13 +1751,24 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 
     ftime   = &(timebuf[0]);
 
+    partbase = NULL;
+    if (nparts > 0)
+    {
+        /* Only the file name is stored, the part files are looked up
+         * in the directory of the checkpoint file.
+         */
+        cpt_part_base(fn, step, pbase);
+        partbase = strrchr(pbase, DIR_SEPARATOR);
+        partbase = (partbase != NULL ? partbase + 1 : pbase);
+    }
+
     do_cpt_header(gmx_fio_getxdr(fp), FALSE, &file_version,
                   &version, &btime, &buser, &bhost, &double_prec, &fprog, &ftime,
                   &eIntegrator, &simulation_part, &step, &t, &nppnodes,
                   DOMAINDECOMP(cr) ? cr->dd->nc : NULL, &npmenodes,
                   &state->natoms, &state->ngtc, &state->nnhpres,
                   &state->nhchainlength, &(state->dfhist.nlambda), &state->flags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state->edsamstate.nED,
+                  &state->edsamstate.nED, &nparts, &partbase,
                   NULL);
 
     sfree(version);
@@ -1532,7 +1777,9 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     sfree(bhost);
     sfree(fprog);
 
-    if ((do_cpt_state(gmx_fio_getxdr(fp), FALSE, state->flags, state, TRUE, NULL) < 0)        ||
+    if ((do_cpt_state(gmx_fio_getxdr(fp), FALSE,
+                      nparts > 0 ? (state->flags & ~CPT_PART_FLAGS) : state->flags,
+                      state, NULL) < 0)        ||
         (do_cpt_ekinstate(gmx_fio_getxdr(fp), FALSE, flags_eks, &state->ekinstate, NULL) < 0) ||
         (do_cpt_enerhist(gmx_fio_getxdr(fp), FALSE, flags_enh, &state->enerhist, NULL) < 0)  ||
         (do_cpt_df_hist(gmx_fio_getxdr(fp), FALSE, flags_dfh, &state->dfhist, NULL) < 0)  ||
@@ -1545,6 +1792,19 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 
     do_cpt_footer(gmx_fio_getxdr(fp), FALSE, file_version);
 
+    sfree(outputfiles);
+
+    *fntemp_out = fntemp;
+
+    return fp;
+}
+
+void finish_checkpoint(t_fileio *fp, char *fntemp,
+                       const char *fn, gmx_bool bNumberAndKeep)
+{
+    char      buf[1024];
+    t_fileio *ret;
+
     /* we really, REALLY, want to make sure to physically write the checkpoint,
        and all the files it depends on, out to disk. Because we've
        opened the checkpoint with gmx_fio_open(), it's in our list
@@ -1604,8 +1864,23 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
         }
     }
 
-    sfree(outputfiles);
     sfree(fntemp);
+}
+
+void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
+                      FILE *fplog, t_commrec *cr,
+                      int eIntegrator, int simulation_part,
+                      gmx_bool bExpanded, int elamstats,
+                      gmx_large_int_t step, double t, t_state *state,
+                      int nparts)
+{
+    t_fileio *fp;
+    char     *fntemp;
+
+    fp = write_checkpoint_data(fn, fplog, cr, eIntegrator, simulation_part,
+                               bExpanded, elamstats, step, t, state, nparts,
+                               &fntemp);
+    finish_checkpoint(fp, fntemp, fn, bNumberAndKeep);
 
 #ifdef GMX_FAHCORE
     /*code for alternate checkpointing scheme.  moved from top of loop over
@@ -1728,7 +2003,7 @@ static void check_match(FILE *fplog,
 static void read_checkpoint(const char *fn, FILE **pfplog,
                             t_commrec *cr, gmx_bool bPartDecomp, ivec dd_nc,
                             int eIntegrator, int *init_fep_state, gmx_large_int_t *step, double *t,
-                            t_state *state, gmx_bool *bReadRNG, gmx_bool *bReadEkin,
+                            t_state *state, gmx_bool *bReadEkin,
                             int *simulation_part,
                             gmx_bool bAppendOutputFiles, gmx_bool bForceAppend)
 {
@@ -1741,6 +2016,8 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
     int                  nppnodes, eIntegrator_f, nppnodes_f, npmenodes_f;
     ivec                 dd_nc_f;
     int                  natoms, ngtc, nnhpres, nhchainlength, nlambda, fflags, flags_eks, flags_enh, flags_dfh;
+    int                  nparts;
+    char                *partbase;
     int                  d;
     int                  ret;
     gmx_file_position_t *outputfiles;
@@ -1756,10 +2033,6 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
     const char *int_warn =
         "WARNING: The checkpoint file was generated with integrator %s,\n"
         "         while the simulation uses integrator %s\n\n";
-    const char *sd_note =
-        "NOTE: The checkpoint file was for %d nodes doing SD or BD,\n"
-        "      while the simulation uses %d SD or BD nodes,\n"
-        "      continuation will be exact, except for the random state\n\n";
 
 #ifndef GMX_NATIVE_WINDOWS
     fl.l_type   = F_WRLCK;
@@ -1782,7 +2055,7 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
                   &nppnodes_f, dd_nc_f, &npmenodes_f,
                   &natoms, &ngtc, &nnhpres, &nhchainlength, &nlambda,
                   &fflags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state->edsamstate.nED, NULL);
+                  &state->edsamstate.nED, &nparts, &partbase, NULL);
 
     if (bAppendOutputFiles &&
         file_version >= 13 && double_prec != GMX_CPT_BUILD_DP)
@@ -1887,17 +2160,7 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
         nppnodes = -1;
     }
 
-    if ((EI_SD(eIntegrator) || eIntegrator == eiBD) && nppnodes > 0)
-    {
-        /* Correct the RNG state size for the number of PP nodes.
-         * Such assignments should all be moved to one central function.
-         */
-        state->nrng  = nppnodes*gmx_rng_n();
-        state->nrngi = nppnodes;
-    }
-
-    *bReadRNG = TRUE;
-    if (fflags != state->flags)
+    if ((fflags & ~CPT_OBSOLETE_FLAGS) != state->flags)
     {
 
         if (MASTER(cr))
@@ -1929,26 +2192,15 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
     }
     else
     {
-        if ((EI_SD(eIntegrator) || eIntegrator == eiBD) &&
-            nppnodes != nppnodes_f)
-        {
-            *bReadRNG = FALSE;
-            if (MASTER(cr))
-            {
-                fprintf(stderr, sd_note, nppnodes_f, nppnodes);
-            }
-            if (fplog)
-            {
-                fprintf(fplog, sd_note, nppnodes_f, nppnodes);
-            }
-        }
         if (MASTER(cr))
         {
             check_match(fplog, version, btime, buser, bhost, double_prec, fprog,
                         cr, bPartDecomp, nppnodes_f, npmenodes_f, dd_nc, dd_nc_f);
         }
     }
-    ret             = do_cpt_state(gmx_fio_getxdr(fp), TRUE, fflags, state, *bReadRNG, NULL);
+    ret             = do_cpt_state(gmx_fio_getxdr(fp), TRUE,
+                                   nparts > 0 ? (fflags & ~CPT_PART_FLAGS) : fflags,
+                                   state, NULL);
     *init_fep_state = state->fep_state;  /* there should be a better way to do this than setting it here.
                                             Investigate for 5.0. */
     if (ret)
@@ -2013,6 +2265,12 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
         gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
     }
 
+    if (nparts > 0)
+    {
+        read_checkpoint_parts(fn, partbase, *step, nparts, fflags, state);
+        sfree(partbase);
+    }
+
     sfree(fprog);
     sfree(ftime);
     sfree(btime);
@@ -2164,7 +2422,7 @@ static void read_checkpoint(const char *fn, FILE **pfplog,
 void load_checkpoint(const char *fn, FILE **fplog,
                      t_commrec *cr, gmx_bool bPartDecomp, ivec dd_nc,
                      t_inputrec *ir, t_state *state,
-                     gmx_bool *bReadRNG, gmx_bool *bReadEkin,
+                     gmx_bool *bReadEkin,
                      gmx_bool bAppend, gmx_bool bForceAppend)
 {
     gmx_large_int_t step;
@@ -2175,7 +2433,7 @@ void load_checkpoint(const char *fn, FILE **fplog,
         /* Read the state from the checkpoint file */
         read_checkpoint(fn, fplog,
                         cr, bPartDecomp, dd_nc,
-                        ir->eI, &(ir->fepvals->init_fep_state), &step, &t, state, bReadRNG, bReadEkin,
+                        ir->eI, &(ir->fepvals->init_fep_state), &step, &t, state, bReadEkin,
                         &ir->simulation_part, bAppend, bForceAppend);
     }
     if (PAR(cr))
@@ -2183,7 +2441,6 @@ void load_checkpoint(const char *fn, FILE **fplog,
         gmx_bcast(sizeof(cr->npmenodes), &cr->npmenodes, cr);
         gmx_bcast(DIM*sizeof(dd_nc[0]), dd_nc, cr);
         gmx_bcast(sizeof(step), &step, cr);
-        gmx_bcast(sizeof(*bReadRNG), bReadRNG, cr);
         gmx_bcast(sizeof(*bReadEkin), bReadEkin, cr);
     }
     ir->bContinuation    = TRUE;
@@ -2197,7 +2454,6 @@ void load_checkpoint(const char *fn, FILE **fplog,
 
 static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
                                  gmx_large_int_t *step, double *t, t_state *state,
-                                 gmx_bool bReadRNG,
                                  int *nfiles, gmx_file_position_t **outputfiles)
 {
     int                  file_version;
@@ -2209,6 +2465,8 @@ static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
     int                  flags_eks, flags_enh, flags_dfh;
     int                  nfiles_loc;
     gmx_file_position_t *files_loc = NULL;
+    int                  nparts;
+    char                *partbase;
     int                  ret;
 
     do_cpt_header(gmx_fio_getxdr(fp), TRUE, &file_version,
@@ -2216,13 +2474,16 @@ static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
                   &eIntegrator, simulation_part, step, t, &nppnodes, dd_nc, &npme,
                   &state->natoms, &state->ngtc, &state->nnhpres, &state->nhchainlength,
                   &(state->dfhist.nlambda), &state->flags, &flags_eks, &flags_enh, &flags_dfh,
-                  &state->edsamstate.nED, NULL);
+                  &state->edsamstate.nED, &nparts, &partbase, NULL);
     ret =
-        do_cpt_state(gmx_fio_getxdr(fp), TRUE, state->flags, state, bReadRNG, NULL);
+        do_cpt_state(gmx_fio_getxdr(fp), TRUE,
+                     nparts > 0 ? (state->flags & ~CPT_PART_FLAGS) : state->flags,
+                     state, NULL);
     if (ret)
     {
         cp_error();
     }
+    state->flags &= ~CPT_OBSOLETE_FLAGS;
     ret = do_cpt_ekinstate(gmx_fio_getxdr(fp), TRUE,
                            flags_eks, &state->ekinstate, NULL);
     if (ret)
@@ -2268,6 +2529,13 @@ static void read_checkpoint_data(t_fileio *fp, int *simulation_part,
         cp_error();
     }
 
+    if (nparts > 0)
+    {
+        read_checkpoint_parts(gmx_fio_getname(fp), partbase, *step, nparts,
+                              state->flags, state);
+        sfree(partbase);
+    }
+
     sfree(fprog);
     sfree(ftime);
     sfree(btime);
@@ -2282,7 +2550,7 @@ read_checkpoint_state(const char *fn, int *simulation_part,
     t_fileio *fp;
 
     fp = gmx_fio_open(fn, "r");
-    read_checkpoint_data(fp, simulation_part, step, t, state, FALSE, NULL, NULL);
+    read_checkpoint_data(fp, simulation_part, step, t, state, NULL, NULL);
     if (gmx_fio_close(fp) != 0)
     {
         gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
@@ -2298,7 +2566,7 @@ void read_checkpoint_trxframe(t_fileio *fp, t_trxframe *fr)
 
     init_state(&state, 0, 0, 0, 0, 0);
 
-    read_checkpoint_data(fp, &simulation_part, &step, &t, &state, FALSE, NULL, NULL);
+    read_checkpoint_data(fp, &simulation_part, &step, &t, &state, NULL, NULL);
 
     fr->natoms  = state.natoms;
     fr->bTitle  = FALSE;
@@ -2349,6 +2617,8 @@ void list_checkpoint(const char *fn, FILE *out)
     int                  ret;
     gmx_file_position_t *outputfiles;
     int                  nfiles;
+    int                  nparts;
+    char                *partbase;
 
     init_state(&state, -1, -1, -1, -1, 0);
 
@@ -2358,8 +2628,12 @@ void list_checkpoint(const char *fn, FILE *out)
                   &eIntegrator, &simulation_part, &step, &t, &nppnodes, dd_nc, &npme,
                   &state.natoms, &state.ngtc, &state.nnhpres, &state.nhchainlength,
                   &(state.dfhist.nlambda), &state.flags,
-                  &flags_eks, &flags_enh, &flags_dfh, &state.edsamstate.nED, out);
-    ret = do_cpt_state(gmx_fio_getxdr(fp), TRUE, state.flags, &state, TRUE, out);
+                  &flags_eks, &flags_enh, &flags_dfh, &state.edsamstate.nED,
+                  &nparts, &partbase, out);
+    /* The per-atom entries of a distributed checkpoint are not listed */
+    ret = do_cpt_state(gmx_fio_getxdr(fp), TRUE,
+                       nparts > 0 ? (state.flags & ~CPT_PART_FLAGS) : state.flags,
+                       &state, out);
     if (ret)
     {
         cp_error();
@@ -2407,6 +2681,108 @@ void list_checkpoint(const char *fn, FILE *out)
     done_state(&state);
 }
 
+void convert_checkpoint(const char *fn, const char *fn_out)
+{
+    t_fileio            *fp;
+    int                  file_version;
+    char                *version, *btime, *buser, *bhost, *fprog, *ftime;
+    int                  double_prec;
+    int                  eIntegrator, simulation_part, nppnodes, npme;
+    gmx_large_int_t      step;
+    double               t;
+    ivec                 dd_nc;
+    t_state              state;
+    int                  flags_eks, flags_enh, flags_dfh;
+    gmx_file_position_t *outputfiles;
+    int                  nfiles;
+    int                  nparts, nparts_out;
+    char                *partbase;
+
+    init_state(&state, 0, 0, 0, 0, 0);
+
+    fp = gmx_fio_open(fn, "r");
+    do_cpt_header(gmx_fio_getxdr(fp), TRUE, &file_version,
+                  &version, &btime, &buser, &bhost, &double_prec, &fprog, &ftime,
+                  &eIntegrator, &simulation_part, &step, &t, &nppnodes, dd_nc, &npme,
+                  &state.natoms, &state.ngtc, &state.nnhpres, &state.nhchainlength,
+                  &(state.dfhist.nlambda), &state.flags,
+                  &flags_eks, &flags_enh, &flags_dfh, &state.edsamstate.nED,
+                  &nparts, &partbase, NULL);
+    if (nparts == 0)
+    {
+        gmx_fio_close(fp);
+        fprintf(stderr, "Checkpoint file %s is not distributed, copying it to %s\n",
+                fn, fn_out);
+        if (gmx_file_copy(fn, fn_out, TRUE) != 0)
+        {
+            gmx_file(fn_out);
+        }
+        done_state(&state);
+
+        return;
+    }
+
+    init_df_history(&state.dfhist, state.dfhist.nlambda, 0);
+
+    if ((do_cpt_state(gmx_fio_getxdr(fp), TRUE, state.flags & ~CPT_PART_FLAGS,
+                      &state, NULL) < 0) ||
+        (do_cpt_ekinstate(gmx_fio_getxdr(fp), TRUE, flags_eks, &state.ekinstate, NULL) < 0) ||
+        (do_cpt_enerhist(gmx_fio_getxdr(fp), TRUE, flags_enh, &state.enerhist, NULL) < 0) ||
+        (do_cpt_df_hist(gmx_fio_getxdr(fp), TRUE, flags_dfh, &state.dfhist, NULL) < 0) ||
+        (do_cpt_EDstate(gmx_fio_getxdr(fp), TRUE, &state.edsamstate, NULL) < 0) ||
+        (do_cpt_files(gmx_fio_getxdr(fp), TRUE, &outputfiles, &nfiles, NULL,
+                      file_version) < 0) ||
+        (do_cpt_footer(gmx_fio_getxdr(fp), TRUE, file_version) < 0))
+    {
+        cp_error();
+    }
+    if (gmx_fio_close(fp) != 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+
+    read_checkpoint_parts(fn, partbase, step, nparts, state.flags, &state);
+    sfree(partbase);
+
+    /* Write all entries, including the build information of the original
+     * file, such that mdrun sees no difference with a single-file checkpoint.
+     */
+    state.flags &= ~CPT_OBSOLETE_FLAGS;
+    nparts_out = 0;
+    fp         = gmx_fio_open(fn_out, "w");
+    do_cpt_header(gmx_fio_getxdr(fp), FALSE, &file_version,
+                  &version, &btime, &buser, &bhost, &double_prec, &fprog, &ftime,
+                  &eIntegrator, &simulation_part, &step, &t, &nppnodes, dd_nc, &npme,
+                  &state.natoms, &state.ngtc, &state.nnhpres, &state.nhchainlength,
+                  &(state.dfhist.nlambda), &state.flags,
+                  &flags_eks, &flags_enh, &flags_dfh, &state.edsamstate.nED,
+                  &nparts_out, &partbase, NULL);
+    if ((do_cpt_state(gmx_fio_getxdr(fp), FALSE, state.flags, &state, NULL) < 0) ||
+        (do_cpt_ekinstate(gmx_fio_getxdr(fp), FALSE, flags_eks, &state.ekinstate, NULL) < 0) ||
+        (do_cpt_enerhist(gmx_fio_getxdr(fp), FALSE, flags_enh, &state.enerhist, NULL) < 0) ||
+        (do_cpt_df_hist(gmx_fio_getxdr(fp), FALSE, flags_dfh, &state.dfhist, NULL) < 0) ||
+        (do_cpt_EDstate(gmx_fio_getxdr(fp), FALSE, &state.edsamstate, NULL) < 0) ||
+        (do_cpt_files(gmx_fio_getxdr(fp), FALSE, &outputfiles, &nfiles, NULL,
+                      file_version) < 0))
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+    do_cpt_footer(gmx_fio_getxdr(fp), FALSE, file_version);
+    if (gmx_fio_close(fp) != 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+
+    sfree(outputfiles);
+    sfree(version);
+    sfree(btime);
+    sfree(buser);
+    sfree(bhost);
+    sfree(fprog);
+    sfree(ftime);
+    done_state(&state);
+}
+
 
 static gmx_bool exist_output_file(const char *fnm_cp, int nfile, const t_filenm fnm[])
 {
@@ -2454,7 +2830,7 @@ gmx_bool read_checkpoint_simulation_part(const char *filename, int *simulation_p
         {
             init_state(&state, 0, 0, 0, 0, 0);
 
-            read_checkpoint_data(fp, simulation_part, &step, &t, &state, FALSE,
+            read_checkpoint_data(fp, simulation_part, &step, &t, &state,
                                  &nfiles, &outputfiles);
             if (gmx_fio_close(fp) != 0)
             {
@@ -52,6 +52,10 @@
 #include "maths.h"
 #include "gmx_random_gausstable.h"
 
+#ifdef GMX_X86_SSE2
+#include <emmintrin.h>
+#endif
+
 #define RNG_N 624
 #define RNG_M 397
 #define RNG_MATRIX_A 0x9908b0dfUL   /* constant vector a */
@@ -385,3 +389,283 @@ gmx_rng_gaussian_table(gmx_rng_t rng)
     /* The Gaussian table is a static constant in this file */
     return gaussian_table[i >> GAUSS_SHIFT];
 }
+
+
+/* The rotation constants of ThreeFry-4x32 */
+static const int threefry_rot[8][2] = {
+    { 10, 26 }, { 11, 21 }, { 13, 27 }, { 23,  5 },
+    {  6, 20 }, { 17, 11 }, { 25, 10 }, { 18, 20 }
+};
+#define THREEFRY_ROUNDS    20
+#define THREEFRY_KS_PARITY 0x1BD11BDA
+
+#define ROTL32(x, r) (((x) << (r)) | ((x) >> (32 - (r))))
+
+void
+gmx_rng_threefry4x32(const unsigned int ctr[4], const unsigned int key[4],
+                     unsigned int rnd[4])
+{
+    unsigned int ks[5], x[4];
+    const int   *R;
+    int          r, i, s;
+
+    ks[4] = THREEFRY_KS_PARITY;
+    for (i = 0; i < 4; i++)
+    {
+        ks[i]  = key[i];
+        ks[4] ^= key[i];
+        x[i]   = ctr[i] + ks[i];
+    }
+
+    for (r = 0; r < THREEFRY_ROUNDS; r++)
+    {
+        R = threefry_rot[r % 8];
+        if (r % 2 == 0)
+        {
+            x[0] += x[1];
+            x[1]  = ROTL32(x[1], R[0]) ^ x[0];
+            x[2] += x[3];
+            x[3]  = ROTL32(x[3], R[1]) ^ x[2];
+        }
+        else
+        {
+            x[0] += x[3];
+            x[3]  = ROTL32(x[3], R[0]) ^ x[0];
+            x[2] += x[1];
+            x[1]  = ROTL32(x[1], R[1]) ^ x[2];
+        }
+        if (r % 4 == 3)
+        {
+            /* Key injection */
+            s = (r + 1)/4;
+            for (i = 0; i < 4; i++)
+            {
+                x[i] += ks[(s + i) % 5];
+            }
+            x[3] += s;
+        }
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        rnd[i] = x[i];
+    }
+}
+
+/* Sets the ThreeFry counter and key.
+ * The step is split into two 32-bit words; the double shift avoids
+ * an undefined shift when gmx_large_int_t has only 32 bits.
+ */
+static void
+threefry_ctr_key(unsigned int seed, int stream,
+                 gmx_large_int_t step, int index, int sub,
+                 unsigned int ctr[4], unsigned int key[4])
+{
+    ctr[0] = (unsigned int)index;
+    ctr[1] = (unsigned int)step;
+    ctr[2] = (unsigned int)((step >> 16) >> 16);
+    ctr[3] = (unsigned int)sub;
+    key[0] = seed;
+    key[1] = (unsigned int)stream;
+    key[2] = 0;
+    key[3] = 0;
+}
+
+void
+gmx_rng_cycle_4gaussian_table(unsigned int seed, int stream,
+                              gmx_large_int_t step, int index, int sub,
+                              real rnd[4])
+{
+    unsigned int ctr[4], key[4], w[4];
+    int          j;
+
+    threefry_ctr_key(seed, stream, step, index, sub, ctr, key);
+    gmx_rng_threefry4x32(ctr, key, w);
+    for (j = 0; j < 4; j++)
+    {
+        rnd[j] = gaussian_table[w[j] >> GAUSS_SHIFT];
+    }
+}
+
+#ifdef GMX_X86_SSE2
+#define ROTL32_SSE2(x, r) _mm_or_si128(_mm_sll_epi32(x, _mm_cvtsi32_si128(r)), \
+                                       _mm_srl_epi32(x, _mm_cvtsi32_si128(32 - (r))))
+
+/* Four independent ThreeFry blocks, one per SSE2 integer lane */
+static gmx_inline void
+threefry4x32_sse2(__m128i x[4], const __m128i ks[5])
+{
+    const int *R;
+    int        r, i, s;
+
+    for (i = 0; i < 4; i++)
+    {
+        x[i] = _mm_add_epi32(x[i], ks[i]);
+    }
+    for (r = 0; r < THREEFRY_ROUNDS; r++)
+    {
+        R = threefry_rot[r % 8];
+        if (r % 2 == 0)
+        {
+            x[0] = _mm_add_epi32(x[0], x[1]);
+            x[1] = _mm_xor_si128(ROTL32_SSE2(x[1], R[0]), x[0]);
+            x[2] = _mm_add_epi32(x[2], x[3]);
+            x[3] = _mm_xor_si128(ROTL32_SSE2(x[3], R[1]), x[2]);
+        }
+        else
+        {
+            x[0] = _mm_add_epi32(x[0], x[3]);
+            x[3] = _mm_xor_si128(ROTL32_SSE2(x[3], R[0]), x[0]);
+            x[2] = _mm_add_epi32(x[2], x[1]);
+            x[1] = _mm_xor_si128(ROTL32_SSE2(x[1], R[1]), x[2]);
+        }
+        if (r % 4 == 3)
+        {
+            s = (r + 1)/4;
+            for (i = 0; i < 4; i++)
+            {
+                x[i] = _mm_add_epi32(x[i], ks[(s + i) % 5]);
+            }
+            x[3] = _mm_add_epi32(x[3], _mm_set1_epi32(s));
+        }
+    }
+}
+#endif
+
+void
+gmx_rng_cycle_gaussian_table_batch(unsigned int seed, int stream,
+                                   gmx_large_int_t step,
+                                   int n, const int *index, int index0,
+                                   int sub0, int nsub,
+                                   real *rnd)
+{
+    unsigned int ctr[4], key[4], w[4];
+    int          i, s, j;
+#ifdef GMX_X86_SSE2
+    __m128i      ks_S[5], x_S[4];
+    unsigned int w4[4][4];
+    int          ind[4], l;
+#endif
+
+    i = 0;
+
+#ifdef GMX_X86_SSE2
+    threefry_ctr_key(seed, stream, step, 0, 0, ctr, key);
+    ks_S[4] = _mm_set1_epi32(THREEFRY_KS_PARITY);
+    for (j = 0; j < 4; j++)
+    {
+        ks_S[j] = _mm_set1_epi32(key[j]);
+        ks_S[4] = _mm_xor_si128(ks_S[4], ks_S[j]);
+    }
+    for (; i + 4 <= n; i += 4)
+    {
+        for (l = 0; l < 4; l++)
+        {
+            ind[l] = (index != NULL ? index[i + l] : index0 + i + l);
+        }
+        for (s = 0; s < nsub; s++)
+        {
+            x_S[0] = _mm_setr_epi32(ind[0], ind[1], ind[2], ind[3]);
+            x_S[1] = _mm_set1_epi32(ctr[1]);
+            x_S[2] = _mm_set1_epi32(ctr[2]);
+            x_S[3] = _mm_set1_epi32(sub0 + s);
+            threefry4x32_sse2(x_S, ks_S);
+            for (j = 0; j < 4; j++)
+            {
+                _mm_storeu_si128((__m128i *)w4[j], x_S[j]);
+            }
+            for (l = 0; l < 4; l++)
+            {
+                for (j = 0; j < 4; j++)
+                {
+                    rnd[((i + l)*nsub + s)*4 + j] = gaussian_table[w4[j][l] >> GAUSS_SHIFT];
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < n; i++)
+    {
+        for (s = 0; s < nsub; s++)
+        {
+            threefry_ctr_key(seed, stream, step,
+                             index != NULL ? index[i] : index0 + i, sub0 + s,
+                             ctr, key);
+            gmx_rng_threefry4x32(ctr, key, w);
+            for (j = 0; j < 4; j++)
+            {
+                rnd[(i*nsub + s)*4 + j] = gaussian_table[w[j] >> GAUSS_SHIFT];
+            }
+        }
+    }
+}
+
+void
+gmx_rng_cycle_init(gmx_rng_cycle_t *rc, unsigned int seed, int stream,
+                   gmx_large_int_t step, int index)
+{
+    threefry_ctr_key(seed, stream, step, index, 0, rc->ctr, rc->key);
+    rc->nleft     = 0;
+    rc->has_saved = 0;
+}
+
+unsigned int
+gmx_rng_cycle_uint32(gmx_rng_cycle_t *rc)
+{
+    if (rc->nleft == 0)
+    {
+        gmx_rng_threefry4x32(rc->ctr, rc->key, rc->rnd);
+        rc->ctr[3]++;
+        rc->nleft = 4;
+    }
+
+    return rc->rnd[4 - rc->nleft--];
+}
+
+real
+gmx_rng_cycle_uniform_real(gmx_rng_cycle_t *rc)
+{
+    /* See gmx_rng_uniform_real for the choice of the divisors */
+    if (sizeof(real) == sizeof(double))
+    {
+        return ((double)gmx_rng_cycle_uint32(rc))*(1.0/4294967296.0);
+    }
+    else
+    {
+        return ((float)gmx_rng_cycle_uint32(rc))*(1.0/4294967423.0);
+    }
+}
+
+real
+gmx_rng_cycle_gaussian_real(gmx_rng_cycle_t *rc)
+{
+    real x, y, r;
+
+    if (rc->has_saved)
+    {
+        rc->has_saved = 0;
+        return rc->gauss_saved;
+    }
+    else
+    {
+        do
+        {
+            x = 2.0*gmx_rng_cycle_uniform_real(rc)-1.0;
+            y = 2.0*gmx_rng_cycle_uniform_real(rc)-1.0;
+            r = x*x+y*y;
+        }
+        while (r > 1.0 || r == 0.0);
+
+        r               = sqrt(-2.0*log(r)/r);
+        rc->gauss_saved = y*r;
+        rc->has_saved   = 1;
+        return x*r;
+    }
+}
+
+real
+gmx_rng_cycle_gaussian_table(gmx_rng_cycle_t *rc)
+{
+    return gaussian_table[gmx_rng_cycle_uint32(rc) >> GAUSS_SHIFT];
+}
@@ -231,7 +231,11 @@ void gmx_fio_fe(t_fileio *fio, int eio, const char *desc,
 /* set the reader/writer functions based on the file type */
 static void gmx_fio_set_iotype(t_fileio *fio)
 {
-    if (in_ftpset(fio->iFTP, asize(ftpXDR), ftpXDR))
+    if (fio->map != NULL)
+    {
+        fio->iotp = &mmap_iotype;
+    }
+    else if (in_ftpset(fio->iFTP, asize(ftpXDR), ftpXDR))
     {
 #ifdef USE_XDR
         fio->iotp = &xdr_iotype;
@@ -393,6 +397,10 @@ static t_fileio *gmx_fio_get_first(void)
     {
         /* after this, the open_file pointer should never change */
         ret = NULL;
+#ifdef GMX_THREAD_MPI
+        /* there is no next file that would release the lock */
+        tMPI_Thread_mutex_unlock(&open_file_mutex);
+#endif
     }
     else
     {
@@ -506,8 +514,10 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
 #endif
     bRead      = (newmode[0] == 'r' && newmode[1] != '+');
     bReadWrite = (newmode[1] == '+');
-    fio->fp    = NULL;
-    fio->xdr   = NULL;
+    fio->fp       = NULL;
+    fio->xdr      = NULL;
+    fio->xtcindex = NULL;
+    fio->map      = NULL;
     if (fn)
     {
         fio->iFTP   = fn2ftp(fn);
@@ -550,6 +560,15 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
 
             snew(fio->xdr, 1);
             xdrstdio_create(fio->xdr, fio->fp, fio->xdrmode);
+
+            /* Trajectories that are only read are decoded directly from
+             * a memory mapping of the file, which avoids the stdio and
+             * XDR overhead for every single value.
+             */
+            if (bRead && fio->iFTP == efTRR)
+            {
+                gmx_fio_mmap_open(fio);
+            }
         }
         else
         {
@@ -601,6 +620,12 @@ static int gmx_fio_close_locked(t_fileio *fio)
         xdr_destroy(fio->xdr);
         sfree(fio->xdr);
     }
+    if (fio->xtcindex)
+    {
+        xdr_xtc_index_done(fio->xtcindex);
+        sfree(fio->xtcindex);
+    }
+    gmx_fio_mmap_close(fio);
 
     /* Don't close stdin and stdout! */
     if (!fio->bStdio && fio->fp != NULL)
@@ -995,6 +1020,7 @@ void gmx_fio_rewind(t_fileio* fio)
 {
     gmx_fio_lock(fio);
 
+    fio->mappos = 0;
     if (fio->xdr)
     {
         xdr_destroy(fio->xdr);
@@ -1099,7 +1125,11 @@ gmx_off_t gmx_fio_ftell(t_fileio* fio)
     gmx_off_t ret = 0;
 
     gmx_fio_lock(fio);
-    if (fio->fp)
+    if (fio->map)
+    {
+        ret = fio->mappos;
+    }
+    else if (fio->fp)
     {
         ret = gmx_ftell(fio->fp);
     }
@@ -1112,7 +1142,13 @@ int gmx_fio_seek(t_fileio* fio, gmx_off_t fpos)
     int rc;
 
     gmx_fio_lock(fio);
-    if (fio->fp)
+    if (fio->map)
+    {
+        /* positions beyond the mapping are checked when reading */
+        fio->mappos = fpos;
+        rc          = 0;
+    }
+    else if (fio->fp)
     {
         rc = gmx_fseek(fio->fp, fpos, SEEK_SET);
     }
@@ -1125,11 +1161,26 @@ int gmx_fio_seek(t_fileio* fio, gmx_off_t fpos)
     return rc;
 }
 
+/* Removes the memory mapping of fio, which should be locked, and moves
+ * the stream to the read position in the mapping, so callers that work
+ * on the FILE or XDR stream directly continue at the right place.
+ */
+static void gmx_fio_unmap_locked(t_fileio *fio)
+{
+    if (fio->map != NULL)
+    {
+        gmx_fseek(fio->fp, fio->mappos, SEEK_SET);
+        gmx_fio_mmap_close(fio);
+        gmx_fio_set_iotype(fio);
+    }
+}
+
 FILE *gmx_fio_getfp(t_fileio *fio)
 {
     FILE *ret = NULL;
 
     gmx_fio_lock(fio);
+    gmx_fio_unmap_locked(fio);
     if (fio->fp)
     {
         ret = fio->fp;
@@ -1143,6 +1194,7 @@ XDR *gmx_fio_getxdr(t_fileio* fio)
     XDR *ret = NULL;
 
     gmx_fio_lock(fio);
+    gmx_fio_unmap_locked(fio);
     if (fio->xdr)
     {
         ret = fio->xdr;
@@ -1163,12 +1215,106 @@ gmx_bool gmx_fio_getread(t_fileio* fio)
     return ret;
 }
 
+/* Returns the frame index of the xtc file fio, which should be locked.
+ * On first use the index is read from the index file, when present and
+ * consistent with the xtc file, and completed by scanning the frame
+ * headers that were not indexed yet. An updated index is written back
+ * to the index file, unless GMX_NO_XTC_INDEX_FILE is set.
+ */
+static t_xtc_index *gmx_fio_int_get_xtc_index(t_fileio *fio, int natoms)
+{
+    char *fn_index;
+    int   nnew;
+
+    if (fio->bStdio || fio->xdr == NULL || fio->xdrmode != XDR_DECODE)
+    {
+        return NULL;
+    }
+
+    if (fio->xtcindex != NULL && fio->xtcindex->natoms != natoms)
+    {
+        xdr_xtc_index_done(fio->xtcindex);
+        sfree(fio->xtcindex);
+    }
+
+    snew(fn_index, strlen(fio->fn) + 5);
+    sprintf(fn_index, "%s.idx", fio->fn);
+
+    if (fio->xtcindex == NULL)
+    {
+        snew(fio->xtcindex, 1);
+        xdr_xtc_index_init(fio->xtcindex, natoms);
+        if (getenv("GMX_NO_XTC_INDEX_FILE") == NULL)
+        {
+            xdr_xtc_index_read(fio->xtcindex, fn_index, fio->fp, fio->xdr);
+        }
+    }
+
+    /* The file can have grown since we last looked, e.g. when mdrun
+     * is still writing it, so always check for new frames.
+     */
+    nnew = xdr_xtc_index_update(fio->xtcindex, fio->fp, fio->xdr);
+    if (nnew < 0)
+    {
+        xdr_xtc_index_done(fio->xtcindex);
+        sfree(fio->xtcindex);
+    }
+    else if (nnew > 1 && getenv("GMX_NO_XTC_INDEX_FILE") == NULL)
+    {
+        /* Failure to write is not a problem, we just lose the index */
+        if (!xdr_xtc_index_write(fio->xtcindex, fn_index) && debug)
+        {
+            fprintf(debug, "Could not write the xtc frame index file %s\n",
+                    fn_index);
+        }
+    }
+    sfree(fn_index);
+
+    return fio->xtcindex;
+}
+
+/* Seeks to frame of the index, or the end of the indexed part of the file
+ * when frame is equal to the number of indexed frames.
+ */
+static int gmx_fio_int_seek_xtc_index_frame(t_fileio *fio, int frame)
+{
+    gmx_off_t offset;
+
+    if (frame < fio->xtcindex->nframes)
+    {
+        offset = fio->xtcindex->offset[frame];
+    }
+    else
+    {
+        offset = fio->xtcindex->end;
+    }
+
+    return gmx_fseek(fio->fp, offset, SEEK_SET);
+}
+
 int xtc_seek_frame(t_fileio *fio, int frame, int natoms)
 {
-    int ret;
+    t_xtc_index *index;
+    int          ret, fr;
 
     gmx_fio_lock(fio);
-    ret = xdr_xtc_seek_frame(frame, fio->fp, fio->xdr, natoms);
+    index = gmx_fio_int_get_xtc_index(fio, natoms);
+    if (index != NULL)
+    {
+        fr = xdr_xtc_index_find_step(index, 0, frame);
+        if (fr < index->nframes)
+        {
+            ret = gmx_fio_int_seek_xtc_index_frame(fio, fr);
+        }
+        else
+        {
+            ret = -1;
+        }
+    }
+    else
+    {
+        ret = xdr_xtc_seek_frame(frame, fio->fp, fio->xdr, natoms);
+    }
     gmx_fio_unlock(fio);
 
     return ret;
@@ -1176,10 +1322,66 @@ int xtc_seek_frame(t_fileio *fio, int frame, int natoms)
 
 int xtc_seek_time(t_fileio *fio, real time, int natoms, gmx_bool bSeekForwardOnly)
 {
-    int ret;
+    t_xtc_index *index;
+    int          ret, first, fr;
+
+    gmx_fio_lock(fio);
+    index = gmx_fio_int_get_xtc_index(fio, natoms);
+    first = 0;
+    if (index != NULL && bSeekForwardOnly)
+    {
+        /* Start searching at the first frame at or after the current position */
+        first = xdr_xtc_index_find_offset(index, gmx_ftell(fio->fp));
+    }
+    if (index != NULL && first >= 0)
+    {
+        fr = xdr_xtc_index_find_time(index, first, time);
+        if (fr < index->nframes)
+        {
+            ret = gmx_fio_int_seek_xtc_index_frame(fio, fr);
+        }
+        else
+        {
+            ret = -1;
+        }
+    }
+    else
+    {
+        ret = xdr_xtc_seek_time(time, fio->fp, fio->xdr, natoms, bSeekForwardOnly);
+    }
+    gmx_fio_unlock(fio);
+
+    return ret;
+}
+
+int xtc_get_index_frame(t_fileio *fio, int natoms,
+                        int *nframes, const float **time)
+{
+    t_xtc_index *index;
+    int          fr = -1;
 
     gmx_fio_lock(fio);
-    ret = xdr_xtc_seek_time(time, fio->fp, fio->xdr, natoms, bSeekForwardOnly);
+    index = gmx_fio_int_get_xtc_index(fio, natoms);
+    if (index != NULL)
+    {
+        fr       = xdr_xtc_index_find_offset(index, gmx_ftell(fio->fp));
+        *nframes = index->nframes;
+        *time    = index->time;
+    }
+    gmx_fio_unlock(fio);
+
+    return fr;
+}
+
+int xtc_seek_index_frame(t_fileio *fio, int frame)
+{
+    int ret = -1;
+
+    gmx_fio_lock(fio);
+    if (fio->xtcindex != NULL && frame >= 0 && frame <= fio->xtcindex->nframes)
+    {
+        ret = gmx_fio_int_seek_xtc_index_frame(fio, frame);
+    }
     gmx_fio_unlock(fio);
 
     return ret;
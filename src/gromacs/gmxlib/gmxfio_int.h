@@ -90,6 +90,14 @@ struct t_fileio
     enum xdr_op xdrmode;               /* the xdr mode */
     int         iFTP;                  /* the file type identifier */
 
+    t_xtc_index *xtcindex;             /* frame index for seeking in xtc files,
+                                          NULL when not (yet) built */
+
+    unsigned char *map;                /* the memory mapped file contents for
+                                          reading, NULL when not mapped */
+    gmx_off_t      mapsize,            /* the size of the mapping */
+                   mappos;             /* the read position in the mapping */
+
     const char *comment;               /* a comment string for debugging */
 
     t_fileio   *next, *prev;           /* next and previous file pointers in the
@@ -108,6 +116,7 @@ extern const t_iotype asc_iotype;
 extern const t_iotype bin_iotype;
 extern const t_iotype xdr_iotype;
 extern const t_iotype dummy_iotype;
+extern const t_iotype mmap_iotype;
 
 extern const char    *eioNames[eioNR];
 
@@ -124,6 +133,12 @@ void gmx_fio_check_nitem(t_fileio *fio, int eio, int nitem, const char *file,
 void gmx_fio_fe(t_fileio *fio, int eio, const char *desc, const char *srcfile,
                 int line);
 
+/* memory map a file opened for reading, returns TRUE when successful,
+   after which mmap_iotype should be used for reading */
+gmx_bool gmx_fio_mmap_open(t_fileio *fio);
+/* remove the memory mapping of a file, if present */
+void gmx_fio_mmap_close(t_fileio *fio);
+
 /* lock/unlock the mutex associated with a fio  */
 void gmx_fio_lock(t_fileio *fio);
 void gmx_fio_unlock(t_fileio *fio);
@@ -0,0 +1,404 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include "gmx_fatal.h"
+#include "macros.h"
+#include "smalloc.h"
+#include "futil.h"
+#include "gmxfio.h"
+
+#ifdef GMX_THREAD_MPI
+#include "thread_mpi.h"
+#endif
+
+#include "gmxfio_int.h"
+
+/* This is the part that reads xdr files from a memory mapped file.
+ *
+ * The data is decoded directly from the mapped region, following the XDR
+ * encoding used by gmxfio_xdr.c, without going through stdio and the XDR
+ * library. Items that are read with a NULL pointer are only skipped.
+ */
+
+
+/* file type functions */
+static gmx_bool do_mmapread(t_fileio *fio, void *item, int nitem, int eio,
+                            const char *desc, const char *srcfile, int line);
+static gmx_bool do_mmapwrite(t_fileio *fio, const void *item, int nitem, int eio,
+                             const char *desc, const char *srcfile, int line);
+
+
+const t_iotype mmap_iotype = {do_mmapread, do_mmapwrite};
+
+
+#ifdef HAVE_SYS_MMAN_H
+
+/* Maps the whole file fio->fp, returns TRUE on success */
+static gmx_bool mmap_file(t_fileio *fio)
+{
+    struct stat st;
+    void       *map;
+
+    if (fstat(fileno(fio->fp), &st) != 0 || !S_ISREG(st.st_mode) ||
+        st.st_size <= 0 || (gmx_off_t)(size_t)st.st_size != st.st_size)
+    {
+        return FALSE;
+    }
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED,
+               fileno(fio->fp), 0);
+    if (map == MAP_FAILED)
+    {
+        return FALSE;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    fio->map     = (unsigned char *)map;
+    fio->mapsize = st.st_size;
+
+    return TRUE;
+}
+
+static void munmap_file(t_fileio *fio)
+{
+    if (fio->map != NULL)
+    {
+        munmap(fio->map, (size_t)fio->mapsize);
+        fio->map     = NULL;
+        fio->mapsize = 0;
+    }
+}
+
+#endif
+
+gmx_bool gmx_fio_mmap_open(t_fileio *fio)
+{
+    fio->map     = NULL;
+    fio->mapsize = 0;
+    fio->mappos  = 0;
+#ifdef HAVE_SYS_MMAN_H
+    if (getenv("GMX_NO_FIO_MMAP") == NULL && mmap_file(fio))
+    {
+        fio->mappos = gmx_ftell(fio->fp);
+        if (debug)
+        {
+            fprintf(debug, "Memory mapped %s (%ld bytes) for reading\n",
+                    fio->fn, (long)fio->mapsize);
+        }
+        return TRUE;
+    }
+#endif
+    return FALSE;
+}
+
+void gmx_fio_mmap_close(t_fileio *fio)
+{
+#ifdef HAVE_SYS_MMAN_H
+    munmap_file(fio);
+#endif
+}
+
+/* Returns a pointer to the next n bytes and advances the position,
+ * returns NULL when the file does not contain n more bytes.
+ */
+static const unsigned char *mmap_get(t_fileio *fio, gmx_off_t n)
+{
+    const unsigned char *p;
+
+    if (fio->mappos + n > fio->mapsize)
+    {
+#ifdef HAVE_SYS_MMAN_H
+        /* The file might have been extended since we mapped it */
+        struct stat st;
+
+        if (fstat(fileno(fio->fp), &st) == 0 && st.st_size > fio->mapsize)
+        {
+            munmap_file(fio);
+            if (!mmap_file(fio))
+            {
+                gmx_fatal(FARGS, "Could not remap file %s", fio->fn);
+            }
+        }
+#endif
+        if (fio->mappos + n > fio->mapsize)
+        {
+            return NULL;
+        }
+    }
+    p            = fio->map + fio->mappos;
+    fio->mappos += n;
+
+    return p;
+}
+
+/* Converts n big-endian items of size bytes each from src to host order */
+static void copy_from_xdr(void *dest, const unsigned char *src,
+                          int size, int n)
+{
+    static const int one = 1;
+    unsigned char   *d   = (unsigned char *)dest;
+    int              i, b;
+
+    if (*(const char *)&one == 0)
+    {
+        /* big-endian host, the data is already in the right order */
+        memcpy(dest, src, size*n);
+        return;
+    }
+    for (i = 0; i < n; i++)
+    {
+        for (b = 0; b < size; b++)
+        {
+            d[b] = src[size - 1 - b];
+        }
+        d   += size;
+        src += size;
+    }
+}
+
+static gmx_bool mmap_int(t_fileio *fio, int *i)
+{
+    const unsigned char *p = mmap_get(fio, 4);
+
+    if (p == NULL)
+    {
+        return FALSE;
+    }
+    *i = (int)(((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+               ((unsigned int)p[2] << 8) | (unsigned int)p[3]);
+
+    return TRUE;
+}
+
+/* Reads n reals stored as float or double, depending on fio->bDouble,
+ * into r, or skips them when r is NULL.
+ */
+static gmx_bool mmap_reals(t_fileio *fio, real *r, int n)
+{
+    const unsigned char *p;
+    float                fbuf[DIM];
+    double               dbuf[DIM];
+    int                  size, i, j, nb;
+
+    size = fio->bDouble ? sizeof(double) : sizeof(float);
+    p    = mmap_get(fio, (gmx_off_t)size*n);
+    if (p == NULL)
+    {
+        return FALSE;
+    }
+    if (r == NULL)
+    {
+        return TRUE;
+    }
+    if (fio->bDouble == (sizeof(real) == sizeof(double)))
+    {
+        copy_from_xdr(r, p, size, n);
+        return TRUE;
+    }
+    /* Convert precision in blocks, using a small buffer */
+    for (i = 0; i < n; i += DIM)
+    {
+        nb = min(DIM, n - i);
+        if (fio->bDouble)
+        {
+            copy_from_xdr(dbuf, p + i*size, size, nb);
+            for (j = 0; j < nb; j++)
+            {
+                r[i + j] = dbuf[j];
+            }
+        }
+        else
+        {
+            copy_from_xdr(fbuf, p + i*size, size, nb);
+            for (j = 0; j < nb; j++)
+            {
+                r[i + j] = fbuf[j];
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static gmx_bool do_mmapread(t_fileio *fio, void *item, int nitem, int eio,
+                            const char *desc, const char *srcfile, int line)
+{
+    const unsigned char *p;
+    gmx_bool             res = FALSE;
+    int                  j, idum, imaj, imin, slen;
+    float                f;
+    double               d;
+
+    gmx_fio_check_nitem(fio, eio, nitem, srcfile, line);
+    switch (eio)
+    {
+        case eioREAL:
+            res = mmap_reals(fio, (real *)item, 1);
+            break;
+        case eioFLOAT:
+            p = mmap_get(fio, sizeof(float));
+            if ((res = (p != NULL)) && item)
+            {
+                copy_from_xdr(&f, p, sizeof(float), 1);
+                *(float *)item = f;
+            }
+            break;
+        case eioDOUBLE:
+            p = mmap_get(fio, sizeof(double));
+            if ((res = (p != NULL)) && item)
+            {
+                copy_from_xdr(&d, p, sizeof(double), 1);
+                *(double *)item = d;
+            }
+            break;
+        case eioINT:
+            res = mmap_int(fio, &idum);
+            if (res && item)
+            {
+                *(int *)item = idum;
+            }
+            break;
+        case eioGMX_LARGE_INT:
+            /* Same encoding as xdr_gmx_large_int */
+            res = mmap_int(fio, &imaj) && mmap_int(fio, &imin);
+            if (res && item)
+            {
+#if ((defined SIZEOF_GMX_LARGE_INT) && SIZEOF_GMX_LARGE_INT == 8)
+                *(gmx_large_int_t *)item =
+                    (((gmx_large_int_t)imaj << 32) |
+                     ((gmx_large_int_t)imin & 0xFFFFFFFF));
+#else
+                *(gmx_large_int_t *)item = imin;
+#endif
+            }
+            break;
+        case eioUCHAR:
+            res = mmap_int(fio, &idum);
+            if (res && item)
+            {
+                *(unsigned char *)item = idum;
+            }
+            break;
+        case eioNUCHAR:
+            res = TRUE;
+            for (j = 0; j < nitem && res; j++)
+            {
+                res = mmap_int(fio, &idum);
+                if (res && item)
+                {
+                    ((unsigned char *)item)[j] = idum;
+                }
+            }
+            break;
+        case eioUSHORT:
+            res = mmap_int(fio, &idum);
+            if (res && item)
+            {
+                *(unsigned short *)item = idum;
+            }
+            break;
+        case eioRVEC:
+            res = mmap_reals(fio, (real *)item, DIM);
+            break;
+        case eioNRVEC:
+            res = mmap_reals(fio, (real *)item, nitem*DIM);
+            break;
+        case eioIVEC:
+            res = TRUE;
+            for (j = 0; j < DIM && res; j++)
+            {
+                res = mmap_int(fio, &idum);
+                if (res && item)
+                {
+                    ((int *)item)[j] = idum;
+                }
+            }
+            break;
+        case eioSTRING:
+            /* The string length is stored twice, see do_xdr */
+            if (!mmap_int(fio, &slen))
+            {
+                gmx_fatal(FARGS, "wrong string length %d for string %s"
+                          " (source %s, line %d)", slen, desc, srcfile, line);
+            }
+            res = mmap_int(fio, &idum) && idum >= 0 && idum <= slen;
+            if (res)
+            {
+                p   = mmap_get(fio, (idum + 3)/4*4);
+                res = (p != NULL);
+            }
+            if (res && item)
+            {
+                memcpy(item, p, idum);
+                ((char *)item)[idum] = '\0';
+            }
+            break;
+        default:
+            gmx_fio_fe(fio, eio, desc, srcfile, line);
+    }
+    if (!res && fio->bDebug)
+    {
+        fprintf(stderr, "Error in xdr I/O %s %s to file %s (source %s, line %d)\n",
+                eioNames[eio], desc, fio->fn, srcfile, line);
+    }
+
+    return res;
+}
+
+
+static gmx_bool do_mmapwrite(t_fileio *fio, const void *item, int nitem, int eio,
+                             const char *desc, const char *srcfile, int line)
+{
+    gmx_fatal(FARGS, "Can not write %s %s to the read-only mapped file %s "
+              "(source %s, line %d)",
+              eioNames[eio], desc, fio->fn, srcfile, line);
+
+    return FALSE;
+}
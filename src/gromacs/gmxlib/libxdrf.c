@@ -46,6 +46,7 @@
 #include "string2.h"
 #include "futil.h"
 #include "gmx_fatal.h"
+#include "smalloc.h"
 
 
 #if 0
@@ -246,6 +247,38 @@ static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
     int          i, num_of_bytes, bytecnt;
     unsigned int bytes[32], tmp;
 
+#if SIZEOF_GMX_LARGE_INT == 8
+    if (num_of_bits < 64)
+    {
+        /* The combined integer fits in a 64-bit integer, so we can
+         * multiply it together directly instead of byte by byte.
+         * This produces exactly the same bits as the general code below.
+         */
+        gmx_large_int_t num;
+
+        num = nums[0];
+        for (i = 1; i < num_of_ints; i++)
+        {
+            if (nums[i] >= sizes[i])
+            {
+                fprintf(stderr, "major breakdown in sendints num %u doesn't "
+                        "match size %u\n", nums[i], sizes[i]);
+                exit(1);
+            }
+            num = num*sizes[i] + nums[i];
+        }
+        for (i = 0; i + 8 <= num_of_bits; i += 8)
+        {
+            sendbits(buf, 8, (int)((num >> i) & 0xff));
+        }
+        if (i < num_of_bits)
+        {
+            sendbits(buf, num_of_bits - i, (int)(num >> i));
+        }
+        return;
+    }
+#endif
+
     tmp          = nums[0];
     num_of_bytes = 0;
     do
@@ -360,6 +393,33 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
     int bytes[32];
     int i, j, num_of_bytes, p, num;
 
+#if SIZEOF_GMX_LARGE_INT == 8
+    if (num_of_bits < 64)
+    {
+        /* The combined integer fits in a 64-bit integer, so we only need
+         * one division per size instead of one per byte.
+         */
+        gmx_large_int_t big;
+
+        big = 0;
+        for (j = 0; j + 8 < num_of_bits; j += 8)
+        {
+            big |= (gmx_large_int_t)receivebits(buf, 8) << j;
+        }
+        if (j < num_of_bits)
+        {
+            big |= (gmx_large_int_t)receivebits(buf, num_of_bits - j) << j;
+        }
+        for (i = num_of_ints-1; i > 0; i--)
+        {
+            nums[i] = (int)(big % sizes[i]);
+            big    /= sizes[i];
+        }
+        nums[0] = (int)big;
+        return;
+    }
+#endif
+
     bytes[0]     = bytes[1] = bytes[2] = bytes[3] = 0;
     num_of_bytes = 0;
     while (num_of_bits > 8)
@@ -386,6 +446,238 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
     nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
 }
 
+void xdr3dfcoord_data_init(t_xdr3dfcoord_data *data)
+{
+    data->size      = 0;
+    data->precision = -1;
+    data->nalloc    = 0;
+    data->buf       = NULL;
+}
+
+void xdr3dfcoord_data_done(t_xdr3dfcoord_data *data)
+{
+    sfree(data->buf);
+    xdr3dfcoord_data_init(data);
+}
+
+int xdr3dfcoord_read_data(XDR *xdrs, t_xdr3dfcoord_data *data, int *size)
+{
+    int lsize, byte_cnt, nint;
+
+    if (xdr_int(xdrs, &lsize) == 0)
+    {
+        return 0;
+    }
+    if (*size != 0 && lsize != *size)
+    {
+        fprintf(stderr, "wrong number of coordinates in xdr3dfcoord; "
+                "%d arg vs %d in file", *size, lsize);
+    }
+    *size      = lsize;
+    data->size = lsize;
+    if (lsize <= 9)
+    {
+        data->precision = -1;
+        return (xdr_vector(xdrs, (char *) data->xsmall, (unsigned int)(lsize*3),
+                           (unsigned int)sizeof(*data->xsmall), (xdrproc_t)xdr_float));
+    }
+    if (xdr_float(xdrs, &(data->precision)) == 0)
+    {
+        return 0;
+    }
+    if ( (xdr_int(xdrs, &(data->minint[0])) == 0) ||
+         (xdr_int(xdrs, &(data->minint[1])) == 0) ||
+         (xdr_int(xdrs, &(data->minint[2])) == 0) ||
+         (xdr_int(xdrs, &(data->maxint[0])) == 0) ||
+         (xdr_int(xdrs, &(data->maxint[1])) == 0) ||
+         (xdr_int(xdrs, &(data->maxint[2])) == 0) ||
+         (xdr_int(xdrs, &(data->smallidx)) == 0))
+    {
+        return 0;
+    }
+    if (data->smallidx < FIRSTIDX || data->smallidx >= (int)LASTIDX)
+    {
+        return 0;
+    }
+
+    /* the length in bytes */
+    if (xdr_int(xdrs, &byte_cnt) == 0 || byte_cnt < 0)
+    {
+        return 0;
+    }
+    /* 3 ints for the bit reading state, the bytes and one int of slack */
+    nint = 3 + byte_cnt/sizeof(int) + 2;
+    if (nint > data->nalloc)
+    {
+        data->nalloc = over_alloc_small(nint);
+        srenew(data->buf, data->nalloc);
+    }
+    data->buf[0] = byte_cnt;
+
+    return xdr_opaque(xdrs, (char *)&(data->buf[3]), (unsigned int)byte_cnt);
+}
+
+int xdr3dfcoord_decompress(t_xdr3dfcoord_data *data, float *fp, float *precision)
+{
+    int          minint[3], *buf;
+    int          lint[2*3], *thiscoord, prevcoord[3];
+    int          lsize, smallidx, flag, k, i;
+    int          smallnum, smaller, is_smaller, run, tmp;
+    unsigned int sizeint[3], sizesmall[3], bitsizeint[3], bitsize;
+    float       *lfp, inv_precision;
+
+    lsize = data->size;
+    if (lsize <= 9)
+    {
+        *precision = -1;
+        for (i = 0; i < lsize*3; i++)
+        {
+            fp[i] = data->xsmall[i];
+        }
+        return 1;
+    }
+    *precision = data->precision;
+
+    buf           = data->buf;
+    bitsizeint[0] = bitsizeint[1] = bitsizeint[2] = 0;
+    prevcoord[0]  = prevcoord[1]  = prevcoord[2]  = 0;
+    minint[0]     = data->minint[0];
+    minint[1]     = data->minint[1];
+    minint[2]     = data->minint[2];
+
+    sizeint[0] = data->maxint[0] - minint[0]+1;
+    sizeint[1] = data->maxint[1] - minint[1]+1;
+    sizeint[2] = data->maxint[2] - minint[2]+1;
+
+    /* check if one of the sizes is to big to be multiplied */
+    if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff)
+    {
+        bitsizeint[0] = sizeofint(sizeint[0]);
+        bitsizeint[1] = sizeofint(sizeint[1]);
+        bitsizeint[2] = sizeofint(sizeint[2]);
+        bitsize       = 0; /* flag the use of large sizes */
+    }
+    else
+    {
+        bitsize = sizeofints(3, sizeint);
+    }
+
+    smallidx     = data->smallidx;
+    smaller      = magicints[MAX(FIRSTIDX, smallidx-1)] / 2;
+    smallnum     = magicints[smallidx] / 2;
+    sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+
+    buf[0] = buf[1] = buf[2] = 0;
+
+    lfp           = fp;
+    inv_precision = 1.0 / *precision;
+    run           = 0;
+    i             = 0;
+    while (i < lsize)
+    {
+        thiscoord = lint;
+
+        if (bitsize == 0)
+        {
+            thiscoord[0] = receivebits(buf, bitsizeint[0]);
+            thiscoord[1] = receivebits(buf, bitsizeint[1]);
+            thiscoord[2] = receivebits(buf, bitsizeint[2]);
+        }
+        else
+        {
+            receiveints(buf, 3, bitsize, sizeint, thiscoord);
+        }
+
+        i++;
+        thiscoord[0] += minint[0];
+        thiscoord[1] += minint[1];
+        thiscoord[2] += minint[2];
+
+        prevcoord[0] = thiscoord[0];
+        prevcoord[1] = thiscoord[1];
+        prevcoord[2] = thiscoord[2];
+
+
+        flag       = receivebits(buf, 1);
+        is_smaller = 0;
+        if (flag == 1)
+        {
+            run        = receivebits(buf, 5);
+            is_smaller = run % 3;
+            run       -= is_smaller;
+            is_smaller--;
+        }
+        if (run > 0)
+        {
+            if (i + run/3 > lsize)
+            {
+                /* corrupt data, the run extends beyond the last atom */
+                return 0;
+            }
+            thiscoord += 3;
+            for (k = 0; k < run; k += 3)
+            {
+                receiveints(buf, 3, smallidx, sizesmall, thiscoord);
+                i++;
+                thiscoord[0] += prevcoord[0] - smallnum;
+                thiscoord[1] += prevcoord[1] - smallnum;
+                thiscoord[2] += prevcoord[2] - smallnum;
+                if (k == 0)
+                {
+                    /* interchange first with second atom for better
+                     * compression of water molecules
+                     */
+                    tmp          = thiscoord[0]; thiscoord[0] = prevcoord[0];
+                    prevcoord[0] = tmp;
+                    tmp          = thiscoord[1]; thiscoord[1] = prevcoord[1];
+                    prevcoord[1] = tmp;
+                    tmp          = thiscoord[2]; thiscoord[2] = prevcoord[2];
+                    prevcoord[2] = tmp;
+                    *lfp++       = prevcoord[0] * inv_precision;
+                    *lfp++       = prevcoord[1] * inv_precision;
+                    *lfp++       = prevcoord[2] * inv_precision;
+                }
+                else
+                {
+                    prevcoord[0] = thiscoord[0];
+                    prevcoord[1] = thiscoord[1];
+                    prevcoord[2] = thiscoord[2];
+                }
+                *lfp++ = thiscoord[0] * inv_precision;
+                *lfp++ = thiscoord[1] * inv_precision;
+                *lfp++ = thiscoord[2] * inv_precision;
+            }
+        }
+        else
+        {
+            *lfp++ = thiscoord[0] * inv_precision;
+            *lfp++ = thiscoord[1] * inv_precision;
+            *lfp++ = thiscoord[2] * inv_precision;
+        }
+        smallidx += is_smaller;
+        if (is_smaller < 0)
+        {
+            smallnum = smaller;
+            if (smallidx > FIRSTIDX)
+            {
+                smaller = magicints[smallidx - 1] /2;
+            }
+            else
+            {
+                smaller = 0;
+            }
+        }
+        else if (is_smaller > 0)
+        {
+            smaller  = smallnum;
+            smallnum = magicints[smallidx] / 2;
+        }
+        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
+    }
+
+    return 1;
+}
+
 /*____________________________________________________________________________
  |
  | xdr3dfcoord - read or write compressed 3d coordinates to xdr file.
@@ -440,6 +732,7 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
     float        inv_precision;
     int          errval = 1;
     int          rc;
+    t_xdr3dfcoord_data data;
 
     bRead         = (xdrs->x_op == XDR_DECODE);
     bitsizeint[0] = bitsizeint[1] = bitsizeint[2] = 0;
@@ -790,235 +1083,17 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
     }
     else
     {
-
         /* xdrs is open for reading */
-
-        if (xdr_int(xdrs, &lsize) == 0)
-        {
-            return 0;
-        }
-        if (*size != 0 && lsize != *size)
-        {
-            fprintf(stderr, "wrong number of coordinates in xdr3dfcoord; "
-                    "%d arg vs %d in file", *size, lsize);
-        }
-        *size = lsize;
-        size3 = *size * 3;
-        if (*size <= 9)
-        {
-            *precision = -1;
-            return (xdr_vector(xdrs, (char *) fp, (unsigned int)size3,
-                               (unsigned int)sizeof(*fp), (xdrproc_t)xdr_float));
-        }
-        if (xdr_float(xdrs, precision) == 0)
-        {
-            return 0;
-        }
-
-        if (size3 <= prealloc_size)
-        {
-            ip  = prealloc_ip;
-            buf = prealloc_buf;
-        }
-        else
-        {
-            we_should_free = 1;
-            bufsize        = size3 * 1.2;
-            ip             = (int *)malloc((size_t)(size3 * sizeof(*ip)));
-            buf            = (int *)malloc((size_t)(bufsize * sizeof(*buf)));
-            if (ip == NULL || buf == NULL)
-            {
-                fprintf(stderr, "malloc failed\n");
-                exit(1);
-            }
-        }
-
-        buf[0] = buf[1] = buf[2] = 0;
-
-        if ( (xdr_int(xdrs, &(minint[0])) == 0) ||
-             (xdr_int(xdrs, &(minint[1])) == 0) ||
-             (xdr_int(xdrs, &(minint[2])) == 0) ||
-             (xdr_int(xdrs, &(maxint[0])) == 0) ||
-             (xdr_int(xdrs, &(maxint[1])) == 0) ||
-             (xdr_int(xdrs, &(maxint[2])) == 0))
-        {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
-            return 0;
-        }
-
-        sizeint[0] = maxint[0] - minint[0]+1;
-        sizeint[1] = maxint[1] - minint[1]+1;
-        sizeint[2] = maxint[2] - minint[2]+1;
-
-        /* check if one of the sizes is to big to be multiplied */
-        if ((sizeint[0] | sizeint[1] | sizeint[2] ) > 0xffffff)
-        {
-            bitsizeint[0] = sizeofint(sizeint[0]);
-            bitsizeint[1] = sizeofint(sizeint[1]);
-            bitsizeint[2] = sizeofint(sizeint[2]);
-            bitsize       = 0; /* flag the use of large sizes */
-        }
-        else
-        {
-            bitsize = sizeofints(3, sizeint);
-        }
-
-        if (xdr_int(xdrs, &smallidx) == 0)
-        {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
-            return 0;
-        }
-
-        maxidx       = MIN(LASTIDX, smallidx + 8);
-        minidx       = maxidx - 8; /* often this equal smallidx */
-        smaller      = magicints[MAX(FIRSTIDX, smallidx-1)] / 2;
-        smallnum     = magicints[smallidx] / 2;
-        sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
-        larger       = magicints[maxidx];
-
-        /* buf[0] holds the length in bytes */
-
-        if (xdr_int(xdrs, &(buf[0])) == 0)
+        xdr3dfcoord_data_init(&data);
+        rc = xdr3dfcoord_read_data(xdrs, &data, size);
+        if (rc)
         {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
-            return 0;
+            rc = xdr3dfcoord_decompress(&data, fp, precision);
         }
+        xdr3dfcoord_data_done(&data);
 
-
-        if (xdr_opaque(xdrs, (char *)&(buf[3]), (unsigned int)buf[0]) == 0)
-        {
-            if (we_should_free)
-            {
-                free(ip);
-                free(buf);
-            }
-            return 0;
-        }
-
-
-
-        buf[0] = buf[1] = buf[2] = 0;
-
-        lfp           = fp;
-        inv_precision = 1.0 / *precision;
-        run           = 0;
-        i             = 0;
-        lip           = ip;
-        while (i < lsize)
-        {
-            thiscoord = (int *)(lip) + i * 3;
-
-            if (bitsize == 0)
-            {
-                thiscoord[0] = receivebits(buf, bitsizeint[0]);
-                thiscoord[1] = receivebits(buf, bitsizeint[1]);
-                thiscoord[2] = receivebits(buf, bitsizeint[2]);
-            }
-            else
-            {
-                receiveints(buf, 3, bitsize, sizeint, thiscoord);
-            }
-
-            i++;
-            thiscoord[0] += minint[0];
-            thiscoord[1] += minint[1];
-            thiscoord[2] += minint[2];
-
-            prevcoord[0] = thiscoord[0];
-            prevcoord[1] = thiscoord[1];
-            prevcoord[2] = thiscoord[2];
-
-
-            flag       = receivebits(buf, 1);
-            is_smaller = 0;
-            if (flag == 1)
-            {
-                run        = receivebits(buf, 5);
-                is_smaller = run % 3;
-                run       -= is_smaller;
-                is_smaller--;
-            }
-            if (run > 0)
-            {
-                thiscoord += 3;
-                for (k = 0; k < run; k += 3)
-                {
-                    receiveints(buf, 3, smallidx, sizesmall, thiscoord);
-                    i++;
-                    thiscoord[0] += prevcoord[0] - smallnum;
-                    thiscoord[1] += prevcoord[1] - smallnum;
-                    thiscoord[2] += prevcoord[2] - smallnum;
-                    if (k == 0)
-                    {
-                        /* interchange first with second atom for better
-                         * compression of water molecules
-                         */
-                        tmp          = thiscoord[0]; thiscoord[0] = prevcoord[0];
-                        prevcoord[0] = tmp;
-                        tmp          = thiscoord[1]; thiscoord[1] = prevcoord[1];
-                        prevcoord[1] = tmp;
-                        tmp          = thiscoord[2]; thiscoord[2] = prevcoord[2];
-                        prevcoord[2] = tmp;
-                        *lfp++       = prevcoord[0] * inv_precision;
-                        *lfp++       = prevcoord[1] * inv_precision;
-                        *lfp++       = prevcoord[2] * inv_precision;
-                    }
-                    else
-                    {
-                        prevcoord[0] = thiscoord[0];
-                        prevcoord[1] = thiscoord[1];
-                        prevcoord[2] = thiscoord[2];
-                    }
-                    *lfp++ = thiscoord[0] * inv_precision;
-                    *lfp++ = thiscoord[1] * inv_precision;
-                    *lfp++ = thiscoord[2] * inv_precision;
-                }
-            }
-            else
-            {
-                *lfp++ = thiscoord[0] * inv_precision;
-                *lfp++ = thiscoord[1] * inv_precision;
-                *lfp++ = thiscoord[2] * inv_precision;
-            }
-            smallidx += is_smaller;
-            if (is_smaller < 0)
-            {
-                smallnum = smaller;
-                if (smallidx > FIRSTIDX)
-                {
-                    smaller = magicints[smallidx - 1] /2;
-                }
-                else
-                {
-                    smaller = 0;
-                }
-            }
-            else if (is_smaller > 0)
-            {
-                smaller  = smallnum;
-                smallnum = magicints[smallidx] / 2;
-            }
-            sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
-        }
-    }
-    if (we_should_free)
-    {
-        free(ip);
-        free(buf);
+        return rc;
     }
-    return 1;
 }
 
 
@@ -1680,3 +1755,361 @@ xdr_xtc_get_last_frame_number(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bOK)
 
     return frame;
 }
+
+
+/* Magic number and version of the xtc frame index file */
+#define XTC_INDEX_MAGIC   1996
+#define XTC_INDEX_VERSION 1
+
+void xdr_xtc_index_init(t_xtc_index *index, int natoms)
+{
+    index->natoms  = natoms;
+    index->nframes = 0;
+    index->nalloc  = 0;
+    index->offset  = NULL;
+    index->step    = NULL;
+    index->time    = NULL;
+    index->bSorted = TRUE;
+    index->end     = 0;
+}
+
+void xdr_xtc_index_done(t_xtc_index *index)
+{
+    sfree(index->offset);
+    sfree(index->step);
+    sfree(index->time);
+    xdr_xtc_index_init(index, index->natoms);
+}
+
+static void xtc_index_add_frame(t_xtc_index *index, gmx_off_t offset,
+                                int step, float time)
+{
+    if (index->nframes == index->nalloc)
+    {
+        index->nalloc = over_alloc_large(index->nframes + 1);
+        srenew(index->offset, index->nalloc);
+        srenew(index->step, index->nalloc);
+        srenew(index->time, index->nalloc);
+    }
+    if (index->nframes > 0 && time < index->time[index->nframes-1])
+    {
+        index->bSorted = FALSE;
+    }
+    index->offset[index->nframes] = offset;
+    index->step[index->nframes]   = step;
+    index->time[index->nframes]   = time;
+    index->nframes++;
+}
+
+/* Reads the header of the frame at the current position and returns
+ * the size in bytes of the whole frame, or -1 when there is no valid
+ * frame header with natoms atoms at the current position.
+ * The layout follows what write_xtc and xdr3dfcoord write.
+ */
+static gmx_off_t xtc_get_frame_size(XDR *xdrs, int natoms,
+                                    int *step, float *time)
+{
+    int       i_inp[3];
+    float     f_inp[DIM*DIM+1];
+    int       i, lsize, byte_cnt;
+    gmx_off_t size;
+
+    /* magic, natoms, step, time and box */
+    for (i = 0; i < 3; i++)
+    {
+        if (!xdr_int(xdrs, &(i_inp[i])))
+        {
+            return -1;
+        }
+    }
+    if (i_inp[0] != XTC_MAGIC || i_inp[1] != natoms)
+    {
+        return -1;
+    }
+    for (i = 0; i < DIM*DIM+1; i++)
+    {
+        if (!xdr_float(xdrs, &(f_inp[i])))
+        {
+            return -1;
+        }
+    }
+    *step = i_inp[2];
+    *time = f_inp[0];
+    size  = 3*XDR_INT_SIZE + (DIM*DIM+1)*XDR_INT_SIZE;
+
+    /* the coordinates, see xdr3dfcoord */
+    if (!xdr_int(xdrs, &lsize) || lsize != natoms)
+    {
+        return -1;
+    }
+    size += XDR_INT_SIZE;
+    if (lsize <= 9)
+    {
+        return size + lsize*DIM*XDR_INT_SIZE;
+    }
+    /* precision, minint, maxint and smallidx, followed by the byte count */
+    for (i = 0; i < 2*DIM+3; i++)
+    {
+        if (!xdr_int(xdrs, &byte_cnt))
+        {
+            return -1;
+        }
+    }
+    if (byte_cnt < 0)
+    {
+        return -1;
+    }
+    size += (2*DIM+3)*XDR_INT_SIZE;
+    /* the opaque data is padded to a multiple of 4 bytes */
+    size += ((byte_cnt + XDR_INT_SIZE - 1)/XDR_INT_SIZE)*XDR_INT_SIZE;
+
+    return size;
+}
+
+int xdr_xtc_index_update(t_xtc_index *index, FILE *fp, XDR *xdrs)
+{
+    gmx_off_t pos, fsize, off, size;
+    int       step, nframes_old;
+    float     time;
+
+    if ((pos = gmx_ftell(fp)) < 0)
+    {
+        return -1;
+    }
+    if (gmx_fseek(fp, 0, SEEK_END) || (fsize = gmx_ftell(fp)) < 0)
+    {
+        return -1;
+    }
+
+    nframes_old = index->nframes;
+    off         = index->end;
+    while (off + header_size <= fsize)
+    {
+        if (gmx_fseek(fp, off, SEEK_SET))
+        {
+            return -1;
+        }
+        size = xtc_get_frame_size(xdrs, index->natoms, &step, &time);
+        /* Stop at a corrupt or incompletely written frame */
+        if (size < 0 || off + size > fsize)
+        {
+            break;
+        }
+        xtc_index_add_frame(index, off, step, time);
+        off += size;
+    }
+    index->end = off;
+
+    if (gmx_fseek(fp, pos, SEEK_SET))
+    {
+        return -1;
+    }
+
+    return index->nframes - nframes_old;
+}
+
+int xdr_xtc_index_find_time(const t_xtc_index *index, int first, real time)
+{
+    int low, high, mid;
+
+    if (!index->bSorted)
+    {
+        while (first < index->nframes && index->time[first] < time)
+        {
+            first++;
+        }
+        return first;
+    }
+
+    low  = first;
+    high = index->nframes;
+    while (low < high)
+    {
+        mid = low + (high - low)/2;
+        if (index->time[mid] < time)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+int xdr_xtc_index_find_step(const t_xtc_index *index, int first, int step)
+{
+    int low, high, mid;
+
+    low  = first;
+    high = index->nframes;
+    while (low < high)
+    {
+        mid = low + (high - low)/2;
+        if (index->step[mid] < step)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+int xdr_xtc_index_find_offset(const t_xtc_index *index, gmx_off_t offset)
+{
+    int low, high, mid;
+
+    low  = 0;
+    high = index->nframes;
+    while (low < high)
+    {
+        mid = low + (high - low)/2;
+        if (index->offset[mid] < offset)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return (low < index->nframes && index->offset[low] == offset) ? low : -1;
+}
+
+/* Checks that the header of the frame at offset matches the step and time
+ * stored in the index for that frame.
+ */
+static gmx_bool xtc_index_check_frame(const t_xtc_index *index, int frame,
+                                      FILE *fp, XDR *xdrs)
+{
+    int   step;
+    float time;
+
+    if (gmx_fseek(fp, index->offset[frame], SEEK_SET))
+    {
+        return FALSE;
+    }
+
+    return (xtc_get_frame_size(xdrs, index->natoms, &step, &time) > 0 &&
+            step == index->step[frame] && time == index->time[frame]);
+}
+
+int xdr_xtc_index_read(t_xtc_index *index, const char *fn, FILE *fp, XDR *xdrs)
+{
+    FILE           *fp_index;
+    XDR             xdr_index;
+    int             magic, version, natoms, nframes, i, step;
+    float           time;
+    gmx_large_int_t lint;
+    gmx_off_t       pos;
+    gmx_bool        bOK;
+
+    xdr_xtc_index_done(index);
+
+    if ((fp_index = fopen(fn, "rb")) == NULL)
+    {
+        return FALSE;
+    }
+    xdrstdio_create(&xdr_index, fp_index, XDR_DECODE);
+
+    bOK = (xdr_int(&xdr_index, &magic) && magic == XTC_INDEX_MAGIC &&
+           xdr_int(&xdr_index, &version) && version == XTC_INDEX_VERSION &&
+           xdr_int(&xdr_index, &natoms) && natoms == index->natoms &&
+           xdr_int(&xdr_index, &nframes) && nframes > 0);
+    for (i = 0; i < nframes && bOK; i++)
+    {
+        bOK = (xdr_gmx_large_int(&xdr_index, &lint, NULL) &&
+               xdr_int(&xdr_index, &step) &&
+               xdr_float(&xdr_index, &time));
+        if (bOK)
+        {
+            xtc_index_add_frame(index, (gmx_off_t)lint, step, time);
+        }
+    }
+    xdr_destroy(&xdr_index);
+    fclose(fp_index);
+
+    /* Check the stored index against the xtc file, which might have been
+     * truncated or overwritten since the index was written.
+     */
+    if (bOK && (pos = gmx_ftell(fp)) >= 0)
+    {
+        bOK = (xtc_index_check_frame(index, 0, fp, xdrs) &&
+               xtc_index_check_frame(index, nframes-1, fp, xdrs));
+        if (gmx_fseek(fp, pos, SEEK_SET))
+        {
+            bOK = FALSE;
+        }
+    }
+    else
+    {
+        bOK = FALSE;
+    }
+
+    if (bOK)
+    {
+        /* The end of the last frame is not stored, so we let
+         * xdr_xtc_index_update index the last frame again.
+         */
+        index->nframes--;
+        index->end = index->offset[index->nframes];
+    }
+    else
+    {
+        xdr_xtc_index_done(index);
+    }
+
+    return bOK;
+}
+
+int xdr_xtc_index_write(const t_xtc_index *index, const char *fn)
+{
+    FILE           *fp_index;
+    XDR             xdr_index;
+    int             magic   = XTC_INDEX_MAGIC;
+    int             version = XTC_INDEX_VERSION;
+    int             natoms, nframes, i, step;
+    float           time;
+    gmx_large_int_t lint;
+    gmx_bool        bOK;
+
+    if ((fp_index = fopen(fn, "wb")) == NULL)
+    {
+        return FALSE;
+    }
+    xdrstdio_create(&xdr_index, fp_index, XDR_ENCODE);
+
+    natoms  = index->natoms;
+    nframes = index->nframes;
+    bOK     = (xdr_int(&xdr_index, &magic) &&
+               xdr_int(&xdr_index, &version) &&
+               xdr_int(&xdr_index, &natoms) &&
+               xdr_int(&xdr_index, &nframes));
+    for (i = 0; i < nframes && bOK; i++)
+    {
+        lint = index->offset[i];
+        step = index->step[i];
+        time = index->time[i];
+        bOK  = (xdr_gmx_large_int(&xdr_index, &lint, NULL) &&
+                xdr_int(&xdr_index, &step) &&
+                xdr_float(&xdr_index, &time));
+    }
+    xdr_destroy(&xdr_index);
+    if (fclose(fp_index) != 0)
+    {
+        bOK = FALSE;
+    }
+    if (!bOK)
+    {
+        remove(fn);
+    }
+
+    return bOK;
+}
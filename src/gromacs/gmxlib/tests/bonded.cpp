@@ -0,0 +1,191 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the bonded kernels without energies.
+ *
+ * Checks that the (SIMD) bonds, angles, Urey-Bradley and Ryckaert-Bellemans
+ * kernels without energies and shift forces return the same forces as
+ * the full scalar kernels. The number of interactions is not a multiple
+ * of the SIMD width and consecutive interactions share atoms, so both
+ * the remainder handling and the force scatter are tested.
+ */
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "bondf.h"
+#include "vec.h"
+
+namespace
+{
+
+/*! \brief
+ * Compares a bonded kernel without energies to the reference kernel.
+ */
+class BondedNoEnerTest : public ::testing::Test
+{
+    public:
+        //! Number of interactions, not a multiple of the SIMD width
+        static const int c_numBonds = 19;
+        //! Number of parameter types
+        static const int c_numTypes = 2;
+
+        BondedNoEnerTest() : x_((c_numBonds + 3)*DIM), iparams_(c_numTypes)
+        {
+            /* A chain with kinks, with a simple generator
+             * for a reproducible geometry.
+             */
+            unsigned int seed = 1234567;
+
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                seed  = 1664525U*seed + 1013904223U;
+                x_[i] = 0.1*(i/DIM) + 0.1*(seed >> 8)/(1 << 24);
+            }
+        }
+
+        //! Returns \p x as an rvec array
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        //! Sets up interactions of \p nratoms consecutive atoms
+        void setAtoms(int nratoms)
+        {
+            iatoms_.clear();
+            for (int i = 0; i < c_numBonds; i++)
+            {
+                iatoms_.push_back(i % c_numTypes);
+                for (int a = 0; a < nratoms; a++)
+                {
+                    iatoms_.push_back(i + a);
+                }
+            }
+        }
+
+        //! Runs \p ifunc and \p noener and compares the forces
+        void compare(t_ifunc ifunc,
+                     void (*noener)(int, const t_iatom[], const t_iparams[],
+                                    const rvec[], rvec[], const t_pbc *))
+        {
+            std::vector<real> fRef(x_.size(), 0), f(x_.size(), 0);
+            rvec              fshift[SHIFTS];
+            real              dvdl = 0, fmax = 0;
+
+            for (int s = 0; s < SHIFTS; s++)
+            {
+                clear_rvec(fshift[s]);
+            }
+            ifunc(iatoms_.size(), &iatoms_[0], &iparams_[0],
+                  as_rvec(&x_), as_rvec(&fRef), fshift,
+                  NULL, NULL, 0, &dvdl, NULL, NULL, NULL);
+            noener(iatoms_.size(), &iatoms_[0], &iparams_[0],
+                   as_rvec(&x_), as_rvec(&f), NULL);
+
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                fmax = std::max(fmax, std::fabs(fRef[i]));
+            }
+            ASSERT_GT(fmax, 0);
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                EXPECT_NEAR(fRef[i], f[i], 1e-4*fmax)
+                << "atom " << i/DIM << " dim " << i % DIM;
+            }
+        }
+
+        std::vector<real>      x_;
+        std::vector<t_iatom>   iatoms_;
+        std::vector<t_iparams> iparams_;
+};
+
+TEST_F(BondedNoEnerTest, Bonds)
+{
+    iparams_[0].harmonic.rA  = 0.10;
+    iparams_[0].harmonic.krA = 3e5;
+    iparams_[1].harmonic.rA  = 0.15;
+    iparams_[1].harmonic.krA = 2e5;
+    setAtoms(2);
+    compare(bonds, bonds_noener);
+}
+
+TEST_F(BondedNoEnerTest, Angles)
+{
+    iparams_[0].harmonic.rA  = 109.5;
+    iparams_[0].harmonic.krA = 400;
+    iparams_[1].harmonic.rA  = 120;
+    iparams_[1].harmonic.krA = 600;
+    setAtoms(3);
+    compare(angles, angles_noener);
+}
+
+TEST_F(BondedNoEnerTest, UreyBradley)
+{
+    iparams_[0].u_b.thetaA  = 109.5;
+    iparams_[0].u_b.kthetaA = 400;
+    iparams_[0].u_b.r13A    = 0.16;
+    iparams_[0].u_b.kUBA    = 2e4;
+    iparams_[1].u_b.thetaA  = 120;
+    iparams_[1].u_b.kthetaA = 600;
+    iparams_[1].u_b.r13A    = 0.25;
+    iparams_[1].u_b.kUBA    = 1e4;
+    setAtoms(3);
+    compare(urey_bradley, urey_bradley_noener);
+}
+
+TEST_F(BondedNoEnerTest, RBDihedrals)
+{
+    const real c[c_numTypes][NR_RBDIHS] = {
+        { 9.28, 12.16, -13.12, -3.06, 26.24, -31.5 },
+        { 0.63, 1.88, 0, -2.51, 0, 0 }
+    };
+
+    for (int t = 0; t < c_numTypes; t++)
+    {
+        for (int i = 0; i < NR_RBDIHS; i++)
+        {
+            iparams_[t].rbdihs.rbcA[i] = c[t][i];
+        }
+    }
+    setAtoms(4);
+    compare(rbdihs, rbdihs_noener);
+}
+
+} // namespace
@@ -0,0 +1,349 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for distributed checkpoints written with write_checkpoint_part.
+ *
+ * The state is split over several parts, which are written in a different
+ * order than the atoms and the parts. Reading the checkpoint should give
+ * back the original state, and converting it, as gmxdump -ocp does, should
+ * give a file that lists the same as a single-file checkpoint of that state.
+ * A missing part, a duplicate atom and a part of another step should give
+ * a fatal error.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testfilemanager.h"
+
+#include "typedefs.h"
+#include "checkpoint.h"
+#include "futil.h"
+#include "gmx_fatal.h"
+#include "smalloc.h"
+#include "vec.h"
+
+namespace
+{
+
+using gmx::test::TestFileManager;
+
+//! Number of atoms, number of parts and the checkpoint step.
+const int c_natoms = 31;
+const int c_nparts = 3;
+const int c_step   = 20;
+
+/*! \brief
+ * Error handler for the death tests.
+ *
+ * gmx_fatal exits with status 0, which gtest does not count as death.
+ */
+void exitOnFatalError(const char *msg)
+{
+    std::fprintf(stderr, "%s\n", msg);
+    std::exit(1);
+}
+
+class CheckpointPartsTest : public ::testing::Test
+{
+    public:
+        CheckpointPartsTest()
+        {
+            /* The death tests re-run the test in a new process,
+             * which also works when other threads have been started.
+             */
+            ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+            cptName_ = tempFiles_.getTemporaryFilePath("state.cpt");
+            refName_ = tempFiles_.getTemporaryFilePath("ref.cpt");
+            tempFiles_.getTemporaryFilePath("state_prev.cpt");
+            tempFiles_.getTemporaryFilePath("state_step20.cpt");
+            tempFiles_.getTemporaryFilePath("ref_step20.cpt");
+
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+
+            /* init_state does not initialize all members */
+            std::memset(&state_, 0, sizeof(state_));
+            init_state(&state_, c_natoms, 1, 0, 0, 0);
+            state_.flags = (1<<estBOX) | (1<<estX) | (1<<estV) | (1<<estSDX);
+            snew(state_.sd_X, c_natoms);
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    state_.x[i][d]    = 0.1*i + 0.3*d;
+                    state_.v[i][d]    = -0.05*i + d;
+                    state_.sd_X[i][d] = 0.01*i*(d + 1);
+                }
+            }
+            for (int d = 0; d < DIM; d++)
+            {
+                state_.box[d][d] = 3.5 + d;
+            }
+        }
+
+        ~CheckpointPartsTest()
+        {
+            done_state(&state_);
+        }
+
+        //! Returns the name of a part file, which is removed after the test.
+        std::string partName(int part, int step)
+        {
+            char buf[STRLEN];
+
+            std::sprintf(buf, "state_step%d_part%d.cpt", step, part);
+
+            return tempFiles_.getTemporaryFilePath(buf);
+        }
+
+        /*! \brief
+         * Returns the global atom indices of a part.
+         *
+         * The atoms are distributed round-robin over the parts,
+         * in decreasing order within each part.
+         */
+        static std::vector<int> partIndex(int part)
+        {
+            std::vector<int> index;
+
+            for (int a = c_natoms - 1; a >= 0; a--)
+            {
+                if (a % c_nparts == part)
+                {
+                    index.push_back(a);
+                }
+            }
+
+            return index;
+        }
+
+        //! Writes the atoms index of the state as part file part.
+        void writePart(int part, int step, const std::vector<int> &index)
+        {
+            std::vector<int> localIndex(index);
+            int              nhome = localIndex.size();
+            t_state          local;
+            rvec            *x, *v, *sd_X;
+
+            snew(x, nhome);
+            snew(v, nhome);
+            snew(sd_X, nhome);
+            for (int i = 0; i < nhome; i++)
+            {
+                copy_rvec(state_.x[index[i]], x[i]);
+                copy_rvec(state_.v[index[i]], v[i]);
+                copy_rvec(state_.sd_X[index[i]], sd_X[i]);
+            }
+            std::memset(&local, 0, sizeof(local));
+            local.natoms = nhome;
+            local.flags  = state_.flags;
+            local.x      = x;
+            local.v      = v;
+            local.sd_X   = sd_X;
+            /* Avoid a backup of the part that is replaced */
+            std::remove(partName(part, step).c_str());
+            write_checkpoint_part(cptName_.c_str(), step, part, c_nparts,
+                                  c_natoms, nhome, &localIndex[0], &local);
+            sfree(x);
+            sfree(v);
+            sfree(sd_X);
+        }
+
+        //! Writes the parts, last part first, and then the checkpoint file.
+        void writeDistributed()
+        {
+            for (int p = c_nparts - 1; p >= 0; p--)
+            {
+                writePart(p, c_step, partIndex(p));
+            }
+            write_checkpoint(cptName_.c_str(), FALSE, NULL, &cr_, eiSD1, 1,
+                             FALSE, 0, c_step, 0.002*c_step, &state_, c_nparts);
+        }
+
+        //! Reads the checkpoint fn into state.
+        static void readState(const std::string &fn, t_state *state)
+        {
+            int             simulation_part;
+            gmx_large_int_t step;
+            double          t;
+
+            std::memset(state, 0, sizeof(*state));
+            init_state(state, 0, 0, 0, 0, 0);
+            read_checkpoint_state(fn.c_str(), &simulation_part, &step, &t, state);
+            EXPECT_EQ(c_step, step);
+        }
+
+        //! Reads the checkpoint with the error handler of the death tests.
+        void readStateOrExit()
+        {
+            t_state state;
+
+            set_gmx_error_handler(exitOnFatalError);
+            readState(cptName_, &state);
+            done_state(&state);
+        }
+
+        //! Checks that state is identical to the state that was written.
+        void checkState(const t_state &state)
+        {
+            ASSERT_EQ(c_natoms, state.natoms);
+            EXPECT_EQ(state_.flags, state.flags);
+            for (int d = 0; d < DIM; d++)
+            {
+                for (int e = 0; e < DIM; e++)
+                {
+                    EXPECT_EQ(state_.box[d][e], state.box[d][e]);
+                }
+            }
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ(state_.x[i][d], state.x[i][d]) << "atom " << i;
+                    EXPECT_EQ(state_.v[i][d], state.v[i][d]) << "atom " << i;
+                    EXPECT_EQ(state_.sd_X[i][d], state.sd_X[i][d]) << "atom " << i;
+                }
+            }
+        }
+
+        /*! \brief
+         * Returns the listing of checkpoint fn, as printed by gmxdump -cp.
+         *
+         * The generation time is left out, since it differs between
+         * checkpoints that are written at different times.
+         */
+        static std::vector<std::string> listCheckpoint(const std::string &fn)
+        {
+            std::vector<std::string> lines;
+            char                     line[4096];
+
+            FILE *fp = std::tmpfile();
+            list_checkpoint(fn.c_str(), fp);
+            std::fseek(fp, 0, SEEK_SET);
+            while (std::fgets(line, sizeof(line), fp) != NULL)
+            {
+                if (std::strstr(line, "generation time") == NULL)
+                {
+                    lines.push_back(line);
+                }
+            }
+            std::fclose(fp);
+
+            return lines;
+        }
+
+        TestFileManager tempFiles_;
+        std::string     cptName_, refName_;
+        t_commrec       cr_;
+        t_state         state_;
+};
+
+TEST_F(CheckpointPartsTest, ReadsPartsWrittenInAnyOrder)
+{
+    writeDistributed();
+    for (int p = 0; p < c_nparts; p++)
+    {
+        EXPECT_TRUE(gmx_fexist(partName(p, c_step).c_str()));
+    }
+
+    t_state state;
+    readState(cptName_, &state);
+    checkState(state);
+    done_state(&state);
+}
+
+TEST_F(CheckpointPartsTest, ConvertsToSingleFile)
+{
+    writeDistributed();
+    std::string singleName(tempFiles_.getTemporaryFilePath("single.cpt"));
+    convert_checkpoint(cptName_.c_str(), singleName.c_str());
+
+    /* The converted file does not need the part files */
+    for (int p = 0; p < c_nparts; p++)
+    {
+        ASSERT_EQ(0, std::remove(partName(p, c_step).c_str()));
+    }
+    t_state state;
+    readState(singleName, &state);
+    checkState(state);
+    done_state(&state);
+
+    write_checkpoint(refName_.c_str(), FALSE, NULL, &cr_, eiSD1, 1,
+                     FALSE, 0, c_step, 0.002*c_step, &state_, 0);
+    std::vector<std::string> single = listCheckpoint(singleName);
+    std::vector<std::string> ref    = listCheckpoint(refName_);
+    ASSERT_EQ(ref.size(), single.size());
+    for (size_t i = 0; i < ref.size(); i++)
+    {
+        EXPECT_EQ(ref[i], single[i]);
+    }
+}
+
+TEST_F(CheckpointPartsTest, RejectsMissingPart)
+{
+    writeDistributed();
+    ASSERT_EQ(0, std::remove(partName(1, c_step).c_str()));
+    EXPECT_DEATH(readStateOrExit(), "is missing");
+}
+
+TEST_F(CheckpointPartsTest, RejectsDuplicateAtom)
+{
+    writeDistributed();
+    /* Replace the first atom of part 1 by the first atom of part 0 */
+    std::vector<int> index = partIndex(1);
+    index[0] = partIndex(0)[0];
+    writePart(1, c_step, index);
+    EXPECT_DEATH(readStateOrExit(), "duplicate atom index");
+}
+
+TEST_F(CheckpointPartsTest, RejectsPartOfOtherStep)
+{
+    writeDistributed();
+    writePart(1, c_step + 10, partIndex(1));
+    ASSERT_EQ(0, gmx_file_rename(partName(1, c_step + 10).c_str(),
+                                 partName(1, c_step).c_str()));
+    EXPECT_DEATH(readStateOrExit(), "does not belong");
+}
+
+} // namespace
@@ -0,0 +1,149 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the counter-based random number generator.
+ *
+ * Checks ThreeFry-4x32-20 against the zero-key known answer from the
+ * Random123 reference implementation, checks that the batched (SIMD) Gaussian
+ * generation returns exactly the scalar numbers, and checks the first
+ * moments of the Gaussian distributions.
+ */
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gmx_random.h"
+
+namespace
+{
+
+TEST(ThreeFryTest, MatchesKnownAnswer)
+{
+    const unsigned int zero[4] = { 0, 0, 0, 0 };
+    unsigned int       rnd[4];
+
+    gmx_rng_threefry4x32(zero, zero, rnd);
+    EXPECT_EQ(0x9c6ca96aU, rnd[0]);
+    EXPECT_EQ(0xe17eae66U, rnd[1]);
+    EXPECT_EQ(0xfc10ecd4U, rnd[2]);
+    EXPECT_EQ(0x5256a7d8U, rnd[3]);
+}
+
+TEST(CounterRngTest, BatchMatchesScalar)
+{
+    /* Not a multiple of the SIMD width */
+    const int         n = 23, nsub = 3, sub0 = 2;
+    std::vector<int>  index(n);
+    std::vector<real> batch(n*nsub*4), batch0(n*nsub*4);
+    real              ref[4];
+
+    for (int i = 0; i < n; i++)
+    {
+        index[i] = 1000 + 7*i;
+    }
+    gmx_rng_cycle_gaussian_table_batch(1993, RND_SEED_UPDATE, 12345678901LL,
+                                       n, &index[0], 0, sub0, nsub, &batch[0]);
+    gmx_rng_cycle_gaussian_table_batch(1993, RND_SEED_UPDATE, 12345678901LL,
+                                       n, NULL, 1000, sub0, nsub, &batch0[0]);
+    for (int i = 0; i < n; i++)
+    {
+        for (int s = 0; s < nsub; s++)
+        {
+            gmx_rng_cycle_4gaussian_table(1993, RND_SEED_UPDATE, 12345678901LL,
+                                          index[i], sub0 + s, ref);
+            for (int j = 0; j < 4; j++)
+            {
+                EXPECT_EQ(ref[j], batch[(i*nsub + s)*4 + j]) << "index " << i << " sub " << s;
+            }
+            gmx_rng_cycle_4gaussian_table(1993, RND_SEED_UPDATE, 12345678901LL,
+                                          1000 + i, sub0 + s, ref);
+            for (int j = 0; j < 4; j++)
+            {
+                EXPECT_EQ(ref[j], batch0[(i*nsub + s)*4 + j]) << "index " << i << " sub " << s;
+            }
+        }
+    }
+}
+
+TEST(CounterRngTest, CycleIsDeterministic)
+{
+    gmx_rng_cycle_t rc1, rc2, rc3;
+
+    gmx_rng_cycle_init(&rc1, 1993, RND_SEED_VRESCALE, 10, 3);
+    gmx_rng_cycle_init(&rc2, 1993, RND_SEED_VRESCALE, 10, 3);
+    gmx_rng_cycle_init(&rc3, 1993, RND_SEED_VRESCALE, 11, 3);
+    int ndiff = 0;
+    for (int i = 0; i < 10; i++)
+    {
+        unsigned int r1 = gmx_rng_cycle_uint32(&rc1);
+        EXPECT_EQ(r1, gmx_rng_cycle_uint32(&rc2));
+        ndiff += (r1 != gmx_rng_cycle_uint32(&rc3));
+    }
+    EXPECT_GT(ndiff, 8);
+}
+
+TEST(CounterRngTest, GaussianMoments)
+{
+    const int       n = 100000;
+    gmx_rng_cycle_t rc;
+    double          sum[2][3] = { { 0 } };
+    real            rnd[4];
+
+    gmx_rng_cycle_init(&rc, 7, RND_SEED_ANDERSEN, 0, 0);
+    for (int i = 0; i < n; i++)
+    {
+        /* Successive steps should be independent */
+        gmx_rng_cycle_4gaussian_table(7, RND_SEED_UPDATE, i, 0, 0, rnd);
+        double g[2] = { rnd[i % 4], gmx_rng_cycle_gaussian_real(&rc) };
+        for (int k = 0; k < 2; k++)
+        {
+            sum[k][0] += g[k];
+            sum[k][1] += g[k]*g[k];
+            sum[k][2] += g[k]*g[k]*g[k]*g[k];
+        }
+    }
+    for (int k = 0; k < 2; k++)
+    {
+        /* Allow for 5 standard errors */
+        EXPECT_NEAR(0, sum[k][0]/n, 5/std::sqrt((double)n)) << "generator " << k;
+        EXPECT_NEAR(1, sum[k][1]/n, 5*std::sqrt(2.0/n)) << "generator " << k;
+        EXPECT_NEAR(3, sum[k][2]/n, 5*std::sqrt(96.0/n)) << "generator " << k;
+    }
+}
+
+} // namespace
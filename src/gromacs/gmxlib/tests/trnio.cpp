@@ -0,0 +1,270 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading and writing trr files with trnio.
+ *
+ * The frames that are read back should be identical to the frames that were
+ * written, also when data is skipped, the file is repositioned, or the file
+ * grows while it is being read. Truncating at a frame boundary, as
+ * trjconv -trunc does, should keep exactly the frames before it.
+ */
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/testfilemanager.h"
+
+#include "futil.h"
+#include "gmxfio.h"
+#include "trnio.h"
+
+namespace
+{
+
+using gmx::test::TestFileManager;
+
+class TrnioTest : public ::testing::Test
+{
+    public:
+        TrnioTest() : natoms_(37)
+        {
+            filename_ = tempFiles_.getTemporaryFilePath(".trr");
+        }
+
+        //! Fills a frame with values that depend on the frame number.
+        void makeFrame(int frame, std::vector<real> *x, std::vector<real> *v,
+                       std::vector<real> *f, matrix box)
+        {
+            x->resize(natoms_*DIM);
+            v->resize(natoms_*DIM);
+            f->resize(natoms_*DIM);
+            for (int i = 0; i < natoms_*DIM; i++)
+            {
+                (*x)[i] = 0.001*(frame*1000 + i);
+                (*v)[i] = -0.5*(frame + i);
+                (*f)[i] = 1234.5*(frame - i);
+            }
+            for (int d = 0; d < DIM; d++)
+            {
+                for (int e = 0; e < DIM; e++)
+                {
+                    box[d][e] = (d == e ? 3.0 + frame : 0.1*e);
+                }
+            }
+        }
+
+        //! Writes frames [first, last) with x, v and f for odd frames only.
+        void writeFrames(const char *mode, int first, int last)
+        {
+            t_fileio *fio = open_trn(filename_.c_str(), mode);
+            for (int frame = first; frame < last; frame++)
+            {
+                std::vector<real> x, v, f;
+                matrix            box;
+                makeFrame(frame, &x, &v, &f, box);
+                bool              bAll = (frame % 2 == 1);
+                fwrite_trn(fio, frame, 0.5*frame, 0, box, natoms_,
+                           asRvec(&x), bAll ? asRvec(&v) : NULL,
+                           bAll ? asRvec(&f) : NULL);
+            }
+            close_trn(fio);
+        }
+
+        /*! \brief
+         * Reads the next frame and checks that it matches what was written.
+         *
+         * When \p bSkip is true, the coordinates are read but the
+         * velocities and forces are skipped.
+         */
+        void checkFrame(t_fileio *fio, int frame, bool bSkip)
+        {
+            t_trnheader       sh;
+            gmx_bool          bOK;
+            std::vector<real> x, v, f, xr(natoms_*DIM), vr(natoms_*DIM), fr(natoms_*DIM);
+            matrix            box, boxr;
+
+            makeFrame(frame, &x, &v, &f, box);
+            ASSERT_TRUE(fread_trnheader(fio, &sh, &bOK)) << "frame " << frame;
+            ASSERT_TRUE(bOK);
+            EXPECT_EQ(natoms_, sh.natoms);
+            EXPECT_EQ(frame, sh.step);
+            EXPECT_EQ(static_cast<real>(0.5*frame), sh.t);
+            bool bAll = (frame % 2 == 1);
+            EXPECT_EQ(bAll, sh.v_size != 0);
+            EXPECT_EQ(bAll, sh.f_size != 0);
+            ASSERT_TRUE(fread_htrn(fio, &sh, boxr, asRvec(&xr),
+                                   bSkip ? NULL : asRvec(&vr),
+                                   bSkip ? NULL : asRvec(&fr)));
+            for (int d = 0; d < DIM; d++)
+            {
+                for (int e = 0; e < DIM; e++)
+                {
+                    EXPECT_EQ(box[d][e], boxr[d][e]);
+                }
+            }
+            for (int i = 0; i < natoms_*DIM; i++)
+            {
+                EXPECT_EQ(x[i], xr[i]) << "frame " << frame << " x " << i;
+                if (bAll && !bSkip)
+                {
+                    EXPECT_EQ(v[i], vr[i]) << "frame " << frame << " v " << i;
+                    EXPECT_EQ(f[i], fr[i]) << "frame " << frame << " f " << i;
+                }
+            }
+        }
+
+        static rvec *asRvec(std::vector<real> *v)
+        {
+            return reinterpret_cast<rvec *>(&(*v)[0]);
+        }
+
+        TestFileManager tempFiles_;
+        std::string     filename_;
+        int             natoms_;
+};
+
+TEST_F(TrnioTest, ReadsWrittenFrames)
+{
+    writeFrames("w", 0, 4);
+    t_fileio *fio = open_trn(filename_.c_str(), "r");
+    for (int frame = 0; frame < 4; frame++)
+    {
+        checkFrame(fio, frame, false);
+    }
+    t_trnheader sh;
+    gmx_bool    bOK;
+    EXPECT_FALSE(fread_trnheader(fio, &sh, &bOK));
+    close_trn(fio);
+}
+
+TEST_F(TrnioTest, SkipsDataAndRepositions)
+{
+    writeFrames("w", 0, 4);
+    t_fileio *fio = open_trn(filename_.c_str(), "r");
+    checkFrame(fio, 0, true);
+    gmx_off_t pos = gmx_fio_ftell(fio);
+    checkFrame(fio, 1, true);
+    checkFrame(fio, 2, false);
+    ASSERT_EQ(0, gmx_fio_seek(fio, pos));
+    checkFrame(fio, 1, false);
+    gmx_fio_rewind(fio);
+    checkFrame(fio, 0, false);
+    close_trn(fio);
+}
+
+TEST_F(TrnioTest, ReadsFramesAppendedWhileReading)
+{
+    writeFrames("w", 0, 2);
+    t_fileio *fio = open_trn(filename_.c_str(), "r");
+    checkFrame(fio, 0, false);
+    checkFrame(fio, 1, false);
+    writeFrames("a", 2, 4);
+    checkFrame(fio, 2, false);
+    checkFrame(fio, 3, false);
+    close_trn(fio);
+}
+
+TEST_F(TrnioTest, DetectsTruncatedFrame)
+{
+    writeFrames("w", 0, 2);
+    gmx_off_t size;
+    {
+        t_fileio *fio = open_trn(filename_.c_str(), "r");
+        checkFrame(fio, 0, false);
+        size = gmx_fio_ftell(fio);
+        close_trn(fio);
+    }
+    /* Copy the file without the last 10 bytes */
+    std::string truncated(tempFiles_.getTemporaryFilePath("truncated.trr"));
+    {
+        FILE *in  = std::fopen(filename_.c_str(), "rb");
+        FILE *out = std::fopen(truncated.c_str(), "wb");
+        int   c;
+        std::vector<char> bytes;
+        while ((c = std::fgetc(in)) != EOF)
+        {
+            bytes.push_back(c);
+        }
+        ASSERT_GT(static_cast<gmx_off_t>(bytes.size()), size + 10);
+        std::fwrite(&bytes[0], 1, bytes.size() - 10, out);
+        std::fclose(in);
+        std::fclose(out);
+    }
+    t_fileio   *fio = open_trn(truncated.c_str(), "r");
+    checkFrame(fio, 0, false);
+    t_trnheader sh;
+    gmx_bool    bOK;
+    std::vector<real> x(natoms_*DIM), v(natoms_*DIM), f(natoms_*DIM);
+    matrix      box;
+    ASSERT_TRUE(fread_trnheader(fio, &sh, &bOK));
+    EXPECT_FALSE(fread_htrn(fio, &sh, box, asRvec(&x), asRvec(&v), asRvec(&f)));
+    close_trn(fio);
+}
+
+TEST_F(TrnioTest, TruncatesAtFrameBoundary)
+{
+    writeFrames("w", 0, 4);
+    gmx_off_t pos;
+    {
+        /* Read the first frame through the mapping, then continue
+         * on the stream, like trjconv -trunc does.
+         */
+        t_fileio *fio = open_trn(filename_.c_str(), "r");
+        checkFrame(fio, 0, false);
+        pos       = gmx_fio_ftell(fio);
+        FILE *fp  = gmx_fio_getfp(fio);
+        ASSERT_TRUE(fp != NULL);
+        EXPECT_EQ(pos, gmx_ftell(fp));
+        checkFrame(fio, 1, true);
+        pos = gmx_fio_ftell(fio);
+        EXPECT_EQ(pos, gmx_ftell(fp));
+        close_trn(fio);
+    }
+    ASSERT_EQ(0, gmx_truncatefile(const_cast<char *>(filename_.c_str()), pos));
+
+    t_fileio *fio = open_trn(filename_.c_str(), "r");
+    checkFrame(fio, 0, false);
+    checkFrame(fio, 1, false);
+    t_trnheader sh;
+    gmx_bool    bOK;
+    EXPECT_FALSE(fread_trnheader(fio, &sh, &bOK));
+    close_trn(fio);
+}
+
+} // namespace
@@ -0,0 +1,268 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the compressed coordinate (xtc) encoding in xdr3dfcoord.
+ *
+ * The compressed bytes are compared against reference data, so any change
+ * in the bit packing shows up as a test failure, and the decoded
+ * coordinates are checked to be the rounded input coordinates.
+ */
+#include <cmath>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "testutils/refdata.h"
+#include "testutils/testfilemanager.h"
+
+#include "xdrf.h"
+
+namespace
+{
+
+using gmx::test::TestFileManager;
+
+class Xdr3dfcoordTest : public ::testing::Test
+{
+    public:
+        Xdr3dfcoordTest() : checker_(data_.rootChecker()), seed_(12345)
+        {
+        }
+
+        //! Returns a pseudo-random number in [0,1), same on all platforms.
+        float uniform()
+        {
+            seed_ = seed_*1103515245u + 12345u;
+            return ((seed_ >> 8) & 0xffffff)/16777216.0f;
+        }
+
+        //! Adds water-like triplets of atoms close together, in a box.
+        void addWaters(int nwater, float boxSize)
+        {
+            for (int i = 0; i < nwater; i++)
+            {
+                float ox = boxSize*uniform();
+                float oy = boxSize*uniform();
+                float oz = boxSize*uniform();
+                addAtom(ox, oy, oz);
+                addAtom(ox + 0.1f*uniform(), oy + 0.1f*uniform(), oz);
+                addAtom(ox - 0.1f*uniform(), oy, oz + 0.1f*uniform());
+            }
+        }
+
+        //! Adds a chain of atoms with bond length steps.
+        void addChain(int natoms, float step)
+        {
+            float x = 1, y = 1, z = 1;
+            for (int i = 0; i < natoms; i++)
+            {
+                x += step*(uniform() - 0.5f);
+                y += step*(uniform() - 0.5f);
+                z += step*(uniform() - 0.5f);
+                addAtom(x, y, z);
+            }
+        }
+
+        void addAtom(float x, float y, float z)
+        {
+            x_.push_back(x);
+            x_.push_back(y);
+            x_.push_back(z);
+        }
+
+        //! Writes x_ with xdr3dfcoord and returns the file contents.
+        std::vector<unsigned char> encode(const std::vector<float> &x,
+                                          float precision)
+        {
+            std::string filename(tempFiles_.getTemporaryFilePath(".xdr"));
+            FILE       *fp = std::fopen(filename.c_str(), "wb");
+            XDR         xdrs;
+            int         size = x.size()/3;
+
+            xdrstdio_create(&xdrs, fp, XDR_ENCODE);
+            std::vector<float> xcopy(x);
+            EXPECT_EQ(1, xdr3dfcoord(&xdrs, &xcopy[0], &size, &precision));
+            xdr_destroy(&xdrs);
+            std::fclose(fp);
+
+            std::vector<unsigned char> bytes;
+            fp = std::fopen(filename.c_str(), "rb");
+            int c;
+            while ((c = std::fgetc(fp)) != EOF)
+            {
+                bytes.push_back(c);
+            }
+            std::fclose(fp);
+            return bytes;
+        }
+
+        //! Reads back the file written by encode() with xdr3dfcoord.
+        std::vector<float> decode(float *precision)
+        {
+            std::string        filename(tempFiles_.getTemporaryFilePath(".xdr"));
+            FILE              *fp = std::fopen(filename.c_str(), "rb");
+            XDR                xdrs;
+            int                size = x_.size()/3;
+            std::vector<float> x(x_.size());
+
+            xdrstdio_create(&xdrs, fp, XDR_DECODE);
+            EXPECT_EQ(1, xdr3dfcoord(&xdrs, &x[0], &size, precision));
+            xdr_destroy(&xdrs);
+            std::fclose(fp);
+            return x;
+        }
+
+        /*! \brief
+         * Encodes and decodes x_ and checks the results.
+         *
+         * The encoded bytes are checked against the reference data,
+         * the decoded coordinates should be the input rounded to the
+         * precision, and encoding them again should give the same bytes.
+         */
+        void runTest(float precision)
+        {
+            std::vector<unsigned char> bytes(encode(x_, precision));
+            bool                       bExact = true;
+            std::vector<int>           words;
+            for (size_t i = 0; i + 3 < bytes.size(); i += 4)
+            {
+                words.push_back((bytes[i] << 24) | (bytes[i+1] << 16) |
+                                (bytes[i+2] << 8) | bytes[i+3]);
+            }
+            checker_.checkInteger(bytes.size(), "NumBytes");
+            checker_.checkSequence(words.begin(), words.end(), "Encoded");
+
+            float              readPrecision;
+            std::vector<float> x(decode(&readPrecision));
+            if (x_.size() > 9*3)
+            {
+                EXPECT_EQ(precision, readPrecision);
+                for (size_t i = 0; i < x_.size(); i++)
+                {
+                    /* This is the rounding done by xdr3dfcoord, which is
+                     * only exact when the integers fit in a float.
+                     */
+                    float lf = x_[i]*precision;
+                    if (std::fabs(lf) >= 4194304)
+                    {
+                        bExact = false;
+                        continue;
+                    }
+                    int   ref = static_cast<int>(lf >= 0 ? lf + 0.5f : lf - 0.5f);
+                    EXPECT_EQ(ref, static_cast<int>(std::floor(x[i]*precision + 0.5f)))
+                    << "coordinate " << i;
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < x_.size(); i++)
+                {
+                    EXPECT_EQ(x_[i], x[i]);
+                }
+            }
+
+            if (bExact)
+            {
+                EXPECT_TRUE(bytes == encode(x, precision))
+                << "Re-encoding the decoded coordinates gives different bytes";
+            }
+        }
+
+        gmx::test::TestReferenceData    data_;
+        gmx::test::TestReferenceChecker checker_;
+        TestFileManager                 tempFiles_;
+        std::vector<float>              x_;
+        unsigned int                    seed_;
+};
+
+TEST_F(Xdr3dfcoordTest, HandlesFewAtomsUncompressed)
+{
+    addChain(5, 0.15f);
+    runTest(1000);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesTenAtoms)
+{
+    addChain(10, 0.15f);
+    runTest(1000);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesWaterBox)
+{
+    addWaters(100, 3.0f);
+    runTest(1000);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesChangingSmallDifferences)
+{
+    /* Alternate between tight and loose packing, so the size used for
+     * the small differences is increased and decreased.
+     */
+    addChain(40, 0.02f);
+    addWaters(20, 2.0f);
+    addChain(40, 0.3f);
+    addChain(40, 0.005f);
+    runTest(1000);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesHighPrecision)
+{
+    /* With this precision the three sizes need more than 64 bits */
+    addWaters(30, 2.9f);
+    runTest(1e6);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesLargeRange)
+{
+    /* Ranges larger than 0xffffff are packed per dimension */
+    addWaters(30, 50000.0f);
+    runTest(1000);
+}
+
+TEST_F(Xdr3dfcoordTest, HandlesNegativeCoordinates)
+{
+    addWaters(50, 4.0f);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        x_[i] -= 2.5f;
+    }
+    runTest(100);
+}
+
+} // namespace
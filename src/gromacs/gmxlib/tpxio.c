@@ -73,7 +73,7 @@
 static const char *tpx_tag = TPX_TAG_RELEASE;
 
 /* This number should be increased whenever the file format changes! */
-static const int tpx_version = 92;
+static const int tpx_version = 93;
 
 /* This number should only be increased when you edit the TOPOLOGY section
  * or the HEADER of the tpx format.
@@ -972,6 +972,14 @@ static void do_inputrec(t_fileio *fio, t_inputrec *ir, gmx_bool bRead,
     gmx_fio_do_int(fio, ir->nky);
     gmx_fio_do_int(fio, ir->nkz);
     gmx_fio_do_int(fio, ir->pme_order);
+    if (file_version >= 93)
+    {
+        gmx_fio_do_int(fio, ir->nstcalcpme);
+    }
+    else
+    {
+        ir->nstcalcpme = 1;
+    }
     gmx_fio_do_real(fio, ir->ewald_rtol);
 
     if (file_version >= 24)
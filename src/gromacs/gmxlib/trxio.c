@@ -47,6 +47,7 @@
 #include "gmxfio.h"
 #include "trnio.h"
 #include "names.h"
+#include "macros.h"
 #include "vec.h"
 #include "futil.h"
 #include "gmxfio.h"
@@ -55,6 +56,7 @@
 #include "confio.h"
 #include "checkpoint.h"
 #include "wgms.h"
+#include "gmx_omp.h"
 #include <math.h>
 
 /* defines for frame counter output */
@@ -67,6 +69,40 @@ typedef enum {
     effXYZ, effXYZBox, effG87, effG87Box, effNR
 } eFileFormat;
 
+/* Minimum number of atoms for reading xtc frames ahead */
+#define XTC_READAHEAD_MIN_ATOMS   1000
+/* Maximum total number of atoms in the frames read ahead */
+#define XTC_READAHEAD_MAX_ATOMS  (1<<25)
+
+/* An xtc frame read ahead, the coordinates are decompressed separately */
+typedef struct
+{
+    gmx_off_t          fpos;        /* file position before reading the frame */
+    int                ret;         /* return value of read_next_xtc_data     */
+    gmx_bool           bOK;         /* frame is not corrupt                   */
+    int                step;
+    real               time;
+    matrix             box;
+    t_xdr3dfcoord_data data;        /* the compressed coordinates             */
+    gmx_bool           bX;          /* the coordinates have been decompressed */
+    rvec              *x;
+    real               prec;
+} t_xtc_readahead_frame;
+
+/* Buffer for reading xtc frames ahead in batches, with the coordinates of
+ * all frames in a batch decompressed in parallel with OpenMP.
+ */
+typedef struct
+{
+    int                    nthreads;    /* the number of decompression threads */
+    int                    nalloc;      /* the maximum number of frames        */
+    int                    nframes;     /* the number of frames in the batch   */
+    int                    next;        /* the next frame to return            */
+    gmx_off_t              fpos;        /* file position after the batch       */
+    real                   t0;          /* fr->t0 used when reading the batch  */
+    t_xtc_readahead_frame *frame;
+} t_xtc_readahead;
+
 struct t_trxstatus
 {
     int             __frame;
@@ -78,6 +114,7 @@ struct t_trxstatus
     double          DT, BOX[3];
     gmx_bool        bReadBox;
     char           *persistent_line; /* Persistent line for reading g96 trajectories */
+    t_xtc_readahead *xtcra;          /* xtc read-ahead buffer, NULL when not used */
 };
 
 static void initcount(t_trxstatus *status)
@@ -92,9 +129,63 @@ static void status_init(t_trxstatus *status)
     status->fio             = NULL;
     status->__frame         = -1;
     status->persistent_line = NULL;
+    status->xtcra           = NULL;
 }
 
 
+static void xtc_readahead_init(t_trxstatus *status, int natoms)
+{
+    t_xtc_readahead *ra;
+    int              i;
+
+    snew(ra, 1);
+    status->xtcra = ra;
+
+    ra->nthreads = gmx_omp_get_max_threads();
+    if (ra->nthreads <= 1 || natoms < XTC_READAHEAD_MIN_ATOMS ||
+        getenv("GMX_NO_XTC_READAHEAD") != NULL)
+    {
+        ra->nalloc = 0;
+        return;
+    }
+    /* Read two frames per thread, to have work for all threads also
+     * when frames are skipped, but limit the memory usage.
+     */
+    ra->nalloc = min(2*ra->nthreads, XTC_READAHEAD_MAX_ATOMS/natoms);
+    ra->nalloc = max(ra->nalloc, 2);
+    snew(ra->frame, ra->nalloc);
+    for (i = 0; i < ra->nalloc; i++)
+    {
+        xdr3dfcoord_data_init(&ra->frame[i].data);
+        snew(ra->frame[i].x, natoms);
+    }
+    if (debug)
+    {
+        fprintf(debug, "Reading xtc frames ahead in batches of %d using %d threads\n",
+                ra->nalloc, ra->nthreads);
+    }
+}
+
+static void xtc_readahead_done(t_trxstatus *status)
+{
+    t_xtc_readahead *ra;
+    int              i;
+
+    ra = status->xtcra;
+    if (ra == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < ra->nalloc; i++)
+    {
+        xdr3dfcoord_data_done(&ra->frame[i].data);
+        sfree(ra->frame[i].x);
+    }
+    sfree(ra->frame);
+    sfree(ra);
+    status->xtcra = NULL;
+}
+
 int nframes_read(t_trxstatus *status)
 {
     return status->__frame;
@@ -435,6 +526,7 @@ int write_trx(t_trxstatus *status, int nind, const atom_id *ind, t_atoms *atoms,
 
 void close_trx(t_trxstatus *status)
 {
+    xtc_readahead_done(status);
     gmx_fio_close(status->fio);
     sfree(status);
 }
@@ -792,6 +884,158 @@ static int pdb_first_x(t_trxstatus *status, FILE *fp, t_trxframe *fr)
     return fr->natoms;
 }
 
+static void xtc_skip_frames(t_trxstatus *status, const output_env_t oenv,
+                            t_trxframe *fr)
+{
+    const float *time;
+    int          nframes, fr0, frame;
+
+    /* Use the frame index to skip the frames that check_times2 would
+     * reject, without reading and decompressing their coordinates.
+     */
+    fr0 = xtc_get_index_frame(status->fio, fr->natoms, &nframes, &time);
+    if (fr0 < 0)
+    {
+        return;
+    }
+    frame = fr0;
+    while (frame < nframes &&
+           check_times2(time[frame], fr->t0, fr->tpf, fr->tppf, fr->bDouble) < 0)
+    {
+        printcount(status, oenv, time[frame], TRUE);
+        fr->tppf = fr->tpf;
+        fr->tpf  = time[frame];
+        frame++;
+    }
+    if (frame > fr0 && xtc_seek_index_frame(status->fio, frame) != 0)
+    {
+        gmx_fatal(FARGS, "Could not seek to frame %d of %s", frame,
+                  gmx_fio_getname(status->fio));
+    }
+}
+
+/* Returns whether frame will be used, following the logic in read_next_frame */
+static gmx_bool xtc_frame_is_used(t_xtc_readahead_frame *frame, t_trxframe *fr)
+{
+    int ct;
+
+    ct = check_times2(frame->time, fr->t0, fr->tpf, fr->tppf, fr->bDouble);
+
+    return (ct == 0 || ((fr->flags & TRX_DONT_SKIP) && ct < 0));
+}
+
+/* Reads the next batch of frames, without decompressing the coordinates
+ * on the reading thread, and decompresses the frames that will be used
+ * in parallel.
+ */
+static void xtc_readahead_fill(t_trxstatus *status, const output_env_t oenv,
+                               t_trxframe *fr)
+{
+    t_xtc_readahead       *ra;
+    t_xtc_readahead_frame *frame;
+    int                    i;
+
+    ra          = status->xtcra;
+    ra->nframes = 0;
+    ra->next    = 0;
+    ra->t0      = fr->t0;
+    while (ra->nframes < ra->nalloc)
+    {
+        frame       = &ra->frame[ra->nframes];
+        frame->fpos = gmx_fio_ftell(status->fio);
+        frame->bX   = FALSE;
+        if (bTimeSet(TDELTA) && !(fr->flags & TRX_DONT_SKIP))
+        {
+            xtc_skip_frames(status, oenv, fr);
+        }
+        frame->ret = read_next_xtc_data(status->fio, fr->natoms,
+                                        &frame->step, &frame->time,
+                                        frame->box, &frame->data, &frame->bOK);
+        ra->nframes++;
+        /* Stop at the end of the file, a corrupt frame or the end time */
+        if (!frame->ret || check_times2(frame->time, fr->t0, fr->tpf, fr->tppf,
+                                        fr->bDouble) > 0)
+        {
+            break;
+        }
+    }
+    ra->fpos = gmx_fio_ftell(status->fio);
+
+#pragma omp parallel for num_threads(ra->nthreads) schedule(dynamic)
+    for (i = 0; i < ra->nframes; i++)
+    {
+        t_xtc_readahead_frame *f = &ra->frame[i];
+
+        if (f->ret && xtc_frame_is_used(f, fr))
+        {
+            f->bOK = xtc_decompress_coords(&f->data, f->x, &f->prec);
+            f->ret = f->bOK;
+            f->bX  = TRUE;
+        }
+    }
+}
+
+/* Reads the next xtc frame through the read-ahead buffer.
+ * Returns -1 when the buffer is not used, otherwise the return value
+ * of read_next_xtc for the frame.
+ */
+static int xtc_readahead_next(t_trxstatus *status, const output_env_t oenv,
+                              t_trxframe *fr, gmx_bool *bOK)
+{
+    t_xtc_readahead       *ra;
+    t_xtc_readahead_frame *frame;
+
+    if (status->xtcra == NULL)
+    {
+        xtc_readahead_init(status, fr->natoms);
+    }
+    ra = status->xtcra;
+    if (ra->nalloc == 0)
+    {
+        return -1;
+    }
+
+    if (ra->next < ra->nframes)
+    {
+        if (gmx_fio_ftell(status->fio) != ra->fpos)
+        {
+            /* The file has been repositioned, so the batch is invalid */
+            ra->nframes = 0;
+        }
+        else if (fr->t0 != ra->t0)
+        {
+            /* The frames to skip might have changed, read them again */
+            gmx_fio_seek(status->fio, ra->frame[ra->next].fpos);
+            ra->nframes = 0;
+        }
+    }
+    if (ra->next >= ra->nframes)
+    {
+        xtc_readahead_fill(status, oenv, fr);
+    }
+
+    frame = &ra->frame[ra->next++];
+    if (frame->ret && !frame->bX)
+    {
+        /* Frame was expected to be skipped, decompress it now */
+        frame->bOK = xtc_decompress_coords(&frame->data, frame->x, &frame->prec);
+        frame->ret = frame->bOK;
+        frame->bX  = TRUE;
+    }
+
+    *bOK      = frame->bOK;
+    fr->step  = frame->step;
+    fr->time  = frame->time;
+    copy_mat(frame->box, fr->box);
+    if (frame->ret)
+    {
+        memcpy(fr->x[0], frame->x[0], fr->natoms*sizeof(rvec));
+        fr->prec = frame->prec;
+    }
+
+    return frame->ret;
+}
+
 gmx_bool read_next_frame(const output_env_t oenv, t_trxstatus *status, t_trxframe *fr)
 {
     real     pt;
@@ -846,8 +1090,16 @@ gmx_bool read_next_frame(const output_env_t oenv, t_trxstatus *status, t_trxfram
                     }
                     initcount(status);
                 }
-                bRet = read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
-                                     fr->x, &fr->prec, &bOK);
+                bRet = xtc_readahead_next(status, oenv, fr, &bOK);
+                if (bRet < 0)
+                {
+                    if (bTimeSet(TDELTA) && !(fr->flags & TRX_DONT_SKIP))
+                    {
+                        xtc_skip_frames(status, oenv, fr);
+                    }
+                    bRet = read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
+                                         fr->x, &fr->prec, &bOK);
+                }
                 fr->bPrec = (bRet && fr->prec > 0);
                 fr->bStep = bRet;
                 fr->bTime = bRet;
@@ -1095,6 +1347,7 @@ gmx_bool read_next_x(const output_env_t oenv, t_trxstatus *status, real *t,
 
 void close_trj(t_trxstatus *status)
 {
+    xtc_readahead_done(status);
     gmx_fio_close(status->fio);
     /* The memory in status->xframe is lost here,
      * but the read_first_x/read_next_x functions are deprecated anyhow.
@@ -1106,6 +1359,11 @@ void close_trj(t_trxstatus *status)
 void rewind_trj(t_trxstatus *status)
 {
     initcount(status);
+    if (status->xtcra != NULL)
+    {
+        status->xtcra->nframes = 0;
+        status->xtcra->next    = 0;
+    }
 
     gmx_fio_rewind(status->fio);
 }
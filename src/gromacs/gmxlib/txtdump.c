@@ -761,6 +761,7 @@ void pr_inputrec(FILE *fp, int indent, const char *title, t_inputrec *ir,
         PI("nky", ir->nky);
         PI("nkz", ir->nkz);
         PI("pme-order", ir->pme_order);
+        PI("nstcalcpme", ir->nstcalcpme);
         PR("ewald-rtol", ir->ewald_rtol);
         PR("ewald-geometry", ir->ewald_geometry);
         PR("epsilon-surface", ir->epsilon_surface);
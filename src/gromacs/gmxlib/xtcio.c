@@ -282,3 +282,73 @@ int read_next_xtc(t_fileio* fio,
 
     return *bOK;
 }
+
+int read_next_xtc_data(t_fileio* fio,
+                       int natoms, int *step, real *time,
+                       matrix box, t_xdr3dfcoord_data *data, gmx_bool *bOK)
+{
+    int  magic;
+    int  n, i, j, result;
+    XDR *xd;
+
+    *bOK = TRUE;
+    xd   = gmx_fio_getxdr(fio);
+
+    /* read header */
+    if (!xtc_header(xd, &magic, &n, step, time, TRUE, bOK))
+    {
+        return 0;
+    }
+
+    /* Check magic number */
+    check_xtc_magic(magic);
+
+    if (n > natoms)
+    {
+        gmx_fatal(FARGS, "Frame contains more atoms (%d) than expected (%d)",
+                  n, natoms);
+    }
+
+    /* box */
+    result = 1;
+    for (i = 0; ((i < DIM) && result); i++)
+    {
+        for (j = 0; ((j < DIM) && result); j++)
+        {
+            result = XTC_CHECK("box", xdr_r2f(xd, &(box[i][j]), TRUE));
+        }
+    }
+
+    if (result)
+    {
+        result = XTC_CHECK("x", xdr3dfcoord_read_data(xd, data, &natoms));
+    }
+    *bOK = result;
+
+    return *bOK;
+}
+
+int xtc_decompress_coords(t_xdr3dfcoord_data *data, rvec *x, real *prec)
+{
+    int    result;
+#ifdef GMX_DOUBLE
+    int    i;
+    float *ftmp;
+    float  fprec;
+
+    snew(ftmp, data->size*DIM);
+    result = XTC_CHECK("x", xdr3dfcoord_decompress(data, ftmp, &fprec));
+    for (i = 0; (i < data->size); i++)
+    {
+        x[i][XX] = ftmp[DIM*i+XX];
+        x[i][YY] = ftmp[DIM*i+YY];
+        x[i][ZZ] = ftmp[DIM*i+ZZ];
+    }
+    *prec = fprec;
+    sfree(ftmp);
+#else
+    result = XTC_CHECK("x", xdr3dfcoord_decompress(data, x[0], prec));
+#endif
+
+    return result;
+}
@@ -472,6 +472,19 @@ void check_ir(const char *mdparin, t_inputrec *ir, t_gromppopts *opts,
                           "nstpcouple", &ir->nstpcouple, wi);
             }
         }
+        if (ir->nstcalcpme > 1)
+        {
+            /* The PME mesh energy and virial are only available
+             * at steps where the mesh part is evaluated.
+             */
+            check_nst("nstcalcpme", ir->nstcalcpme,
+                      "nstcalcenergy", &ir->nstcalcenergy, wi);
+            if (ir->epc != epcNO)
+            {
+                check_nst("nstcalcpme", ir->nstcalcpme,
+                          "nstpcouple", &ir->nstpcouple, wi);
+            }
+        }
 
         if (ir->nstcalcenergy > 0)
         {
@@ -1113,6 +1126,34 @@ void check_ir(const char *mdparin, t_inputrec *ir, t_gromppopts *opts,
         }
     }
 
+    if (ir->nstcalcpme < 1)
+    {
+        warning_error(wi, "nstcalcpme should be 1 or larger");
+    }
+    else if (ir->nstcalcpme > 1)
+    {
+        if (!EEL_PME(ir->coulombtype))
+        {
+            warning_error(wi, "nstcalcpme > 1 is only supported with PME electrostatics");
+        }
+        if (ir->cutoff_scheme != ecutsVERLET)
+        {
+            warning_error(wi, "nstcalcpme > 1 is only supported with cutoff-scheme = Verlet");
+        }
+        if (!(ir->eI == eiMD || EI_SD(ir->eI) || ir->eI == eiBD))
+        {
+            sprintf(warn_buf, "nstcalcpme > 1 is only supported with integrators %s, %s, %s and %s",
+                    ei_names[eiMD], ei_names[eiSD1], ei_names[eiSD2], ei_names[eiBD]);
+            warning_error(wi, warn_buf);
+        }
+        if (ir->nstcalcpme*ir->delta_t > 0.008 + GMX_REAL_EPS)
+        {
+            sprintf(warn_buf, "The PME mesh time step nstcalcpme*delta-t (%g ps) is longer than 0.008 ps. With impulse multiple time stepping this can cause resonances with the fastest motions in the system, leading to poor energy conservation or instabilities.",
+                    ir->nstcalcpme*ir->delta_t);
+            warning(wi, warn_buf);
+        }
+    }
+
     if (ir->nwall == 2 && EEL_FULL(ir->coulombtype))
     {
         if (ir->ewald_geometry == eewg3D)
@@ -1788,6 +1829,8 @@ void get_ir(const char *mdparin, const char *mdparout,
     ITYPE ("fourier-nz",  ir->nkz,         0);
     CTYPE ("EWALD/PME/PPPM parameters");
     ITYPE ("pme-order",   ir->pme_order,   4);
+    CTYPE ("Evaluate the PME mesh part every nstcalcpme steps (multiple time stepping)");
+    ITYPE ("nstcalcpme",  ir->nstcalcpme,  1);
     RTYPE ("ewald-rtol",  ir->ewald_rtol, 0.00001);
     EETYPE("ewald-geometry", ir->ewald_geometry, eewg_names);
     RTYPE ("epsilon-surface", ir->epsilon_surface, 0.0);
@@ -153,6 +153,26 @@ t_ifunc pdihs, idihs, rbdihs;
 t_ifunc tab_bonds, tab_angles, tab_dihs;
 t_ifunc polarize, anharm_polarize, water_pol, thole_pol, angres, angresz, dihres, unimplemented;
 
+/* As bonds, angles, urey_bradley and rbdihs, but without energies,
+ * shift forces and free-energy perturbation. When SIMD acceleration
+ * is available, the interactions are processed in SIMD-width batches.
+ */
+void bonds_noener(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[], const t_pbc *pbc);
+
+void angles_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[], const t_pbc *pbc);
+
+void urey_bradley_noener(int nbonds,
+                         const t_iatom forceatoms[], const t_iparams forceparams[],
+                         const rvec x[], rvec f[], const t_pbc *pbc);
+
+void rbdihs_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[], const t_pbc *pbc);
+
 
 /* Initialize the setup for the bonded force buffer reduction
  * over threads. This should be called each time the bonded setup
@@ -50,13 +50,48 @@ extern "C" {
 /* Write a checkpoint to <fn>.cpt
  * Appends the _step<step>.cpt with bNumberAndKeep,
  * otherwise moves the previous <fn>.cpt to <fn>_prev.cpt
+ * With nparts > 0 the per-atom state entries (x, v, sd_X) are not written;
+ * these should have been written by the nparts PP nodes
+ * with write_checkpoint_part.
  */
 void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       FILE *fplog, t_commrec *cr,
                       int eIntegrator, int simulation_part,
                       gmx_bool bExpanded, int elamstats,
                       gmx_large_int_t step, double t,
-                      t_state *state);
+                      t_state *state, int nparts);
+
+/* The two stages of write_checkpoint, which allow for syncing the output
+ * files to disk, which can be slow, on a different thread than the one
+ * that collects the state.
+ * write_checkpoint_data stores the positions and checksums of all output
+ * files and writes the state to a temporary file, the name of which
+ * is returned in fntemp.
+ * finish_checkpoint syncs all output files, closes fp and renames the
+ * temporary file as described for write_checkpoint; it frees fntemp.
+ */
+t_fileio *write_checkpoint_data(const char *fn,
+                                FILE *fplog, t_commrec *cr,
+                                int eIntegrator, int simulation_part,
+                                gmx_bool bExpanded, int elamstats,
+                                gmx_large_int_t step, double t,
+                                t_state *state, int nparts, char **fntemp);
+
+void finish_checkpoint(t_fileio *fp, char *fntemp,
+                       const char *fn, gmx_bool bNumberAndKeep);
+
+/* Write part number part of a distributed checkpoint with base name fn
+ * to <fn>_step<step>_part<part>.cpt. The part contains the nhome atoms
+ * with global indices index of the local state.
+ * The part files are read, and checked for completeness, together with
+ * the main checkpoint file by all the checkpoint reading functions.
+ */
+void write_checkpoint_part(const char *fn, gmx_large_int_t step,
+                           int part, int nparts, int natoms,
+                           int nhome, int *index, t_state *state);
+
+/* Remove the part file written by write_checkpoint_part, if present */
+void remove_checkpoint_part(const char *fn, gmx_large_int_t step, int part);
 
 /* Loads a checkpoint from fn for run continuation.
  * Generates a fatal error on system size mismatch.
@@ -70,13 +105,11 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
  */
 void load_checkpoint(const char *fn, FILE **fplog,
                      t_commrec *cr, gmx_bool bPartDecomp, ivec dd_nc,
-                     t_inputrec *ir, t_state *state, gmx_bool *bReadRNG,
+                     t_inputrec *ir, t_state *state,
                      gmx_bool *bReadEkin, gmx_bool bAppend, gmx_bool bForceAppend);
 
 /* Read the state from checkpoint file.
  * Arrays in state that are NULL are allocated.
- * If bReadRNG=TRUE a RNG state compatible with the current
- * number of nodes was read.
  */
 void read_checkpoint_state(const char *fn, int *simulation_part,
                            gmx_large_int_t *step, double *t, t_state *state);
@@ -87,6 +120,11 @@ void read_checkpoint_trxframe(t_fileio *fp, t_trxframe *fr);
 /* Print the complete contents of checkpoint file fn to out */
 void list_checkpoint(const char *fn, FILE *out);
 
+/* Convert the distributed checkpoint fn, with its part files,
+ * to the single-file checkpoint fn_out.
+ */
+void convert_checkpoint(const char *fn, const char *fn_out);
+
 /* Read just the simulation 'generation' and with bAppendReq check files.
  * This is necessary already at the beginning of mdrun,
  * to be able to rename the logfile correctly.
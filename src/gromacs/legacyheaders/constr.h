@@ -96,7 +96,15 @@ gmx_bool bshakef(FILE           *log,          /* Log file			*/
 
 gmx_settledata_t settle_init(real mO, real mH, real invmO, real invmH,
                              real dOH, real dHH);
-/* Initializes and returns a structure with SETTLE parameters */
+/* Initializes and returns a structure with SETTLE parameters.
+ * The SIMD kernels are used, when available, unless the environment
+ * variable GMX_SETTLE_NO_SIMD is set.
+ */
+
+void settle_set_simd(gmx_settledata_t settled, gmx_bool bSimd);
+/* Sets whether to use the SIMD SETTLE kernels, ignored when they are
+ * not available.
+ */
 
 void csettle(gmx_settledata_t settled,
              int              nsettle,          /* Number of settles            */
@@ -236,7 +244,16 @@ real lincs_rmsd(gmx_lincsdata_t lincsd, gmx_bool bSD2);
 gmx_lincsdata_t init_lincs(FILE *fplog, gmx_mtop_t *mtop,
                            int nflexcon_global, t_blocka *at2con,
                            gmx_bool bPLINCS, int nIter, int nProjOrder);
-/* Initializes and returns the lincs data struct */
+/* Initializes and returns the lincs data struct.
+ * The SIMD kernels are used, when available, unless the environment
+ * variable GMX_LINCS_NO_SIMD is set.
+ */
+
+void lincs_set_simd(gmx_lincsdata_t li, gmx_bool bSimd);
+/* Sets whether to use the SIMD LINCS kernels, ignored when they are
+ * not available or with constraint triangles. Should be called
+ * before set_lincs.
+ */
 
 void set_lincs(t_idef *idef, t_mdatoms *md,
                gmx_bool bDynamics, t_commrec *cr,
@@ -126,8 +126,22 @@ void dd_collect_vec(gmx_domdec_t *dd,
 void dd_collect_state(gmx_domdec_t *dd,
                       t_state *state_local, t_state *state);
 
+void dd_collect_state_no_atoms(gmx_domdec_t *dd,
+                               t_state *state_local, t_state *state);
+/* As dd_collect_state, but leaves out the per-atom entries x, v, sd_X
+ * and cg_p, which are written per node with distributed checkpointing.
+ */
+
+int dd_get_home_atom_index(gmx_domdec_t *dd, t_state *state_local,
+                           int **index_gl);
+/* Sets *index_gl to the global atom indices of the home atoms of state_local,
+ * in local order, and returns the number of home atoms.
+ * The index array is owned by dd and is valid until the next call
+ * or the next repartitioning.
+ */
+
 enum {
-    ddCyclStep, ddCyclPPduringPME, ddCyclF, ddCyclPME, ddCyclNr
+    ddCyclStep, ddCyclPPduringPME, ddCyclF, ddCyclPME, ddCyclWaitPME, ddCyclNr
 };
 
 void dd_cycles_add(gmx_domdec_t *dd, float cycles, int ddCycl);
@@ -147,6 +161,18 @@ float dd_pme_f_ratio(gmx_domdec_t *dd);
 void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[]);
 /* Communicate the coordinates to the neighboring cells and do pbc. */
 
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[]);
+/* Starts the communication done by dd_move_x. Only the first pulse,
+ * which only sends home atoms, is started with non-blocking calls.
+ * Between this call and dd_move_x_finish, the home coordinates
+ * should not be changed and the non-home coordinates not be used.
+ * Without decomposed dimensions or with GMX_DD_SENDRECV2 set,
+ * all communication is done here with blocking calls.
+ */
+
+void dd_move_x_finish(gmx_domdec_t *dd, matrix box, rvec x[]);
+/* Completes the communication started by dd_move_x_start */
+
 void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift);
 /* Sum the forces over the neighboring cells.
  * When fshift!=NULL the shift forces are updated to obtain
@@ -190,6 +216,13 @@ void reset_dd_statistics_counters(gmx_domdec_t *dd);
 
 void print_dd_statistics(t_commrec *cr, t_inputrec *ir, FILE *fplog);
 
+void dd_init_load_stats(FILE *fplog, gmx_domdec_t *dd,
+                        const char *fn, gmx_bool bAppend);
+/* Sets up writing the load, cell boundaries and halo sizes of all DD nodes
+ * to file fn at every load collection. Should be called on all PP nodes,
+ * only the DD master opens the file.
+ */
+
 /* In domdec_con.c */
 
 void dd_move_f_vsites(gmx_domdec_t *dd, rvec *f, rvec *fshift);
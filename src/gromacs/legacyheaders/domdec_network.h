@@ -61,6 +61,22 @@ dd_sendrecv_rvec(const gmx_domdec_t *dd,
                  rvec *buf_r, int n_r);
 
 
+/* As dd_sendrecv_rvec, but only starts the communication with
+ * non-blocking calls. The (at most two) requests are returned in req,
+ * their number in nreq. The buffers should not be accessed
+ * before completing the requests with dd_waitall.
+ */
+void
+dd_isendrecv_rvec(const gmx_domdec_t *dd,
+                  int ddimind, int direction,
+                  rvec *buf_s, int n_s,
+                  rvec *buf_r, int n_r,
+                  int *nreq, MPI_Request req[]);
+
+/* Waits for the completion of nreq non-blocking requests */
+void
+dd_waitall(int nreq, MPI_Request req[]);
+
 /* Move revc's in the comm. region one cell along the domain decomposition
  * in dimension indexed by ddimind
  * simultaneously in the forward and backward directions.
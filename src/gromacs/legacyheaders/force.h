@@ -290,6 +290,19 @@ extern void do_force_lowlevel(FILE         *fplog,
                               float        *cycles_pme);
 /* Call all the force routines */
 
+gmx_bool pme_mesh_step(const t_forcerec *fr, const t_inputrec *ir,
+                       gmx_large_int_t step, int flags);
+/* Returns whether the PME mesh part should be computed at this step.
+ * With multiple time stepping (nstcalcpme > 1) this is only the case
+ * every nstcalcpme steps and when energies, the virial or dH/dl are needed.
+ */
+
+gmx_bool pme_mesh_impulse_step(const t_forcerec *fr, const t_inputrec *ir,
+                               gmx_large_int_t step);
+/* Returns whether the PME mesh forces in fr->f_twin should be applied
+ * as an impulse at this step, i.e. with nstcalcpme > 1 every nstcalcpme steps.
+ */
+
 #ifdef __cplusplus
 }
 #endif
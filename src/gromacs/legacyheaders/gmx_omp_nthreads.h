@@ -38,6 +38,9 @@
 
 #include "types/commrec.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /*! Enum values corresponding to multithreaded algorithmic modules. */
 typedef enum module_nth
@@ -66,4 +69,8 @@ int gmx_omp_nthreads_get(int mod);
 void gmx_omp_nthreads_read_env(int     *nthreads_omp,
                                gmx_bool bIsSimMaster);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* GMX_OMP_NTHREADS */
@@ -57,6 +57,10 @@ typedef struct gmx_parallel_3dfft *
  *                        that could make results differ for two runs with
  *                        identical input (reproducibility for debugging).
  *  \param nthreads       Run in parallel using n threads
+ *  \param bLowMem        Do not allocate extra transpose buffers for
+ *                        threads, at the cost of some thread
+ *                        synchronization. The real data is then also
+ *                        overwritten by the forward transform.
  *
  *  \return 0 or a standard error code.
  */
@@ -69,7 +73,8 @@ int
                                int *                     slab2index_major,
                                int *                     slab2index_minor,
                                gmx_bool                  bReproducible,
-                               int                       nthreads);
+                               int                       nthreads,
+                               gmx_bool                  bLowMem);
 
 
 
@@ -257,6 +257,103 @@ gmx_rng_gaussian_real(gmx_rng_t rng);
 real
 gmx_rng_gaussian_table(gmx_rng_t rng);
 
+
+/* Counter-based random numbers
+ *
+ * The functions below do not have a state that advances: each call
+ * returns 4 random 32-bit words that are a function only of a key,
+ * formed by a seed and a stream number, and a counter, formed by
+ * the MD step, an index (usually the global atom index) and a sub-counter.
+ * This means that random numbers for an atom can be generated on any
+ * rank and thread in any order, the results do not depend on
+ * the parallelization, and there is no state to store in checkpoints.
+ * The generator is ThreeFry-4x32 with 20 rounds, see Salmon et al.,
+ * "Parallel random numbers: as easy as 1, 2, 3", SC11 (2011).
+ *
+ * Each use of random numbers in mdrun should use its own stream,
+ * so the same seed can be shared between them without correlations.
+ */
+enum {
+    RND_SEED_UPDATE = 1, RND_SEED_VRESCALE, RND_SEED_ANDERSEN, RND_SEED_REPLEX
+};
+
+/*! \brief Applies the ThreeFry-4x32-20 block function
+ *
+ *  Returns in rnd 4 random 32-bit words for counter ctr and key key.
+ *
+ * \threadsafe Yes.
+ */
+void
+gmx_rng_threefry4x32(const unsigned int ctr[4], const unsigned int key[4],
+                     unsigned int rnd[4]);
+
+/*! \brief Returns 4 Gaussian random numbers, using the Gaussian table
+ *
+ *  The numbers are determined by the seed, stream, step, index and sub
+ *  counter, the granularity is that of gmx_rng_gaussian_table().
+ *
+ * \threadsafe Yes.
+ */
+void
+gmx_rng_cycle_4gaussian_table(unsigned int seed, int stream,
+                              gmx_large_int_t step, int index, int sub,
+                              real rnd[4]);
+
+/*! \brief Generates Gaussian random numbers for n indices at once
+ *
+ *  For each i in 0..n-1 and s in 0..nsub-1 this stores in
+ *  rnd[(i*nsub + s)*4 + j], j=0..3, the same numbers as
+ *  gmx_rng_cycle_4gaussian_table() returns for index index[i]
+ *  and sub counter sub0+s. When index is NULL, index0+i is used instead.
+ *  With SSE2 four indices are processed at once.
+ *
+ * \threadsafe Yes.
+ */
+void
+gmx_rng_cycle_gaussian_table_batch(unsigned int seed, int stream,
+                                   gmx_large_int_t step,
+                                   int n, const int *index, int index0,
+                                   int sub0, int nsub,
+                                   real *rnd);
+
+/*! \brief A sequence of counter-based random numbers
+ *
+ *  For the cases where an a priori unknown amount of random numbers
+ *  is required, such as rejection sampling, this cycles the sub counter.
+ *  Note that the sub counter starts at 0, so the numbers overlap with
+ *  those from gmx_rng_cycle_4gaussian_table() with the same stream,
+ *  step and index.
+ */
+typedef struct {
+    unsigned int ctr[4];
+    unsigned int key[4];
+    unsigned int rnd[4];
+    int          nleft;
+    int          has_saved;
+    real         gauss_saved;
+} gmx_rng_cycle_t;
+
+/*! \brief Initializes a random number sequence */
+void
+gmx_rng_cycle_init(gmx_rng_cycle_t *rc, unsigned int seed, int stream,
+                   gmx_large_int_t step, int index);
+
+/*! \brief Random 32-bit integer from a uniform distribution */
+unsigned int
+gmx_rng_cycle_uint32(gmx_rng_cycle_t *rc);
+
+/*! \brief Random real 0<=x<1 from a uniform distribution */
+real
+gmx_rng_cycle_uniform_real(gmx_rng_cycle_t *rc);
+
+/*! \brief Random real from a Gaussian distribution, polar Box-Muller */
+real
+gmx_rng_cycle_gaussian_real(gmx_rng_cycle_t *rc);
+
+/*! \brief Random real from a Gaussian distribution, using the table */
+real
+gmx_rng_cycle_gaussian_table(gmx_rng_cycle_t *rc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -55,6 +55,8 @@
 #undef gmx_mm_pr
 
 #undef gmx_load_pr
+/* Only used for PME spreading and gathering */
+#undef gmx_loadu_pr
 #undef gmx_load1_pr
 #undef gmx_set1_pr
 #undef gmx_setzero_pr
@@ -66,6 +68,7 @@
 #undef gmx_sub_pr
 #undef gmx_mul_pr
 #undef gmx_max_pr
+#undef gmx_min_pr
 #undef gmx_cmplt_pr
 #undef gmx_and_pr
 #undef gmx_or_pr
@@ -87,6 +90,9 @@
 #undef gmx_cvtepi32_pr
 
 #undef gmx_invsqrt_pr
+#undef gmx_inv_pr
+#undef gmx_exp_pr
+#undef gmx_acos_pr
 #undef gmx_calc_rsq_pr
 #undef gmx_sum4_pr
 
@@ -142,6 +148,7 @@
 #define gmx_mm_pr  __m128
 
 #define gmx_load_pr       _mm_load_ps
+#define gmx_loadu_pr      _mm_loadu_ps
 #define gmx_load1_pr      _mm_load1_ps
 #define gmx_set1_pr       _mm_set1_ps
 #define gmx_setzero_pr    _mm_setzero_ps
@@ -152,6 +159,7 @@
 #define gmx_sub_pr        _mm_sub_ps
 #define gmx_mul_pr        _mm_mul_ps
 #define gmx_max_pr        _mm_max_ps
+#define gmx_min_pr        _mm_min_ps
 #define gmx_cmplt_pr      _mm_cmplt_ps
 #define gmx_and_pr        _mm_and_ps
 #define gmx_or_pr         _mm_or_ps
@@ -168,6 +176,9 @@
 #define gmx_cvtepi32_pr   _mm_cvtepi32_ps
 
 #define gmx_invsqrt_pr    gmx_mm_invsqrt_ps
+#define gmx_inv_pr        gmx_mm_inv_ps
+#define gmx_exp_pr        gmx_mm_exp_ps
+#define gmx_acos_pr       gmx_mm_acos_ps
 #define gmx_calc_rsq_pr   gmx_mm_calc_rsq_ps
 #define gmx_sum4_pr       gmx_mm_sum4_ps
 
@@ -183,6 +194,7 @@
 #define gmx_mm_pr  __m128d
 
 #define gmx_load_pr       _mm_load_pd
+#define gmx_loadu_pr      _mm_loadu_pd
 #define gmx_load1_pr      _mm_load1_pd
 #define gmx_set1_pr       _mm_set1_pd
 #define gmx_setzero_pr    _mm_setzero_pd
@@ -193,6 +205,7 @@
 #define gmx_sub_pr        _mm_sub_pd
 #define gmx_mul_pr        _mm_mul_pd
 #define gmx_max_pr        _mm_max_pd
+#define gmx_min_pr        _mm_min_pd
 #define gmx_cmplt_pr      _mm_cmplt_pd
 #define gmx_and_pr        _mm_and_pd
 #define gmx_or_pr         _mm_or_pd
@@ -209,6 +222,9 @@
 #define gmx_cvtepi32_pr   _mm_cvtepi32_pd
 
 #define gmx_invsqrt_pr    gmx_mm_invsqrt_pd
+#define gmx_inv_pr        gmx_mm_inv_pd
+#define gmx_exp_pr        gmx_mm_exp_pd
+#define gmx_acos_pr       gmx_mm_acos_pd
 #define gmx_calc_rsq_pr   gmx_mm_calc_rsq_pd
 #define gmx_sum4_pr       gmx_mm_sum4_pd
 
@@ -232,6 +248,7 @@
 #define gmx_mm_pr  __m256
 
 #define gmx_load_pr       _mm256_load_ps
+#define gmx_loadu_pr      _mm256_loadu_ps
 #define gmx_load1_pr(x)   _mm256_set1_ps((x)[0])
 #define gmx_set1_pr       _mm256_set1_ps
 #define gmx_setzero_pr    _mm256_setzero_ps
@@ -242,6 +259,7 @@
 #define gmx_sub_pr        _mm256_sub_ps
 #define gmx_mul_pr        _mm256_mul_ps
 #define gmx_max_pr        _mm256_max_ps
+#define gmx_min_pr        _mm256_min_ps
 /* Not-equal (ordered, non-signaling)  */
 #define gmx_cmpneq_pr(x, y)  _mm256_cmp_ps(x, y, 0x0c)
 /* Less-than (ordered, non-signaling)  */
@@ -260,6 +278,9 @@
 #define gmx_cvttpr_epi32  _mm256_cvttps_epi32
 
 #define gmx_invsqrt_pr    gmx_mm256_invsqrt_ps
+#define gmx_inv_pr        gmx_mm256_inv_ps
+#define gmx_exp_pr        gmx_mm256_exp_ps
+#define gmx_acos_pr       gmx_mm256_acos_ps
 #define gmx_calc_rsq_pr   gmx_mm256_calc_rsq_ps
 #define gmx_sum4_pr       gmx_mm256_sum4_ps
 
@@ -292,6 +313,7 @@
 #define gmx_mm_pr  __m256d
 
 #define gmx_load_pr       _mm256_load_pd
+#define gmx_loadu_pr      _mm256_loadu_pd
 #define gmx_load1_pr(x)   _mm256_set1_pd((x)[0])
 #define gmx_set1_pr       _mm256_set1_pd
 #define gmx_setzero_pr    _mm256_setzero_pd
@@ -302,6 +324,7 @@
 #define gmx_sub_pr        _mm256_sub_pd
 #define gmx_mul_pr        _mm256_mul_pd
 #define gmx_max_pr        _mm256_max_pd
+#define gmx_min_pr        _mm256_min_pd
 /* Not-equal (ordered, non-signaling)  */
 #define gmx_cmpneq_pr(x, y)  _mm256_cmp_pd(x, y, 0x0c)
 /* Less-than (ordered, non-signaling)  */
@@ -320,6 +343,9 @@
 #define gmx_cvttpr_epi32  _mm256_cvttpd_epi32
 
 #define gmx_invsqrt_pr    gmx_mm256_invsqrt_pd
+#define gmx_inv_pr        gmx_mm256_inv_pd
+#define gmx_exp_pr        gmx_mm256_exp_pd
+#define gmx_acos_pr       gmx_mm256_acos_pd
 #define gmx_calc_rsq_pr   gmx_mm256_calc_rsq_pd
 #define gmx_sum4_pr       gmx_mm256_sum4_pd
 
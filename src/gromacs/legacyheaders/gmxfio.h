@@ -166,10 +166,15 @@ int gmx_fio_seek(t_fileio *fio, gmx_off_t fpos);
 /* Set file position if possible, quit otherwise */
 
 FILE *gmx_fio_getfp(t_fileio *fio);
-/* Return the file pointer itself */
+/* Return the file pointer itself.
+ * A memory mapping for reading is removed, after which fio reads
+ * through the stream, starting at the current position.
+ */
 
 XDR *gmx_fio_getxdr(t_fileio *fio);
-/* Return the file pointer itself */
+/* Return the XDR pointer itself, a memory mapping is removed
+ * as with gmx_fio_getfp.
+ */
 
 
 
@@ -224,8 +229,30 @@ int gmx_fio_get_file_md5(t_fileio *fio, gmx_off_t offset,
 
 
 int xtc_seek_frame(t_fileio *fio, int frame, int natoms);
+/* Seek to the first frame with step >= frame, returns 0 on success */
 
 int xtc_seek_time(t_fileio *fio, real time, int natoms, gmx_bool bSeekForwardOnly);
+/* Seek to the first frame with time >= time, returns 0 on success.
+ * Both seek functions use a frame offset index of the xtc file, which is
+ * stored in the file <name>.xtc.idx, so it only needs to be built once.
+ * Setting the environment variable GMX_NO_XTC_INDEX_FILE disables
+ * reading and writing of the index file.
+ */
+
+int xtc_get_index_frame(t_fileio *fio, int natoms,
+                        int *nframes, const float **time);
+/* Returns the number of the indexed xtc frame at the current file position
+ * and sets *nframes and *time to the number and times of the indexed frames.
+ * The times stay valid until the next call of an xtc seek function.
+ * Returns -1 when the file can not be indexed or the current position
+ * is not at the start of an indexed frame.
+ */
+
+int xtc_seek_index_frame(t_fileio *fio, int frame);
+/* Seek to frame number frame of the xtc index, frame equal to the number
+ * of indexed frames seeks to the end of the indexed frames.
+ * Returns 0 on success.
+ */
 
 
 /* Add this to the comment string for debugging */
@@ -118,6 +118,14 @@ t_pargs *add_acf_pargs(int *npargs, t_pargs *pa);
 void cross_corr(int n, real f[], real g[], real corr[]);
 /* Simple minded cross correlation algorithm */
 
+void do_four_core(unsigned long mode, int nfour, int nf2, int nframes,
+                  real c1[], real csum[], real ctmp[]);
+/* Calculates the autocorrelation function of c1 using FFT.
+ * nfour should be a power of two that is at least 2*nframes, csum and ctmp
+ * should have nfour elements. On return, the first nf2 elements of c1 contain
+ * the correlation function normalized by the number of contributing points.
+ */
+
 real fit_acf(int ncorr, int fitfn, const output_env_t oenv, gmx_bool bVerbose,
              real tbeginfit, real tendfit, real dt, real c1[], real *fit);
 /* Fit an ACF to a given function */
@@ -47,6 +47,8 @@
 extern "C" {
 #endif
 
+typedef struct gmx_mdoutf_writer *gmx_mdoutf_writer_t;
+
 typedef struct {
     t_fileio   *fp_trn;
     t_fileio   *fp_xtc;
@@ -54,12 +56,23 @@ typedef struct {
     ener_file_t fp_ene;
     const char *fn_cpt;
     gmx_bool    bKeepAndNumCPT;
+    /* With bCPTParts each DD node writes the atom state of its home atoms
+     * to a separate checkpoint part file; the steps of the last parts
+     * written are stored for removing them when they are no longer used.
+     */
+    gmx_bool        bCPTParts;
+    gmx_large_int_t cpt_part_step[3];
+    int             ncpt_part_step;
     int         eIntegrator;
     gmx_bool    bExpanded;
     int         elamstats;
     int         simulation_part;
     FILE       *fp_dhdl;
     FILE       *fp_field;
+    /* Writes trn and xtc frames and finishes checkpoints on a separate
+     * thread, NULL when output is written by the calling thread.
+     */
+    gmx_mdoutf_writer_t writer;
 } gmx_mdoutf_t;
 
 typedef struct gmx_global_stat *gmx_global_stat_t;
@@ -134,6 +147,8 @@ void write_traj(FILE *fplog, t_commrec *cr,
 /* Routine that writes frames to trn, xtc and/or checkpoint.
  * What is written is determined by the mdof_flags defined above.
  * Data is collected to the master node only when necessary.
+ * With an output writer thread, the collected data is copied and
+ * written and synced to disk asynchronously.
  */
 
 int do_per_step(gmx_large_int_t step, gmx_large_int_t nstep);
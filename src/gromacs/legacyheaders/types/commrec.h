@@ -137,6 +137,8 @@ typedef struct {
     MPI_Comm               mpi_comm_all;
     /* Use MPI_Sendrecv communication instead of non-blocking calls */
     gmx_bool               bSendRecv2;
+    /* Overlap the first coordinate halo pulse with local force work */
+    gmx_bool               bOverlapX;
     /* The local DD cell index and rank */
     ivec                   ci;
     int                    rank;
@@ -148,6 +150,11 @@ typedef struct {
     gmx_pme_comm_n_box_p_t cnb;
     int                    nreq_pme;
     MPI_Request            req_pme[4];
+    /* Non-blocking halo coordinate communication started by
+     * dd_move_x_start, nreq_x=-1 when no communication is pending.
+     */
+    int                    nreq_x;
+    MPI_Request            req_x[2];
 
 
     /* The communication setup, identical for each cell, cartesian index */
@@ -328,6 +328,10 @@ typedef struct {
     gmx_bool bTwinRange;
     int      nlr;
     rvec    *f_twin;
+    /* PME multiple time stepping (nstcalcpme > 1),
+     * the PME mesh forces are then stored in f_twin.
+     */
+    gmx_bool bPMEMTS;
 
     /* Forces that should not enter into the virial summation:
      * PPPM/PME/Ewald/posres
@@ -463,6 +467,11 @@ typedef struct {
     int         red_ashift;
     int         red_nblock;
     f_thread_t *f_t;
+    /* Division of the bonded interactions over the threads, thread t
+     * computes iatoms il_thread_division[ftype*(nthreads+1)+t] up to
+     * il_thread_division[ftype*(nthreads+1)+t+1] of each type.
+     */
+    int        *il_thread_division;
 
     /* Exclusion load distribution over the threads */
     int  *excl_load;
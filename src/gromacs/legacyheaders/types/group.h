@@ -73,6 +73,7 @@ typedef struct {
     t_grp_tcstat    *tcstat;          /* T-coupling data            */
     tensor         **ekin_work_alloc; /* Allocated locations of ekin_work   */
     tensor         **ekin_work;       /* Work arrays for tcstat per thread    */
+    gmx_bool         bEkinhUpdate;    /* ekin_work holds ekinh from the update */
     int              ngacc;           /* The number of acceleration groups    */
     t_grp_acc       *grpstat;         /* Acceleration data			*/
     tensor           ekin;            /* overall kinetic energy               */
@@ -301,6 +301,7 @@ typedef struct {
     int             nkx, nky, nkz;        /* number of k vectors in each spatial dimension*/
                                           /* for fourier methods for long range electrost.*/
     int             pme_order;            /* interpolation order for PME                  */
+    int             nstcalcpme;           /* Frequency of evaluating the PME mesh part    */
     real            ewald_rtol;           /* Real space tolerance for Ewald, determines   */
                                           /* the real/reciprocal space relative weight    */
     int             ewald_geometry;       /* normal/3d ewald, or pseudo-2d LR corrections */
@@ -57,10 +57,16 @@ typedef struct {
     int                    nChargePerturbed;
     gmx_bool               bOrires;
     real                  *massA, *massB, *massT, *invmass;
+    /* Per-dimension copies of massT and invmass (3*nr reals), only set
+     * for leap-frog MD, used by the SIMD update with fused kinetic energy
+     */
+    real                  *massT_dim, *invmass_dim;
     real                  *chargeA, *chargeB;
     gmx_bool              *bPerturbed;
     int                   *typeA, *typeB;
     unsigned short        *ptype;
+    /* The number of home virtual sites and shells */
+    int                    nVsiteShell;
     unsigned short        *cTC, *cENER, *cACC, *cFREEZE, *cVCM;
     unsigned short        *cU1, *cU2, *cORF;
     /* for QMMM, atomnumber contains atomic number of the atoms */
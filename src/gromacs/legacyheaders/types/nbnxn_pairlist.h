@@ -166,6 +166,7 @@ enum {
 
 typedef struct {
     real *f;      /* f, size natoms*fstride                             */
+    real *fred;   /* Reduction buffer for one buffer flag block         */
     real *fshift; /* Shift force array, size SHIFTS*DIM                 */
     int   nV;     /* The size of *Vvdw and *Vc                          */
     real *Vvdw;   /* Temporary Van der Waals group energy storage       */
@@ -55,6 +55,9 @@ extern "C" {
 /* These enums are used in flags as (1<<est...).
  * The order of these enums should not be changed,
  * since that affects the checkpoint (.cpt) file format.
+ * estLD_RNG and estLD_RNGI are no longer used, since the SD, BD and
+ * temperature coupling random numbers are now counter based,
+ * but they are kept to be able to read old checkpoint files.
  */
 enum {
     estLAMBDA,
@@ -183,8 +186,6 @@ typedef struct
     int              ngtc;
     int              nnhpres;
     int              nhchainlength; /* number of nose-hoover chains               */
-    int              nrng;
-    int              nrngi;
     int              flags;           /* Flags telling which entries are present      */
     int              fep_state;       /* indicates which of the alchemical states we are in                 */
     real            *lambda;          /* lambda vector                               */
@@ -207,9 +208,6 @@ typedef struct
     rvec            *sd_X;            /* random part of the x update for stoch. dyn.  */
     rvec            *cg_p;            /* p vector for conjugate gradient minimization */
 
-    unsigned int    *ld_rng;          /* RNG random state                           */
-    int             *ld_rngi;         /* RNG index                                  */
-
     int              nmcrng;          /* number of RNG states                       */
     unsigned int    *mc_rng;          /* lambda MC RNG random state                 */
     int             *mc_rngi;         /* lambda MC RNG index                        */
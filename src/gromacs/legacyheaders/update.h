@@ -55,12 +55,6 @@ typedef struct gmx_update *gmx_update_t;
 /* Initialize the stochastic dynamics struct */
 gmx_update_t init_update(FILE *fplog, t_inputrec *ir);
 
-/* Store the random state from sd in state */
-void get_stochd_state(gmx_update_t sd, t_state *state);
-
-/* Set the random in sd from state */
-void set_stochd_state(gmx_update_t sd, t_state *state);
-
 /* Store the box at step step
  * as a reference state for simulations with box deformation.
  */
@@ -111,7 +105,7 @@ void update_coords(FILE             *fplog,
 
 /* Return TRUE if OK, FALSE in case of Shake Error */
 
-extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_large_int_t step, t_mdatoms *md, t_state *state, gmx_update_t upd, t_idef *idef, gmx_constr_t constr);
+extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_large_int_t step, const t_commrec *cr, t_mdatoms *md, t_state *state, gmx_update_t upd, t_idef *idef, gmx_constr_t constr);
 
 void update_constraints(FILE             *fplog,
                         gmx_large_int_t   step,
@@ -185,7 +179,7 @@ restore_ekinstate_from_state(t_commrec *cr,
 
 void berendsen_tcoupl(t_inputrec *ir, gmx_ekindata_t *ekind, real dt);
 
-void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rng, real rate, t_idef *idef, int nblocks, int *sblock, gmx_bool *randatom, int *randatom_list, gmx_bool *randomize, real *boltzfac);
+void andersen_tcoupl(t_inputrec *ir, gmx_large_int_t step, const t_commrec *cr, t_mdatoms *md, t_state *state, real rate, t_idef *idef, int nblocks, int *sblock, gmx_bool *randatom, int *randatom_list, gmx_bool *randomize, real *boltzfac);
 
 void nosehoover_tcoupl(t_grpopts *opts, gmx_ekindata_t *ekind, real dt,
                        double xi[], double vxi[], t_extmass *MassQ);
@@ -206,9 +200,9 @@ real NPT_energy(t_inputrec *ir, t_state *state, t_extmass *MassQ);
 void NBaroT_trotter(t_grpopts *opts, real dt,
                     double xi[], double vxi[], real *veta, t_extmass *MassQ);
 
-void vrescale_tcoupl(t_inputrec *ir, gmx_ekindata_t *ekind, real dt,
-                     double therm_integral[],
-                     gmx_rng_t rng);
+void vrescale_tcoupl(t_inputrec *ir, gmx_large_int_t step,
+                     gmx_ekindata_t *ekind, real dt,
+                     double therm_integral[]);
 /* Compute temperature scaling. For V-rescale it is done in update. */
 
 real vrescale_energy(t_grpopts *opts, double therm_integral[]);
@@ -39,6 +39,7 @@
 
 #include <stdio.h>
 #include "typedefs.h"
+#include "futil.h"
 
 #ifdef __PGI    /*Portland group compiler*/
 #define int64_t long long
@@ -83,6 +84,38 @@ extern const char *xdr_datatype_names[];
 int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision);
 
 
+/* The compressed coordinates of one frame as stored in the file */
+typedef struct
+{
+    int    size;          /* the number of coordinate triplets             */
+    float  precision;     /* the precision, -1 for uncompressed data       */
+    int    minint[3];     /* the minimum integer coordinates               */
+    int    maxint[3];     /* the maximum integer coordinates               */
+    int    smallidx;      /* the initial index for small differences       */
+    float  xsmall[3*9];   /* the coordinates, when size <= 9               */
+    int    nalloc;        /* the allocation size of buf                    */
+    int   *buf;           /* the bit reading state and compressed bytes    */
+} t_xdr3dfcoord_data;
+
+void xdr3dfcoord_data_init(t_xdr3dfcoord_data *data);
+/* Initializes data to an empty buffer */
+
+void xdr3dfcoord_data_done(t_xdr3dfcoord_data *data);
+/* Frees the buffer in data */
+
+int xdr3dfcoord_read_data(XDR *xdrs, t_xdr3dfcoord_data *data, int *size);
+/* Reads the compressed coordinates written by xdr3dfcoord into data,
+ * without decompressing them. Together with xdr3dfcoord_decompress this
+ * does the same as reading with xdr3dfcoord, but the decompression does
+ * not need the file, so it can be done in parallel for multiple frames.
+ */
+
+int xdr3dfcoord_decompress(t_xdr3dfcoord_data *data, float *fp, float *precision);
+/* Decompresses the coordinates in data into fp, which should have space
+ * for data->size triplets. Returns 0 when the data is corrupt.
+ */
+
+
 /* Read or write a *real* value (stored as float) */
 int xdr_real(XDR *xdrs, real *r);
 
@@ -112,6 +145,57 @@ float xdr_xtc_get_last_frame_time(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bO
 
 int xdr_xtc_get_last_frame_number(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bOK);
 
+
+/* Frame offset index of an xtc file, which allows seeking directly to a frame
+ * by number or time instead of bisecting the file for a frame header.
+ */
+typedef struct
+{
+    int        natoms;    /* the number of atoms in each frame                */
+    int        nframes;   /* the number of complete frames that are indexed   */
+    int        nalloc;    /* allocation size of offset, step and time         */
+    gmx_off_t *offset;    /* file offset of the start of each frame           */
+    int       *step;      /* step of each frame                               */
+    float     *time;      /* time of each frame                               */
+    gmx_bool   bSorted;   /* TRUE when time is non-decreasing over the frames */
+    gmx_off_t  end;       /* the offset up to which the file has been indexed */
+} t_xtc_index;
+
+void xdr_xtc_index_init(t_xtc_index *index, int natoms);
+/* Initializes an empty index for frames with natoms atoms */
+
+void xdr_xtc_index_done(t_xtc_index *index);
+/* Frees the contents of index */
+
+int xdr_xtc_index_update(t_xtc_index *index, FILE *fp, XDR *xdrs);
+/* Appends all complete frames between index->end and the end of the file
+ * to the index. Only the frame headers are read, the coordinates are
+ * skipped. The file position is restored on return.
+ * Returns the number of frames added or -1 on a file error.
+ */
+
+int xdr_xtc_index_find_time(const t_xtc_index *index, int first, real time);
+/* Returns the first frame from frame first onward with a time >= time,
+ * index->nframes when there is no such frame.
+ */
+
+int xdr_xtc_index_find_step(const t_xtc_index *index, int first, int step);
+/* Returns the first frame from frame first onward with a step >= step,
+ * index->nframes when there is no such frame.
+ */
+
+int xdr_xtc_index_find_offset(const t_xtc_index *index, gmx_off_t offset);
+/* Returns the frame starting at offset, -1 when no frame starts there */
+
+int xdr_xtc_index_read(t_xtc_index *index, const char *fn, FILE *fp, XDR *xdrs);
+/* Reads an index written with xdr_xtc_index_write from file fn and checks
+ * it against the xtc file open in fp and xdrs. Returns TRUE when the stored
+ * index is valid, otherwise index is left empty and FALSE is returned.
+ */
+
+int xdr_xtc_index_write(const t_xtc_index *index, const char *fn);
+/* Writes index to file fn, returns TRUE on success */
+
 #ifdef __cplusplus
 }
 #endif
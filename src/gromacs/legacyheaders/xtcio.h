@@ -64,6 +64,18 @@ int read_next_xtc(t_fileio *fio,
                   matrix box, rvec *x, real *prec, gmx_bool *bOK);
 /* Read subsequent frames */
 
+int read_next_xtc_data(t_fileio *fio,
+                       int natoms, int *step, real *time,
+                       matrix box, t_xdr3dfcoord_data *data, gmx_bool *bOK);
+/* Read the next frame, but return the coordinates in compressed form
+ * in data, so the decompression can be done later in parallel
+ */
+
+int xtc_decompress_coords(t_xdr3dfcoord_data *data, rvec *x, real *prec);
+/* Decompress the coordinates read by read_next_xtc_data into x,
+ * this function is thread safe
+ */
+
 int write_xtc(t_fileio *fio,
               int natoms, int step, real time,
               matrix box, rvec *x, real prec);
@@ -39,6 +39,7 @@
 #endif
 
 #include <math.h>
+#include <stdlib.h>
 #include "main.h"
 #include "constr.h"
 #include "copyrite.h"
@@ -54,6 +55,15 @@
 #include "gmxfio.h"
 #include "gmx_omp_nthreads.h"
 #include "gmx_omp.h"
+#include "macros.h"
+
+#ifdef GMX_X86_SSE2
+#define LINCS_SIMD
+#include "gmx_simd_widest.h"
+#define LINCS_SIMD_WIDTH GMX_SIMD_WIDTH_HERE
+#else
+#define LINCS_SIMD_WIDTH 1
+#endif
 
 typedef struct {
     int    b0;         /* first constraint for this thread */
@@ -106,6 +116,22 @@ typedef struct gmx_lincsdata {
     real           *mlambda; /* the Lagrange multipliers * -1 */
     /* storage for the constraint RMS relative deviation output */
     real            rmsd_data[3];
+    /* The SIMD data. The constraints 0 to nbatch*LINCS_SIMD_WIDTH are
+     * processed in batches of LINCS_SIMD_WIDTH. The coupling matrix of
+     * each batch is stored in SoA form with, for each lane, as many
+     * elements as the maximum number of connections in the batch.
+     * Unused elements couple to the constraint itself with factor 0.
+     */
+    gmx_bool        bSimd;        /* use the SIMD kernels */
+    int             nbatch;       /* the number of SIMD batches */
+    int             nbatch_alloc; /* allocation size of blnr_p and r_p */
+    int            *blnr_p;       /* index into the packed matrix per batch */
+    int             ncc_p_alloc;  /* allocation size of the packed matrix */
+    int            *blbnb_p;      /* packed list of constraint connections */
+    real           *blmf_p;       /* packed blmf */
+    real           *blmf1_p;      /* packed blmf1 */
+    real           *blcc_p;       /* packed tmpncc */
+    real           *r_p;          /* the normalized bond vectors in SoA form */
 } t_gmx_lincsdata;
 
 real *lincs_rmsd_data(struct gmx_lincsdata *lincsd)
@@ -125,6 +151,286 @@ real lincs_rmsd(struct gmx_lincsdata *lincsd, gmx_bool bSD2)
     }
 }
 
+/* Returns the end of the range of constraints, starting at b0,
+ * which the calling thread processes in SIMD batches.
+ */
+static int lincs_simd_end(const struct gmx_lincsdata *li, int b0, int b1)
+{
+    return max(b0, min(b1, li->nbatch*LINCS_SIMD_WIDTH));
+}
+
+#ifdef LINCS_SIMD
+
+/* The SIMD LINCS kernels process GMX_SIMD_WIDTH_HERE consecutive
+ * constraints at once. The thread ranges start at multiples of the
+ * SIMD width, so all r_p, rhs and sol accesses are per batch.
+ * Coordinates and connected constraint data are gathered with scalar
+ * loads into aligned buffers, since there is no gather instruction.
+ * The atom updates are left scalar, since constraints in a batch
+ * often share atoms.
+ */
+
+/* Gathers the atom pair distance vectors of the batch starting at b
+ * into the SoA buffer dx_buf, with pbc when pbc!=NULL.
+ */
+static void gather_dx_simd(int b, const int *bla, rvec *x, const t_pbc *pbc,
+                           real *dx_buf)
+{
+    int  l, m;
+    rvec dx;
+
+    for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+    {
+        if (pbc)
+        {
+            pbc_dx_aiuc(pbc, x[bla[2*(b+l)]], x[bla[2*(b+l)+1]], dx);
+        }
+        else
+        {
+            rvec_sub(x[bla[2*(b+l)]], x[bla[2*(b+l)+1]], dx);
+        }
+        for (m = 0; m < DIM; m++)
+        {
+            dx_buf[m*GMX_SIMD_WIDTH_HERE+l] = dx[m];
+        }
+    }
+}
+
+/* Computes the normalized bond vectors of constraints b0 to b1
+ * and stores them in r and, in SoA form, in r_p.
+ */
+static void calc_r_simd(int b0, int b1, const int *bla, rvec *x,
+                        const t_pbc *pbc, rvec *r, real *r_p)
+{
+    real      buf_array[DIM*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    int       b, l, m;
+    gmx_mm_pr dx_S[DIM], rlen_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (b = b0; b < b1; b += GMX_SIMD_WIDTH_HERE)
+    {
+        gather_dx_simd(b, bla, x, pbc, buf);
+        for (m = 0; m < DIM; m++)
+        {
+            dx_S[m] = gmx_load_pr(buf+m*GMX_SIMD_WIDTH_HERE);
+        }
+        rlen_S = gmx_invsqrt_pr(gmx_calc_rsq_pr(dx_S[XX], dx_S[YY], dx_S[ZZ]));
+        for (m = 0; m < DIM; m++)
+        {
+            gmx_store_pr(r_p+b*DIM+m*GMX_SIMD_WIDTH_HERE,
+                         gmx_mul_pr(rlen_S, dx_S[m]));
+        }
+        for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                r[b+l][m] = r_p[b*DIM+m*GMX_SIMD_WIDTH_HERE+l];
+            }
+        }
+    }
+}
+
+/* Computes the packed coupling matrix elements blcc_p and
+ * rhs1 = sol = blc*(r.dx - len) for constraints b0 to b1,
+ * where dx is the atom pair distance in x, with pbc when pbc!=NULL,
+ * and len is bllen, or 0 when bllen=NULL.
+ */
+static void calc_blcc_rhs_simd(int b0, int b1, const int *bla,
+                               rvec *x, const t_pbc *pbc,
+                               const real *blc, const real *bllen,
+                               rvec *r, const real *r_p,
+                               const int *blnr_p, const int *blbnb_p,
+                               const real *blmf_p, real *blcc_p,
+                               real *rhs1, real *sol)
+{
+    real      buf_array[DIM*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    int       b, n, k, l, m;
+    gmx_mm_pr r_S[DIM], ip_S, mvb_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (b = b0; b < b1; b += GMX_SIMD_WIDTH_HERE)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            r_S[m] = gmx_load_pr(r_p+b*DIM+m*GMX_SIMD_WIDTH_HERE);
+        }
+
+        for (n = blnr_p[b/GMX_SIMD_WIDTH_HERE]; n < blnr_p[b/GMX_SIMD_WIDTH_HERE+1]; n++)
+        {
+            for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+            {
+                k = blbnb_p[n*GMX_SIMD_WIDTH_HERE+l];
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[m*GMX_SIMD_WIDTH_HERE+l] = r[k][m];
+                }
+            }
+            ip_S = gmx_add_pr(gmx_add_pr(gmx_mul_pr(r_S[XX], gmx_load_pr(buf)),
+                                         gmx_mul_pr(r_S[YY], gmx_load_pr(buf+GMX_SIMD_WIDTH_HERE))),
+                              gmx_mul_pr(r_S[ZZ], gmx_load_pr(buf+2*GMX_SIMD_WIDTH_HERE)));
+            gmx_store_pr(blcc_p+n*GMX_SIMD_WIDTH_HERE,
+                         gmx_mul_pr(gmx_load_pr(blmf_p+n*GMX_SIMD_WIDTH_HERE), ip_S));
+        }
+
+        gather_dx_simd(b, bla, x, pbc, buf);
+        ip_S = gmx_add_pr(gmx_add_pr(gmx_mul_pr(r_S[XX], gmx_load_pr(buf)),
+                                     gmx_mul_pr(r_S[YY], gmx_load_pr(buf+GMX_SIMD_WIDTH_HERE))),
+                          gmx_mul_pr(r_S[ZZ], gmx_load_pr(buf+2*GMX_SIMD_WIDTH_HERE)));
+        if (bllen != NULL)
+        {
+            ip_S = gmx_sub_pr(ip_S, gmx_loadu_pr(bllen+b));
+        }
+        mvb_S = gmx_mul_pr(gmx_loadu_pr(blc+b), ip_S);
+        gmx_storeu_pr(rhs1+b, mvb_S);
+        gmx_storeu_pr(sol+b, mvb_S);
+    }
+}
+
+/* One matrix multiplication of the expansion for constraints b0 to b1 */
+static void lincs_matrix_mult_simd(int b0, int b1,
+                                   const int *blnr_p, const int *blbnb_p,
+                                   const real *blcc_p,
+                                   const real *rhs1, real *rhs2, real *sol)
+{
+    real      buf_array[GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    int       b, n, l;
+    gmx_mm_pr mvb_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (b = b0; b < b1; b += GMX_SIMD_WIDTH_HERE)
+    {
+        mvb_S = gmx_setzero_pr();
+        for (n = blnr_p[b/GMX_SIMD_WIDTH_HERE]; n < blnr_p[b/GMX_SIMD_WIDTH_HERE+1]; n++)
+        {
+            for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+            {
+                buf[l] = rhs1[blbnb_p[n*GMX_SIMD_WIDTH_HERE+l]];
+            }
+            mvb_S = gmx_add_pr(mvb_S,
+                               gmx_mul_pr(gmx_load_pr(blcc_p+n*GMX_SIMD_WIDTH_HERE),
+                                          gmx_load_pr(buf)));
+        }
+        gmx_storeu_pr(rhs2+b, mvb_S);
+        gmx_storeu_pr(sol+b, gmx_add_pr(gmx_loadu_pr(sol+b), mvb_S));
+    }
+}
+
+/* Computes the right-hand side of the centripetal correction
+ * for constraints b0 to b1 and sets *warn when a bond rotated
+ * more than allowed by wfac.
+ */
+static void calc_dist_iter_simd(int b0, int b1, const int *bla,
+                                rvec *xp, const t_pbc *pbc,
+                                const real *bllen, const real *blc,
+                                const int *nlocat, real wfac,
+                                real *rhs, real *sol, int *warn)
+{
+    real      buf_array[DIM*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    int       b, l, m, warn_mask;
+    gmx_mm_pr dx_S[DIM], len_S, len2_S, dlen2_S, lc_S, mvb_S;
+    gmx_mm_pr two_S, wfac_S, zero_S, min_S;
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    two_S  = gmx_set1_pr(2.0);
+    wfac_S = gmx_set1_pr(wfac);
+    zero_S = gmx_setzero_pr();
+    min_S  = gmx_set1_pr(GMX_REAL_MIN);
+
+    for (b = b0; b < b1; b += GMX_SIMD_WIDTH_HERE)
+    {
+        gather_dx_simd(b, bla, xp, pbc, buf);
+        for (m = 0; m < DIM; m++)
+        {
+            dx_S[m] = gmx_load_pr(buf+m*GMX_SIMD_WIDTH_HERE);
+        }
+        len_S   = gmx_loadu_pr(bllen+b);
+        len2_S  = gmx_mul_pr(len_S, len_S);
+        dlen2_S = gmx_sub_pr(gmx_mul_pr(two_S, len2_S),
+                             gmx_calc_rsq_pr(dx_S[XX], dx_S[YY], dx_S[ZZ]));
+
+        warn_mask = gmx_movemask_pr(gmx_cmplt_pr(dlen2_S, gmx_mul_pr(wfac_S, len2_S)));
+        if (warn_mask)
+        {
+            for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+            {
+                if ((warn_mask & (1<<l)) && (nlocat == NULL || nlocat[b+l]))
+                {
+                    *warn = b + l;
+                }
+            }
+        }
+
+        /* With dlen2 <= 0 we can only correct with the full length */
+        lc_S  = gmx_and_pr(gmx_cmplt_pr(zero_S, dlen2_S),
+                           gmx_mul_pr(dlen2_S,
+                                      gmx_invsqrt_pr(gmx_max_pr(dlen2_S, min_S))));
+        mvb_S = gmx_mul_pr(gmx_loadu_pr(blc+b), gmx_sub_pr(len_S, lc_S));
+        gmx_storeu_pr(rhs+b, mvb_S);
+        gmx_storeu_pr(sol+b, mvb_S);
+    }
+}
+
+/* Adds the sum over constraints b0 to b1 of bllen*fac*r r to vir */
+static void lincs_add_virial_simd(int b0, int b1,
+                                  const real *bllen, const real *fac,
+                                  const real *r_p, tensor vir)
+{
+    real      buf_array[GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+    int       b, l, i, j, c;
+    gmx_mm_pr r_S[DIM], f_S, fr_S, vir_S[6];
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (c = 0; c < 6; c++)
+    {
+        vir_S[c] = gmx_setzero_pr();
+    }
+
+    for (b = b0; b < b1; b += GMX_SIMD_WIDTH_HERE)
+    {
+        for (i = 0; i < DIM; i++)
+        {
+            r_S[i] = gmx_load_pr(r_p+b*DIM+i*GMX_SIMD_WIDTH_HERE);
+        }
+        f_S = gmx_mul_pr(gmx_loadu_pr(bllen+b), gmx_loadu_pr(fac+b));
+        /* Only the upper triangle, the tensor is symmetric */
+        c   = 0;
+        for (i = 0; i < DIM; i++)
+        {
+            fr_S = gmx_mul_pr(f_S, r_S[i]);
+            for (j = i; j < DIM; j++)
+            {
+                vir_S[c] = gmx_add_pr(vir_S[c], gmx_mul_pr(fr_S, r_S[j]));
+                c++;
+            }
+        }
+    }
+
+    c = 0;
+    for (i = 0; i < DIM; i++)
+    {
+        for (j = i; j < DIM; j++)
+        {
+            gmx_store_pr(buf, vir_S[c]);
+            for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+            {
+                vir[i][j] += buf[l];
+                if (j != i)
+                {
+                    vir[j][i] += buf[l];
+                }
+            }
+            c++;
+        }
+    }
+}
+
+#endif /* LINCS_SIMD */
+
 /* Do a set of nrec LINCS matrix multiplications.
  * This function will return with up to date thread-local
  * constraint data, without an OpenMP barrier.
@@ -134,7 +440,7 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
                                 const real *blcc,
                                 real *rhs1, real *rhs2, real *sol)
 {
-    int        nrec, rec, b, j, n, nr0, nr1;
+    int        nrec, rec, b, bs, j, n, nr0, nr1;
     real       mvb, *swap;
     int        ntriangle, tb, bits;
     const int *blnr     = lincsd->blnr, *blbnb = lincsd->blbnb;
@@ -142,11 +448,16 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
 
     ntriangle = lincsd->ntriangle;
     nrec      = lincsd->nOrder;
+    bs        = lincs_simd_end(lincsd, b0, b1);
 
     for (rec = 0; rec < nrec; rec++)
     {
 #pragma omp barrier
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        lincs_matrix_mult_simd(b0, bs, lincsd->blnr_p, lincsd->blbnb_p,
+                               lincsd->blcc_p, rhs1, rhs2, sol);
+#endif
+        for (b = bs; b < b1; b++)
         {
             mvb = 0;
             for (n = blnr[b]; n < blnr[b+1]; n++)
@@ -360,15 +671,17 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
                       int econq, real *dvdlambda,
                       gmx_bool bCalcVir, tensor rmdf)
 {
-    int      b0, b1, b, i, j, k, n;
+    int      b0, b1, bs, b, i, j, k, n;
     real     tmp0, tmp1, tmp2, im1, im2, mvb, rlen, len, wfac, lam;
     rvec     dx;
     int     *bla, *blnr, *blbnb;
     rvec    *r;
     real    *blc, *blmf, *blcc, *rhs1, *rhs2, *sol;
+    real    *blmf_p;
 
     b0 = lincsd->th[th].b0;
     b1 = lincsd->th[th].b1;
+    bs = lincs_simd_end(lincsd, b0, b1);
 
     bla    = lincsd->bla;
     r      = lincsd->tmpv;
@@ -377,14 +690,16 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     if (econq != econqForce)
     {
         /* Use mass-weighted parameters */
-        blc  = lincsd->blc;
-        blmf = lincsd->blmf;
+        blc    = lincsd->blc;
+        blmf   = lincsd->blmf;
+        blmf_p = lincsd->blmf_p;
     }
     else
     {
         /* Use non mass-weighted parameters */
-        blc  = lincsd->blc1;
-        blmf = lincsd->blmf1;
+        blc    = lincsd->blc1;
+        blmf   = lincsd->blmf1;
+        blmf_p = lincsd->blmf1_p;
     }
     blcc   = lincsd->tmpncc;
     rhs1   = lincsd->tmp1;
@@ -392,9 +707,12 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     sol    = lincsd->tmp3;
 
     /* Compute normalized i-j vectors */
+#ifdef LINCS_SIMD
+    calc_r_simd(b0, bs, bla, x, pbc, r, lincsd->r_p);
+#endif
     if (pbc)
     {
-        for (b = b0; b < b1; b++)
+        for (b = bs; b < b1; b++)
         {
             pbc_dx_aiuc(pbc, x[bla[2*b]], x[bla[2*b+1]], dx);
             unitv(dx, r[b]);
@@ -402,7 +720,7 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     }
     else
     {
-        for (b = b0; b < b1; b++)
+        for (b = bs; b < b1; b++)
         {
             rvec_sub(x[bla[2*b]], x[bla[2*b+1]], dx);
             unitv(dx, r[b]);
@@ -410,7 +728,12 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     }
 
 #pragma omp barrier
-    for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+    calc_blcc_rhs_simd(b0, bs, bla, f, NULL, blc, NULL, r, lincsd->r_p,
+                       lincsd->blnr_p, lincsd->blbnb_p, blmf_p, lincsd->blcc_p,
+                       rhs1, sol);
+#endif
+    for (b = bs; b < b1; b++)
     {
         tmp0 = r[b][0];
         tmp1 = r[b][1];
@@ -477,7 +800,10 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
          * where delta f is the constraint correction
          * of the quantity that is being constrained.
          */
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        lincs_add_virial_simd(b0, bs, lincsd->bllen, sol, lincsd->r_p, rmdf);
+#endif
+        for (b = bs; b < b1; b++)
         {
             mvb = lincsd->bllen[b]*sol[b];
             for (i = 0; i < DIM; i++)
@@ -501,7 +827,7 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
                      real invdt, rvec *v,
                      gmx_bool bCalcVir, tensor vir_r_m_dr)
 {
-    int      b0, b1, b, i, j, k, n, iter;
+    int      b0, b1, bs, b, i, j, k, n, iter;
     real     tmp0, tmp1, tmp2, im1, im2, mvb, rlen, len, len2, dlen2, wfac;
     rvec     dx;
     int     *bla, *blnr, *blbnb;
@@ -511,6 +837,7 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
 
     b0 = lincsd->th[th].b0;
     b1 = lincsd->th[th].b1;
+    bs = lincs_simd_end(lincsd, b0, b1);
 
     bla     = lincsd->bla;
     r       = lincsd->tmpv;
@@ -539,16 +866,26 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
         nlocat = NULL;
     }
 
+#ifdef LINCS_SIMD
+    /* Compute normalized i-j vectors for the SIMD batches */
+    calc_r_simd(b0, bs, bla, x, pbc, r, lincsd->r_p);
+#endif
+
     if (pbc)
     {
         /* Compute normalized i-j vectors */
-        for (b = b0; b < b1; b++)
+        for (b = bs; b < b1; b++)
         {
             pbc_dx_aiuc(pbc, x[bla[2*b]], x[bla[2*b+1]], dx);
             unitv(dx, r[b]);
         }
 #pragma omp barrier
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        calc_blcc_rhs_simd(b0, bs, bla, xp, pbc, blc, bllen, r, lincsd->r_p,
+                           lincsd->blnr_p, lincsd->blbnb_p, lincsd->blmf_p,
+                           lincsd->blcc_p, rhs1, sol);
+#endif
+        for (b = bs; b < b1; b++)
         {
             for (n = blnr[b]; n < blnr[b+1]; n++)
             {
@@ -563,7 +900,7 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
     else
     {
         /* Compute normalized i-j vectors */
-        for (b = b0; b < b1; b++)
+        for (b = bs; b < b1; b++)
         {
             i       = bla[2*b];
             j       = bla[2*b+1];
@@ -577,7 +914,12 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
         } /* 16 ncons flops */
 
 #pragma omp barrier
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        calc_blcc_rhs_simd(b0, bs, bla, xp, NULL, blc, bllen, r, lincsd->r_p,
+                           lincsd->blnr_p, lincsd->blbnb_p, lincsd->blmf_p,
+                           lincsd->blcc_p, rhs1, sol);
+#endif
+        for (b = bs; b < b1; b++)
         {
             tmp0 = r[b][0];
             tmp1 = r[b][1];
@@ -639,7 +981,11 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
         }
 
 #pragma omp barrier
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        calc_dist_iter_simd(b0, bs, bla, xp, pbc, bllen, blc, nlocat, wfac,
+                            rhs1, sol, warn);
+#endif
+        for (b = bs; b < b1; b++)
         {
             len = bllen[b];
             if (pbc)
@@ -705,7 +1051,10 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
     if (bCalcVir)
     {
         /* Constraint virial */
-        for (b = b0; b < b1; b++)
+#ifdef LINCS_SIMD
+        lincs_add_virial_simd(b0, bs, bllen, mlambda, lincsd->r_p, vir_r_m_dr);
+#endif
+        for (b = bs; b < b1; b++)
         {
             tmp0 = -bllen[b]*mlambda[b];
             for (i = 0; i < DIM; i++)
@@ -733,7 +1082,7 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
 void set_lincs_matrix(struct gmx_lincsdata *li, real *invmass, real lambda)
 {
     int        i, a1, a2, n, k, sign, center;
-    int        end, nk, kk;
+    int        end, nk, kk, g, l, s, np;
     const real invsqrt2 = 0.7071067811865475244;
 
     for (i = 0; (i < li->nc); i++)
@@ -805,6 +1154,30 @@ void set_lincs_matrix(struct gmx_lincsdata *li, real *invmass, real lambda)
         }
     }
 
+    /* Copy the mass factors to the packed matrix of the SIMD batches */
+    for (g = 0; g < li->nbatch; g++)
+    {
+        for (s = 0; s < li->blnr_p[g+1] - li->blnr_p[g]; s++)
+        {
+            for (l = 0; l < LINCS_SIMD_WIDTH; l++)
+            {
+                i  = g*LINCS_SIMD_WIDTH + l;
+                n  = li->blnr[i] + s;
+                np = (li->blnr_p[g] + s)*LINCS_SIMD_WIDTH + l;
+                if (n < li->blnr[i+1])
+                {
+                    li->blmf_p[np]  = li->blmf[n];
+                    li->blmf1_p[np] = li->blmf1[n];
+                }
+                else
+                {
+                    li->blmf_p[np]  = 0;
+                    li->blmf1_p[np] = 0;
+                }
+            }
+        }
+    }
+
     if (debug)
     {
         fprintf(debug, "Of the %d constraints %d participate in triangles\n",
@@ -987,6 +1360,8 @@ gmx_lincsdata_t init_lincs(FILE *fplog, gmx_mtop_t *mtop,
         fprintf(debug, "LINCS: using %d threads\n", li->nth);
     }
 
+    lincs_set_simd(li, getenv("GMX_LINCS_NO_SIMD") == NULL);
+
     if (bPLINCS || li->ncg_triangle > 0)
     {
         please_cite(fplog, "Hess2008a");
@@ -1012,19 +1387,102 @@ gmx_lincsdata_t init_lincs(FILE *fplog, gmx_mtop_t *mtop,
                     "between constraints inside triangles\n",
                     li->ncg_triangle, li->nOrder);
         }
+        if (li->bSimd)
+        {
+            fprintf(fplog, "Using SIMD LINCS kernels on batches of %d constraints\n",
+                    LINCS_SIMD_WIDTH);
+        }
     }
 
     return li;
 }
 
+void lincs_set_simd(struct gmx_lincsdata *li, gmx_bool bSimd)
+{
+#ifdef LINCS_SIMD
+    /* The extra expansion for triangles is not supported with SIMD */
+    li->bSimd = (bSimd && li->ncg_triangle == 0);
+#else
+    li->bSimd = FALSE;
+#endif
+}
+
+/* Sets up the SIMD batches and the packed constraint connection list */
+static void lincs_pack_matrix(struct gmx_lincsdata *li)
+{
+    int g, l, b, s, n, nslot, ncc_p;
+
+    li->nbatch = (li->bSimd ? li->nc/LINCS_SIMD_WIDTH : 0);
+
+    if (li->nbatch + 1 > li->nbatch_alloc)
+    {
+        li->nbatch_alloc = over_alloc_dd(li->nbatch + 1);
+        srenew(li->blnr_p, li->nbatch_alloc);
+        sfree_aligned(li->r_p);
+        snew_aligned(li->r_p, li->nbatch_alloc*DIM*LINCS_SIMD_WIDTH, 32);
+    }
+
+    /* Each batch gets the maximum number of connections of its lanes */
+    li->blnr_p[0] = 0;
+    for (g = 0; g < li->nbatch; g++)
+    {
+        nslot = 0;
+        for (l = 0; l < LINCS_SIMD_WIDTH; l++)
+        {
+            b     = g*LINCS_SIMD_WIDTH + l;
+            nslot = max(nslot, li->blnr[b+1] - li->blnr[b]);
+        }
+        li->blnr_p[g+1] = li->blnr_p[g] + nslot;
+    }
+
+    ncc_p = li->blnr_p[li->nbatch];
+    if (ncc_p > li->ncc_p_alloc)
+    {
+        li->ncc_p_alloc = over_alloc_dd(ncc_p);
+        srenew(li->blbnb_p, li->ncc_p_alloc*LINCS_SIMD_WIDTH);
+        sfree_aligned(li->blmf_p);
+        sfree_aligned(li->blmf1_p);
+        sfree_aligned(li->blcc_p);
+        snew_aligned(li->blmf_p, li->ncc_p_alloc*LINCS_SIMD_WIDTH, 32);
+        snew_aligned(li->blmf1_p, li->ncc_p_alloc*LINCS_SIMD_WIDTH, 32);
+        snew_aligned(li->blcc_p, li->ncc_p_alloc*LINCS_SIMD_WIDTH, 32);
+    }
+
+    for (g = 0; g < li->nbatch; g++)
+    {
+        for (s = 0; s < li->blnr_p[g+1] - li->blnr_p[g]; s++)
+        {
+            for (l = 0; l < LINCS_SIMD_WIDTH; l++)
+            {
+                b = g*LINCS_SIMD_WIDTH + l;
+                n = li->blnr[b] + s;
+                /* Let padding elements couple to the constraint itself,
+                 * their mass factor is set to zero.
+                 */
+                li->blbnb_p[(li->blnr_p[g] + s)*LINCS_SIMD_WIDTH + l] =
+                    (n < li->blnr[b+1] ? li->blbnb[n] : b);
+            }
+        }
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "LINCS: %d SIMD batches with %d packed couplings\n",
+                li->nbatch, ncc_p*LINCS_SIMD_WIDTH);
+    }
+}
+
 /* Sets up the work division over the threads */
 static void lincs_thread_setup(struct gmx_lincsdata *li, int natoms)
 {
     lincs_thread_t *li_m;
-    int             th;
+    int             th, sw, nb;
     unsigned       *atf;
     int             a;
 
+    sw = (li->bSimd ? LINCS_SIMD_WIDTH : 1);
+    nb = li->nc/sw;
+
     if (natoms > li->atf_nalloc)
     {
         li->atf_nalloc = over_alloc_large(natoms);
@@ -1045,9 +1503,11 @@ static void lincs_thread_setup(struct gmx_lincsdata *li, int natoms)
 
         li_th = &li->th[th];
 
-        /* The constraints are divided equally over the threads */
-        li_th->b0 = (li->nc* th   )/li->nth;
-        li_th->b1 = (li->nc*(th+1))/li->nth;
+        /* The constraints are divided equally over the threads,
+         * with SIMD in whole batches, the remainder goes to the last thread.
+         */
+        li_th->b0 = sw*((nb* th   )/li->nth);
+        li_th->b1 = (th == li->nth - 1 ? li->nc : sw*((nb*(th+1))/li->nth));
 
         if (th < sizeof(*atf)*8)
         {
@@ -1161,8 +1621,9 @@ void set_lincs(t_idef *idef, t_mdatoms *md,
     real         lenA = 0, lenB;
     gmx_bool     bLocal;
 
-    li->nc  = 0;
-    li->ncc = 0;
+    li->nc     = 0;
+    li->ncc    = 0;
+    li->nbatch = 0;
     /* Zero the thread index ranges.
      * Otherwise without local constraints we could return with old ranges.
      */
@@ -1336,6 +1797,8 @@ void set_lincs(t_idef *idef, t_mdatoms *md,
                 li->nc, li->ncc);
     }
 
+    lincs_pack_matrix(li);
+
     if (li->nth == 1)
     {
         li->th[0].b0 = 0;
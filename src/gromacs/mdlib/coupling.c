@@ -720,32 +720,41 @@ void berendsen_tcoupl(t_inputrec *ir, gmx_ekindata_t *ekind, real dt)
     }
 }
 
-static int poisson_variate(real lambda, gmx_rng_t rng)
+/* Initializes the random number sequence for home atom i for Andersen
+ * temperature coupling at step step. The first number in the sequence is used
+ * for selecting the atom and the second, for the first atom of a constraint
+ * group, for selecting the group. The velocities use sub counter 1.
+ */
+static void andersen_rng_init(gmx_rng_cycle_t *rc, const t_inputrec *ir,
+                              gmx_large_int_t step, const t_commrec *cr, int i)
 {
+    gmx_rng_cycle_init(rc, ir->ld_seed, RND_SEED_ANDERSEN, step,
+                       DOMAINDECOMP(cr) ? cr->dd->gatindex[i] : i);
+}
 
-    real L;
-    int  k = 0;
-    real p = 1.0;
+/* Returns the uniform random number for selecting the constraint group
+ * that starts with home atom i.
+ */
+static real andersen_group_uniform(const t_inputrec *ir, gmx_large_int_t step,
+                                   const t_commrec *cr, int i)
+{
+    gmx_rng_cycle_t rc;
 
-    L = exp(-lambda);
+    andersen_rng_init(&rc, ir, step, cr, i);
+    gmx_rng_cycle_uint32(&rc);
 
-    do
-    {
-        k  = k+1;
-        p *= gmx_rng_uniform_real(rng);
-    }
-    while (p > L);
-
-    return k-1;
+    return gmx_rng_cycle_uniform_real(&rc);
 }
 
-void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rng, real rate, t_idef *idef, int nblocks, int *sblock, gmx_bool *randatom, int *randatom_list, gmx_bool *randomize, real *boltzfac)
+void andersen_tcoupl(t_inputrec *ir, gmx_large_int_t step, const t_commrec *cr, t_mdatoms *md, t_state *state, real rate, t_idef *idef, int nblocks, int *sblock, gmx_bool *randatom, int *randatom_list, gmx_bool *randomize, real *boltzfac)
 {
-    t_grpopts *opts;
-    int        i, j, k, d, len, n, ngtc, gc = 0;
-    int        nshake, nsettle, nrandom, nrand_group;
-    real       boltz, scal, reft, prand;
-    t_iatom   *iatoms;
+    t_grpopts      *opts;
+    int             i, j, k, d, len, n, ngtc, gc = 0;
+    int             nshake, nsettle, nrandom, nrand_group;
+    real            boltz, scal, reft, prand;
+    t_iatom        *iatoms;
+    gmx_rng_cycle_t rc;
+    real            rnd[4];
 
     /* convenience variables */
     opts = &ir->opts;
@@ -769,30 +778,17 @@ void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rn
               2b. all atoms in the constraint group are randomized with probability f.
          */
 
+        /* The random numbers are keyed on the global atom index,
+         * so the selection does not depend on the parallelization.
+         */
         nrandom = 0;
-        if ((rate < 0.05) && (md->homenr > 50))
-        {
-            /* if the rate is relatively high, use a standard method, if low rate,
-             * use poisson */
-            /* poisson distributions approxmation, more efficient for
-             * low rates, fewer random numbers required */
-            nrandom = poisson_variate(md->homenr*rate, rng);  /* how many do we randomize? Use Poisson. */
-            /* now we know how many, choose them randomly. No worries about repeats, at this rate, it's negligible.
-               worst thing that happens, it lowers the true rate an negligible amount */
-            for (i = 0; i < nrandom; i++)
-            {
-                randatom[(int)(gmx_rng_uniform_real(rng)*md->homenr)] = TRUE;
-            }
-        }
-        else
+        for (i = 0; i < md->homenr; i++)
         {
-            for (i = 0; i < md->homenr; i++)
+            andersen_rng_init(&rc, ir, step, cr, i);
+            if (gmx_rng_cycle_uniform_real(&rc) < rate)
             {
-                if (gmx_rng_uniform_real(rng) < rate)
-                {
-                    randatom[i] = TRUE;
-                    nrandom++;
-                }
+                randatom[i] = TRUE;
+                nrandom++;
             }
         }
 
@@ -804,17 +800,17 @@ void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rn
 
         /* first, loop through the settles to make sure all groups either entirely randomized, or not randomized. */
 
-        nsettle  = idef->il[F_SETTLE].nr/2;
+        nsettle  = idef->il[F_SETTLE].nr/4;
         for (i = 0; i < nsettle; i++)
         {
             iatoms      = idef->il[F_SETTLE].iatoms;
             nrand_group = 0;
             for (k = 0; k < 3; k++)  /* settles are always 3 atoms, hardcoded */
             {
-                if (randatom[iatoms[2*i+1]+k])
+                if (randatom[iatoms[4*i+1+k]])
                 {
                     nrand_group++;     /* count the number of atoms to be shaken in the settles group */
-                    randatom[iatoms[2*i+1]+k] = FALSE;
+                    randatom[iatoms[4*i+1+k]] = FALSE;
                     nrandom--;
                 }
             }
@@ -822,11 +818,11 @@ void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rn
             {
                 prand = (nrand_group)/3.0;  /* use this fraction to compute the probability the
                                                whole group is randomized */
-                if (gmx_rng_uniform_real(rng) < prand)
+                if (andersen_group_uniform(ir, step, cr, iatoms[4*i+1]) < prand)
                 {
                     for (k = 0; k < 3; k++)
                     {
-                        randatom[iatoms[2*i+1]+k] = TRUE;   /* mark them all to be randomized */
+                        randatom[iatoms[4*i+1+k]] = TRUE;   /* mark them all to be randomized */
                     }
                     nrandom += 3;
                 }
@@ -856,7 +852,7 @@ void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rn
             if (nrand_group > 0)
             {
                 prand = (nrand_group)/(1.0*(2*len/3));
-                if (gmx_rng_uniform_real(rng) < prand)
+                if (andersen_group_uniform(ir, step, cr, iatoms[1]) < prand)
                 {
                     for (k = 0; k < len; k++)
                     {
@@ -911,9 +907,12 @@ void andersen_tcoupl(t_inputrec *ir, t_mdatoms *md, t_state *state, gmx_rng_t rn
         if (randomize[gc])
         {
             scal = sqrt(boltzfac[gc]*md->invmass[n]);
+            gmx_rng_cycle_4gaussian_table(ir->ld_seed, RND_SEED_ANDERSEN, step,
+                                          DOMAINDECOMP(cr) ? cr->dd->gatindex[n] : n,
+                                          1, rnd);
             for (d = 0; d < DIM; d++)
             {
-                state->v[n][d] = scal*gmx_rng_gaussian_table(rng);
+                state->v[n][d] = scal*rnd[d];
             }
         }
         randatom[n] = FALSE; /* unmark this atom for randomization */
@@ -1505,7 +1504,7 @@ real NPT_energy(t_inputrec *ir, t_state *state, t_extmass *MassQ)
     return ener_npt;
 }
 
-static real vrescale_gamdev(int ia, gmx_rng_t rng)
+static real vrescale_gamdev(int ia, gmx_rng_cycle_t *rng)
 /* Gamma distribution, adapted from numerical recipes */
 {
     int  j;
@@ -1518,7 +1517,7 @@ static real vrescale_gamdev(int ia, gmx_rng_t rng)
             x = 1.0;
             for (j = 1; j <= ia; j++)
             {
-                x *= gmx_rng_uniform_real(rng);
+                x *= gmx_rng_cycle_uniform_real(rng);
             }
         }
         while (x == 0);
@@ -1532,8 +1531,8 @@ static real vrescale_gamdev(int ia, gmx_rng_t rng)
             {
                 do
                 {
-                    v1 = gmx_rng_uniform_real(rng);
-                    v2 = 2.0*gmx_rng_uniform_real(rng)-1.0;
+                    v1 = gmx_rng_cycle_uniform_real(rng);
+                    v2 = 2.0*gmx_rng_cycle_uniform_real(rng)-1.0;
                 }
                 while (v1*v1 + v2*v2 > 1.0 ||
                        v1*v1*GMX_REAL_MAX < 3.0*ia);
@@ -1548,13 +1547,13 @@ static real vrescale_gamdev(int ia, gmx_rng_t rng)
             while (x <= 0.0);
             e = (1.0 + y*y)*exp(am*log(x/am) - s*y);
         }
-        while (gmx_rng_uniform_real(rng) > e);
+        while (gmx_rng_cycle_uniform_real(rng) > e);
     }
 
     return x;
 }
 
-static real vrescale_sumnoises(int nn, gmx_rng_t rng)
+static real vrescale_sumnoises(int nn, gmx_rng_cycle_t *rng)
 {
 /*
  * Returns the sum of n independent gaussian noises squared
@@ -1569,7 +1568,7 @@ static real vrescale_sumnoises(int nn, gmx_rng_t rng)
     }
     else if (nn == 1)
     {
-        rr = gmx_rng_gaussian_real(rng);
+        rr = gmx_rng_cycle_gaussian_real(rng);
         return rr*rr;
     }
     else if (nn % 2 == 0)
@@ -1578,13 +1577,13 @@ static real vrescale_sumnoises(int nn, gmx_rng_t rng)
     }
     else
     {
-        rr = gmx_rng_gaussian_real(rng);
+        rr = gmx_rng_cycle_gaussian_real(rng);
         return 2.0*vrescale_gamdev((nn-1)/2, rng) + rr*rr;
     }
 }
 
 static real vrescale_resamplekin(real kk, real sigma, int ndeg, real taut,
-                                 gmx_rng_t rng)
+                                 gmx_rng_cycle_t *rng)
 {
 /*
  * Generates a new value for the kinetic energy,
@@ -1604,19 +1603,21 @@ static real vrescale_resamplekin(real kk, real sigma, int ndeg, real taut,
     {
         factor = 0.0;
     }
-    rr = gmx_rng_gaussian_real(rng);
+    rr = gmx_rng_cycle_gaussian_real(rng);
     return
         kk +
         (1.0 - factor)*(sigma*(vrescale_sumnoises(ndeg-1, rng) + rr*rr)/ndeg - kk) +
         2.0*rr*sqrt(kk*sigma/ndeg*(1.0 - factor)*factor);
 }
 
-void vrescale_tcoupl(t_inputrec *ir, gmx_ekindata_t *ekind, real dt,
-                     double therm_integral[], gmx_rng_t rng)
+void vrescale_tcoupl(t_inputrec *ir, gmx_large_int_t step,
+                     gmx_ekindata_t *ekind, real dt,
+                     double therm_integral[])
 {
-    t_grpopts *opts;
-    int        i;
-    real       Ek, Ek_ref1, Ek_ref, Ek_new;
+    t_grpopts      *opts;
+    int             i;
+    real            Ek, Ek_ref1, Ek_ref, Ek_new;
+    gmx_rng_cycle_t rng;
 
     opts = &ir->opts;
 
@@ -1636,8 +1637,13 @@ void vrescale_tcoupl(t_inputrec *ir, gmx_ekindata_t *ekind, real dt,
             Ek_ref1 = 0.5*opts->ref_t[i]*BOLTZ;
             Ek_ref  = Ek_ref1*opts->nrdf[i];
 
+            /* The random numbers depend only on the step and group,
+             * so all ranks compute the same scaling factor.
+             */
+            gmx_rng_cycle_init(&rng, ir->ld_seed, RND_SEED_VRESCALE, step, i);
+
             Ek_new  = vrescale_resamplekin(Ek, Ek_ref, opts->nrdf[i],
-                                           opts->tau_t[i]/dt, rng);
+                                           opts->tau_t[i]/dt, &rng);
 
             /* Analytically Ek_new>=0, but we check for rounding errors */
             if (Ek_new <= 0)
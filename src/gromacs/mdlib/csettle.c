@@ -39,11 +39,18 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "vec.h"
 #include "constr.h"
 #include "gmx_fatal.h"
 #include "smalloc.h"
 #include "pbc.h"
+#include "macros.h"
+
+#ifdef GMX_X86_SSE2
+#define SETTLE_SIMD
+#include "gmx_simd_widest.h"
+#endif
 
 typedef struct
 {
@@ -68,6 +75,7 @@ typedef struct gmx_settledata
 {
     settleparam_t massw;
     settleparam_t mass1;
+    gmx_bool      bSimd; /* Use the SIMD kernels */
 } t_gmx_settledata;
 
 
@@ -145,9 +153,20 @@ gmx_settledata_t settle_init(real mO, real mH, real invmO, real invmH,
 
     settleparam_init(&settled->mass1, 1.0, 1.0, 1.0, 1.0, dOH, dHH);
 
+    settle_set_simd(settled, getenv("GMX_SETTLE_NO_SIMD") == NULL);
+
     return settled;
 }
 
+void settle_set_simd(gmx_settledata_t settled, gmx_bool bSimd)
+{
+#ifdef SETTLE_SIMD
+    settled->bSimd = bSimd;
+#else
+    settled->bSimd = FALSE;
+#endif
+}
+
 #ifdef DEBUG
 static void check_cons(FILE *fp, char *title, real x[], int OW1, int HW2, int HW3)
 {
@@ -166,6 +185,611 @@ static void check_cons(FILE *fp, char *title, real x[], int OW1, int HW2, int HW
 #endif
 
 
+#ifdef SETTLE_SIMD
+
+/* The SIMD SETTLE kernels process GMX_SIMD_WIDTH_HERE waters at once.
+ * The coordinates are gathered, with pbc when needed, into aligned
+ * SoA buffers, the analytical solution is computed in SIMD registers
+ * and the results are scattered back, together with the velocity
+ * correction. The virial is accumulated in SIMD registers.
+ * When nsettle is not a multiple of the SIMD width, the last water
+ * is duplicated in the remaining lanes, these lanes are not stored.
+ */
+
+/* Offsets, in SIMD widths, of the input and output quantities
+ * in the SoA buffer of csettle_simd
+ */
+enum {
+    sbB4O = 0,    /* old O position, for the virial */
+    sbB0  = 3,    /* old H2-O distance vector */
+    sbC0  = 6,    /* old H3-O distance vector */
+    sbDOH2 = 9,   /* new H2-O distance vector */
+    sbDOH3 = 12,  /* new H3-O distance vector */
+    sbA   = 15,   /* new O position */
+    sbB   = 18,   /* new H2 position, in the periodic image of O */
+    sbC   = 21,   /* new H3 position, in the periodic image of O */
+    sbVir = 24,   /* 1 for lanes which contribute to the virial, 0 otherwise */
+    sbA3  = 25,   /* settled O position */
+    sbB3  = 28,   /* settled H2 position */
+    sbC3  = 31,   /* settled H3 position */
+    sbDA  = 34,   /* O displacement */
+    sbDB  = 37,   /* H2 displacement */
+    sbDC  = 40,   /* H3 displacement */
+    sbNR  = 43
+};
+
+static void csettle_simd(const settleparam_t *p,
+                         int nsettle, const t_iatom iatoms[],
+                         const t_pbc *pbc,
+                         real b4[], real after[],
+                         real invdt, real *v, int CalcVirAtomEnd,
+                         tensor vir_r_m_dr,
+                         int *error,
+                         const t_vetavars *vetavar)
+{
+    const int W = GMX_SIMD_WIDTH_HERE;
+    real      buf_array[sbNR*GMX_SIMD_WIDTH_HERE + GMX_SIMD_WIDTH_HERE], *buf;
+    int       ow1[GMX_SIMD_WIDTH_HERE], hw2[GMX_SIMD_WIDTH_HERE], hw3[GMX_SIMD_WIDTH_HERE];
+    rvec      sh_hw2[GMX_SIMD_WIDTH_HERE], sh_hw3[GMX_SIMD_WIDTH_HERE];
+    gmx_bool  bCalcVir;
+    real      mOs, mHs, invdts;
+    int       s0, l, nl, i, m, is, okbits;
+    rvec      dx;
+
+    gmx_mm_pr minus_wh_S, ra_S, rb_S, rc_S, irc2_S, inv_ra_S, one_S, zero_S;
+    gmx_mm_pr mOs_S, mHs_S;
+    gmx_mm_pr vir_S[DIM][DIM];
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    CalcVirAtomEnd *= 3;
+    bCalcVir        = (CalcVirAtomEnd > 0);
+
+    mOs    = p->mO / vetavar->rvscale;
+    mHs    = p->mH / vetavar->rvscale;
+    invdts = invdt / vetavar->rscale;
+
+    minus_wh_S = gmx_set1_pr(-p->wh);
+    ra_S       = gmx_set1_pr(p->ra);
+    rb_S       = gmx_set1_pr(p->rb);
+    rc_S       = gmx_set1_pr(p->rc);
+    irc2_S     = gmx_set1_pr(p->irc2);
+    inv_ra_S   = gmx_set1_pr(gmx_invsqrt(p->ra*p->ra));
+    one_S      = gmx_set1_pr(1.0);
+    zero_S     = gmx_setzero_pr();
+    mOs_S      = gmx_set1_pr(mOs);
+    mHs_S      = gmx_set1_pr(mHs);
+
+    for (m = 0; m < DIM; m++)
+    {
+        for (i = 0; i < DIM; i++)
+        {
+            vir_S[m][i] = gmx_setzero_pr();
+        }
+    }
+
+    for (s0 = 0; s0 < nsettle; s0 += W)
+    {
+        gmx_mm_pr xb0, yb0, zb0, xc0, yc0, zc0;
+        gmx_mm_pr xa1, ya1, za1, xb1, yb1, zb1, xc1, yc1, zc1;
+        gmx_mm_pr xcom, ycom, zcom;
+        gmx_mm_pr xakszd, yakszd, zakszd, xaksxd, yaksxd, zaksxd;
+        gmx_mm_pr xaksyd, yaksyd, zaksyd;
+        gmx_mm_pr axlng, aylng, azlng;
+        gmx_mm_pr trns11, trns21, trns31, trns12, trns22, trns32;
+        gmx_mm_pr trns13, trns23, trns33;
+        gmx_mm_pr xb0d, yb0d, xc0d, yc0d, za1d;
+        gmx_mm_pr xb1d, yb1d, zb1d, xc1d, yc1d, zc1d;
+        gmx_mm_pr sinphi, cosphi, sinpsi, cospsi, tmp, tmp2, ok_S;
+        gmx_mm_pr ya2d, xb2d, yb2d, yc2d, t1, t2;
+        gmx_mm_pr alpa, beta, gama, al2be2, sinthe, costhe;
+        gmx_mm_pr xa3d, ya3d, za3d, xb3d, yb3d, zb3d, xc3d, yc3d, zc3d;
+        gmx_mm_pr xa3, ya3, za3, xb3, yb3, zb3, xc3, yc3, zc3;
+        gmx_mm_pr dax, day, daz, dbx, dby, dbz, dcx, dcy, dcz;
+        gmx_mm_pr mdax, mday, mdaz, mdbx, mdby, mdbz, mdcx, mdcy, mdcz;
+        gmx_mm_pr bx, by, bz, vw_S;
+
+        nl = min(W, nsettle - s0);
+
+        /* Gather the coordinates of W waters into the SoA buffer */
+        for (l = 0; l < W; l++)
+        {
+            i      = s0 + min(l, nl - 1);
+            ow1[l] = iatoms[i*4+1]*3;
+            hw2[l] = iatoms[i*4+2]*3;
+            hw3[l] = iatoms[i*4+3]*3;
+
+            if (pbc == NULL)
+            {
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(sbB0 +m)*W+l] = b4[hw2[l]+m] - b4[ow1[l]+m];
+                    buf[(sbC0 +m)*W+l] = b4[hw3[l]+m] - b4[ow1[l]+m];
+                    buf[(sbDOH2+m)*W+l] = after[hw2[l]+m] - after[ow1[l]+m];
+                    buf[(sbDOH3+m)*W+l] = after[hw3[l]+m] - after[ow1[l]+m];
+                    buf[(sbB+m)*W+l]    = after[hw2[l]+m];
+                    buf[(sbC+m)*W+l]    = after[hw3[l]+m];
+                }
+            }
+            else
+            {
+                pbc_dx_aiuc(pbc, b4+hw2[l], b4+ow1[l], dx);
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(sbB0+m)*W+l] = dx[m];
+                }
+                pbc_dx_aiuc(pbc, b4+hw3[l], b4+ow1[l], dx);
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(sbC0+m)*W+l] = dx[m];
+                }
+
+                /* Put the hydrogens in the periodic image of the oxygen */
+                is = pbc_dx_aiuc(pbc, after+hw2[l], after+ow1[l], dx);
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(sbDOH2+m)*W+l] = dx[m];
+                    sh_hw2[l][m]        = (is == CENTRAL ? 0 : after[hw2[l]+m] - (after[ow1[l]+m] + dx[m]));
+                    buf[(sbB+m)*W+l]    = after[hw2[l]+m] - sh_hw2[l][m];
+                }
+                is = pbc_dx_aiuc(pbc, after+hw3[l], after+ow1[l], dx);
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(sbDOH3+m)*W+l] = dx[m];
+                    sh_hw3[l][m]        = (is == CENTRAL ? 0 : after[hw3[l]+m] - (after[ow1[l]+m] + dx[m]));
+                    buf[(sbC+m)*W+l]    = after[hw3[l]+m] - sh_hw3[l][m];
+                }
+            }
+            for (m = 0; m < DIM; m++)
+            {
+                buf[(sbB4O+m)*W+l] = b4[ow1[l]+m];
+                buf[(sbA+m)*W+l]   = after[ow1[l]+m];
+            }
+            buf[sbVir*W+l] = ((l < nl && ow1[l] < CalcVirAtomEnd) ? 1 : 0);
+        }
+
+        xb0 = gmx_load_pr(buf+(sbB0+XX)*W);
+        yb0 = gmx_load_pr(buf+(sbB0+YY)*W);
+        zb0 = gmx_load_pr(buf+(sbB0+ZZ)*W);
+        xc0 = gmx_load_pr(buf+(sbC0+XX)*W);
+        yc0 = gmx_load_pr(buf+(sbC0+YY)*W);
+        zc0 = gmx_load_pr(buf+(sbC0+ZZ)*W);
+
+        /* As in the scalar code, we compute the center of mass using
+         * the oxygen position and the O-H distances.
+         */
+        xa1 = gmx_mul_pr(gmx_add_pr(gmx_load_pr(buf+(sbDOH2+XX)*W), gmx_load_pr(buf+(sbDOH3+XX)*W)), minus_wh_S);
+        ya1 = gmx_mul_pr(gmx_add_pr(gmx_load_pr(buf+(sbDOH2+YY)*W), gmx_load_pr(buf+(sbDOH3+YY)*W)), minus_wh_S);
+        za1 = gmx_mul_pr(gmx_add_pr(gmx_load_pr(buf+(sbDOH2+ZZ)*W), gmx_load_pr(buf+(sbDOH3+ZZ)*W)), minus_wh_S);
+
+        xcom = gmx_sub_pr(gmx_load_pr(buf+(sbA+XX)*W), xa1);
+        ycom = gmx_sub_pr(gmx_load_pr(buf+(sbA+YY)*W), ya1);
+        zcom = gmx_sub_pr(gmx_load_pr(buf+(sbA+ZZ)*W), za1);
+
+        xb1 = gmx_sub_pr(gmx_load_pr(buf+(sbB+XX)*W), xcom);
+        yb1 = gmx_sub_pr(gmx_load_pr(buf+(sbB+YY)*W), ycom);
+        zb1 = gmx_sub_pr(gmx_load_pr(buf+(sbB+ZZ)*W), zcom);
+        xc1 = gmx_sub_pr(gmx_load_pr(buf+(sbC+XX)*W), xcom);
+        yc1 = gmx_sub_pr(gmx_load_pr(buf+(sbC+YY)*W), ycom);
+        zc1 = gmx_sub_pr(gmx_load_pr(buf+(sbC+ZZ)*W), zcom);
+
+        xakszd = gmx_sub_pr(gmx_mul_pr(yb0, zc0), gmx_mul_pr(zb0, yc0));
+        yakszd = gmx_sub_pr(gmx_mul_pr(zb0, xc0), gmx_mul_pr(xb0, zc0));
+        zakszd = gmx_sub_pr(gmx_mul_pr(xb0, yc0), gmx_mul_pr(yb0, xc0));
+        xaksxd = gmx_sub_pr(gmx_mul_pr(ya1, zakszd), gmx_mul_pr(za1, yakszd));
+        yaksxd = gmx_sub_pr(gmx_mul_pr(za1, xakszd), gmx_mul_pr(xa1, zakszd));
+        zaksxd = gmx_sub_pr(gmx_mul_pr(xa1, yakszd), gmx_mul_pr(ya1, xakszd));
+        xaksyd = gmx_sub_pr(gmx_mul_pr(yakszd, zaksxd), gmx_mul_pr(zakszd, yaksxd));
+        yaksyd = gmx_sub_pr(gmx_mul_pr(zakszd, xaksxd), gmx_mul_pr(xakszd, zaksxd));
+        zaksyd = gmx_sub_pr(gmx_mul_pr(xakszd, yaksxd), gmx_mul_pr(yakszd, xaksxd));
+
+        axlng = gmx_invsqrt_pr(gmx_calc_rsq_pr(xaksxd, yaksxd, zaksxd));
+        aylng = gmx_invsqrt_pr(gmx_calc_rsq_pr(xaksyd, yaksyd, zaksyd));
+        azlng = gmx_invsqrt_pr(gmx_calc_rsq_pr(xakszd, yakszd, zakszd));
+
+        trns11 = gmx_mul_pr(xaksxd, axlng);
+        trns21 = gmx_mul_pr(yaksxd, axlng);
+        trns31 = gmx_mul_pr(zaksxd, axlng);
+        trns12 = gmx_mul_pr(xaksyd, aylng);
+        trns22 = gmx_mul_pr(yaksyd, aylng);
+        trns32 = gmx_mul_pr(zaksyd, aylng);
+        trns13 = gmx_mul_pr(xakszd, azlng);
+        trns23 = gmx_mul_pr(yakszd, azlng);
+        trns33 = gmx_mul_pr(zakszd, azlng);
+
+        /* The transformation to the rotated frame and back */
+#define SETTLE_ROT(t1, t2, t3, x, y, z) gmx_add_pr(gmx_add_pr(gmx_mul_pr(t1, x), gmx_mul_pr(t2, y)), gmx_mul_pr(t3, z))
+
+        xb0d = SETTLE_ROT(trns11, trns21, trns31, xb0, yb0, zb0);
+        yb0d = SETTLE_ROT(trns12, trns22, trns32, xb0, yb0, zb0);
+        xc0d = SETTLE_ROT(trns11, trns21, trns31, xc0, yc0, zc0);
+        yc0d = SETTLE_ROT(trns12, trns22, trns32, xc0, yc0, zc0);
+        za1d = SETTLE_ROT(trns13, trns23, trns33, xa1, ya1, za1);
+        xb1d = SETTLE_ROT(trns11, trns21, trns31, xb1, yb1, zb1);
+        yb1d = SETTLE_ROT(trns12, trns22, trns32, xb1, yb1, zb1);
+        zb1d = SETTLE_ROT(trns13, trns23, trns33, xb1, yb1, zb1);
+        xc1d = SETTLE_ROT(trns11, trns21, trns31, xc1, yc1, zc1);
+        yc1d = SETTLE_ROT(trns12, trns22, trns32, xc1, yc1, zc1);
+        zc1d = SETTLE_ROT(trns13, trns23, trns33, xc1, yc1, zc1);
+
+        /* Lanes for which one of the sqrt arguments is not positive
+         * give NaN, they are masked with ok_S.
+         */
+        sinphi = gmx_mul_pr(za1d, inv_ra_S);
+        tmp    = gmx_sub_pr(one_S, gmx_mul_pr(sinphi, sinphi));
+        ok_S   = gmx_cmplt_pr(zero_S, tmp);
+        tmp2   = gmx_invsqrt_pr(tmp);
+        cosphi = gmx_mul_pr(tmp, tmp2);
+        sinpsi = gmx_mul_pr(gmx_mul_pr(gmx_sub_pr(zb1d, zc1d), irc2_S), tmp2);
+        tmp2   = gmx_sub_pr(one_S, gmx_mul_pr(sinpsi, sinpsi));
+        ok_S   = gmx_and_pr(ok_S, gmx_cmplt_pr(zero_S, tmp2));
+        cospsi = gmx_mul_pr(tmp2, gmx_invsqrt_pr(tmp2));
+
+        ya2d = gmx_mul_pr(ra_S, cosphi);
+        xb2d = gmx_mul_pr(gmx_sub_pr(zero_S, rc_S), cospsi);
+        t1   = gmx_mul_pr(gmx_sub_pr(zero_S, rb_S), cosphi);
+        t2   = gmx_mul_pr(gmx_mul_pr(rc_S, sinpsi), sinphi);
+        yb2d = gmx_sub_pr(t1, t2);
+        yc2d = gmx_add_pr(t1, t2);
+
+        /*     --- Step3  al,be,ga            --- */
+        alpa   = gmx_add_pr(gmx_add_pr(gmx_mul_pr(xb2d, gmx_sub_pr(xb0d, xc0d)),
+                                       gmx_mul_pr(yb0d, yb2d)),
+                            gmx_mul_pr(yc0d, yc2d));
+        beta   = gmx_add_pr(gmx_add_pr(gmx_mul_pr(xb2d, gmx_sub_pr(yc0d, yb0d)),
+                                       gmx_mul_pr(xb0d, yb2d)),
+                            gmx_mul_pr(xc0d, yc2d));
+        gama   = gmx_sub_pr(gmx_add_pr(gmx_sub_pr(gmx_mul_pr(xb0d, yb1d),
+                                                  gmx_mul_pr(xb1d, yb0d)),
+                                       gmx_mul_pr(xc0d, yc1d)),
+                            gmx_mul_pr(xc1d, yc0d));
+        al2be2 = gmx_add_pr(gmx_mul_pr(alpa, alpa), gmx_mul_pr(beta, beta));
+        tmp2   = gmx_sub_pr(al2be2, gmx_mul_pr(gama, gama));
+        sinthe = gmx_mul_pr(gmx_sub_pr(gmx_mul_pr(alpa, gama),
+                                       gmx_mul_pr(gmx_mul_pr(beta, tmp2), gmx_invsqrt_pr(tmp2))),
+                            gmx_invsqrt_pr(gmx_mul_pr(al2be2, al2be2)));
+
+        /*  --- Step4  A3' --- */
+        tmp2   = gmx_sub_pr(one_S, gmx_mul_pr(sinthe, sinthe));
+        costhe = gmx_mul_pr(tmp2, gmx_invsqrt_pr(tmp2));
+        xa3d   = gmx_sub_pr(zero_S, gmx_mul_pr(ya2d, sinthe));
+        ya3d   = gmx_mul_pr(ya2d, costhe);
+        za3d   = za1d;
+        xb3d   = gmx_sub_pr(gmx_mul_pr(xb2d, costhe), gmx_mul_pr(yb2d, sinthe));
+        yb3d   = gmx_add_pr(gmx_mul_pr(xb2d, sinthe), gmx_mul_pr(yb2d, costhe));
+        zb3d   = zb1d;
+        xc3d   = gmx_sub_pr(gmx_sub_pr(zero_S, gmx_mul_pr(xb2d, costhe)), gmx_mul_pr(yc2d, sinthe));
+        yc3d   = gmx_add_pr(gmx_sub_pr(zero_S, gmx_mul_pr(xb2d, sinthe)), gmx_mul_pr(yc2d, costhe));
+        zc3d   = zc1d;
+
+        /*    --- Step5  A3 --- */
+        xa3 = SETTLE_ROT(trns11, trns12, trns13, xa3d, ya3d, za3d);
+        ya3 = SETTLE_ROT(trns21, trns22, trns23, xa3d, ya3d, za3d);
+        za3 = SETTLE_ROT(trns31, trns32, trns33, xa3d, ya3d, za3d);
+        xb3 = SETTLE_ROT(trns11, trns12, trns13, xb3d, yb3d, zb3d);
+        yb3 = SETTLE_ROT(trns21, trns22, trns23, xb3d, yb3d, zb3d);
+        zb3 = SETTLE_ROT(trns31, trns32, trns33, xb3d, yb3d, zb3d);
+        xc3 = SETTLE_ROT(trns11, trns12, trns13, xc3d, yc3d, zc3d);
+        yc3 = SETTLE_ROT(trns21, trns22, trns23, xc3d, yc3d, zc3d);
+        zc3 = SETTLE_ROT(trns31, trns32, trns33, xc3d, yc3d, zc3d);
+#undef SETTLE_ROT
+
+        gmx_store_pr(buf+(sbA3+XX)*W, gmx_add_pr(xcom, xa3));
+        gmx_store_pr(buf+(sbA3+YY)*W, gmx_add_pr(ycom, ya3));
+        gmx_store_pr(buf+(sbA3+ZZ)*W, gmx_add_pr(zcom, za3));
+        gmx_store_pr(buf+(sbB3+XX)*W, gmx_add_pr(xcom, xb3));
+        gmx_store_pr(buf+(sbB3+YY)*W, gmx_add_pr(ycom, yb3));
+        gmx_store_pr(buf+(sbB3+ZZ)*W, gmx_add_pr(zcom, zb3));
+        gmx_store_pr(buf+(sbC3+XX)*W, gmx_add_pr(xcom, xc3));
+        gmx_store_pr(buf+(sbC3+YY)*W, gmx_add_pr(ycom, yc3));
+        gmx_store_pr(buf+(sbC3+ZZ)*W, gmx_add_pr(zcom, zc3));
+
+        /* Zero the displacements of failed lanes, which can be NaN */
+        dax = gmx_and_pr(gmx_sub_pr(xa3, xa1), ok_S);
+        day = gmx_and_pr(gmx_sub_pr(ya3, ya1), ok_S);
+        daz = gmx_and_pr(gmx_sub_pr(za3, za1), ok_S);
+        dbx = gmx_and_pr(gmx_sub_pr(xb3, xb1), ok_S);
+        dby = gmx_and_pr(gmx_sub_pr(yb3, yb1), ok_S);
+        dbz = gmx_and_pr(gmx_sub_pr(zb3, zb1), ok_S);
+        dcx = gmx_and_pr(gmx_sub_pr(xc3, xc1), ok_S);
+        dcy = gmx_and_pr(gmx_sub_pr(yc3, yc1), ok_S);
+        dcz = gmx_and_pr(gmx_sub_pr(zc3, zc1), ok_S);
+
+        if (v != NULL)
+        {
+            gmx_store_pr(buf+(sbDA+XX)*W, dax);
+            gmx_store_pr(buf+(sbDA+YY)*W, day);
+            gmx_store_pr(buf+(sbDA+ZZ)*W, daz);
+            gmx_store_pr(buf+(sbDB+XX)*W, dbx);
+            gmx_store_pr(buf+(sbDB+YY)*W, dby);
+            gmx_store_pr(buf+(sbDB+ZZ)*W, dbz);
+            gmx_store_pr(buf+(sbDC+XX)*W, dcx);
+            gmx_store_pr(buf+(sbDC+YY)*W, dcy);
+            gmx_store_pr(buf+(sbDC+ZZ)*W, dcz);
+        }
+
+        if (bCalcVir)
+        {
+            vw_S = gmx_load_pr(buf+sbVir*W);
+            mdax = gmx_mul_pr(gmx_mul_pr(mOs_S, vw_S), dax);
+            mday = gmx_mul_pr(gmx_mul_pr(mOs_S, vw_S), day);
+            mdaz = gmx_mul_pr(gmx_mul_pr(mOs_S, vw_S), daz);
+            mdbx = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dbx);
+            mdby = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dby);
+            mdbz = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dbz);
+            mdcx = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dcx);
+            mdcy = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dcy);
+            mdcz = gmx_mul_pr(gmx_mul_pr(mHs_S, vw_S), dcz);
+
+            bx = gmx_load_pr(buf+(sbB4O+XX)*W);
+            by = gmx_load_pr(buf+(sbB4O+YY)*W);
+            bz = gmx_load_pr(buf+(sbB4O+ZZ)*W);
+
+#define SETTLE_VIR(b, b0, c0, mda, mdb, mdc) gmx_add_pr(gmx_add_pr(gmx_mul_pr(b, mda), gmx_mul_pr(gmx_add_pr(b, b0), mdb)), gmx_mul_pr(gmx_add_pr(b, c0), mdc))
+
+            vir_S[XX][XX] = gmx_add_pr(vir_S[XX][XX], SETTLE_VIR(bx, xb0, xc0, mdax, mdbx, mdcx));
+            vir_S[XX][YY] = gmx_add_pr(vir_S[XX][YY], SETTLE_VIR(bx, xb0, xc0, mday, mdby, mdcy));
+            vir_S[XX][ZZ] = gmx_add_pr(vir_S[XX][ZZ], SETTLE_VIR(bx, xb0, xc0, mdaz, mdbz, mdcz));
+            vir_S[YY][XX] = gmx_add_pr(vir_S[YY][XX], SETTLE_VIR(by, yb0, yc0, mdax, mdbx, mdcx));
+            vir_S[YY][YY] = gmx_add_pr(vir_S[YY][YY], SETTLE_VIR(by, yb0, yc0, mday, mdby, mdcy));
+            vir_S[YY][ZZ] = gmx_add_pr(vir_S[YY][ZZ], SETTLE_VIR(by, yb0, yc0, mdaz, mdbz, mdcz));
+            vir_S[ZZ][XX] = gmx_add_pr(vir_S[ZZ][XX], SETTLE_VIR(bz, zb0, zc0, mdax, mdbx, mdcx));
+            vir_S[ZZ][YY] = gmx_add_pr(vir_S[ZZ][YY], SETTLE_VIR(bz, zb0, zc0, mday, mdby, mdcy));
+            vir_S[ZZ][ZZ] = gmx_add_pr(vir_S[ZZ][ZZ], SETTLE_VIR(bz, zb0, zc0, mdaz, mdbz, mdcz));
+#undef SETTLE_VIR
+        }
+
+        /* Scatter the settled coordinates and correct the velocities */
+        okbits = gmx_movemask_pr(ok_S);
+        for (l = 0; l < nl; l++)
+        {
+            if (!(okbits & (1<<l)))
+            {
+                *error = s0 + l;
+                continue;
+            }
+            for (m = 0; m < DIM; m++)
+            {
+                after[ow1[l]+m] = buf[(sbA3+m)*W+l];
+                after[hw2[l]+m] = buf[(sbB3+m)*W+l];
+                after[hw3[l]+m] = buf[(sbC3+m)*W+l];
+            }
+            if (pbc != NULL)
+            {
+                rvec_inc(after+hw2[l], sh_hw2[l]);
+                rvec_inc(after+hw3[l], sh_hw3[l]);
+            }
+            if (v != NULL)
+            {
+                for (m = 0; m < DIM; m++)
+                {
+                    v[ow1[l]+m] += buf[(sbDA+m)*W+l]*invdts;
+                    v[hw2[l]+m] += buf[(sbDB+m)*W+l]*invdts;
+                    v[hw3[l]+m] += buf[(sbDC+m)*W+l]*invdts;
+                }
+            }
+        }
+    }
+
+    if (bCalcVir)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            for (i = 0; i < DIM; i++)
+            {
+                gmx_store_pr(buf, vir_S[m][i]);
+                for (l = 0; l < W; l++)
+                {
+                    vir_r_m_dr[m][i] -= buf[l];
+                }
+            }
+        }
+    }
+}
+
+/* Offsets, in SIMD widths, of the quantities in the SoA buffer
+ * of settle_proj_simd
+ */
+enum {
+    spbDer  = 0,  /* der of O, H2, H3 */
+    spbX    = 9,  /* x of O, H2, H3 */
+    spbR    = 18, /* the O-H2, O-H3 and H2-H3 distance vectors */
+    spbVir  = 27, /* 1 for lanes which contribute to the virial, 0 otherwise */
+    spbCorr = 28, /* the corrections to subtract from O, H2 and add to H3 */
+    spbNR   = 37
+};
+
+static void settle_proj_simd(const settleparam_t *p,
+                             int nsettle, const t_iatom iatoms[],
+                             const t_pbc *pbc,
+                             rvec x[],
+                             rvec *der, rvec *derp,
+                             int calcvir_atom_end, tensor vir_r_m_dder,
+                             const t_vetavars *vetavar)
+{
+    const int W = GMX_SIMD_WIDTH_HERE;
+    real      buf_array[spbNR*GMX_SIMD_WIDTH_HERE + GMX_SIMD_WIDTH_HERE], *buf;
+    int       ind[3][GMX_SIMD_WIDTH_HERE];
+    gmx_bool  bCalcVir;
+    int       s0, l, nl, a, i, m, m2;
+    rvec      dx[3];
+
+    gmx_mm_pr vscale_nhc_S, veta_S, inv_vscale_nhc_S;
+    gmx_mm_pr invd_S[3], d_S[3], im_S[3], invmat_S[DIM][DIM];
+    gmx_mm_pr vir_S[DIM][DIM];
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    calcvir_atom_end *= DIM;
+    bCalcVir          = (calcvir_atom_end > 0);
+
+    vscale_nhc_S     = gmx_set1_pr(vetavar->vscale_nhc[0]);
+    veta_S           = gmx_set1_pr(vetavar->veta);
+    inv_vscale_nhc_S = gmx_set1_pr(1.0/vetavar->vscale_nhc[0]);
+    invd_S[0]        = gmx_set1_pr(p->invdOH);
+    invd_S[1]        = gmx_set1_pr(p->invdOH);
+    invd_S[2]        = gmx_set1_pr(p->invdHH);
+    d_S[0]           = gmx_set1_pr(p->dOH);
+    d_S[1]           = gmx_set1_pr(p->dOH);
+    d_S[2]           = gmx_set1_pr(p->dHH);
+    im_S[0]          = gmx_set1_pr(p->imO);
+    im_S[1]          = gmx_set1_pr(p->imH);
+    im_S[2]          = gmx_set1_pr(p->imH);
+    for (m = 0; m < DIM; m++)
+    {
+        for (m2 = 0; m2 < DIM; m2++)
+        {
+            invmat_S[m][m2] = gmx_set1_pr(p->invmat[m][m2]);
+            vir_S[m][m2]    = gmx_setzero_pr();
+        }
+    }
+
+    for (s0 = 0; s0 < nsettle; s0 += W)
+    {
+        gmx_mm_pr derm[3][DIM], r[3][DIM], dc[3], fc[3], fcv[3], vw_S;
+
+        nl = min(W, nsettle - s0);
+
+        /* Gather the coordinates and derivatives of W waters */
+        for (l = 0; l < W; l++)
+        {
+            i = s0 + min(l, nl - 1);
+            for (a = 0; a < 3; a++)
+            {
+                ind[a][l] = iatoms[i*4+1+a];
+            }
+            if (pbc == NULL)
+            {
+                rvec_sub(x[ind[0][l]], x[ind[1][l]], dx[0]);
+                rvec_sub(x[ind[0][l]], x[ind[2][l]], dx[1]);
+                rvec_sub(x[ind[1][l]], x[ind[2][l]], dx[2]);
+            }
+            else
+            {
+                pbc_dx_aiuc(pbc, x[ind[0][l]], x[ind[1][l]], dx[0]);
+                pbc_dx_aiuc(pbc, x[ind[0][l]], x[ind[2][l]], dx[1]);
+                pbc_dx_aiuc(pbc, x[ind[1][l]], x[ind[2][l]], dx[2]);
+            }
+            for (a = 0; a < 3; a++)
+            {
+                for (m = 0; m < DIM; m++)
+                {
+                    buf[(spbDer+a*DIM+m)*W+l] = der[ind[a][l]][m];
+                    buf[(spbX  +a*DIM+m)*W+l] = x[ind[a][l]][m];
+                    buf[(spbR  +a*DIM+m)*W+l] = dx[a][m];
+                }
+            }
+            buf[spbVir*W+l] = ((l < nl && ind[0][l] < calcvir_atom_end) ? 1 : 0);
+        }
+
+        for (a = 0; a < 3; a++)
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                /* In the velocity case, these are the velocities, so we
+                 * need to modify with the pressure control velocities.
+                 */
+                derm[a][m] = gmx_add_pr(gmx_mul_pr(vscale_nhc_S, gmx_load_pr(buf+(spbDer+a*DIM+m)*W)),
+                                        gmx_mul_pr(veta_S, gmx_load_pr(buf+(spbX+a*DIM+m)*W)));
+                r[a][m]    = gmx_mul_pr(invd_S[a], gmx_load_pr(buf+(spbR+a*DIM+m)*W));
+            }
+        }
+
+        /* Determine the projections of der(modified) on the bonds */
+        for (a = 0; a < 3; a++)
+        {
+            dc[a] = gmx_setzero_pr();
+        }
+        for (m = 0; m < DIM; m++)
+        {
+            dc[0] = gmx_add_pr(dc[0], gmx_mul_pr(gmx_sub_pr(derm[0][m], derm[1][m]), r[0][m]));
+            dc[1] = gmx_add_pr(dc[1], gmx_mul_pr(gmx_sub_pr(derm[0][m], derm[2][m]), r[1][m]));
+            dc[2] = gmx_add_pr(dc[2], gmx_mul_pr(gmx_sub_pr(derm[1][m], derm[2][m]), r[2][m]));
+        }
+
+        /* Determine the correction for the three bonds and divide by
+         * vscale_nhc, since the velocities have not yet been scaled.
+         */
+        for (a = 0; a < 3; a++)
+        {
+            fc[a]  = gmx_add_pr(gmx_add_pr(gmx_mul_pr(invmat_S[a][XX], dc[XX]),
+                                           gmx_mul_pr(invmat_S[a][YY], dc[YY])),
+                                gmx_mul_pr(invmat_S[a][ZZ], dc[ZZ]));
+            fcv[a] = gmx_mul_pr(inv_vscale_nhc_S, fc[a]);
+        }
+
+        for (m = 0; m < DIM; m++)
+        {
+            gmx_store_pr(buf+(spbCorr+0*DIM+m)*W,
+                         gmx_mul_pr(im_S[0], gmx_add_pr(gmx_mul_pr(fcv[0], r[0][m]),
+                                                        gmx_mul_pr(fcv[1], r[1][m]))));
+            gmx_store_pr(buf+(spbCorr+1*DIM+m)*W,
+                         gmx_mul_pr(im_S[1], gmx_sub_pr(gmx_mul_pr(fcv[2], r[2][m]),
+                                                        gmx_mul_pr(fcv[0], r[0][m]))));
+            gmx_store_pr(buf+(spbCorr+2*DIM+m)*W,
+                         gmx_mul_pr(im_S[2], gmx_add_pr(gmx_mul_pr(fcv[1], r[1][m]),
+                                                        gmx_mul_pr(fcv[2], r[2][m]))));
+        }
+
+        if (bCalcVir)
+        {
+            /* Determining r \dot m der is easy,
+             * since fc contains the mass weighted corrections for der.
+             */
+            vw_S = gmx_load_pr(buf+spbVir*W);
+            for (a = 0; a < 3; a++)
+            {
+                fcv[a] = gmx_mul_pr(gmx_mul_pr(d_S[a], vw_S), fcv[a]);
+            }
+            for (m = 0; m < DIM; m++)
+            {
+                for (m2 = 0; m2 < DIM; m2++)
+                {
+                    vir_S[m][m2] =
+                        gmx_add_pr(vir_S[m][m2],
+                                   gmx_add_pr(gmx_add_pr(gmx_mul_pr(gmx_mul_pr(r[0][m], r[0][m2]), fcv[0]),
+                                                         gmx_mul_pr(gmx_mul_pr(r[1][m], r[1][m2]), fcv[1])),
+                                              gmx_mul_pr(gmx_mul_pr(r[2][m], r[2][m2]), fcv[2])));
+                }
+            }
+        }
+
+        /* Subtract the corrections from derp */
+        for (l = 0; l < nl; l++)
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                derp[ind[0][l]][m] -= buf[(spbCorr+0*DIM+m)*W+l];
+                derp[ind[1][l]][m] -= buf[(spbCorr+1*DIM+m)*W+l];
+                derp[ind[2][l]][m] += buf[(spbCorr+2*DIM+m)*W+l];
+            }
+        }
+    }
+
+    if (bCalcVir)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            for (m2 = 0; m2 < DIM; m2++)
+            {
+                gmx_store_pr(buf, vir_S[m][m2]);
+                for (l = 0; l < W; l++)
+                {
+                    vir_r_m_dder[m][m2] += buf[l];
+                }
+            }
+        }
+
+        /* Correct r_m_dder, which will be used to calcualate the virial;
+         * we need to use the unscaled multipliers in the virial.
+         */
+        msmul(vir_r_m_dder, 1.0/vetavar->vscale, vir_r_m_dder);
+    }
+}
+
+#endif /* SETTLE_SIMD */
+
+
 void settle_proj(FILE *fp,
                  gmx_settledata_t settled, int econq,
                  int nsettle, t_iatom iatoms[],
@@ -189,8 +813,6 @@ void settle_proj(FILE *fp,
     real           invvscale, vscale_nhc, veta;
     real           kfacOH, kfacHH;
 
-    calcvir_atom_end *= DIM;
-
     if (econq == econqForce)
     {
         p = &settled->mass1;
@@ -199,6 +821,18 @@ void settle_proj(FILE *fp,
     {
         p = &settled->massw;
     }
+
+#ifdef SETTLE_SIMD
+    if (settled->bSimd)
+    {
+        settle_proj_simd(p, nsettle, iatoms, pbc, x, der, derp,
+                         calcvir_atom_end, vir_r_m_dder, vetavar);
+
+        return;
+    }
+#endif
+
+    calcvir_atom_end *= DIM;
     imO    = p->imO;
     imH    = p->imH;
     copy_mat(p->invmat, invmat);
@@ -358,9 +992,20 @@ void csettle(gmx_settledata_t settled,
 
     *error = -1;
 
+    p    = &settled->massw;
+
+#ifdef SETTLE_SIMD
+    if (settled->bSimd)
+    {
+        csettle_simd(p, nsettle, iatoms, pbc, b4, after, invdt, v,
+                     CalcVirAtomEnd, vir_r_m_dr, error, vetavar);
+
+        return;
+    }
+#endif
+
     CalcVirAtomEnd *= 3;
 
-    p    = &settled->massw;
     wh   = p->wh;
     rc   = p->rc;
     ra   = p->ra;
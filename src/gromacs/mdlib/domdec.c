@@ -32,6 +32,7 @@
 #include "vec.h"
 #include "domdec.h"
 #include "domdec_network.h"
+#include "network.h"
 #include "nrnb.h"
 #include "pbc.h"
 #include "chargegroup.h"
@@ -201,6 +202,25 @@ typedef struct
     int              nsend_zone;
 } dd_comm_setup_work_t;
 
+/* The load and decomposition data of one node for the load statistics file.
+ * The cycle counts are averages per step since the previous record.
+ */
+typedef struct
+{
+    ivec  ci;       /* The DD cell index                     */
+    int   node;     /* The physical node number              */
+    int   nat_home; /* The number of home atoms              */
+    int   nat_halo; /* The number of halo atoms received     */
+    int   nat_send; /* The number of atoms sent for the halo */
+    float f;        /* The force load                        */
+    float step;     /* The MD step                           */
+    float ppdpme;   /* The PP work while PME is running      */
+    float pme;      /* The PME mesh work on the PME node     */
+    float waitpme;  /* The wait for the PME mesh forces      */
+    rvec  cell_x0;  /* The lower cell boundaries             */
+    rvec  cell_x1;  /* The upper cell boundaries             */
+} gmx_dd_load_stats_t;
+
 typedef struct gmx_domdec_comm
 {
     /* All arrays are indexed with 0 to dd->ndim (not Cartesian indexing),
@@ -262,6 +282,8 @@ typedef struct gmx_domdec_comm
     rvec     cellsize_min_dlb;
     /* The lower limit for the DD cell size with DLB */
     real     cellsize_limit;
+    /* The cell size limit due to bondeds and constraints only */
+    real     cellsize_limit_bonded;
     /* Effectively no NB cut-off limit with DLB for systems without PBC? */
     gmx_bool bVacDLBNoLimit;
 
@@ -377,6 +399,12 @@ typedef struct gmx_domdec_comm
     double load_mdf;
     double load_pme;
 
+    /* Per node load statistics output */
+    gmx_bool             bLoadStats;
+    int                  load_stats_node;
+    FILE                *fp_load_stats;
+    gmx_dd_load_stats_t *load_stats;
+
     /* The last partition step */
     gmx_large_int_t partition_step;
 
@@ -616,116 +644,215 @@ void dd_get_constraint_range(gmx_domdec_t *dd, int *at_start, int *at_end)
     *at_end   = dd->comm->nat[ddnatCON];
 }
 
-void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+/* Packs the coordinates to send for pulse p in DD dimension index d */
+static void dd_move_x_pack(gmx_domdec_t *dd, matrix box, rvec x[],
+                           int d, int p, int nzone)
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
+    int                    n, i, j, at0, at1;
     int                   *index, *cgindex;
-    gmx_domdec_comm_t     *comm;
-    gmx_domdec_comm_dim_t *cd;
     gmx_domdec_ind_t      *ind;
-    rvec                   shift = {0, 0, 0}, *buf, *rbuf;
+    rvec                   shift = {0, 0, 0}, *buf;
     gmx_bool               bPBC, bScrew;
 
-    comm = dd->comm;
-
     cgindex = dd->cgindex;
 
-    buf = comm->vbuf.v;
+    buf = dd->comm->vbuf.v;
 
-    nzone   = 1;
-    nat_tot = dd->nat_home;
-    for (d = 0; d < dd->ndim; d++)
+    bPBC   = (dd->ci[dd->dim[d]] == 0);
+    bScrew = (bPBC && dd->bScrewPBC && dd->dim[d] == XX);
+    if (bPBC)
     {
-        bPBC   = (dd->ci[dd->dim[d]] == 0);
-        bScrew = (bPBC && dd->bScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
-        {
-            copy_rvec(box[dd->dim[d]], shift);
-        }
-        cd = &comm->cd[d];
-        for (p = 0; p < cd->np; p++)
+        copy_rvec(box[dd->dim[d]], shift);
+    }
+    ind   = &dd->comm->cd[d].ind[p];
+    index = ind->index;
+    n     = 0;
+    if (!bPBC)
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
         {
-            ind   = &cd->ind[p];
-            index = ind->index;
-            n     = 0;
-            if (!bPBC)
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        copy_rvec(x[j], buf[n]);
-                        n++;
-                    }
-                }
+                copy_rvec(x[j], buf[n]);
+                n++;
             }
-            else if (!bScrew)
+        }
+    }
+    else if (!bScrew)
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
+        {
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* We need to shift the coordinates */
-                        rvec_add(x[j], shift, buf[n]);
-                        n++;
-                    }
-                }
+                /* We need to shift the coordinates */
+                rvec_add(x[j], shift, buf[n]);
+                n++;
             }
-            else
+        }
+    }
+    else
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
+        {
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* Shift x */
-                        buf[n][XX] = x[j][XX] + shift[XX];
-                        /* Rotate y and z.
-                         * This operation requires a special shift force
-                         * treatment, which is performed in calc_vir.
-                         */
-                        buf[n][YY] = box[YY][YY] - x[j][YY];
-                        buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                        n++;
-                    }
-                }
+                /* Shift x */
+                buf[n][XX] = x[j][XX] + shift[XX];
+                /* Rotate y and z.
+                 * This operation requires a special shift force
+                 * treatment, which is performed in calc_vir.
+                 */
+                buf[n][YY] = box[YY][YY] - x[j][YY];
+                buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+                n++;
             }
+        }
+    }
+}
 
-            if (cd->bInPlace)
-            {
-                rbuf = x + nat_tot;
-            }
-            else
+/* Returns the buffer to receive the coordinates of a pulse in */
+static rvec *dd_move_x_recvbuf(gmx_domdec_t *dd, rvec x[], int d, int nat_tot)
+{
+    if (dd->comm->cd[d].bInPlace)
+    {
+        return x + nat_tot;
+    }
+    else
+    {
+        return dd->comm->vbuf2.v;
+    }
+}
+
+/* Copies the received coordinates to x, when not received in place */
+static void dd_move_x_unpack(gmx_domdec_t *dd, rvec x[],
+                             int d, int p, int nzone)
+{
+    gmx_domdec_ind_t *ind;
+    rvec             *rbuf;
+    int               zone, i, j;
+
+    if (!dd->comm->cd[d].bInPlace)
+    {
+        ind  = &dd->comm->cd[d].ind[p];
+        rbuf = dd->comm->vbuf2.v;
+        j    = 0;
+        for (zone = 0; zone < nzone; zone++)
+        {
+            for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
             {
-                rbuf = comm->vbuf2.v;
+                copy_rvec(rbuf[j], x[i]);
+                j++;
             }
+        }
+    }
+}
+
+/* Communicates the coordinates with blocking calls,
+ * starting at pulse p0 in DD dimension index d0,
+ * with nzone zones and nat_tot atoms present at that point.
+ */
+static void dd_move_x_pulses(gmx_domdec_t *dd, matrix box, rvec x[],
+                             int d0, int p0, int nzone, int nat_tot)
+{
+    int                    d, p;
+    gmx_domdec_comm_dim_t *cd;
+    gmx_domdec_ind_t      *ind;
+    rvec                  *rbuf;
+
+    for (d = d0; d < dd->ndim; d++)
+    {
+        cd = &dd->comm->cd[d];
+        for (p = (d == d0 ? p0 : 0); p < cd->np; p++)
+        {
+            ind = &cd->ind[p];
+
+            dd_move_x_pack(dd, box, x, d, p, nzone);
+
+            rbuf = dd_move_x_recvbuf(dd, x, d, nat_tot);
             /* Send and receive the coordinates */
             dd_sendrecv_rvec(dd, d, dddirBackward,
-                             buf,  ind->nsend[nzone+1],
+                             dd->comm->vbuf.v, ind->nsend[nzone+1],
                              rbuf, ind->nrecv[nzone+1]);
-            if (!cd->bInPlace)
-            {
-                j = 0;
-                for (zone = 0; zone < nzone; zone++)
-                {
-                    for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
-                    {
-                        copy_rvec(rbuf[j], x[i]);
-                        j++;
-                    }
-                }
-            }
+
+            dd_move_x_unpack(dd, x, d, p, nzone);
+
             nat_tot += ind->nrecv[nzone+1];
         }
         nzone += nzone;
     }
 }
 
+void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, 0, 0, 1, dd->nat_home);
+}
+
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    gmx_domdec_ind_t *ind;
+
+    if (dd->ndim == 0 || dd->bSendRecv2)
+    {
+        /* Nothing to overlap, or only blocking calls should be used */
+        dd_move_x(dd, box, x);
+        dd->nreq_x = 0;
+
+        return;
+    }
+
+    /* The first pulse only sends home atoms, so it can run concurrently
+     * with work on home atoms. All later pulses (partially) forward
+     * coordinates received earlier, so we have to wait for those.
+     */
+    ind = &dd->comm->cd[0].ind[0];
+
+    dd_move_x_pack(dd, box, x, 0, 0, 1);
+
+    dd_isendrecv_rvec(dd, 0, dddirBackward,
+                      dd->comm->vbuf.v, ind->nsend[2],
+                      dd_move_x_recvbuf(dd, x, 0, dd->nat_home), ind->nrecv[2],
+                      &dd->nreq_x, dd->req_x);
+}
+
+void dd_move_x_finish(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    gmx_domdec_ind_t *ind;
+
+    if (dd->nreq_x < 0)
+    {
+        gmx_incons("dd_move_x_finish called without dd_move_x_start");
+    }
+
+    if (dd->ndim == 0 || dd->bSendRecv2)
+    {
+        /* All communication was done in dd_move_x_start */
+        dd->nreq_x = -1;
+
+        return;
+    }
+
+    dd_waitall(dd->nreq_x, dd->req_x);
+    dd->nreq_x = -1;
+
+    dd_move_x_unpack(dd, x, 0, 0, 1);
+
+    ind = &dd->comm->cd[0].ind[0];
+    if (dd->comm->cd[0].np > 1)
+    {
+        dd_move_x_pulses(dd, box, x, 0, 1, 1, dd->nat_home + ind->nrecv[2]);
+    }
+    else
+    {
+        dd_move_x_pulses(dd, box, x, 1, 0, 2, dd->nat_home + ind->nrecv[2]);
+    }
+}
+
 void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
 {
     int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
@@ -1507,8 +1634,9 @@ void dd_collect_vec(gmx_domdec_t *dd,
 }
 
 
-void dd_collect_state(gmx_domdec_t *dd,
-                      t_state *state_local, t_state *state)
+static void dd_collect_state_low(gmx_domdec_t *dd,
+                                 t_state *state_local, t_state *state,
+                                 gmx_bool bAtoms)
 {
     int est, i, j, nh;
 
@@ -1555,46 +1683,27 @@ void dd_collect_state(gmx_domdec_t *dd,
             switch (est)
             {
                 case estX:
-                    dd_collect_vec(dd, state_local, state_local->x, state->x);
-                    break;
-                case estV:
-                    dd_collect_vec(dd, state_local, state_local->v, state->v);
-                    break;
-                case estSDX:
-                    dd_collect_vec(dd, state_local, state_local->sd_X, state->sd_X);
-                    break;
-                case estCGP:
-                    dd_collect_vec(dd, state_local, state_local->cg_p, state->cg_p);
-                    break;
-                case estLD_RNG:
-                    if (state->nrngi == 1)
+                    if (bAtoms)
                     {
-                        if (DDMASTER(dd))
-                        {
-                            for (i = 0; i < state_local->nrng; i++)
-                            {
-                                state->ld_rng[i] = state_local->ld_rng[i];
-                            }
-                        }
+                        dd_collect_vec(dd, state_local, state_local->x, state->x);
                     }
-                    else
+                    break;
+                case estV:
+                    if (bAtoms)
                     {
-                        dd_gather(dd, state_local->nrng*sizeof(state->ld_rng[0]),
-                                  state_local->ld_rng, state->ld_rng);
+                        dd_collect_vec(dd, state_local, state_local->v, state->v);
                     }
                     break;
-                case estLD_RNGI:
-                    if (state->nrngi == 1)
+                case estSDX:
+                    if (bAtoms)
                     {
-                        if (DDMASTER(dd))
-                        {
-                            state->ld_rngi[0] = state_local->ld_rngi[0];
-                        }
+                        dd_collect_vec(dd, state_local, state_local->sd_X, state->sd_X);
                     }
-                    else
+                    break;
+                case estCGP:
+                    if (bAtoms)
                     {
-                        dd_gather(dd, sizeof(state->ld_rngi[0]),
-                                  state_local->ld_rngi, state->ld_rngi);
+                        dd_collect_vec(dd, state_local, state_local->cg_p, state->cg_p);
                     }
                     break;
                 case estDISRE_INITF:
@@ -1609,6 +1718,66 @@ void dd_collect_state(gmx_domdec_t *dd,
     }
 }
 
+void dd_collect_state(gmx_domdec_t *dd,
+                      t_state *state_local, t_state *state)
+{
+    dd_collect_state_low(dd, state_local, state, TRUE);
+}
+
+void dd_collect_state_no_atoms(gmx_domdec_t *dd,
+                               t_state *state_local, t_state *state)
+{
+    dd_collect_state_low(dd, state_local, state, FALSE);
+}
+
+int dd_get_home_atom_index(gmx_domdec_t *dd, t_state *state_local,
+                           int **index_gl)
+{
+    gmx_domdec_comm_t *comm;
+    t_block           *cgs_gl;
+    int                nat_home, i, cg, a;
+
+    if (state_local->ddp_count == dd->ddp_count)
+    {
+        /* The home atoms are the first nat_home local atoms */
+        *index_gl = dd->gatindex;
+
+        return dd->nat_home;
+    }
+
+    if (state_local->ddp_count_cg_gl != state_local->ddp_count)
+    {
+        gmx_incons("Attempted to get the atom indices for a state for which the charge group distribution is unknown");
+    }
+
+    comm   = dd->comm;
+    cgs_gl = &comm->cgs_gl;
+
+    nat_home = 0;
+    for (i = 0; i < state_local->ncg_gl; i++)
+    {
+        cg        = state_local->cg_gl[i];
+        nat_home += cgs_gl->index[cg+1] - cgs_gl->index[cg];
+    }
+    if (nat_home > comm->nalloc_int)
+    {
+        comm->nalloc_int = over_alloc_dd(nat_home);
+        srenew(comm->buf_int, comm->nalloc_int);
+    }
+    nat_home = 0;
+    for (i = 0; i < state_local->ncg_gl; i++)
+    {
+        cg = state_local->cg_gl[i];
+        for (a = cgs_gl->index[cg]; a < cgs_gl->index[cg+1]; a++)
+        {
+            comm->buf_int[nat_home++] = a;
+        }
+    }
+    *index_gl = comm->buf_int;
+
+    return nat_home;
+}
+
 static void dd_realloc_state(t_state *state, rvec **f, int nalloc)
 {
     int est;
@@ -1864,32 +2033,6 @@ static void dd_distribute_state(gmx_domdec_t *dd, t_block *cgs,
                 case estCGP:
                     dd_distribute_vec(dd, cgs, state->cg_p, state_local->cg_p);
                     break;
-                case estLD_RNG:
-                    if (state->nrngi == 1)
-                    {
-                        dd_bcastc(dd,
-                                  state_local->nrng*sizeof(state_local->ld_rng[0]),
-                                  state->ld_rng, state_local->ld_rng);
-                    }
-                    else
-                    {
-                        dd_scatter(dd,
-                                   state_local->nrng*sizeof(state_local->ld_rng[0]),
-                                   state->ld_rng, state_local->ld_rng);
-                    }
-                    break;
-                case estLD_RNGI:
-                    if (state->nrngi == 1)
-                    {
-                        dd_bcastc(dd, sizeof(state_local->ld_rngi[0]),
-                                  state->ld_rngi, state_local->ld_rngi);
-                    }
-                    else
-                    {
-                        dd_scatter(dd, sizeof(state_local->ld_rngi[0]),
-                                   state->ld_rngi, state_local->ld_rngi);
-                    }
-                    break;
                 case estDISRE_INITF:
                 case estDISRE_RM3TAV:
                 case estORIRE_INITF:
@@ -5330,6 +5473,121 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
     }
 }
 
+static float dd_cycles_av(gmx_domdec_comm_t *comm, int ddCycl)
+{
+    return (comm->cycl_n[ddCycl] > 0 ?
+            comm->cycl[ddCycl]/comm->cycl_n[ddCycl] : 0);
+}
+
+static void dd_write_load_stats(gmx_domdec_t *dd, gmx_large_int_t step,
+                                matrix box)
+{
+    gmx_domdec_comm_t  *comm;
+    gmx_dd_load_stats_t ls, *l;
+    int                 nzone, d, p, i;
+    char                buf[22];
+
+    comm = dd->comm;
+
+    copy_ivec(dd->ci, ls.ci);
+    ls.node     = comm->load_stats_node;
+    ls.nat_home = dd->nat_home;
+    ls.nat_halo = comm->nat[ddnatZONE] - dd->nat_home;
+    ls.nat_send = 0;
+    nzone       = 1;
+    for (d = 0; d < dd->ndim; d++)
+    {
+        for (p = 0; p < comm->cd[d].np; p++)
+        {
+            ls.nat_send += comm->cd[d].ind[p].nsend[nzone+1];
+        }
+        nzone += nzone;
+    }
+    ls.f       = dd_cycles_av(comm, ddCyclF);
+    ls.step    = dd_cycles_av(comm, ddCyclStep);
+    ls.ppdpme  = dd_cycles_av(comm, ddCyclPPduringPME);
+    ls.pme     = dd_cycles_av(comm, ddCyclPME);
+    ls.waitpme = dd_cycles_av(comm, ddCyclWaitPME);
+    copy_rvec(comm->cell_x0, ls.cell_x0);
+    copy_rvec(comm->cell_x1, ls.cell_x1);
+
+    dd_gather(dd, sizeof(ls), &ls, comm->load_stats);
+
+    if (DDMASTER(dd))
+    {
+        for (i = 0; i < dd->nnodes; i++)
+        {
+            l = &comm->load_stats[i];
+            fprintf(comm->fp_load_stats,
+                    "%s %d %d %d %d %d %d %d %d %.4g %.4g %.4g %.4g %.4g"
+                    " %.5f %.5f %.5f %.5f %.5f %.5f %.5f %.5f %.5f\n",
+                    gmx_step_str(step, buf), i, l->node,
+                    l->ci[XX], l->ci[YY], l->ci[ZZ],
+                    l->nat_home, l->nat_halo, l->nat_send,
+                    l->f, l->step, l->ppdpme, l->pme, l->waitpme,
+                    l->cell_x0[XX], l->cell_x1[XX],
+                    l->cell_x0[YY], l->cell_x1[YY],
+                    l->cell_x0[ZZ], l->cell_x1[ZZ],
+                    box[XX][XX], box[YY][YY], box[ZZ][ZZ]);
+        }
+        fflush(comm->fp_load_stats);
+    }
+}
+
+void dd_init_load_stats(FILE *fplog, gmx_domdec_t *dd,
+                        const char *fn, gmx_bool bAppend)
+{
+    gmx_domdec_comm_t *comm;
+
+    comm = dd->comm;
+
+    if (!comm->bRecordLoad)
+    {
+        if (fplog)
+        {
+            fprintf(fplog, "NOTE: Can not write DD load statistics, since the loads are not recorded\n");
+        }
+        return;
+    }
+
+    comm->bLoadStats      = TRUE;
+    comm->load_stats_node = gmx_hostname_num();
+
+    if (DDMASTER(dd))
+    {
+        snew(comm->load_stats, dd->nnodes);
+
+        comm->fp_load_stats = ffopen(fn, bAppend ? "a" : "w");
+        if (!bAppend)
+        {
+            fprintf(comm->fp_load_stats,
+                    "# DD load statistics\n"
+                    "# nnodes %d\n"
+                    "# grid %d %d %d\n"
+                    "# npme %d\n"
+                    "# dlb %s\n"
+                    "# cutoff %.5f\n"
+                    "# cellsize_limit_bonded %.5f\n"
+                    "# cellsize_limit %.5f\n",
+                    dd->nnodes, dd->nc[XX], dd->nc[YY], dd->nc[ZZ],
+                    (dd->pme_nodeid >= 0) ? comm->npmenodes : 0,
+                    edlb_names[comm->eDLB],
+                    comm->cutoff, comm->cellsize_limit_bonded,
+                    comm->cellsize_limit);
+            fprintf(comm->fp_load_stats,
+                    "# Cycle counts are averages per step since the previous record\n"
+                    "# step rank node cx cy cz nat_home nat_halo nat_send"
+                    " force step pp_during_pme pme wait_pme"
+                    " x0 x1 y0 y1 z0 z1 box_x box_y box_z\n");
+        }
+    }
+
+    if (fplog)
+    {
+        fprintf(fplog, "Will write DD load statistics to %s\n", fn);
+    }
+}
+
 static float dd_force_imb_perf_loss(gmx_domdec_t *dd)
 {
     /* Return the relative performance loss on the total run time
@@ -6504,6 +6762,8 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog, t_commrec *cr,
 
     snew(dd, 1);
 
+    dd->nreq_x = -1;
+
     dd->comm = init_dd_comm();
     comm     = dd->comm;
     snew(comm->cggl_flag, DIM*2);
@@ -6513,6 +6773,7 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog, t_commrec *cr,
     dd->bScrewPBC = (ir->ePBC == epbcSCREW);
 
     dd->bSendRecv2      = dd_nst_env(fplog, "GMX_DD_SENDRECV2", 0);
+    dd->bOverlapX       = (getenv("GMX_DD_NO_OVERLAP_X") == NULL);
     comm->dlb_scale_lim = dd_nst_env(fplog, "GMX_DLB_MAX", 10);
     comm->eFlop         = dd_nst_env(fplog, "GMX_DLB_FLOP", 0);
     recload             = dd_nst_env(fplog, "GMX_DD_LOAD", 1);
@@ -6528,6 +6789,10 @@ gmx_domdec_t *init_domain_decomposition(FILE *fplog, t_commrec *cr,
     {
         fprintf(fplog, "Will use two sequential MPI_Sendrecv calls instead of two simultaneous non-blocking MPI_Irecv and MPI_Isend pairs for constraint and vsite communication\n");
     }
+    if (!dd->bOverlapX && fplog)
+    {
+        fprintf(fplog, "Will not overlap the halo coordinate communication with force calculation\n");
+    }
     if (comm->eFlop)
     {
         if (fplog)
@@ -7309,6 +7574,7 @@ void set_dd_parameters(FILE *fplog, gmx_domdec_t *dd, real dlb_scale,
     {
         fprintf(debug, "The DD cut-off is %f\n", comm->cutoff);
     }
+    comm->cellsize_limit_bonded = max(comm->cellsize_limit, comm->cutoff_mbody);
     if (comm->eDLB != edlbNO)
     {
         set_cell_limits_dlb(dd, dlb_scale, ir, ddbox);
@@ -9070,6 +9336,12 @@ void print_dd_statistics(t_commrec *cr, t_inputrec *ir, FILE *fplog)
 
     comm = cr->dd->comm;
 
+    if (comm->fp_load_stats)
+    {
+        ffclose(comm->fp_load_stats);
+        comm->fp_load_stats = NULL;
+    }
+
     gmx_sumd(ddnatNR-ddnatZONE, comm->sum_nat, cr);
 
     if (fplog == NULL)
@@ -9230,10 +9502,14 @@ void dd_partition_system(FILE                *fplog,
         /* Avoid extra communication due to verbose screen output
          * when nstglobalcomm is set.
          */
-        if (bDoDLB || bLogLoad || bCheckDLB ||
+        if (bDoDLB || bLogLoad || bCheckDLB || comm->bLoadStats ||
             (bVerbose && (ir->nstlist == 0 || nstglobalcomm <= ir->nstlist)))
         {
             get_load_distribution(dd, wcycle);
+            if (comm->bLoadStats)
+            {
+                dd_write_load_stats(dd, step-1, state_local->box);
+            }
             if (DDMASTER(dd))
             {
                 if (bLogLoad)
@@ -125,6 +125,44 @@ void dd_sendrecv_rvec(const gmx_domdec_t *dd,
 #endif
 }
 
+void dd_isendrecv_rvec(const gmx_domdec_t *dd,
+                       int ddimind, int direction,
+                       rvec *buf_s, int n_s,
+                       rvec *buf_r, int n_r,
+                       int *nreq, MPI_Request req[])
+{
+#ifdef GMX_MPI
+    int rank_s, rank_r;
+#endif
+
+    *nreq = 0;
+#ifdef GMX_MPI
+    rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
+    rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
+
+    if (n_r)
+    {
+        MPI_Irecv(buf_r[0], n_r*sizeof(rvec), MPI_BYTE,
+                  rank_r, 0, dd->mpi_comm_all, &req[(*nreq)++]);
+    }
+    if (n_s)
+    {
+        MPI_Isend(buf_s[0], n_s*sizeof(rvec), MPI_BYTE,
+                  rank_s, 0, dd->mpi_comm_all, &req[(*nreq)++]);
+    }
+#endif
+}
+
+void dd_waitall(int nreq, MPI_Request req[])
+{
+#ifdef GMX_MPI
+    if (nreq > 0)
+    {
+        MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+    }
+#endif
+}
+
 void dd_sendrecv2_rvec(const gmx_domdec_t *dd,
                        int ddimind,
                        rvec *buf_s_fw, int n_s_fw,
@@ -48,10 +48,11 @@ typedef struct {
 } gmx_reverse_ilist_t;
 
 typedef struct {
-    int  a_start;
-    int  a_end;
-    int  natoms_mol;
-    int  type;
+    int      a_start;
+    int      a_end;
+    int      natoms_mol;
+    int      type;
+    gmx_bool bMultiCG; /* Does this molecule type have multiple charge groups? */
 } gmx_molblock_ind_t;
 
 typedef struct gmx_reverse_top {
@@ -662,6 +663,7 @@ static gmx_reverse_top_t *make_reverse_top(gmx_mtop_t *mtop, gmx_bool bFE,
         rt->mbi[mb].a_end      = i;
         rt->mbi[mb].natoms_mol = mtop->molblock[mb].natoms_mol;
         rt->mbi[mb].type       = mtop->molblock[mb].type;
+        rt->mbi[mb].bMultiCG   = (mtop->moltype[rt->mbi[mb].type].cgs.nr > 1);
     }
 
     rt->nthread = gmx_omp_nthreads_get(emntDomdec);
@@ -1149,6 +1151,32 @@ static void combine_idef(t_idef *dest, const t_idef *src, int nsrc,
     }
 }
 
+/* Returns in a_loc and kz the local index and zone of global atom a_gl,
+ * which is in the same molecule as local atom i with global index i_gl.
+ * Atoms of a charge group, and often of a whole molecule, are consecutive
+ * in the local order, so we first check the local atom at the same offset
+ * within zone iz, which has atom range at0 to at1. Only when that fails
+ * we use the global to local lookup.
+ */
+static inline gmx_bool get_local_atom_mol(const gmx_domdec_t *dd,
+                                          int i, int i_gl, int a_gl,
+                                          int iz, int at0, int at1,
+                                          int *a_loc, int *kz)
+{
+    int j;
+
+    j = i + a_gl - i_gl;
+    if (j >= at0 && j < at1 && dd->gatindex[j] == a_gl)
+    {
+        *a_loc = j;
+        *kz    = iz;
+
+        return TRUE;
+    }
+
+    return ga2la_get(dd->ga2la, a_gl, a_loc, kz);
+}
+
 /* This function looks up and assigns bonded interactions for zone iz.
  * With thread parallelizing each thread acts on a different atom range:
  * at_start to at_end.
@@ -1178,10 +1206,14 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
     const gmx_domdec_ns_ranges_t *izone;
     gmx_reverse_top_t            *rt;
     int                           nbonded_local;
+    int                           at_zone0, at_zone1;
 
     nizone = zones->nizone;
     izone  = zones->izone;
 
+    at_zone0 = dd->cgindex[zones->cg_range[iz]];
+    at_zone1 = dd->cgindex[zones->cg_range[iz+1]];
+
     rt = dd->reverse_top;
 
     bBCheck = rt->bBCheck;
@@ -1195,6 +1227,16 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
         /* Get the global atom number */
         i_gl = dd->gatindex[i];
         global_atomnr_to_moltype_ind(rt, i_gl, &mb, &mt, &mol, &i_mol);
+        if (iz > 0 && !rt->mbi[mb].bMultiCG)
+        {
+            /* All atoms of a single charge-group molecule are in zone iz,
+             * only the home zone interacts with itself and all other
+             * interactions are assigned in the home zone only.
+             * So no interactions can be assigned here.
+             * This skips most of the work for the communicated solvent.
+             */
+            continue;
+        }
         /* Check all interactions assigned to this atom */
         index = rt->ril_mt[mt].index;
         rtil  = rt->ril_mt[mt].il;
@@ -1267,7 +1309,9 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
                     /* This is a two-body interaction, we can assign
                      * analogous to the non-bonded assignments.
                      */
-                    if (!ga2la_get(ga2la, i_gl+iatoms[2]-i_mol, &a_loc, &kz))
+                    if (!get_local_atom_mol(dd, i, i_gl, i_gl+iatoms[2]-i_mol,
+                                            iz, at_zone0, at_zone1,
+                                            &a_loc, &kz))
                     {
                         bUse = FALSE;
                     }
@@ -1309,8 +1353,10 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
                     clear_ivec(k_plus);
                     for (k = 1; k <= nral && bUse; k++)
                     {
-                        bLocal = ga2la_get(ga2la, i_gl+iatoms[k]-i_mol,
-                                           &a_loc, &kz);
+                        bLocal = get_local_atom_mol(dd, i, i_gl,
+                                                    i_gl+iatoms[k]-i_mol,
+                                                    iz, at_zone0, at_zone1,
+                                                    &a_loc, &kz);
                         if (!bLocal || kz >= zones->n)
                         {
                             /* We do not have this atom of this interaction
@@ -1943,29 +1989,6 @@ void dd_init_local_state(gmx_domdec_t *dd,
 
     init_state(state_local, 0, buf[1], buf[2], buf[3], buf[4]);
     state_local->flags = buf[0];
-
-    /* With Langevin Dynamics we need to make proper storage space
-     * in the global and local state for the random numbers.
-     */
-    if (state_local->flags & (1<<estLD_RNG))
-    {
-        if (DDMASTER(dd) && state_global->nrngi > 1)
-        {
-            state_global->nrng = dd->nnodes*gmx_rng_n();
-            srenew(state_global->ld_rng, state_global->nrng);
-        }
-        state_local->nrng = gmx_rng_n();
-        snew(state_local->ld_rng, state_local->nrng);
-    }
-    if (state_local->flags & (1<<estLD_RNGI))
-    {
-        if (DDMASTER(dd) && state_global->nrngi > 1)
-        {
-            state_global->nrngi = dd->nnodes;
-            srenew(state_global->ld_rngi, state_global->nrngi);
-        }
-        snew(state_local->ld_rngi, 1);
-    }
 }
 
 static void check_link(t_blocka *link, int cg_gl, int cg_gl_j)
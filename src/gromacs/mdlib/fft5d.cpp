@@ -162,6 +162,16 @@ static int vmax(int* a, int s)
 }
 
 
+/* Returns in l0 and l1 the range of local 1D lines (minor index y < pM,
+ * major index z < pK) in slab c out of nslab. The slabs divide the
+ * maximum local size K along the major axis.
+ */
+static void slab_lines(int K, int pM, int pK, int nslab, int c, int *l0, int *l1)
+{
+    *l0 = std::min(K*c/nslab, pK)*pM;
+    *l1 = std::min(K*(c+1)/nslab, pK)*pM;
+}
+
 /* NxMxK the size of the data
  * comm communicator to use for fft5d
  * P0 number of processor in 1st axes (can be null for automatic)
@@ -411,13 +421,30 @@ fft5d_plan fft5d_plan_3d(int NG, int MG, int KG, MPI_Comm comm[2], int flags, t_
     /* int lsize = fmax(N[0]*M[0]*K[0]*nP[0],N[1]*M[1]*K[1]*nP[1]); */
     lsize = std::max(N[0]*M[0]*K[0]*nP[0], std::max(N[1]*M[1]*K[1]*nP[1], C[2]*M[2]*K[2]));
     /* int lsize = fmax(C[0]*M[0]*K[0],fmax(C[1]*M[1]*K[1],C[2]*M[2]*K[2])); */
+
+#ifndef FFT5D_MPI_TRANSPOSE
+    if (!(nP[0] > 1 || nP[1] > 1))
+#endif
+    {
+        /* Nothing to pipeline without communication */
+        flags &= ~FFT5D_PIPELINE;
+    }
+    if (flags&FFT5D_LOWMEM)
+    {
+        /* Pipelining requires separate transpose buffers */
+        flags &= ~FFT5D_PIPELINE;
+    }
+
     if (!(flags&FFT5D_NOMALLOC))
     {
         snew_aligned(lin, lsize, 32);
         snew_aligned(lout, lsize, 32);
-        if (nthreads > 1)
+        if ((nthreads > 1 && !(flags&FFT5D_LOWMEM)) || (flags&FFT5D_PIPELINE))
         {
-            /* We need extra transpose buffers to avoid OpenMP barriers */
+            /* We need extra transpose buffers to avoid OpenMP barriers,
+             * and, when pipelining, to not overwrite the FFT input and
+             * output of the next slab while communicating.
+             */
             snew_aligned(lout2, lsize, 32);
             snew_aligned(lout3, lsize, 32);
         }
@@ -432,7 +459,7 @@ fft5d_plan fft5d_plan_3d(int NG, int MG, int KG, MPI_Comm comm[2], int flags, t_
     {
         lin  = *rlin;
         lout = *rlout;
-        if (nthreads > 1)
+        if ((nthreads > 1 && !(flags&FFT5D_LOWMEM)) || (flags&FFT5D_PIPELINE))
         {
             lout2 = *rlout2;
             lout3 = *rlout3;
@@ -608,6 +635,59 @@ fft5d_plan fft5d_plan_3d(int NG, int MG, int KG, MPI_Comm comm[2], int flags, t_
         }
     }
 
+    for (s = 0; s < 2; s++)
+    {
+        int nslab, c;
+
+        if (!(flags&FFT5D_PIPELINE) || nP[s] == 1)
+        {
+            continue;
+        }
+        /* The slabs are defined on the maximum local size K[s], which is
+         * the same on all ranks in the communicator, so all ranks agree
+         * on the size of the messages.
+         */
+        nslab           = std::min(FFT5D_PIPELINE_NSLAB, K[s]);
+        plan->nslab[s]  = nslab;
+        plan->p1dp[s]   = (gmx_fft_t*)malloc(sizeof(gmx_fft_t)*nslab*nthreads);
+        if (debug)
+        {
+            fprintf(debug, "FFT5D: Pipelining transpose %d in %d slabs\n", s, nslab);
+        }
+
+#pragma omp parallel for num_threads(nthreads) schedule(static) ordered
+        for (t = 0; t < nthreads; t++)
+        {
+#pragma omp ordered
+            {
+                for (c = 0; c < nslab; c++)
+                {
+                    int l0, l1, tsize;
+
+                    slab_lines(K[s], pM[s], pK[s], nslab, c, &l0, &l1);
+                    tsize = ((t+1)*(l1 - l0)/nthreads) - (t*(l1 - l0)/nthreads);
+
+                    if (tsize == 0)
+                    {
+                        plan->p1dp[s][c*nthreads+t] = NULL;
+                    }
+                    else if ((flags&FFT5D_REALCOMPLEX) && !(flags&FFT5D_BACKWARD) && s == 0)
+                    {
+                        gmx_fft_init_many_1d_real( &plan->p1dp[s][c*nthreads+t], rC[s], tsize, (flags&FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0 );
+                    }
+                    else
+                    {
+                        gmx_fft_init_many_1d     ( &plan->p1dp[s][c*nthreads+t],  C[s], tsize, (flags&FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0 );
+                    }
+                }
+            }
+        }
+    }
+    if (plan->nslab[0] > 0 || plan->nslab[1] > 0)
+    {
+        plan->req = (MPI_Request*)malloc(sizeof(MPI_Request)*2*std::max(nP[0], nP[1])*FFT5D_PIPELINE_NSLAB);
+    }
+
 #ifdef GMX_FFT_FFTW3
 }
 #endif
@@ -733,53 +813,53 @@ static void splitaxes(t_complex* lout, const t_complex* lin,
     }
 }
 
+/* Tile size for the cache blocking of the local transposes */
+#define FFT5D_TRANSPOSE_TILE 8
+
 /*make axis contiguous again (after AllToAll) and also do local transpose*/
 /*transpose mayor and major dimension
    variables see above
    the major, middle, minor order is only correct for x,y,z (N,M,K) for the input
    N,M,K local dimensions
-   KG global size*/
+   KG global size
+   The input is contiguous in x and the output in z, so we loop over tiles
+   of x and z such that both reads and writes stay within a few cache lines*/
 static void joinAxesTrans13(t_complex* lout, const t_complex* lin,
                             int maxN, int maxM, int maxK, int pN, int pM, int pK,
                             int P, int KG, int* K, int* oK, int starty, int startx, int endy, int endx)
 {
-    int i, x, y, z;
-    int out_i, in_i, out_x, in_x, out_z, in_z;
+    int i, x, y, z, xb, xe, zb, ze;
+    int out_i, in_i, out_x, in_x;
     int s_y, e_y;
 
-    for (x = startx; x < endx+1; x++) /*1.j*/
+    for (xb = startx; xb < endx+1; xb += FFT5D_TRANSPOSE_TILE)
     {
-        if (x == startx)
-        {
-            s_y = starty;
-        }
-        else
-        {
-            s_y = 0;
-        }
-        if (x == endx)
-        {
-            e_y = endy;
-        }
-        else
-        {
-            e_y = pM;
-        }
-
-        out_x  = x*KG*pM;
-        in_x   = x;
+        xe = std::min(xb + FFT5D_TRANSPOSE_TILE, endx + 1);
 
         for (i = 0; i < P; i++) /*index cube along long axis*/
         {
-            out_i  = out_x  + oK[i];
-            in_i   = in_x + i*maxM*maxN*maxK;
-            for (z = 0; z < K[i]; z++) /*3.l*/
+            out_i  = oK[i];
+            in_i   = i*maxM*maxN*maxK;
+            for (zb = 0; zb < K[i]; zb += FFT5D_TRANSPOSE_TILE)
             {
-                out_z  = out_i  + z;
-                in_z   = in_i + z*maxM*maxN;
-                for (y = s_y; y < e_y; y++)              /*2.k*/
+                ze = std::min(zb + FFT5D_TRANSPOSE_TILE, K[i]);
+                for (y = 0; y < pM; y++) /*2.k*/
                 {
-                    lout[out_z+y*KG] = lin[in_z+y*maxN]; /*out=x*KG*pM+oK[i]+z+y*KG*/
+                    for (x = xb; x < xe; x++) /*1.j*/
+                    {
+                        s_y = (x == startx ? starty : 0);
+                        e_y = (x == endx   ? endy   : pM);
+                        if (y < s_y || y >= e_y)
+                        {
+                            continue;
+                        }
+                        out_x  = out_i + x*KG*pM + y*KG;
+                        in_x   = in_i + x + y*maxN;
+                        for (z = zb; z < ze; z++) /*3.l*/
+                        {
+                            lout[out_x+z] = lin[in_x+z*maxM*maxN]; /*out=x*KG*pM+oK[i]+z+y*KG*/
+                        }
+                    }
                 }
             }
         }
@@ -791,11 +871,13 @@ static void joinAxesTrans13(t_complex* lout, const t_complex* lin,
    variables see above
    the minor, middle, major order is only correct for x,y,z (N,M,K) for the input
    N,M,K local size
-   MG, global size*/
+   MG, global size
+   The output is contiguous in y, we loop over tiles of y such that
+   the reads for consecutive x stay within a few cache lines*/
 static void joinAxesTrans12(t_complex* lout, const t_complex* lin, int maxN, int maxM, int maxK, int pN, int pM, int pK,
                             int P, int MG, int* M, int* oM, int startx, int startz, int endx, int endz)
 {
-    int i, z, y, x;
+    int i, z, y, x, yb, ye;
     int out_i, in_i, out_z, in_z, out_x, in_x;
     int s_x, e_x;
 
@@ -824,20 +906,23 @@ static void joinAxesTrans12(t_complex* lout, const t_complex* lin, int maxN, int
         {
             out_i  = out_z  + oM[i];
             in_i   = in_z + i*maxM*maxN*maxK;
-            for (x = s_x; x < e_x; x++)
+            for (yb = 0; yb < M[i]; yb += FFT5D_TRANSPOSE_TILE)
             {
-                out_x  = out_i  + x*MG;
-                in_x   = in_i + x;
-                for (y = 0; y < M[i]; y++)
+                ye = std::min(yb + FFT5D_TRANSPOSE_TILE, M[i]);
+                for (x = s_x; x < e_x; x++)
                 {
-                    lout[out_x+y] = lin[in_x+y*maxN]; /*out=z*MG*pN+oM[i]+x*MG+y*/
+                    out_x  = out_i  + x*MG;
+                    in_x   = in_i + x;
+                    for (y = yb; y < ye; y++)
+                    {
+                        lout[out_x+y] = lin[in_x+y*maxN]; /*out=z*MG*pN+oM[i]+x*MG+y*/
+                    }
                 }
             }
         }
     }
 }
 
-
 static void rotate_offsets(int x[])
 {
     int t = x[0];
@@ -956,6 +1041,102 @@ static void print_localdata(const t_complex* lin, const char* txt, int s, fft5d_
     }
 }
 
+/* Pipelined version of the 1D FFTs along the first axis of step s and the
+ * following all-to-all communication. The local data is divided into
+ * plan->nslab[s] slabs along the major axis. As soon as a slab has been
+ * transformed and split, its communication is started, so it can overlap
+ * with the FFTs of the next slabs. Must be called by all threads, the
+ * result is in lout3 after the next OpenMP barrier.
+ */
+static void fft5d_pipelined_fft_split_transpose(fft5d_plan plan, int s, int thread, fft5d_time times)
+{
+#ifdef GMX_MPI
+    t_complex  *lin   = plan->lin;
+    t_complex  *lout  = plan->lout;
+    int        *N     = plan->N, *M = plan->M, *K = plan->K, *pN = plan->pN, *pM = plan->pM, *pK = plan->pK, *C = plan->C, *P = plan->P;
+    int         nslab = plan->nslab[s], nthreads = plan->nthreads;
+    int         c, l0, l1, tstart, tend, i, z0, z1, nreq, blocksize, offset, count;
+    gmx_fft_t   p1d;
+
+    blocksize = N[s]*M[s]*K[s];
+    nreq      = 0;
+
+    /* The lines of a slab are divided over the threads differently from
+     * how the previous join (or the caller) divided the input over threads.
+     */
+#pragma omp barrier
+
+    for (c = 0; c < nslab; c++)
+    {
+        slab_lines(K[s], pM[s], pK[s], nslab, c, &l0, &l1);
+        tstart = l0 + ( thread   *(l1 - l0)/nthreads);
+        tend   = l0 + ((thread+1)*(l1 - l0)/nthreads);
+        if (tend > tstart)
+        {
+            p1d = plan->p1dp[s][c*nthreads+thread];
+            if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
+            {
+                gmx_fft_many_1d_real(p1d, GMX_FFT_REAL_TO_COMPLEX, lin+tstart*C[s], lout+tstart*C[s]);
+            }
+            else
+            {
+                gmx_fft_many_1d(     p1d, (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD, lin+tstart*C[s], lout+tstart*C[s]);
+            }
+            splitaxes(plan->lout2, lout, N[s], M[s], K[s], pN[s], pM[s], pK[s], P[s], C[s], plan->iNout[s], plan->oNout[s], tstart%pM[s], tstart/pM[s], tend%pM[s], tend/pM[s]);
+        }
+#pragma omp barrier /*all threads have to have split this slab before sending it*/
+
+        if (thread == 0)
+        {
+#ifndef NOGMX
+            if (c == 0)
+            {
+                wallcycle_start(times, ewcPME_FFTCOMM);
+            }
+            else
+            {
+                wallcycle_start_nocount(times, ewcPME_FFTCOMM);
+            }
+#endif
+            /* Both in the send and receive buffer the slab is
+             * at the same offset in each block of size blocksize.
+             */
+            z0     = K[s]*c/nslab;
+            z1     = K[s]*(c+1)/nslab;
+            offset = z0*N[s]*M[s];
+            count  = (z1 - z0)*N[s]*M[s]*sizeof(t_complex)/sizeof(real);
+            for (i = 0; i < P[s]; i++)
+            {
+                MPI_Irecv(plan->lout3 + i*blocksize + offset, count, GMX_MPI_REAL,
+                          i, c, plan->cart[s], &plan->req[nreq++]);
+            }
+            for (i = 0; i < P[s]; i++)
+            {
+                MPI_Isend(plan->lout2 + i*blocksize + offset, count, GMX_MPI_REAL,
+                          i, c, plan->cart[s], &plan->req[nreq++]);
+            }
+#ifndef NOGMX
+            wallcycle_stop(times, ewcPME_FFTCOMM);
+#endif
+        }
+    }
+
+    if (thread == 0)
+    {
+#ifndef NOGMX
+        wallcycle_start_nocount(times, ewcPME_FFTCOMM);
+#endif
+        MPI_Waitall(nreq, plan->req, MPI_STATUSES_IGNORE);
+#ifndef NOGMX
+        wallcycle_stop(times, ewcPME_FFTCOMM);
+#endif
+    }
+#else
+    gmx_incons("fft5d MPI call without MPI configuration");
+#endif /*GMX_MPI*/
+}
+
+
 void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 {
     t_complex  *lin   = plan->lin;
@@ -1024,118 +1205,130 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
             bParallelDim = 0;
         }
 
-        /* ---------- START FFT ------------ */
-#ifdef NOGMX
-        if (times != 0 && thread == 0)
+        if (bParallelDim && plan->nslab[s] > 0)
         {
-            time = MPI_Wtime();
-        }
-#endif
-
-        if (bParallelDim || plan->nthreads == 1)
-        {
-            fftout = lout;
+            fft5d_pipelined_fft_split_transpose(plan, s, thread, times);
         }
         else
         {
-            if (s == 0)
+            /* ---------- START FFT ------------ */
+#ifdef NOGMX
+            if (times != 0 && thread == 0)
+            {
+                time = MPI_Wtime();
+            }
+#endif
+
+            if (bParallelDim || plan->nthreads == 1 || (plan->flags&FFT5D_LOWMEM))
             {
-                fftout = lout3;
+                fftout = lout;
             }
             else
             {
-                fftout = lout2;
+                if (s == 0)
+                {
+                    fftout = lout3;
+                }
+                else
+                {
+                    fftout = lout2;
+                }
             }
-        }
 
-        tstart = (thread*pM[s]*pK[s]/plan->nthreads)*C[s];
-        if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
-        {
-            gmx_fft_many_1d_real(p1d[s][thread], (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_COMPLEX_TO_REAL : GMX_FFT_REAL_TO_COMPLEX, lin+tstart, fftout+tstart);
-        }
-        else
-        {
-            gmx_fft_many_1d(     p1d[s][thread], (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD,               lin+tstart, fftout+tstart);
-
-        }
-
-#ifdef NOGMX
-        if (times != NULL && thread == 0)
-        {
-            time_fft += MPI_Wtime()-time;
-        }
-#endif
-        if (plan->flags&FFT5D_DEBUG && thread == 0)
-        {
-            print_localdata(lout, "%d %d: FFT %d\n", s, plan);
-        }
-        /* ---------- END FFT ------------ */
-
-        /* ---------- START SPLIT + TRANSPOSE------------ (if parallel in in this dimension)*/
-        if (bParallelDim)
-        {
-#ifdef NOGMX
-            if (times != NULL && thread == 0)
+            tstart = (thread*pM[s]*pK[s]/plan->nthreads)*C[s];
+            if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
             {
-                time = MPI_Wtime();
+                gmx_fft_many_1d_real(p1d[s][thread], (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_COMPLEX_TO_REAL : GMX_FFT_REAL_TO_COMPLEX, lin+tstart, fftout+tstart);
             }
-#endif
-            /*prepare for A
-               llToAll
-               1. (most outer) axes (x) is split into P[s] parts of size N[s]
-               for sending*/
-            if (pM[s] > 0)
+            else
             {
-                tend    = ((thread+1)*pM[s]*pK[s]/plan->nthreads);
-                tstart /= C[s];
-                splitaxes(lout2, lout, N[s], M[s], K[s], pN[s], pM[s], pK[s], P[s], C[s], iNout[s], oNout[s], tstart%pM[s], tstart/pM[s], tend%pM[s], tend/pM[s]);
+                gmx_fft_many_1d(     p1d[s][thread], (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD,               lin+tstart, fftout+tstart);
+
             }
-#pragma omp barrier /*barrier required before AllToAll (all input has to be their) - before timing to make timing more acurate*/
+
 #ifdef NOGMX
             if (times != NULL && thread == 0)
             {
-                time_local += MPI_Wtime()-time;
+                time_fft += MPI_Wtime()-time;
             }
 #endif
+            if (plan->flags&FFT5D_DEBUG && thread == 0)
+            {
+                print_localdata(lout, "%d %d: FFT %d\n", s, plan);
+            }
+            /* ---------- END FFT ------------ */
 
-            /* ---------- END SPLIT , START TRANSPOSE------------ */
-
-            if (thread == 0)
+            /* ---------- START SPLIT + TRANSPOSE------------ (if parallel in in this dimension)*/
+            if (bParallelDim)
             {
 #ifdef NOGMX
-                if (times != 0)
+                if (times != NULL && thread == 0)
                 {
                     time = MPI_Wtime();
                 }
-#else
-                wallcycle_start(times, ewcPME_FFTCOMM);
 #endif
-#ifdef FFT5D_MPI_TRANSPOSE
-                FFTW(execute)(mpip[s]);
-#else
-#ifdef GMX_MPI
-                if ((s == 0 && !(plan->flags&FFT5D_ORDER_YZ)) || (s == 1 && (plan->flags&FFT5D_ORDER_YZ)))
+                /*prepare for A
+                   llToAll
+                   1. (most outer) axes (x) is split into P[s] parts of size N[s]
+                   for sending*/
+                if ((plan->flags&FFT5D_LOWMEM) && plan->nthreads > 1)
                 {
-                    MPI_Alltoall(lout2, N[s]*pM[s]*K[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, lout3, N[s]*pM[s]*K[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, cart[s]);
+                    /* lout2 is lin, which other threads might still read */
+#pragma omp barrier
                 }
-                else
+                if (pM[s] > 0)
+                {
+                    tend    = ((thread+1)*pM[s]*pK[s]/plan->nthreads);
+                    tstart /= C[s];
+                    splitaxes(lout2, lout, N[s], M[s], K[s], pN[s], pM[s], pK[s], P[s], C[s], iNout[s], oNout[s], tstart%pM[s], tstart/pM[s], tend%pM[s], tend/pM[s]);
+                }
+#pragma omp barrier /*barrier required before AllToAll (all input has to be their) - before timing to make timing more acurate*/
+#ifdef NOGMX
+                if (times != NULL && thread == 0)
                 {
-                    MPI_Alltoall(lout2, N[s]*M[s]*pK[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, lout3, N[s]*M[s]*pK[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, cart[s]);
+                    time_local += MPI_Wtime()-time;
                 }
+#endif
+
+                /* ---------- END SPLIT , START TRANSPOSE------------ */
+
+                if (thread == 0)
+                {
+#ifdef NOGMX
+                    if (times != 0)
+                    {
+                        time = MPI_Wtime();
+                    }
+#else
+                    wallcycle_start(times, ewcPME_FFTCOMM);
+#endif
+#ifdef FFT5D_MPI_TRANSPOSE
+                    FFTW(execute)(mpip[s]);
 #else
-                gmx_incons("fft5d MPI call without MPI configuration");
+#ifdef GMX_MPI
+                    if ((s == 0 && !(plan->flags&FFT5D_ORDER_YZ)) || (s == 1 && (plan->flags&FFT5D_ORDER_YZ)))
+                    {
+                        MPI_Alltoall(lout2, N[s]*pM[s]*K[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, lout3, N[s]*pM[s]*K[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, cart[s]);
+                    }
+                    else
+                    {
+                        MPI_Alltoall(lout2, N[s]*M[s]*pK[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, lout3, N[s]*M[s]*pK[s]*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, cart[s]);
+                    }
+#else
+                    gmx_incons("fft5d MPI call without MPI configuration");
 #endif /*GMX_MPI*/
 #endif /*FFT5D_MPI_TRANSPOSE*/
 #ifdef NOGMX
-                if (times != 0)
-                {
-                    time_mpi[s] = MPI_Wtime()-time;
-                }
+                    if (times != 0)
+                    {
+                        time_mpi[s] = MPI_Wtime()-time;
+                    }
 #else
-                wallcycle_stop(times, ewcPME_FFTCOMM);
+                    wallcycle_stop(times, ewcPME_FFTCOMM);
 #endif
-            } /*master*/
-        }     /* bPrallelDim */
+                } /*master*/
+            }     /* bPrallelDim */
+        }
 #pragma omp barrier  /*both needed for parallel and non-parallel dimension (either have to wait on data from AlltoAll or from last FFT*/
 
         /* ---------- END SPLIT + TRANSPOSE------------ */
@@ -1192,6 +1385,14 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         }
         /* ---------- END JOIN ------------ */
 
+        if ((plan->flags&FFT5D_LOWMEM) && plan->nthreads > 1)
+        {
+            /* The next FFT writes lout, which other threads might still
+             * read in the join.
+             */
+#pragma omp barrier
+        }
+
         /*if (debug) print_localdata(lin, "%d %d: transposed x-z\n", N1, M0, K, ZYX, coor);*/
     }  /* for(s=0;s<2;s++) */
 #ifdef NOGMX
@@ -1250,6 +1451,14 @@ void fft5d_destroy(fft5d_plan plan)
             }
             free(plan->p1d[s]);
         }
+        if (s < 2 && plan->p1dp[s])
+        {
+            for (t = 0; t < plan->nslab[s]*plan->nthreads; t++)
+            {
+                gmx_many_fft_destroy(plan->p1dp[s][t]);
+            }
+            free(plan->p1dp[s]);
+        }
         if (plan->iNin[s])
         {
             free(plan->iNin[s]);
@@ -1271,6 +1480,10 @@ void fft5d_destroy(fft5d_plan plan)
             plan->oNout[s] = 0;
         }
     }
+    if (plan->req)
+    {
+        free(plan->req);
+    }
 #ifdef GMX_FFT_FFTW3
     FFTW_LOCK;
 #ifdef FFT5D_MPI_TRANSPOS
@@ -1290,7 +1503,7 @@ void fft5d_destroy(fft5d_plan plan)
     {
         sfree_aligned(plan->lin);
         sfree_aligned(plan->lout);
-        if (plan->nthreads > 1)
+        if ((plan->nthreads > 1 && !(plan->flags&FFT5D_LOWMEM)) || (plan->flags&FFT5D_PIPELINE))
         {
             sfree_aligned(plan->lout2);
             sfree_aligned(plan->lout3);
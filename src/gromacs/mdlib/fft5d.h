@@ -85,13 +85,31 @@ typedef enum fft5d_flags_t {
     FFT5D_DEBUG       = 8,
     FFT5D_NOMEASURE   = 16,
     FFT5D_INPLACE     = 32,
-    FFT5D_NOMALLOC    = 64
+    FFT5D_NOMALLOC    = 64,
+    FFT5D_PIPELINE    = 128,
+    FFT5D_LOWMEM      = 256
 } fft5d_flags;
 
+/* With FFT5D_PIPELINE the local data of each parallel transpose is
+ * split into (at most) this many slabs along the major axis. The
+ * communication of one slab is started as soon as it has been
+ * transformed, so it can overlap with the FFTs of the next slab.
+ */
+#define FFT5D_PIPELINE_NSLAB 4
+
+/* With FFT5D_LOWMEM no separate transpose buffers are allocated with
+ * OpenMP threads. The transposes go through the input and output
+ * buffers, as without threads, and extra OpenMP barriers avoid races.
+ * The input data is overwritten. Pipelining is not supported.
+ */
+
 struct fft5d_plan_t {
     t_complex *lin;
     t_complex *lout, *lout2, *lout3;
     gmx_fft_t* p1d[3]; /*1D plans*/
+    gmx_fft_t* p1dp[2]; /*1D plans per pipeline slab and thread (only with FFT5D_PIPELINE)*/
+    int        nslab[2]; /*number of pipeline slabs, 0 when not pipelined*/
+    MPI_Request *req;   /*requests for the pipelined transposes*/
 #ifdef GMX_FFT_FFTW3
     FFTW(plan) p2d;    /*2D plan: used for 1D decomposition if FFT supports transposed output*/
     FFTW(plan) p3d;    /*3D plan: used for 0D decomposition if FFT supports transposed output*/
@@ -551,7 +551,8 @@ void do_force_lowlevel(FILE       *fplog,   gmx_large_int_t step,
                 if (cr->duty & DUTY_PME)
                 {
                     assert(fr->n_tpi >= 0);
-                    if (fr->n_tpi == 0 || (flags & GMX_FORCE_STATECHANGED))
+                    if ((fr->n_tpi == 0 || (flags & GMX_FORCE_STATECHANGED)) &&
+                        pme_mesh_step(fr, ir, step, flags))
                     {
                         pme_flags = GMX_PME_SPREAD_Q | GMX_PME_SOLVE;
                         if (flags & GMX_FORCE_FORCES)
@@ -570,7 +571,7 @@ void do_force_lowlevel(FILE       *fplog,   gmx_large_int_t step,
                         wallcycle_start(wcycle, ewcPMEMESH);
                         status = gmx_pme_do(fr->pmedata,
                                             md->start, md->homenr - fr->n_tpi,
-                                            x, fr->f_novirsum,
+                                            x, fr->bPMEMTS ? fr->f_twin : fr->f_novirsum,
                                             md->chargeA, md->chargeB,
                                             bSB ? boxs : box, cr,
                                             DOMAINDECOMP(cr) ? dd_pme_maxshift_x(cr->dd) : 0,
@@ -684,6 +685,19 @@ void do_force_lowlevel(FILE       *fplog,   gmx_large_int_t step,
 
 }
 
+gmx_bool pme_mesh_step(const t_forcerec *fr, const t_inputrec *ir,
+                       gmx_large_int_t step, int flags)
+{
+    return (!fr->bPMEMTS || do_per_step(step, ir->nstcalcpme) ||
+            (flags & (GMX_FORCE_VIRIAL | GMX_FORCE_ENERGY | GMX_FORCE_DHDL)));
+}
+
+gmx_bool pme_mesh_impulse_step(const t_forcerec *fr, const t_inputrec *ir,
+                               gmx_large_int_t step)
+{
+    return (fr->bPMEMTS && do_per_step(step, ir->nstcalcpme));
+}
+
 void init_enerdata(int ngener, int n_lambda, gmx_enerdata_t *enerd)
 {
     int i, n2;
@@ -1337,7 +1337,7 @@ void forcerec_set_ranges(t_forcerec *fr,
     {
         fr->nalloc_force = over_alloc_dd(fr->natoms_force_constr);
 
-        if (fr->bTwinRange)
+        if (fr->bTwinRange || fr->bPMEMTS)
         {
             srenew(fr->f_twin, fr->nalloc_force);
         }
@@ -2337,6 +2337,7 @@ void init_forcerec(FILE              *fp,
 
     fr->bTwinRange = fr->rlistlong > fr->rlist;
     fr->bEwald     = (EEL_PME(fr->eeltype) || fr->eeltype == eelEWALD);
+    fr->bPMEMTS    = (EEL_PME(fr->eeltype) && ir->nstcalcpme > 1);
 
     fr->reppow     = mtop->ffparams.reppow;
 
@@ -2440,6 +2441,11 @@ void init_forcerec(FILE              *fp,
         {
             fprintf(fp, "Using a Gaussian width (1/beta) of %g nm for Ewald\n",
                     1/fr->ewaldcoeff);
+            if (fr->bPMEMTS)
+            {
+                fprintf(fp, "Applying the PME mesh forces as an impulse every %d steps\n",
+                        ir->nstcalcpme);
+            }
         }
     }
 
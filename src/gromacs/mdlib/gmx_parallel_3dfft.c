@@ -46,7 +46,8 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t     *    pfft_setup,
                            int     *                     slab2index_major,
                            int     *                     slab2index_minor,
                            gmx_bool                      bReproducible,
-                           int                           nthreads)
+                           int                           nthreads,
+                           gmx_bool                      bLowMem)
 {
     int        rN      = ndata[2], M = ndata[1], K = ndata[0];
     int        flags   = FFT5D_REALCOMPLEX | FFT5D_ORDER_YZ; /* FFT5D_DEBUG */
@@ -59,6 +60,15 @@ gmx_parallel_3dfft_init   (gmx_parallel_3dfft_t     *    pfft_setup,
     {
         flags |= FFT5D_NOMEASURE;
     }
+    if (bLowMem)
+    {
+        flags |= FFT5D_LOWMEM;
+    }
+    if (getenv("GMX_PME_FFT_PIPELINE") != NULL)
+    {
+        /* Overlap the transpose communication with the FFTs */
+        flags |= FFT5D_PIPELINE;
+    }
 
     if (!(flags&FFT5D_ORDER_YZ))
     {
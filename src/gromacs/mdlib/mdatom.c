@@ -144,6 +144,11 @@ void atoms2md(gmx_mtop_t *mtop, t_inputrec *ir,
         }
         srenew(md->massT, md->nalloc);
         srenew(md->invmass, md->nalloc);
+        if (ir->eI == eiMD)
+        {
+            srenew(md->massT_dim, DIM*md->nalloc);
+            srenew(md->invmass_dim, DIM*md->nalloc);
+        }
         srenew(md->chargeA, md->nalloc);
         if (md->nPerturbed)
         {
@@ -307,6 +312,14 @@ void atoms2md(gmx_mtop_t *mtop, t_inputrec *ir,
             md->bPerturbed[i] = PERTURBED(*atom);
         }
         md->ptype[i]    = atom->ptype;
+        if (md->invmass_dim)
+        {
+            for (g = 0; g < DIM; g++)
+            {
+                md->massT_dim[i*DIM+g]   = md->massT[i];
+                md->invmass_dim[i*DIM+g] = md->invmass[i];
+            }
+        }
         if (md->cTC)
         {
             md->cTC[i]    = groups->grpnr[egcTC][ag];
@@ -371,6 +384,15 @@ void atoms2md(gmx_mtop_t *mtop, t_inputrec *ir,
 
     gmx_mtop_atomlookup_destroy(alook);
 
+    md->nVsiteShell = 0;
+    for (i = start; i < start+homenr; i++)
+    {
+        if (md->ptype[i] == eptVSite || md->ptype[i] == eptShell)
+        {
+            md->nVsiteShell++;
+        }
+    }
+
     md->start  = start;
     md->homenr = homenr;
     md->lambda = 0;
@@ -378,7 +400,7 @@ void atoms2md(gmx_mtop_t *mtop, t_inputrec *ir,
 
 void update_mdatoms(t_mdatoms *md, real lambda)
 {
-    int    al, end;
+    int    al, end, d;
     real   L1 = 1.0-lambda;
 
     end = md->nr;
@@ -394,6 +416,14 @@ void update_mdatoms(t_mdatoms *md, real lambda)
                 {
                     md->invmass[al] = 1.0/md->massT[al];
                 }
+                if (md->invmass_dim)
+                {
+                    for (d = 0; d < DIM; d++)
+                    {
+                        md->massT_dim[al*DIM+d]   = md->massT[al];
+                        md->invmass_dim[al*DIM+d] = md->invmass[al];
+                    }
+                }
             }
         }
         md->tmass = L1*md->tmassA + lambda*md->tmassB;
@@ -138,6 +138,8 @@ static void nbnxn_atomdata_output_init(nbnxn_atomdata_output_t *out,
     int cj_size;
 
     out->f = NULL;
+    /* Space for one buffer flag block in any force format */
+    ma((void **)&out->fred, NBNXN_BUFFERFLAG_SIZE*STRIDE_XYZQ*sizeof(*out->fred));
     ma((void **)&out->fshift, SHIFTS*DIM*sizeof(*out->fshift));
     out->nV = nenergrp*nenergrp;
     ma((void **)&out->Vvdw, out->nV*sizeof(*out->Vvdw));
@@ -1009,18 +1011,6 @@ void nbnxn_atomdata_copy_x_to_nbat_x(const nbnxn_search_t nbs,
     }
 }
 
-static void
-nbnxn_atomdata_clear_reals(real * gmx_restrict dest,
-                           int i0, int i1)
-{
-    int i;
-
-    for (i = i0; i < i1; i++)
-    {
-        dest[i] = 0;
-    }
-}
-
 static void
 nbnxn_atomdata_reduce_reals(real * gmx_restrict dest,
                             gmx_bool bDestSet,
@@ -1220,6 +1210,71 @@ nbnxn_atomdata_add_nbat_f_to_f_part(const nbnxn_search_t nbs,
     }
 }
 
+/* Add the forces of one buffer flag block, starting at cell c0 and
+ * stored contiguously in fb, to the, differently ordered, force array f.
+ */
+static void
+nbnxn_atomdata_add_nbat_f_block_to_f(const nbnxn_search_t nbs,
+                                     const nbnxn_atomdata_t *nbat,
+                                     const real *fb,
+                                     int c0, int c1,
+                                     rvec *f)
+{
+    int        c, a, i;
+    const int *atom;
+
+    atom = nbs->a;
+
+    switch (nbat->FFormat)
+    {
+        case nbatXYZ:
+        case nbatXYZQ:
+            for (c = c0; c < c1; c++)
+            {
+                a = atom[c];
+                if (a >= 0)
+                {
+                    i = (c - c0)*nbat->fstride;
+
+                    f[a][XX] += fb[i];
+                    f[a][YY] += fb[i+1];
+                    f[a][ZZ] += fb[i+2];
+                }
+            }
+            break;
+        case nbatX4:
+            for (c = c0; c < c1; c++)
+            {
+                a = atom[c];
+                if (a >= 0)
+                {
+                    i = X4_IND_A(c) - X4_IND_A(c0);
+
+                    f[a][XX] += fb[i+XX*PACK_X4];
+                    f[a][YY] += fb[i+YY*PACK_X4];
+                    f[a][ZZ] += fb[i+ZZ*PACK_X4];
+                }
+            }
+            break;
+        case nbatX8:
+            for (c = c0; c < c1; c++)
+            {
+                a = atom[c];
+                if (a >= 0)
+                {
+                    i = X8_IND_A(c) - X8_IND_A(c0);
+
+                    f[a][XX] += fb[i+XX*PACK_X8];
+                    f[a][YY] += fb[i+YY*PACK_X8];
+                    f[a][ZZ] += fb[i+ZZ*PACK_X8];
+                }
+            }
+            break;
+        default:
+            gmx_incons("Unsupported nbnxn_atomdata_t format");
+    }
+}
+
 /* Add the force array(s) from nbnxn_atomdata_t to f */
 void nbnxn_atomdata_add_nbat_f_to_f(const nbnxn_search_t    nbs,
                                     int                     locality,
@@ -1251,25 +1306,41 @@ void nbnxn_atomdata_add_nbat_f_to_f(const nbnxn_search_t    nbs,
 
     if (nbat->nout > 1)
     {
+        double nbytes;
+
         if (locality != eatAll)
         {
             gmx_incons("add_f_to_f called with nout>1 and locality!=eatAll");
         }
+        if (nth > nbat->nout)
+        {
+            gmx_incons("add_f_to_f called with more threads than output buffers");
+        }
 
-        /* Reduce the force thread output buffers into buffer 0, before adding
-         * them to the, differently ordered, "real" force buffer.
+        /* Each thread owns a contiguous range of cell blocks and adds
+         * the forces of its blocks directly to f. Only the thread output
+         * buffers which wrote to a block, as given by the buffer flags,
+         * are read. Blocks written by a single thread, which is the case
+         * for the cells a thread does not share with other threads,
+         * are added without reduction. Blocks on the boundaries between
+         * the threads are first reduced into a small, thread-private buffer.
+         * Since each cell, and thus each atom, belongs to one block,
+         * no synchronization is needed on f.
          */
-#pragma omp parallel for num_threads(nth) schedule(static)
+        nbytes = 0;
+#pragma omp parallel for num_threads(nth) schedule(static) reduction(+:nbytes)
         for (th = 0; th < nth; th++)
         {
             const nbnxn_buffer_flags_t *flags;
             int   b0, b1, b;
-            int   i0, i1;
+            int   c0, c1, i0, i1;
             int   nfptr;
             real *fptr[NBNXN_BUFFERFLAG_MAX_THREADS];
+            real *fred;
             int   out;
 
             flags = &nbat->buffer_flags;
+            fred  = nbat->out[th].fred;
 
             /* Calculate the cell-block range for our thread */
             b0 = (flags->nflag* th   )/nth;
@@ -1277,47 +1348,56 @@ void nbnxn_atomdata_add_nbat_f_to_f(const nbnxn_search_t    nbs,
 
             for (b = b0; b < b1; b++)
             {
-                i0 =  b   *NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
+                c0 = b*NBNXN_BUFFERFLAG_SIZE;
+                c1 = min(c0 + NBNXN_BUFFERFLAG_SIZE, nbat->natoms);
+                i0 = c0*nbat->fstride;
                 i1 = (b+1)*NBNXN_BUFFERFLAG_SIZE*nbat->fstride;
 
                 nfptr = 0;
-                for (out = 1; out < nbat->nout; out++)
+                for (out = 0; out < nbat->nout; out++)
                 {
                     if (flags->flag[b] & (1U<<out))
                     {
-                        fptr[nfptr++] = nbat->out[out].f;
+                        fptr[nfptr++] = nbat->out[out].f + i0;
                     }
                 }
-                if (nfptr > 0)
+                if (nfptr == 1)
+                {
+                    nbnxn_atomdata_add_nbat_f_block_to_f(nbs, nbat, fptr[0],
+                                                         c0, c1, f);
+                }
+                else if (nfptr > 1)
                 {
 #ifdef GMX_NBNXN_SIMD
                     nbnxn_atomdata_reduce_reals_simd
 #else
                     nbnxn_atomdata_reduce_reals
 #endif
-                        (nbat->out[0].f,
-                        flags->flag[b] & (1U<<0),
+                        (fred, FALSE,
                         fptr, nfptr,
-                        i0, i1);
-                }
-                else if (!(flags->flag[b] & (1U<<0)))
-                {
-                    nbnxn_atomdata_clear_reals(nbat->out[0].f,
-                                               i0, i1);
+                        0, i1 - i0);
+                    nbnxn_atomdata_add_nbat_f_block_to_f(nbs, nbat, fred,
+                                                         c0, c1, f);
                 }
+                /* Count the reads of the thread buffers and the update of f */
+                nbytes += (nfptr*(i1 - i0) + (nfptr > 0 ? 2*DIM*(c1 - c0) : 0))*sizeof(real);
             }
         }
+        nbs->reduce_bytes += nbytes;
     }
-
-#pragma omp parallel for num_threads(nth) schedule(static)
-    for (th = 0; th < nth; th++)
+    else
     {
-        nbnxn_atomdata_add_nbat_f_to_f_part(nbs, nbat,
-                                            nbat->out,
-                                            1,
-                                            a0+((th+0)*na)/nth,
-                                            a0+((th+1)*na)/nth,
-                                            f);
+#pragma omp parallel for num_threads(nth) schedule(static)
+        for (th = 0; th < nth; th++)
+        {
+            nbnxn_atomdata_add_nbat_f_to_f_part(nbs, nbat,
+                                                nbat->out,
+                                                1,
+                                                a0+((th+0)*na)/nth,
+                                                a0+((th+1)*na)/nth,
+                                                f);
+        }
+        nbs->reduce_bytes += (nbat->fstride + 2*DIM)*(double)na*sizeof(real);
     }
 
     nbs_cycle_stop(&nbs->cc[enbsCCreducef]);
@@ -235,6 +235,7 @@ typedef struct nbnxn_search {
     gmx_bool             print_cycles;
     int                  search_count;
     nbnxn_cycle_t        cc[enbsCCnr];
+    double               reduce_bytes; /* Bytes accessed by the force reduction */
 
     gmx_icell_set_x_t   *icell_set_x; /* Function for setting i-coords    */
 
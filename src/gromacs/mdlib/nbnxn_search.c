@@ -209,11 +209,12 @@ static void nbs_cycle_print(FILE *fp, const nbnxn_search_t nbs)
     int t;
 
     fprintf(fp, "\n");
-    fprintf(fp, "ns %4d grid %4.1f search %4.1f red.f %5.3f",
+    fprintf(fp, "ns %4d grid %4.1f search %4.1f red.f %5.3f %6.1f kB",
             nbs->cc[enbsCCgrid].count,
             Mcyc_av(&nbs->cc[enbsCCgrid]),
             Mcyc_av(&nbs->cc[enbsCCsearch]),
-            Mcyc_av(&nbs->cc[enbsCCreducef]));
+            Mcyc_av(&nbs->cc[enbsCCreducef]),
+            nbs->reduce_bytes*1e-3/max(nbs->cc[enbsCCreducef].count, 1));
 
     if (nbs->nthread_max > 1)
     {
@@ -404,6 +405,7 @@ void nbnxn_init_search(nbnxn_search_t    * nbs_ptr,
     nbs->print_cycles = (getenv("GMX_NBNXN_CYCLE") != 0);
     nbs->search_count = 0;
     nbs_cycle_clear(nbs->cc);
+    nbs->reduce_bytes = 0;
     for (t = 0; t < nbs->nthread_max; t++)
     {
         nbs_cycle_clear(nbs->work[t].cc);
@@ -4758,47 +4760,37 @@ static void reduce_buffer_flags(const nbnxn_search_t        nbs,
 
 static void print_reduction_cost(const nbnxn_buffer_flags_t *flags, int nout)
 {
-    int nelem, nkeep, ncopy, nred, b, c, out;
+    int nelem, ndirect, nred, b, c, out;
 
-    nelem = 0;
-    nkeep = 0;
-    ncopy = 0;
-    nred  = 0;
+    nelem   = 0;
+    ndirect = 0;
+    nred    = 0;
     for (b = 0; b < flags->nflag; b++)
     {
-        if (flags->flag[b] == 1)
-        {
-            /* Only flag 0 is set, no copy of reduction required */
-            nelem++;
-            nkeep++;
-        }
-        else if (flags->flag[b] > 0)
+        c = 0;
+        for (out = 0; out < nout; out++)
         {
-            c = 0;
-            for (out = 0; out < nout; out++)
-            {
-                if (flags->flag[b] & (1U<<out))
-                {
-                    c++;
-                }
-            }
-            nelem += c;
-            if (c == 1)
+            if (flags->flag[b] & (1U<<out))
             {
-                ncopy++;
-            }
-            else
-            {
-                nred += c;
+                c++;
             }
         }
+        nelem += c;
+        if (c == 1)
+        {
+            /* Owned by one thread, added to f without reduction */
+            ndirect++;
+        }
+        else if (c > 1)
+        {
+            nred += c;
+        }
     }
 
-    fprintf(debug, "nbnxn reduction: #flag %d #list %d elem %4.2f, keep %4.2f copy %4.2f red %4.2f\n",
+    fprintf(debug, "nbnxn reduction: #flag %d #list %d elem %4.2f, direct %4.2f red %4.2f\n",
             flags->nflag, nout,
             nelem/(double)(flags->nflag),
-            nkeep/(double)(flags->nflag),
-            ncopy/(double)(flags->nflag),
+            ndirect/(double)(flags->nflag),
             nred/(double)(flags->nflag));
 }
 
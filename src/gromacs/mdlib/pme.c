@@ -86,17 +86,11 @@
 #include "gmx_omp.h"
 #include "macros.h"
 
-/* Single precision, with SSE2 or higher available */
-#if defined(GMX_X86_SSE2) && !defined(GMX_DOUBLE)
+/* Sets up PME_SIMD and its widths, see pme_simd.h */
+#include "pme_simd.h"
 
-#include "gmx_x86_simd_single.h"
-
-#define PME_SSE
-/* Some old AMD processors could have problems with unaligned loads+stores */
-#ifndef GMX_FAHCORE
-#define PME_SSE_UNALIGNED
-#endif
-#endif
+/* The byte alignment of the PME grids, sufficient for 256-bit SIMD */
+#define PME_GRID_ALIGN_BYTES 32
 
 #define DFT_TOL 1e-7
 /* #define PRT_FORCE */
@@ -219,16 +213,12 @@ typedef struct {
     real      *grid_all;     /* Allocated array for the grids in *grid_th        */
     int      **g2t;          /* The grid to thread index                         */
     ivec       nthread_comm; /* The number of threads to communicate with        */
+    gmx_bool   bLowMem;      /* Threads spread directly on grid, no grid_th      */
 } pmegrids_t;
 
 
 typedef struct {
-#ifdef PME_SSE
-    /* Masks for SSE aligned spreading and gathering */
-    __m128 mask_SSE0[6], mask_SSE1[6];
-#else
-    int    dummy; /* C89 requires that struct has at least one member */
-#endif
+    gmx_bool bSIMD; /* Use SIMD spreading and gathering */
 } pme_spline_work_t;
 
 typedef struct {
@@ -1173,6 +1163,9 @@ copy_pmegrid_to_fftgrid(gmx_pme_t pme, real *pmegrid, real *fftgrid)
         sprintf(format, "%s%s\n", pdbformat, "%6.2f%6.2f");
 #endif
 
+#ifndef DEBUG_PME
+#pragma omp parallel for num_threads(pme->nthread) private(iy, iz, pmeidx, fftidx) schedule(static)
+#endif
         for (ix = 0; ix < local_fft_ndata[XX]; ix++)
         {
             for (iy = 0; iy < local_fft_ndata[YY]; iy++)
@@ -1298,6 +1291,7 @@ wrap_periodic_pmegrid(gmx_pme_t pme, real *pmegrid)
     overlap = pme->pme_order - 1;
 
     /* Add periodic overlap in z */
+#pragma omp parallel for num_threads(pme->nthread) private(iy, iz) schedule(static)
     for (ix = 0; ix < pme->pmegrid_nx; ix++)
     {
         for (iy = 0; iy < pme->pmegrid_ny; iy++)
@@ -1312,6 +1306,7 @@ wrap_periodic_pmegrid(gmx_pme_t pme, real *pmegrid)
 
     if (pme->nnodes_minor == 1)
     {
+#pragma omp parallel for num_threads(pme->nthread) private(iy, iz) schedule(static)
         for (ix = 0; ix < pme->pmegrid_nx; ix++)
         {
             for (iy = 0; iy < overlap; iy++)
@@ -1331,6 +1326,7 @@ wrap_periodic_pmegrid(gmx_pme_t pme, real *pmegrid)
 
         for (ix = 0; ix < overlap; ix++)
         {
+#pragma omp parallel for num_threads(pme->nthread) private(iz) schedule(static)
             for (iy = 0; iy < ny_x; iy++)
             {
                 for (iz = 0; iz < nz; iz++)
@@ -1459,6 +1455,28 @@ static void clear_grid(int nx, int ny, int nz, real *grid,
     }
 }
 
+#ifdef PME_SIMD
+/* Instantiate the SIMD spreading and gathering for orders 4 to 12 */
+#define PME_ORDER 4
+#include "pme_simd.h"
+#define PME_ORDER 5
+#include "pme_simd.h"
+#define PME_ORDER 6
+#include "pme_simd.h"
+#define PME_ORDER 7
+#include "pme_simd.h"
+#define PME_ORDER 8
+#include "pme_simd.h"
+#define PME_ORDER 9
+#include "pme_simd.h"
+#define PME_ORDER 10
+#include "pme_simd.h"
+#define PME_ORDER 11
+#include "pme_simd.h"
+#define PME_ORDER 12
+#include "pme_simd.h"
+#endif
+
 /* This has to be a macro to enable full compiler optimization with xlC (and probably others too) */
 #define DO_BSPLINE(order)                            \
     for (ithx = 0; (ithx < order); ithx++)                    \
@@ -1480,9 +1498,27 @@ static void clear_grid(int nx, int ny, int nz, real *grid,
     }
 
 
+static void clear_pmegrid_x(pmegrid_t *pmegrid, int x0, int x1)
+{
+    int  i, i0, i1;
+    real *grid;
+
+    grid = pmegrid->grid;
+    i0   = x0*pmegrid->s[YY]*pmegrid->s[ZZ];
+    i1   = x1*pmegrid->s[YY]*pmegrid->s[ZZ];
+    for (i = i0; i < i1; i++)
+    {
+        grid[i] = 0;
+    }
+}
+
+/* Spreads the charges of the atoms in spline with local x grid index
+ * x0 <= idx[XX] < x1 on pmegrid, which should have been cleared.
+ */
 static void spread_q_bsplines_thread(pmegrid_t *pmegrid,
                                      pme_atomcomm_t *atc, splinedata_t *spline,
-                                     pme_spline_work_t *work)
+                                     pme_spline_work_t *work,
+                                     int x0, int x1)
 {
 
     /* spread charges from home atoms to local grid */
@@ -1494,7 +1530,7 @@ static void spread_q_bsplines_thread(pmegrid_t *pmegrid,
     real           valx, valxy, qn;
     real          *thx, *thy, *thz;
     int            localsize, bndsize;
-    int            pnx, pny, pnz, ndatatot;
+    int            pnx, pny, pnz;
     int            offx, offy, offz;
 
     pnx = pmegrid->s[XX];
@@ -1505,23 +1541,17 @@ static void spread_q_bsplines_thread(pmegrid_t *pmegrid,
     offy = pmegrid->offset[YY];
     offz = pmegrid->offset[ZZ];
 
-    ndatatot = pnx*pny*pnz;
-    grid     = pmegrid->grid;
-    for (i = 0; i < ndatatot; i++)
-    {
-        grid[i] = 0;
-    }
-
+    grid  = pmegrid->grid;
     order = pmegrid->order;
 
     for (nn = 0; nn < spline->n; nn++)
     {
-        n  = spline->ind[nn];
-        qn = atc->q[n];
+        n      = spline->ind[nn];
+        qn     = atc->q[n];
+        idxptr = atc->idx[n];
 
-        if (qn != 0)
+        if (qn != 0 && idxptr[XX] >= x0 && idxptr[XX] < x1)
         {
-            idxptr = atc->idx[n];
             norder = nn*order;
 
             i0   = idxptr[XX] - offx;
@@ -1532,29 +1562,32 @@ static void spread_q_bsplines_thread(pmegrid_t *pmegrid,
             thy = spline->theta[YY] + norder;
             thz = spline->theta[ZZ] + norder;
 
+#ifdef PME_SIMD
+            if (work->bSIMD)
+            {
+                switch (order)
+                {
+                    case 4: pme_spread_simd_4(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 5: pme_spread_simd_5(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 6: pme_spread_simd_6(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 7: pme_spread_simd_7(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 8: pme_spread_simd_8(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 9: pme_spread_simd_9(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 10: pme_spread_simd_10(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 11: pme_spread_simd_11(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    case 12: pme_spread_simd_12(grid, pny, pnz, i0, j0, k0, qn, thx, thy, thz); break;
+                    default: gmx_incons("SIMD PME spreading called with an unsupported order");
+                }
+                continue;
+            }
+#endif
             switch (order)
             {
                 case 4:
-#ifdef PME_SSE
-#ifdef PME_SSE_UNALIGNED
-#define PME_SPREAD_SSE_ORDER4
-#else
-#define PME_SPREAD_SSE_ALIGNED
-#define PME_ORDER 4
-#endif
-#include "pme_sse_single.h"
-#else
                     DO_BSPLINE(4);
-#endif
                     break;
                 case 5:
-#ifdef PME_SSE
-#define PME_SPREAD_SSE_ALIGNED
-#define PME_ORDER 5
-#include "pme_sse_single.h"
-#else
                     DO_BSPLINE(5);
-#endif
                     break;
                 default:
                     DO_BSPLINE(order);
@@ -1566,33 +1599,20 @@ static void spread_q_bsplines_thread(pmegrid_t *pmegrid,
 
 static void set_grid_alignment(int *pmegrid_nz, int pme_order)
 {
-#ifdef PME_SSE
-    if (pme_order == 5
-#ifndef PME_SSE_UNALIGNED
-        || pme_order == 4
-#endif
-        )
-    {
-        /* Round nz up to a multiple of 4 to ensure alignment */
-        *pmegrid_nz = ((*pmegrid_nz + 3) & ~3);
-    }
+#ifdef PME_SIMD
+    /* Round nz up to a multiple of the SIMD width to ensure alignment */
+    *pmegrid_nz = ((*pmegrid_nz + PME_SIMD_ALIGN - 1) & ~(PME_SIMD_ALIGN - 1));
 #endif
 }
 
 static void set_gridsize_alignment(int *gridsize, int pme_order)
 {
-#ifdef PME_SSE
-#ifndef PME_SSE_UNALIGNED
-    if (pme_order == 4)
-    {
-        /* Add extra elements to ensured aligned operations do not go
-         * beyond the allocated grid size.
-         * Note that for pme_order=5, the pme grid z-size alignment
-         * ensures that we will not go beyond the grid size.
-         */
-        *gridsize += 4;
-    }
-#endif
+#ifdef PME_SIMD
+    /* Add extra elements to ensure aligned operations, which can extend
+     * one SIMD width beyond the end of a grid line, do not go beyond
+     * the allocated grid size.
+     */
+    *gridsize += PME_SIMD_ALIGN;
 #endif
 }
 
@@ -1633,7 +1653,7 @@ static void pmegrid_init(pmegrid_t *grid,
     {
         gridsize = grid->s[XX]*grid->s[YY]*grid->s[ZZ];
         set_gridsize_alignment(&gridsize, pme_order);
-        snew_aligned(grid->grid, gridsize, 16);
+        snew_aligned(grid->grid, gridsize, PME_GRID_ALIGN_BYTES);
     }
     else
     {
@@ -1704,6 +1724,7 @@ static void pmegrids_init(pmegrids_t *grids,
                           int nx, int ny, int nz, int nz_base,
                           int pme_order,
                           int nthread,
+                          gmx_bool bLowMem,
                           int overlap_x,
                           int overlap_y)
 {
@@ -1721,11 +1742,30 @@ static void pmegrids_init(pmegrids_t *grids,
     pmegrid_init(&grids->grid, 0, 0, 0, 0, 0, 0, n[XX], n[YY], n[ZZ], FALSE, pme_order,
                  NULL);
 
-    grids->nthread = nthread;
+    grids->nthread  = nthread;
+    grids->bLowMem  = bLowMem;
+    grids->grid_th  = NULL;
+    grids->grid_all = NULL;
 
-    make_subgrid_division(n_base, pme_order-1, grids->nthread, grids->nc);
+    if (bLowMem)
+    {
+        /* All threads spread on grids->grid, each thread owns a slab in x */
+        grids->nc[XX] = grids->nthread;
+        grids->nc[YY] = 1;
+        grids->nc[ZZ] = 1;
 
-    if (grids->nthread > 1)
+        if (debug)
+        {
+            fprintf(debug, "pmegrid low-memory thread division: %d x 1 x 1\n",
+                    grids->nc[XX]);
+        }
+    }
+    else
+    {
+        make_subgrid_division(n_base, pme_order-1, grids->nthread, grids->nc);
+    }
+
+    if (grids->nthread > 1 && !bLowMem)
     {
         ivec nst;
         int gridsize;
@@ -1751,7 +1791,7 @@ static void pmegrids_init(pmegrids_t *grids,
         set_gridsize_alignment(&gridsize, pme_order);
         snew_aligned(grids->grid_all,
                      grids->nthread*gridsize+(grids->nthread+1)*GMX_CACHE_SEP,
-                     16);
+                     PME_GRID_ALIGN_BYTES);
 
         for (x = 0; x < grids->nc[XX]; x++)
         {
@@ -1826,18 +1866,14 @@ static void pmegrids_init(pmegrids_t *grids,
 
 static void pmegrids_destroy(pmegrids_t *grids)
 {
-    int t;
-
     if (grids->grid.grid != NULL)
     {
-        sfree(grids->grid.grid);
+        sfree_aligned(grids->grid.grid);
 
-        if (grids->nthread > 0)
+        if (grids->grid_th != NULL)
         {
-            for (t = 0; t < grids->nthread; t++)
-            {
-                sfree(grids->grid_th[t].grid);
-            }
+            /* The thread grids point into grid_all */
+            sfree_aligned(grids->grid_all);
             sfree(grids->grid_th);
         }
     }
@@ -1853,8 +1889,9 @@ static void realloc_work(pme_work_t *work, int nkx)
         srenew(work->mhy, work->nalloc);
         srenew(work->mhz, work->nalloc);
         srenew(work->m2, work->nalloc);
-        /* Allocate an aligned pointer for SSE operations, including 3 extra
-         * elements at the end since SSE operates on 4 elements at a time.
+        /* Allocate an aligned pointer for SIMD operations, including 3 extra
+         * elements at the end since 128-bit SIMD operates on up to 4 elements
+         * at a time.
          */
         sfree_aligned(work->denom);
         sfree_aligned(work->tmp1);
@@ -1880,28 +1917,25 @@ static void free_work(pme_work_t *work)
 }
 
 
-#ifdef PME_SSE
-/* Calculate exponentials through SSE in float precision */
+#ifdef PME_SIMD
+/* The work arrays are aligned and padded for 128-bit SIMD */
+#undef GMX_MM256_HERE
+#define GMX_MM128_HERE
+#include "gmx_simd_macros.h"
+
+/* Calculate exponentials through SIMD */
 inline static void calc_exponentials(int start, int end, real f, real *d_aligned, real *r_aligned, real *e_aligned)
 {
+    gmx_mm_pr f_S, d_inv_S, r_S, e_S;
+    int       kx;
+
+    f_S = gmx_set1_pr(f);
+    for (kx = 0; kx < end; kx += GMX_SIMD_WIDTH_HERE)
     {
-        const __m128 two = _mm_set_ps(2.0f, 2.0f, 2.0f, 2.0f);
-        __m128 f_sse;
-        __m128 lu;
-        __m128 tmp_d1, d_inv, tmp_r, tmp_e;
-        int kx;
-        f_sse = _mm_load1_ps(&f);
-        for (kx = 0; kx < end; kx += 4)
-        {
-            tmp_d1   = _mm_load_ps(d_aligned+kx);
-            lu       = _mm_rcp_ps(tmp_d1);
-            d_inv    = _mm_mul_ps(lu, _mm_sub_ps(two, _mm_mul_ps(lu, tmp_d1)));
-            tmp_r    = _mm_load_ps(r_aligned+kx);
-            tmp_r    = gmx_mm_exp_ps(tmp_r);
-            tmp_e    = _mm_mul_ps(f_sse, d_inv);
-            tmp_e    = _mm_mul_ps(tmp_e, tmp_r);
-            _mm_store_ps(e_aligned+kx, tmp_e);
-        }
+        d_inv_S = gmx_inv_pr(gmx_load_pr(d_aligned+kx));
+        r_S     = gmx_exp_pr(gmx_load_pr(r_aligned+kx));
+        e_S     = gmx_mul_pr(gmx_mul_pr(f_S, d_inv_S), r_S);
+        gmx_store_pr(e_aligned+kx, e_S);
     }
 }
 #else
@@ -2294,33 +2328,38 @@ static void gather_f_bsplines(gmx_pme_t pme, real *grid,
             dthy = spline->dtheta[YY] + norder;
             dthz = spline->dtheta[ZZ] + norder;
 
-            switch (order)
+#ifdef PME_SIMD
+            if (work->bSIMD)
             {
-                case 4:
-#ifdef PME_SSE
-#ifdef PME_SSE_UNALIGNED
-#define PME_GATHER_F_SSE_ORDER4
-#else
-#define PME_GATHER_F_SSE_ALIGNED
-#define PME_ORDER 4
-#endif
-#include "pme_sse_single.h"
-#else
-                    DO_FSPLINE(4);
-#endif
-                    break;
-                case 5:
-#ifdef PME_SSE
-#define PME_GATHER_F_SSE_ALIGNED
-#define PME_ORDER 5
-#include "pme_sse_single.h"
-#else
-                    DO_FSPLINE(5);
+                switch (order)
+                {
+                    case 4: pme_gather_simd_4(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 5: pme_gather_simd_5(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 6: pme_gather_simd_6(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 7: pme_gather_simd_7(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 8: pme_gather_simd_8(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 9: pme_gather_simd_9(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 10: pme_gather_simd_10(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 11: pme_gather_simd_11(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    case 12: pme_gather_simd_12(grid, pny, pnz, i0, j0, k0, thx, thy, thz, dthx, dthy, dthz, &fx, &fy, &fz); break;
+                    default: gmx_incons("SIMD PME gathering called with an unsupported order");
+                }
+            }
+            else
 #endif
-                    break;
-                default:
-                    DO_FSPLINE(order);
-                    break;
+            {
+                switch (order)
+                {
+                    case 4:
+                        DO_FSPLINE(4);
+                        break;
+                    case 5:
+                        DO_FSPLINE(5);
+                        break;
+                    default:
+                        DO_FSPLINE(order);
+                        break;
+                }
             }
 
             atc->f[n][XX] += -qn*( fx*nx*rxx );
@@ -2692,15 +2731,12 @@ int gmx_pme_destroy(FILE *log, gmx_pme_t *pmedata)
 
     pmegrids_destroy(&(*pmedata)->pmegridA);
 
-    sfree((*pmedata)->fftgridA);
-    sfree((*pmedata)->cfftgridA);
+    /* The FFT grids are freed with the FFT setup */
     gmx_parallel_3dfft_destroy((*pmedata)->pfft_setupA);
 
     if ((*pmedata)->pmegridB.grid.grid != NULL)
     {
         pmegrids_destroy(&(*pmedata)->pmegridB);
-        sfree((*pmedata)->fftgridB);
-        sfree((*pmedata)->cfftgridB);
         gmx_parallel_3dfft_destroy((*pmedata)->pfft_setupB);
     }
     for (thread = 0; thread < (*pmedata)->nthread; thread++)
@@ -2987,32 +3023,16 @@ static pme_spline_work_t *make_pme_spline_work(int order)
 {
     pme_spline_work_t *work;
 
-#ifdef PME_SSE
-    float  tmp[8];
-    __m128 zero_SSE;
-    int    of, i;
-
-    snew_aligned(work, 1, 16);
-
-    zero_SSE = _mm_setzero_ps();
+    snew(work, 1);
 
-    /* Generate bit masks to mask out the unused grid entries,
-     * as we only operate on order of the 8 grid entries that are
-     * load into 2 SSE float registers.
+#ifdef PME_SIMD
+    /* GMX_PME_NO_SIMD selects the plain C reference implementation,
+     * which is useful for comparing accuracy and performance.
      */
-    for (of = 0; of < 8-(order-1); of++)
-    {
-        for (i = 0; i < 8; i++)
-        {
-            tmp[i] = (i >= of && i < of+order ? 1 : 0);
-        }
-        work->mask_SSE0[of] = _mm_loadu_ps(tmp);
-        work->mask_SSE1[of] = _mm_loadu_ps(tmp+4);
-        work->mask_SSE0[of] = _mm_cmpgt_ps(work->mask_SSE0[of], zero_SSE);
-        work->mask_SSE1[of] = _mm_cmpgt_ps(work->mask_SSE1[of], zero_SSE);
-    }
+    work->bSIMD = (order >= 4 && order <= PME_ORDER_MAX &&
+                   getenv("GMX_PME_NO_SIMD") == NULL);
 #else
-    work = NULL;
+    work->bSIMD = FALSE;
 #endif
 
     return work;
@@ -3057,6 +3077,7 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
 
     pme_atomcomm_t *atc;
     ivec ndata;
+    gmx_bool bLowMem;
 
     if (debug)
     {
@@ -3256,10 +3277,51 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
                       pme->nky,
                       (div_round_up(pme->nkx, pme->nnodes_major)+pme->pme_order+1)*pme->nkz);
 
+    /* The required size of the interpolation grid, including overlap.
+     * The allocated size (pmegrid_n?) might be slightly larger.
+     */
+    pme->pmegrid_nx = pme->overlap[0].s2g1[pme->nodeid_major] -
+        pme->overlap[0].s2g0[pme->nodeid_major];
+    pme->pmegrid_ny = pme->overlap[1].s2g1[pme->nodeid_minor] -
+        pme->overlap[1].s2g0[pme->nodeid_minor];
+    pme->pmegrid_nz_base = pme->nkz;
+    pme->pmegrid_nz      = pme->pmegrid_nz_base + pme->pme_order - 1;
+    set_grid_alignment(&pme->pmegrid_nz, pme->pme_order);
+
+    /* In the low-memory mode the threads spread directly on the node grid
+     * instead of on separate thread-local grids. The FFT then also does
+     * not use extra transpose buffers for the threads.
+     * This requires each half of the x-slab of each thread to be
+     * at least pme_order grid lines wide: an atom spreads on pme_order
+     * x-lines and the aligned SIMD spreading can add zeros up to one
+     * SIMD width beyond the end of a z-line, which from the last y-line
+     * ends up in the next x-line.
+     * The copies between the node grid and the FFT grid remain, as with
+     * a single thread, since only the node grid has the pme_order-1 extra
+     * lines for the periodic and DD overlap; these copies are threaded.
+     */
+    bLowMem = (pme->nthread > 1 && getenv("GMX_PME_LOW_MEMORY") != NULL);
+    if (bLowMem &&
+        (pme->pmegrid_nx - (pme->pme_order - 1))/pme->nthread < 2*pme->pme_order)
+    {
+        if (pme->nodeid == 0)
+        {
+            fprintf(stderr,
+                    "\nNOTE: GMX_PME_LOW_MEMORY is set, but %d PME grid lines along x are\n"
+                    "      too few for %d threads with pme_order %d, not using low memory PME\n\n",
+                    pme->pmegrid_nx - (pme->pme_order - 1), pme->nthread, pme->pme_order);
+        }
+        bLowMem = FALSE;
+    }
+    if (debug)
+    {
+        fprintf(debug, "Using low-memory PME: %s\n", bLowMem ? "yes" : "no");
+    }
+
     /* Check for a limitation of the (current) sum_fftgrid_dd code.
      * We only allow multiple communication pulses in dim 1, not in dim 0.
      */
-    if (pme->nthread > 1 && (pme->overlap[0].noverlap_nodes > 1 ||
+    if (pme->nthread > 1 && !bLowMem && (pme->overlap[0].noverlap_nodes > 1 ||
                              pme->nkx < pme->nnodes_major*pme->pme_order))
     {
         gmx_fatal(FARGS, "The number of PME grid lines per node along x is %g. But when using OpenMP threads, the number of grid lines per node along x and should be >= pme_order (%d). To resolve this issue, use less nodes along x (and possibly more along y and/or z) by specifying -dd manually.",
@@ -3270,17 +3332,6 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
     snew(pme->bsp_mod[YY], pme->nky);
     snew(pme->bsp_mod[ZZ], pme->nkz);
 
-    /* The required size of the interpolation grid, including overlap.
-     * The allocated size (pmegrid_n?) might be slightly larger.
-     */
-    pme->pmegrid_nx = pme->overlap[0].s2g1[pme->nodeid_major] -
-        pme->overlap[0].s2g0[pme->nodeid_major];
-    pme->pmegrid_ny = pme->overlap[1].s2g1[pme->nodeid_minor] -
-        pme->overlap[1].s2g0[pme->nodeid_minor];
-    pme->pmegrid_nz_base = pme->nkz;
-    pme->pmegrid_nz      = pme->pmegrid_nz_base + pme->pme_order - 1;
-    set_grid_alignment(&pme->pmegrid_nz, pme->pme_order);
-
     pme->pmegrid_start_ix = pme->overlap[0].s2g0[pme->nodeid_major];
     pme->pmegrid_start_iy = pme->overlap[1].s2g0[pme->nodeid_minor];
     pme->pmegrid_start_iz = 0;
@@ -3303,6 +3354,7 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
                   pme->pmegrid_nz_base,
                   pme->pme_order,
                   pme->nthread,
+                  bLowMem,
                   pme->overlap[0].s2g1[pme->nodeid_major]-pme->overlap[0].s2g0[pme->nodeid_major+1],
                   pme->overlap[1].s2g1[pme->nodeid_minor]-pme->overlap[1].s2g0[pme->nodeid_minor+1]);
 
@@ -3317,7 +3369,7 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
                             &pme->fftgridA, &pme->cfftgridA,
                             pme->mpi_comm_d,
                             pme->overlap[0].s2g0, pme->overlap[1].s2g0,
-                            bReproducible, pme->nthread);
+                            bReproducible, pme->nthread, bLowMem);
 
     if (bFreeEnergy)
     {
@@ -3326,6 +3378,7 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
                       pme->pmegrid_nz_base,
                       pme->pme_order,
                       pme->nthread,
+                      bLowMem,
                       pme->nkx % pme->nnodes_major != 0,
                       pme->nky % pme->nnodes_minor != 0);
 
@@ -3333,7 +3386,7 @@ int gmx_pme_init(gmx_pme_t *         pmedata,
                                 &pme->fftgridB, &pme->cfftgridB,
                                 pme->mpi_comm_d,
                                 pme->overlap[0].s2g0, pme->overlap[1].s2g0,
-                                bReproducible, pme->nthread);
+                                bReproducible, pme->nthread, bLowMem);
     }
     else
     {
@@ -3398,7 +3451,8 @@ static void reuse_pmegrids(const pmegrids_t *old, pmegrids_t *new)
     sfree_aligned(new->grid.grid);
     new->grid.grid = old->grid.grid;
 
-    if (new->nthread > 1 && new->nthread == old->nthread)
+    if (new->nthread > 1 && new->nthread == old->nthread &&
+        new->grid_th != NULL && old->grid_th != NULL)
     {
         sfree_aligned(new->grid_all);
         for (t = 0; t < new->nthread; t++)
@@ -3882,6 +3936,38 @@ static void sum_fftgrid_dd(gmx_pme_t pme, real *fftgrid)
 }
 
 
+/* Spreads the charges with all threads directly on the node grid.
+ * Each thread owns a slab along x, which is split in two halves.
+ * Atoms spread on pme_order-1 lines beyond their half and the aligned
+ * SIMD kernels can add zeros to the start of one more line.
+ * As each half is at least pme_order grid lines wide, spreading
+ * the atoms of all lower halves cannot conflict between threads.
+ * After a barrier all upper halves are spread, again without conflicts.
+ */
+static void spread_q_bsplines_lowmem(gmx_pme_t pme, pme_atomcomm_t *atc,
+                                     pmegrids_t *grids, int thread)
+{
+    pmegrid_t *grid;
+    int        n, x0, x1, xm;
+
+    grid = &grids->grid;
+    n    = grid->n[XX] - (grid->order - 1);
+    x0   = (n*thread      )/grids->nthread;
+    x1   = (n*(thread + 1))/grids->nthread;
+    xm   = (x0 + x1)/2;
+
+    /* Clear our own slab, the last thread also clears the overlap */
+    clear_pmegrid_x(grid, x0, thread == grids->nthread - 1 ? grid->n[XX] : x1);
+#pragma omp barrier
+
+    spread_q_bsplines_thread(grid, atc, &atc->spline[thread], pme->spline_work,
+                             x0, xm);
+#pragma omp barrier
+
+    spread_q_bsplines_thread(grid, atc, &atc->spline[thread], pme->spline_work,
+                             xm, x1);
+}
+
 static void spread_on_grid(gmx_pme_t pme,
                            pme_atomcomm_t *atc, pmegrids_t *grids,
                            gmx_bool bCalcSplines, gmx_bool bSpread,
@@ -3946,7 +4032,7 @@ static void spread_on_grid(gmx_pme_t pme,
 
             make_thread_local_ind(atc, thread, spline);
 
-            grid = &grids->grid_th[thread];
+            grid = (grids->bLowMem ? &grids->grid : &grids->grid_th[thread]);
         }
 
         if (bCalcSplines)
@@ -3955,13 +4041,15 @@ static void spread_on_grid(gmx_pme_t pme,
                           atc->fractx, spline->n, spline->ind, atc->q, pme->bFEP);
         }
 
-        if (bSpread)
+        if (bSpread && !grids->bLowMem)
         {
             /* put local atoms on grid. */
 #ifdef PME_TIME_SPREAD
             ct1a = omp_cyc_start();
 #endif
-            spread_q_bsplines_thread(grid, atc, spline, pme->spline_work);
+            clear_pmegrid_x(grid, 0, grid->s[XX]);
+            spread_q_bsplines_thread(grid, atc, spline, pme->spline_work,
+                                     0, grid->offset[XX] + grid->n[XX]);
 
             if (grids->nthread > 1)
             {
@@ -3973,12 +4061,20 @@ static void spread_on_grid(gmx_pme_t pme,
 #endif
         }
     }
+
+    if (bSpread && grids->bLowMem)
+    {
+#pragma omp parallel num_threads(nthread)
+        {
+            spread_q_bsplines_lowmem(pme, atc, grids, gmx_omp_get_thread_num());
+        }
+    }
 #ifdef PME_TIME_THREADS
     c2   = omp_cyc_end(c2);
     cs2 += (double)c2;
 #endif
 
-    if (bSpread && grids->nthread > 1)
+    if (bSpread && grids->nthread > 1 && !grids->bLowMem)
     {
 #ifdef PME_TIME_THREADS
         c3 = omp_cyc_start();
@@ -4408,7 +4504,7 @@ int gmx_pme_do(gmx_pme_t pme,
             inc_nrnb(nrnb, eNR_SPREADQBSP,
                      pme->pme_order*pme->pme_order*pme->pme_order*atc->n);
 
-            if (pme->nthread == 1)
+            if (pme->nthread == 1 || pmegrid->bLowMem)
             {
                 wrap_periodic_pmegrid(pme, grid);
 
@@ -0,0 +1,308 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 1991-2000, University of Groningen, The Netherlands.
+ * Copyright (c) 2001-2012, The GROMACS Development Team
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/* This include file contains SIMD versions of the B-spline charge
+ * spreading and force gathering for a single atom, for a PME order
+ * fixed at compile time, so all loops can be fully unrolled.
+ * It should be included once for each supported order, with PME_ORDER
+ * set to that order. The functions are called pme_spread_simd_<order>
+ * and pme_gather_simd_<order>.
+ *
+ * Included without PME_ORDER set, it only defines, when SIMD support
+ * is available, PME_SIMD and:
+ * PME_SIMD_WIDTH_128   the number of reals in a 128-bit SIMD register
+ * PME_SIMD_WIDTH_256   the same for 256-bit, undefined without
+ *                      256-bit SIMD support
+ * PME_SIMD_UNALIGNED   1 when unaligned grid loads/stores are allowed
+ *                      when they avoid masking, 0 otherwise
+ * PME_SIMD_ALIGN       the grid alignment in reals
+ *
+ * The SIMD operations run along z. When the order is a multiple of
+ * the SIMD width and PME_SIMD_UNALIGNED=1, we load exactly order
+ * elements with unaligned loads. Otherwise we use aligned loads
+ * starting at the aligned grid element at or below k0 and zero the
+ * spline coefficients outside k0 to k0+order-1. With a fixed number
+ * of registers this can touch up to one SIMD width of grid elements
+ * beyond the aligned end of the line, where only zero is added.
+ * The grid should therefore be aligned to the largest SIMD width, its
+ * z-stride should be a multiple of it and its allocation should be
+ * padded by one SIMD width.
+ * For each order the width is chosen which needs the fewest SIMD
+ * operations per grid line; on a tie the narrower width is used.
+ */
+
+#ifndef GMX_MDLIB_PME_SIMD_H
+#define GMX_MDLIB_PME_SIMD_H
+
+#ifdef GMX_X86_SSE2
+#define PME_SIMD
+#ifndef GMX_DOUBLE
+#define PME_SIMD_WIDTH_128  4
+#ifdef GMX_X86_AVX_256
+#define PME_SIMD_WIDTH_256  8
+#endif
+#else
+#define PME_SIMD_WIDTH_128  2
+#ifdef GMX_X86_AVX_256
+#define PME_SIMD_WIDTH_256  4
+#endif
+#endif
+/* Some old AMD processors could have problems with unaligned loads+stores */
+#ifndef GMX_FAHCORE
+#define PME_SIMD_UNALIGNED  1
+#else
+#define PME_SIMD_UNALIGNED  0
+#endif
+/* The grid alignment, in reals, required by the widest SIMD width */
+#ifdef PME_SIMD_WIDTH_256
+#define PME_SIMD_ALIGN      PME_SIMD_WIDTH_256
+#else
+#define PME_SIMD_ALIGN      PME_SIMD_WIDTH_128
+#endif
+#endif
+
+#endif /* GMX_MDLIB_PME_SIMD_H */
+
+#ifdef PME_ORDER
+
+/* The number of SIMD registers needed to cover a grid line along z */
+#define PME_SIMD_NREG(w) ((PME_SIMD_UNALIGNED && PME_ORDER % (w) == 0) ? PME_ORDER/(w) : (PME_ORDER + 2*(w) - 2)/(w))
+
+#undef GMX_MM128_HERE
+#undef GMX_MM256_HERE
+#undef PME_SIMD_W
+#ifdef PME_SIMD_WIDTH_256
+#if PME_SIMD_NREG(PME_SIMD_WIDTH_256) < PME_SIMD_NREG(PME_SIMD_WIDTH_128)
+#define GMX_MM256_HERE
+#define PME_SIMD_W  PME_SIMD_WIDTH_256
+#endif
+#endif
+#ifndef PME_SIMD_W
+#define GMX_MM128_HERE
+#define PME_SIMD_W  PME_SIMD_WIDTH_128
+#endif
+
+#include "gmx_simd_macros.h"
+
+#undef PME_SIMD_NVEC
+#undef PME_SIMD_ALIGNED
+#define PME_SIMD_NVEC  PME_SIMD_NREG(PME_SIMD_W)
+#if !(PME_SIMD_UNALIGNED && PME_ORDER % PME_SIMD_W == 0)
+#define PME_SIMD_ALIGNED
+#endif
+
+#undef PME_SIMD_FUNC_2
+#undef PME_SIMD_FUNC_1
+#undef PME_SIMD_FUNC
+#define PME_SIMD_FUNC_2(name, order) name ## _ ## order
+#define PME_SIMD_FUNC_1(name, order) PME_SIMD_FUNC_2(name, order)
+#define PME_SIMD_FUNC(name)          PME_SIMD_FUNC_1(name, PME_ORDER)
+
+static gmx_inline void
+PME_SIMD_FUNC(pme_spread_simd)(real *grid, int pny, int pnz,
+                               int i0, int j0, int k0, real qn,
+                               const real *thx, const real *thy,
+                               const real *thz)
+{
+    int       ithx, ithy, iz, index;
+    gmx_mm_pr vx_S, ty_S[PME_ORDER], tz_S[PME_SIMD_NVEC], vx_tz_S[PME_SIMD_NVEC];
+    gmx_mm_pr gri_S;
+#ifdef PME_SIMD_ALIGNED
+    real      tz_buf[PME_SIMD_NVEC*PME_SIMD_W];
+    int       offset;
+
+    /* Start at the aligned grid element at or below k0 and put the
+     * spline coefficients at their place in a zeroed buffer.
+     */
+    offset = k0 & (PME_SIMD_W - 1);
+    k0    -= offset;
+    for (iz = 0; iz < PME_SIMD_NVEC*PME_SIMD_W; iz++)
+    {
+        tz_buf[iz] = 0;
+    }
+    for (iz = 0; iz < PME_ORDER; iz++)
+    {
+        tz_buf[offset+iz] = thz[iz];
+    }
+    thz = tz_buf;
+#endif
+
+    for (iz = 0; iz < PME_SIMD_NVEC; iz++)
+    {
+        tz_S[iz] = gmx_loadu_pr(thz + iz*PME_SIMD_W);
+    }
+    for (ithy = 0; ithy < PME_ORDER; ithy++)
+    {
+        ty_S[ithy] = gmx_set1_pr(thy[ithy]);
+    }
+
+    for (ithx = 0; ithx < PME_ORDER; ithx++)
+    {
+        vx_S = gmx_set1_pr(qn*thx[ithx]);
+        for (iz = 0; iz < PME_SIMD_NVEC; iz++)
+        {
+            vx_tz_S[iz] = gmx_mul_pr(vx_S, tz_S[iz]);
+        }
+
+        for (ithy = 0; ithy < PME_ORDER; ithy++)
+        {
+            index = ((i0 + ithx)*pny + j0 + ithy)*pnz + k0;
+
+            for (iz = 0; iz < PME_SIMD_NVEC; iz++)
+            {
+#ifdef PME_SIMD_ALIGNED
+                gri_S = gmx_load_pr(grid + index + iz*PME_SIMD_W);
+                gri_S = gmx_add_pr(gri_S, gmx_mul_pr(vx_tz_S[iz], ty_S[ithy]));
+                gmx_store_pr(grid + index + iz*PME_SIMD_W, gri_S);
+#else
+                gri_S = gmx_loadu_pr(grid + index + iz*PME_SIMD_W);
+                gri_S = gmx_add_pr(gri_S, gmx_mul_pr(vx_tz_S[iz], ty_S[ithy]));
+                gmx_storeu_pr(grid + index + iz*PME_SIMD_W, gri_S);
+#endif
+            }
+        }
+    }
+}
+
+static gmx_inline void
+PME_SIMD_FUNC(pme_gather_simd)(const real *grid, int pny, int pnz,
+                               int i0, int j0, int k0,
+                               const real *thx, const real *thy,
+                               const real *thz,
+                               const real *dthx, const real *dthy,
+                               const real *dthz,
+                               real *fx, real *fy, real *fz)
+{
+    int       ithx, ithy, iz, index, i;
+    gmx_mm_pr fx_S, fy_S, fz_S;
+    gmx_mm_pr tx_S, ty_S, dx_S, dy_S;
+    gmx_mm_pr tz_S[PME_SIMD_NVEC], dz_S[PME_SIMD_NVEC];
+    gmx_mm_pr gval_S, fxy1_S, fz1_S;
+    real      f_buf[PME_SIMD_W], fsum;
+#ifdef PME_SIMD_ALIGNED
+    real      tz_buf[PME_SIMD_NVEC*PME_SIMD_W];
+    real      dz_buf[PME_SIMD_NVEC*PME_SIMD_W];
+    int       offset;
+
+    offset = k0 & (PME_SIMD_W - 1);
+    k0    -= offset;
+    for (iz = 0; iz < PME_SIMD_NVEC*PME_SIMD_W; iz++)
+    {
+        tz_buf[iz] = 0;
+        dz_buf[iz] = 0;
+    }
+    for (iz = 0; iz < PME_ORDER; iz++)
+    {
+        tz_buf[offset+iz] = thz[iz];
+        dz_buf[offset+iz] = dthz[iz];
+    }
+    thz  = tz_buf;
+    dthz = dz_buf;
+#endif
+
+    for (iz = 0; iz < PME_SIMD_NVEC; iz++)
+    {
+        tz_S[iz] = gmx_loadu_pr(thz  + iz*PME_SIMD_W);
+        dz_S[iz] = gmx_loadu_pr(dthz + iz*PME_SIMD_W);
+    }
+
+    fx_S = gmx_setzero_pr();
+    fy_S = gmx_setzero_pr();
+    fz_S = gmx_setzero_pr();
+
+    for (ithx = 0; ithx < PME_ORDER; ithx++)
+    {
+        tx_S = gmx_set1_pr(thx[ithx]);
+        dx_S = gmx_set1_pr(dthx[ithx]);
+
+        for (ithy = 0; ithy < PME_ORDER; ithy++)
+        {
+            index = ((i0 + ithx)*pny + j0 + ithy)*pnz + k0;
+            ty_S  = gmx_set1_pr(thy[ithy]);
+            dy_S  = gmx_set1_pr(dthy[ithy]);
+
+#ifdef PME_SIMD_ALIGNED
+            gval_S = gmx_load_pr(grid + index);
+#else
+            gval_S = gmx_loadu_pr(grid + index);
+#endif
+            fxy1_S = gmx_mul_pr(tz_S[0], gval_S);
+            fz1_S  = gmx_mul_pr(dz_S[0], gval_S);
+            for (iz = 1; iz < PME_SIMD_NVEC; iz++)
+            {
+#ifdef PME_SIMD_ALIGNED
+                gval_S = gmx_load_pr(grid + index + iz*PME_SIMD_W);
+#else
+                gval_S = gmx_loadu_pr(grid + index + iz*PME_SIMD_W);
+#endif
+                fxy1_S = gmx_add_pr(fxy1_S, gmx_mul_pr(tz_S[iz], gval_S));
+                fz1_S  = gmx_add_pr(fz1_S, gmx_mul_pr(dz_S[iz], gval_S));
+            }
+
+            fx_S = gmx_add_pr(fx_S, gmx_mul_pr(gmx_mul_pr(dx_S, ty_S), fxy1_S));
+            fy_S = gmx_add_pr(fy_S, gmx_mul_pr(gmx_mul_pr(tx_S, dy_S), fxy1_S));
+            fz_S = gmx_add_pr(fz_S, gmx_mul_pr(gmx_mul_pr(tx_S, ty_S), fz1_S));
+        }
+    }
+
+    gmx_storeu_pr(f_buf, fx_S);
+    fsum = f_buf[0];
+    for (i = 1; i < PME_SIMD_W; i++)
+    {
+        fsum += f_buf[i];
+    }
+    *fx += fsum;
+    gmx_storeu_pr(f_buf, fy_S);
+    fsum = f_buf[0];
+    for (i = 1; i < PME_SIMD_W; i++)
+    {
+        fsum += f_buf[i];
+    }
+    *fy += fsum;
+    gmx_storeu_pr(f_buf, fz_S);
+    fsum = f_buf[0];
+    for (i = 1; i < PME_SIMD_W; i++)
+    {
+        fsum += f_buf[i];
+    }
+    *fz += fsum;
+}
+
+#undef PME_SIMD_NREG
+#undef PME_ORDER
+
+#endif /* PME_ORDER */
@@ -493,7 +493,7 @@ static void pme_receive_force_ener(FILE           *fplog,
                                    t_forcerec     *fr)
 {
     real   e, v, dvdl;
-    float  cycles_ppdpme, cycles_seppme;
+    float  cycles_ppdpme, cycles_seppme, cycles_wait;
 
     cycles_ppdpme = wallcycle_stop(wcycle, ewcPPDURINGPME);
     dd_cycles_add(cr->dd, cycles_ppdpme, ddCyclPPduringPME);
@@ -503,8 +503,8 @@ static void pme_receive_force_ener(FILE           *fplog,
      */
     wallcycle_start(wcycle, ewcPP_PMEWAITRECVF);
     dvdl = 0;
-    gmx_pme_receive_f(cr, fr->f_novirsum, fr->vir_el_recip, &e, &dvdl,
-                      &cycles_seppme);
+    gmx_pme_receive_f(cr, fr->bPMEMTS ? fr->f_twin : fr->f_novirsum,
+                      fr->vir_el_recip, &e, &dvdl, &cycles_seppme);
     if (bSepDVDL)
     {
         fprintf(fplog, sepdvdlformat, "PME mesh", e, dvdl);
@@ -515,7 +515,11 @@ static void pme_receive_force_ener(FILE           *fplog,
     {
         dd_cycles_add(cr->dd, cycles_seppme, ddCyclPME);
     }
-    wallcycle_stop(wcycle, ewcPP_PMEWAITRECVF);
+    cycles_wait = wallcycle_stop(wcycle, ewcPP_PMEWAITRECVF);
+    if (wcycle)
+    {
+        dd_cycles_add(cr->dd, cycles_wait, ddCyclWaitPME);
+    }
 }
 
 static void print_large_forces(FILE *fp, t_mdatoms *md, t_commrec *cr,
@@ -748,6 +752,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     double              mu[2*DIM];
     gmx_bool            bSepDVDL, bStateChanged, bNS, bFillGrid, bCalcCGCM, bBS;
     gmx_bool            bDoLongRange, bDoForces, bSepLRF, bUseGPU, bUseOrEmulGPU;
+    gmx_bool            bOverlapX, bDoPMEMesh;
     gmx_bool            bDiffKernels = FALSE;
     matrix              boxs;
     rvec                vzero, box_diag;
@@ -789,6 +794,14 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     bSepLRF       = (bDoLongRange && bDoForces && (flags & GMX_FORCE_SEPLRF));
     bUseGPU       = fr->nbv->bUseGPU;
     bUseOrEmulGPU = bUseGPU || (nbv->grp[0].kernel_type == nbnxnk8x8x8_PlainC);
+    /* With DD on the CPU we can overlap the halo coordinate communication
+     * with the local non-bonded kernel, except at search steps.
+     */
+    bOverlapX     = (DOMAINDECOMP(cr) && cr->dd->bOverlapX &&
+                     cr->dd->ndim > 0 && !cr->dd->bSendRecv2 &&
+                     !bNS && !bUseOrEmulGPU);
+    /* With PME multiple time stepping we skip the mesh part at most steps */
+    bDoPMEMesh    = pme_mesh_step(fr, inputrec, step, flags);
 
     if (bStateChanged)
     {
@@ -830,7 +843,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                                  fr->shift_vec, nbv->grp[0].nbat);
 
 #ifdef GMX_MPI
-    if (!(cr->duty & DUTY_PME))
+    if (!(cr->duty & DUTY_PME) && bDoPMEMesh)
     {
         /* Send particle coordinates to the pme nodes.
          * Since this is only implemented for domain decomposition
@@ -1020,7 +1033,17 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         else
         {
             wallcycle_start(wcycle, ewcMOVEX);
-            dd_move_x(cr->dd, box, x);
+            if (bOverlapX)
+            {
+                /* Completed by dd_move_x_finish after the local
+                 * non-bonded kernel has been called.
+                 */
+                dd_move_x_start(cr->dd, box, x);
+            }
+            else
+            {
+                dd_move_x(cr->dd, box, x);
+            }
 
             /* When we don't need the total dipole we sum it in global_stat */
             if (bStateChanged && NEED_MUTOT(*inputrec))
@@ -1029,12 +1052,15 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             }
             wallcycle_stop(wcycle, ewcMOVEX);
 
-            wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
-            wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
-            nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
-                                            nbv->grp[eintNonlocal].nbat);
-            wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
-            cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+            if (!bOverlapX)
+            {
+                wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+                wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+                nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                                nbv->grp[eintNonlocal].nbat);
+                wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+                cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+            }
         }
 
         if (bUseGPU && !bDiffKernels)
@@ -1098,7 +1124,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     {
         if (!(cr->duty & DUTY_PME))
         {
-            wallcycle_start(wcycle, ewcPPDURINGPME);
+            if (bDoPMEMesh)
+            {
+                wallcycle_start(wcycle, ewcPPDURINGPME);
+            }
             dd_force_flop_start(cr->dd, nrnb);
         }
     }
@@ -1139,13 +1168,38 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
         /* Clear the short- and long-range forces */
         clear_rvecs(fr->natoms_force_constr, f);
-        if (bSepLRF && do_per_step(step, inputrec->nstcalclr))
+        if ((bSepLRF && do_per_step(step, inputrec->nstcalclr)) ||
+            (fr->bPMEMTS && bDoPMEMesh))
         {
             clear_rvecs(fr->natoms_force_constr, fr->f_twin);
         }
 
         clear_rvec(fr->vir_diag_posres);
     }
+
+    if (bOverlapX)
+    {
+        /* The local non-bonded kernel only uses home atoms,
+         * so it can run while the halo coordinates are underway.
+         */
+        do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
+                     nrnb, wcycle);
+
+        /* Bondeds, PME and the non-local kernel need the halo */
+        cycles_force += wallcycle_stop(wcycle, ewcFORCE);
+        wallcycle_start_nocount(wcycle, ewcMOVEX);
+        dd_move_x_finish(cr->dd, box, x);
+        wallcycle_stop(wcycle, ewcMOVEX);
+
+        wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+        nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                        nbv->grp[eintNonlocal].nbat);
+        wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+        cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_start_nocount(wcycle, ewcFORCE);
+    }
+
     if (inputrec->ePull == epullCONSTRAINT)
     {
         clear_pull_forces(inputrec->pull);
@@ -1183,7 +1237,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         }
     }
 
-    if (!bUseOrEmulGPU)
+    if (!bUseOrEmulGPU && !bOverlapX)
     {
         /* Maybe we should move this into do_force_lowlevel */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
@@ -1399,7 +1453,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                                f, vir_force, mdatoms, enerd, lambda, t);
     }
 
-    if (PAR(cr) && !(cr->duty & DUTY_PME))
+    if (PAR(cr) && !(cr->duty & DUTY_PME) && bDoPMEMesh)
     {
         /* In case of node-splitting, the PP nodes receive the long-range
          * forces, virial and energy from the PME nodes here.
@@ -1407,6 +1461,29 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         pme_receive_force_ener(fplog, bSepDVDL, cr, wcycle, enerd, fr);
     }
 
+    if (bDoForces && fr->bPMEMTS && bDoPMEMesh)
+    {
+        /* The PME mesh forces are in f_twin, so update can apply them
+         * as an impulse. They do not contribute to the single sum virial.
+         */
+        if (vsite)
+        {
+            wallcycle_start(wcycle, ewcVSITESPREAD);
+            spread_vsite_f(fplog, vsite, x, fr->f_twin, NULL,
+                           (flags & GMX_FORCE_VIRIAL), fr->vir_el_recip,
+                           nrnb,
+                           &top->idef, fr->ePBC, fr->bMolPBC, graph, box, cr);
+            wallcycle_stop(wcycle, ewcVSITESPREAD);
+        }
+        /* At steps where we only need the mesh energy or virial,
+         * the mesh forces should not enter the dynamics.
+         */
+        if (pme_mesh_impulse_step(fr, inputrec, step))
+        {
+            sum_forces(start, start+homenr, f, fr->f_twin);
+        }
+    }
+
     if (bDoForces)
     {
         post_process_forces(fplog, cr, step, nrnb, wcycle,
@@ -69,6 +69,7 @@
 #include "md_support.h"
 #include "mdrun.h"
 #include "sim_util.h"
+#include "thread_mpi/threads.h"
 
 typedef struct gmx_global_stat
 {
@@ -441,6 +442,212 @@ static void moveit(t_commrec *cr,
                xx, NULL, (cr->nnodes-cr->npmenodes)-1, NULL);
 }
 
+/* The number of output jobs that can be queued for the writer thread */
+#define MDOUTF_NJOB 2
+
+/* A trajectory frame and/or checkpoint to be written by the writer thread */
+typedef struct
+{
+    int              mdof_flags; /* what to write, MDOF_CPT means finish
+                                    the checkpoint in fp_cpt */
+    gmx_large_int_t  step;
+    double           t;
+    real             lambda;
+    matrix           box;
+    int              natoms;
+    rvec            *x;          /* the trn output data, natoms entries,
+                                    allocated on first use */
+    rvec            *v;
+    rvec            *f;
+    int              n_xtc;
+    rvec            *x_xtc;      /* the xtc output coordinates */
+    t_fileio        *fp_cpt;     /* the checkpoint file to finish */
+    char            *fn_cpt;     /* the temporary name of fp_cpt */
+} t_mdoutf_job;
+
+typedef struct gmx_mdoutf_writer
+{
+    gmx_mdoutf_t        *of;
+    tMPI_Thread_t        thread;
+    tMPI_Thread_mutex_t  mtx;
+    tMPI_Thread_cond_t   cond;
+    t_mdoutf_job         job[MDOUTF_NJOB];
+    int                  head;    /* the first queued job */
+    int                  nqueued; /* the number of jobs queued or being written */
+    gmx_bool             bStop;
+} t_gmx_mdoutf_writer;
+
+static void write_trn_frame(gmx_mdoutf_t *of, gmx_large_int_t step, double t,
+                            real lambda, matrix box, int natoms,
+                            rvec *x, rvec *v, rvec *f)
+{
+    fwrite_trn(of->fp_trn, step, t, lambda, box, natoms, x, v, f);
+    if (gmx_fio_flush(of->fp_trn) != 0)
+    {
+        gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+    }
+    gmx_fio_check_file_position(of->fp_trn);
+}
+
+static void write_xtc_frame(gmx_mdoutf_t *of, int n_xtc,
+                            gmx_large_int_t step, double t,
+                            matrix box, rvec *x_xtc)
+{
+    if (write_xtc(of->fp_xtc, n_xtc, step, t, box, x_xtc, of->xtc_prec) == 0)
+    {
+        gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+    }
+    gmx_fio_check_file_position(of->fp_xtc);
+}
+
+static void write_job(gmx_mdoutf_t *of, t_mdoutf_job *job)
+{
+    if (job->mdof_flags & MDOF_CPT)
+    {
+        finish_checkpoint(job->fp_cpt, job->fn_cpt,
+                          of->fn_cpt, of->bKeepAndNumCPT);
+    }
+    if (job->mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+    {
+        write_trn_frame(of, job->step, job->t, job->lambda, job->box,
+                        job->natoms,
+                        (job->mdof_flags & MDOF_X) ? job->x : NULL,
+                        (job->mdof_flags & MDOF_V) ? job->v : NULL,
+                        (job->mdof_flags & MDOF_F) ? job->f : NULL);
+    }
+    if (job->mdof_flags & MDOF_XTC)
+    {
+        write_xtc_frame(of, job->n_xtc, job->step, job->t, job->box,
+                        job->x_xtc);
+    }
+}
+
+static void *mdoutf_writer_thread(void *arg)
+{
+    t_gmx_mdoutf_writer *w;
+    t_mdoutf_job        *job;
+
+    w = (t_gmx_mdoutf_writer *)arg;
+
+    tMPI_Thread_mutex_lock(&w->mtx);
+    while (TRUE)
+    {
+        while (w->nqueued == 0 && !w->bStop)
+        {
+            tMPI_Thread_cond_wait(&w->cond, &w->mtx);
+        }
+        if (w->nqueued == 0)
+        {
+            /* We should stop and all jobs have been written */
+            break;
+        }
+        job = &w->job[w->head];
+        tMPI_Thread_mutex_unlock(&w->mtx);
+
+        write_job(w->of, job);
+
+        tMPI_Thread_mutex_lock(&w->mtx);
+        w->head = (w->head + 1) % MDOUTF_NJOB;
+        w->nqueued--;
+        tMPI_Thread_cond_broadcast(&w->cond);
+    }
+    tMPI_Thread_mutex_unlock(&w->mtx);
+
+    return NULL;
+}
+
+/* Returns the next free job, waits when all jobs are queued */
+static t_mdoutf_job *writer_get_free_job(t_gmx_mdoutf_writer *w)
+{
+    t_mdoutf_job *job;
+
+    tMPI_Thread_mutex_lock(&w->mtx);
+    while (w->nqueued == MDOUTF_NJOB)
+    {
+        tMPI_Thread_cond_wait(&w->cond, &w->mtx);
+    }
+    job = &w->job[(w->head + w->nqueued) % MDOUTF_NJOB];
+    tMPI_Thread_mutex_unlock(&w->mtx);
+
+    return job;
+}
+
+/* Queues the job returned by the last call to writer_get_free_job */
+static void writer_push_job(t_gmx_mdoutf_writer *w)
+{
+    tMPI_Thread_mutex_lock(&w->mtx);
+    w->nqueued++;
+    tMPI_Thread_cond_broadcast(&w->cond);
+    tMPI_Thread_mutex_unlock(&w->mtx);
+}
+
+/* Waits until all queued jobs have been written */
+static void writer_wait_idle(t_gmx_mdoutf_writer *w)
+{
+    tMPI_Thread_mutex_lock(&w->mtx);
+    while (w->nqueued > 0)
+    {
+        tMPI_Thread_cond_wait(&w->cond, &w->mtx);
+    }
+    tMPI_Thread_mutex_unlock(&w->mtx);
+}
+
+static gmx_mdoutf_writer_t init_writer(gmx_mdoutf_t *of)
+{
+#ifdef GMX_THREAD_MPI
+    t_gmx_mdoutf_writer *w;
+
+    if (tMPI_Thread_support() != TMPI_THREAD_SUPPORT_YES)
+    {
+        return NULL;
+    }
+
+    snew(w, 1);
+    w->of      = of;
+    w->head    = 0;
+    w->nqueued = 0;
+    w->bStop   = FALSE;
+    tMPI_Thread_mutex_init(&w->mtx);
+    tMPI_Thread_cond_init(&w->cond);
+    if (tMPI_Thread_create(&w->thread, mdoutf_writer_thread, w) != 0)
+    {
+        tMPI_Thread_cond_destroy(&w->cond);
+        tMPI_Thread_mutex_destroy(&w->mtx);
+        sfree(w);
+        w = NULL;
+    }
+
+    return w;
+#else
+    /* Without thread-MPI gmxfio does not lock its list of open files,
+     * so all files need to be accessed from the same thread.
+     */
+    return NULL;
+#endif
+}
+
+static void done_writer(t_gmx_mdoutf_writer *w)
+{
+    int i;
+
+    tMPI_Thread_mutex_lock(&w->mtx);
+    w->bStop = TRUE;
+    tMPI_Thread_cond_broadcast(&w->cond);
+    tMPI_Thread_mutex_unlock(&w->mtx);
+    tMPI_Thread_join(w->thread, NULL);
+
+    tMPI_Thread_cond_destroy(&w->cond);
+    tMPI_Thread_mutex_destroy(&w->mtx);
+    for (i = 0; i < MDOUTF_NJOB; i++)
+    {
+        sfree(w->job[i].x);
+        sfree(w->job[i].v);
+        sfree(w->job[i].f);
+        sfree(w->job[i].x_xtc);
+    }
+    sfree(w);
+}
+
 gmx_mdoutf_t *init_mdoutf(int nfile, const t_filenm fnm[], int mdrun_flags,
                           const t_commrec *cr, const t_inputrec *ir,
                           const output_env_t oenv)
@@ -456,18 +663,23 @@ gmx_mdoutf_t *init_mdoutf(int nfile, const t_filenm fnm[], int mdrun_flags,
     of->fp_xtc   = NULL;
     of->fp_dhdl  = NULL;
     of->fp_field = NULL;
+    of->writer   = NULL;
 
     of->eIntegrator     = ir->eI;
     of->bExpanded       = ir->bExpanded;
     of->elamstats       = ir->expandedvals->elamstats;
     of->simulation_part = ir->simulation_part;
 
+    /* With distributed checkpointing all PP nodes write checkpoint files */
+    of->fn_cpt         = opt2fn("-cpo", nfile, fnm);
+    of->bKeepAndNumCPT = (mdrun_flags & MD_KEEPANDNUMCPT);
+    of->bCPTParts      = (DOMAINDECOMP(cr) && (mdrun_flags & MD_CPTPARTS));
+    of->ncpt_part_step = 0;
+
     if (MASTER(cr))
     {
         bAppendFiles = (mdrun_flags & MD_APPENDFILES);
 
-        of->bKeepAndNumCPT = (mdrun_flags & MD_KEEPANDNUMCPT);
-
         sprintf(filemode, bAppendFiles ? "a+" : "w+");
 
         if ((EI_DYNAMICS(ir->eI) || EI_ENERGY_MINIMIZATION(ir->eI))
@@ -492,7 +704,6 @@ gmx_mdoutf_t *init_mdoutf(int nfile, const t_filenm fnm[], int mdrun_flags,
         {
             of->fp_ene = open_enx(ftp2fn(efEDR, nfile, fnm), filemode);
         }
-        of->fn_cpt = opt2fn("-cpo", nfile, fnm);
 
         if ((ir->efep != efepNO || ir->bSimTemp) && ir->fepvals->nstdhdl > 0 &&
             (ir->fepvals->separate_dhdl_file == esepdhdlfileYES ) &&
@@ -523,6 +734,16 @@ gmx_mdoutf_t *init_mdoutf(int nfile, const t_filenm fnm[], int mdrun_flags,
                                         "E (V/nm)", oenv);
             }
         }
+
+#ifndef GMX_FAHCORE
+        /* Write the trajectory frames and sync the checkpoints to disk
+         * on a separate thread, so the MD steps do not wait for this.
+         */
+        if (EI_DYNAMICS(ir->eI) && getenv("GMX_NO_ASYNC_OUTPUT") == NULL)
+        {
+            of->writer = init_writer(of);
+        }
+#endif
     }
 
     return of;
@@ -530,6 +751,11 @@ gmx_mdoutf_t *init_mdoutf(int nfile, const t_filenm fnm[], int mdrun_flags,
 
 void done_mdoutf(gmx_mdoutf_t *of)
 {
+    if (of->writer != NULL)
+    {
+        /* Write all queued output before closing the files */
+        done_writer(of->writer);
+    }
     if (of->fp_ene != NULL)
     {
         close_enx(of->fp_ene);
@@ -554,6 +780,149 @@ void done_mdoutf(gmx_mdoutf_t *of)
     sfree(of);
 }
 
+static int cpt_nparts(const t_commrec *cr, const gmx_mdoutf_t *of)
+{
+    return of->bCPTParts ? cr->dd->nnodes : 0;
+}
+
+/* Writes the home atom part of a distributed checkpoint on this DD node.
+ * After this call the parts of all DD nodes have been written.
+ */
+static void write_cpt_part(t_commrec *cr, gmx_mdoutf_t *of,
+                           gmx_large_int_t step, t_state *state_local,
+                           int natoms)
+{
+    int *index_gl, nhome, nsum;
+
+    nhome = dd_get_home_atom_index(cr->dd, state_local, &index_gl);
+    write_checkpoint_part(of->fn_cpt, step, cr->dd->rank, cr->dd->nnodes,
+                          natoms, nhome, index_gl, state_local);
+
+    /* This sum also ensures that no part is missing when the master
+     * writes the checkpoint file that references the parts.
+     */
+    nsum = nhome;
+    gmx_sumi(1, &nsum, cr);
+    if (nsum != natoms)
+    {
+        gmx_fatal(FARGS, "The checkpoint parts contain %d atoms instead of %d",
+                  nsum, natoms);
+    }
+
+    if (!of->bKeepAndNumCPT)
+    {
+        /* Only the last two checkpoint files reference parts, but we keep
+         * one more, since the master renames the files after this call.
+         */
+        if (of->ncpt_part_step == 3)
+        {
+            remove_checkpoint_part(of->fn_cpt, of->cpt_part_step[0],
+                                   cr->dd->rank);
+            of->cpt_part_step[0] = of->cpt_part_step[1];
+            of->cpt_part_step[1] = of->cpt_part_step[2];
+            of->ncpt_part_step--;
+        }
+        of->cpt_part_step[of->ncpt_part_step++] = step;
+    }
+}
+
+/* Copies the collected output data to a job for the writer thread */
+static void write_traj_async(FILE *fplog, t_commrec *cr,
+                             gmx_mdoutf_t *of,
+                             int mdof_flags,
+                             gmx_mtop_t *top_global,
+                             gmx_large_int_t step, double t,
+                             t_state *state_local, t_state *state_global,
+                             rvec *global_v, rvec *f_global,
+                             int n_xtc)
+{
+    t_gmx_mdoutf_writer *w;
+    t_mdoutf_job        *job;
+    t_fileio            *fp_cpt = NULL;
+    char                *fn_cpt = NULL;
+    gmx_groups_t        *groups;
+    int                  natoms, i, j;
+
+    w      = of->writer;
+    natoms = top_global->natoms;
+
+    if (mdof_flags & MDOF_CPT)
+    {
+        /* The checkpoint stores the positions and checksums of the output
+         * files, so all frames of previous steps should be written first.
+         * Only syncing to disk and renaming is left to the writer thread.
+         */
+        writer_wait_idle(w);
+        fp_cpt = write_checkpoint_data(of->fn_cpt, fplog, cr,
+                                       of->eIntegrator, of->simulation_part,
+                                       of->bExpanded, of->elamstats,
+                                       step, t, state_global,
+                                       cpt_nparts(cr, of), &fn_cpt);
+    }
+
+    job = writer_get_free_job(w);
+
+    job->mdof_flags = mdof_flags;
+    job->step       = step;
+    job->t          = t;
+    job->lambda     = state_local->lambda[efptFEP];
+    copy_mat(state_local->box, job->box);
+    job->natoms     = natoms;
+    job->fp_cpt     = fp_cpt;
+    job->fn_cpt     = fn_cpt;
+
+    if (mdof_flags & MDOF_X)
+    {
+        if (job->x == NULL)
+        {
+            snew(job->x, natoms);
+        }
+        memcpy(job->x, state_global->x, natoms*sizeof(rvec));
+    }
+    if (mdof_flags & MDOF_V)
+    {
+        if (job->v == NULL)
+        {
+            snew(job->v, natoms);
+        }
+        memcpy(job->v, global_v, natoms*sizeof(rvec));
+    }
+    if (mdof_flags & MDOF_F)
+    {
+        if (job->f == NULL)
+        {
+            snew(job->f, natoms);
+        }
+        memcpy(job->f, f_global, natoms*sizeof(rvec));
+    }
+    if (mdof_flags & MDOF_XTC)
+    {
+        job->n_xtc = n_xtc;
+        if (job->x_xtc == NULL)
+        {
+            snew(job->x_xtc, n_xtc);
+        }
+        if (n_xtc == natoms)
+        {
+            memcpy(job->x_xtc, state_global->x, natoms*sizeof(rvec));
+        }
+        else
+        {
+            groups = &top_global->groups;
+            j      = 0;
+            for (i = 0; i < natoms; i++)
+            {
+                if (ggrpnr(groups, egcXTC, i) == 0)
+                {
+                    copy_rvec(state_global->x[i], job->x_xtc[j++]);
+                }
+            }
+        }
+    }
+
+    writer_push_job(w);
+}
+
 void write_traj(FILE *fplog, t_commrec *cr,
                 gmx_mdoutf_t *of,
                 int mdof_flags,
@@ -579,12 +948,17 @@ void write_traj(FILE *fplog, t_commrec *cr,
 
     if (DOMAINDECOMP(cr))
     {
-        if (mdof_flags & MDOF_CPT)
+        if ((mdof_flags & MDOF_CPT) && !of->bCPTParts)
         {
             dd_collect_state(cr->dd, state_local, state_global);
         }
         else
         {
+            if (mdof_flags & MDOF_CPT)
+            {
+                dd_collect_state_no_atoms(cr->dd, state_local, state_global);
+                write_cpt_part(cr, of, step, state_local, top_global->natoms);
+            }
             if (mdof_flags & (MDOF_X | MDOF_XTC))
             {
                 dd_collect_vec(cr->dd, state_local, state_local->x,
@@ -634,29 +1008,6 @@ void write_traj(FILE *fplog, t_commrec *cr,
                 {
                     MX(state_global->sd_X);
                 }
-                if (state_global->nrngi > 1)
-                {
-                    if (state_local->flags & (1<<estLD_RNG))
-                    {
-#ifdef GMX_MPI
-                        MPI_Gather(state_local->ld_rng,
-                                   state_local->nrng*sizeof(state_local->ld_rng[0]), MPI_BYTE,
-                                   state_global->ld_rng,
-                                   state_local->nrng*sizeof(state_local->ld_rng[0]), MPI_BYTE,
-                                   MASTERRANK(cr), cr->mpi_comm_mygroup);
-#endif
-                    }
-                    if (state_local->flags & (1<<estLD_RNGI))
-                    {
-#ifdef GMX_MPI
-                        MPI_Gather(state_local->ld_rngi,
-                                   sizeof(state_local->ld_rngi[0]), MPI_BYTE,
-                                   state_global->ld_rngi,
-                                   sizeof(state_local->ld_rngi[0]), MPI_BYTE,
-                                   MASTERRANK(cr), cr->mpi_comm_mygroup);
-#endif
-                    }
-                }
             }
             else
             {
@@ -678,26 +1029,6 @@ void write_traj(FILE *fplog, t_commrec *cr,
 
     if (MASTER(cr))
     {
-        if (mdof_flags & MDOF_CPT)
-        {
-            write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
-                             fplog, cr, of->eIntegrator, of->simulation_part,
-                             of->bExpanded, of->elamstats, step, t, state_global);
-        }
-
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
-        {
-            fwrite_trn(of->fp_trn, step, t, state_local->lambda[efptFEP],
-                       state_local->box, top_global->natoms,
-                       (mdof_flags & MDOF_X) ? state_global->x : NULL,
-                       (mdof_flags & MDOF_V) ? global_v : NULL,
-                       (mdof_flags & MDOF_F) ? f_global : NULL);
-            if (gmx_fio_flush(of->fp_trn) != 0)
-            {
-                gmx_file("Cannot write trajectory; maybe you are out of disk space?");
-            }
-            gmx_fio_check_file_position(of->fp_trn);
-        }
         if (mdof_flags & MDOF_XTC)
         {
             groups = &top_global->groups;
@@ -711,11 +1042,39 @@ void write_traj(FILE *fplog, t_commrec *cr,
                         (*n_xtc)++;
                     }
                 }
-                if (*n_xtc != top_global->natoms)
+                if (*n_xtc != top_global->natoms && of->writer == NULL)
                 {
                     snew(*x_xtc, *n_xtc);
                 }
             }
+        }
+
+        if (of->writer != NULL)
+        {
+            write_traj_async(fplog, cr, of, mdof_flags, top_global, step, t,
+                             state_local, state_global, global_v, f_global,
+                             *n_xtc);
+            return;
+        }
+
+        if (mdof_flags & MDOF_CPT)
+        {
+            write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
+                             fplog, cr, of->eIntegrator, of->simulation_part,
+                             of->bExpanded, of->elamstats, step, t, state_global,
+                             cpt_nparts(cr, of));
+        }
+
+        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+        {
+            write_trn_frame(of, step, t, state_local->lambda[efptFEP],
+                            state_local->box, top_global->natoms,
+                            (mdof_flags & MDOF_X) ? state_global->x : NULL,
+                            (mdof_flags & MDOF_V) ? global_v : NULL,
+                            (mdof_flags & MDOF_F) ? f_global : NULL);
+        }
+        if (mdof_flags & MDOF_XTC)
+        {
             if (*n_xtc == top_global->natoms)
             {
                 xxtc = state_global->x;
@@ -732,12 +1091,7 @@ void write_traj(FILE *fplog, t_commrec *cr,
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, *n_xtc, step, t,
-                          state_local->box, xxtc, of->xtc_prec) == 0)
-            {
-                gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
-            }
-            gmx_fio_check_file_position(of->fp_xtc);
+            write_xtc_frame(of, *n_xtc, step, t, state_local->box, xxtc);
         }
     }
 }
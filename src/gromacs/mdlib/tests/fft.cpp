@@ -253,7 +253,7 @@ TEST_F(FFFTest3D, Real5_6_9)
     ivec       local_ndata, offset, rsize, csize, complex_order;
 
     gmx_parallel_3dfft_init(&fft_, ndata, &rdata, &cdata,
-                            comm, NULL, NULL, TRUE, 1);
+                            comm, NULL, NULL, TRUE, 1, FALSE);
 
     gmx_parallel_3dfft_real_limits(fft_, local_ndata, offset, rsize);
     gmx_parallel_3dfft_complex_limits(fft_, complex_order,
@@ -0,0 +1,400 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the SIMD LINCS kernels against the scalar ones,
+ * and reports the constraint throughput.
+ *
+ * The timings are recorded in the XML test output when GMX_LINCS_BENCH
+ * is set in the environment, see simdbenchmark.h.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "typedefs.h"
+#include "vec.h"
+#include "constr.h"
+#include "nrnb.h"
+#include "gmx_omp_nthreads.h"
+
+#include "simdbenchmark.h"
+
+namespace
+{
+
+//! Bond lengths and masses of the heavy atoms and hydrogens.
+const real dCC = 0.15, dCH = 0.1, mC = 12.011, mH = 1.008;
+
+/*! \brief Random branched chains, of which the bonds are constrained.
+ *
+ * Every third heavy atom carries two hydrogens, so there are
+ * no constraint triangles.
+ */
+class LincsTest : public ::testing::Test
+{
+    public:
+        LincsTest() : lincsd_(NULL)
+        {
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+            gmx_omp_nthreads_init(NULL, &cr_, 1, 1, 1, FALSE, TRUE);
+
+            std::memset(iparams_, 0, sizeof(iparams_));
+            iparams_[0].constr.dA = dCC;
+            iparams_[0].constr.dB = dCC;
+            iparams_[1].constr.dA = dCH;
+            iparams_[1].constr.dB = dCH;
+
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI             = eiMD;
+            ir_.efep           = efepNO;
+            ir_.delta_t        = 0.002;
+            ir_.LincsWarnAngle = 30;
+            init_nrnb(&nrnb_);
+        }
+
+        //! Generates nheavy heavy atoms with hydrogens and sets up LINCS.
+        void generate(int nheavy, int nIter, int nOrder)
+        {
+            std::vector<real> dir(DIM, 0);
+            int               last = -1;
+
+            srand(1993);
+            x_.clear();
+            invmass_.clear();
+            iatoms_.clear();
+            for (int c = 0; c < nheavy; c++)
+            {
+                int  a = natoms();
+                rvec u;
+
+                /* A random walk with bond angles of 110 degrees */
+                randomUnit(u);
+                if (c > 0)
+                {
+                    real ip = iprod(u, &dir[0]);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        u[d] -= ip*dir[d];
+                    }
+                    svmul(1/norm(u), u, u);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        dir[d] = std::cos(M_PI*70/180)*dir[d] + std::sin(M_PI*70/180)*u[d];
+                    }
+                    /* Avoid the chain bumping into itself too often */
+                    if (c % 50 == 0)
+                    {
+                        randomUnit(&dir[0]);
+                    }
+                }
+                else
+                {
+                    copy_rvec(u, &dir[0]);
+                }
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_.push_back(c == 0 ? 2 : x_[last*DIM + d] + dCC*dir[d]);
+                }
+                invmass_.push_back(1/mC);
+                if (c > 0)
+                {
+                    addConstraint(0, last, a);
+                }
+                last = a;
+                if (c % 3 == 0)
+                {
+                    for (int h = 0; h < 2; h++)
+                    {
+                        randomUnit(u);
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            x_.push_back(x_[a*DIM + d] + dCH*u[d]);
+                        }
+                        invmass_.push_back(1/mH);
+                        addConstraint(1, a, natoms() - 1);
+                    }
+                }
+            }
+            xp_.resize(x_.size());
+            v_.resize(x_.size());
+            for (size_t i = 0; i < x_.size(); i++)
+            {
+                v_[i]  = 2*(uniform() - 0.5);
+                xp_[i] = x_[i] + ir_.delta_t*v_[i];
+            }
+
+            std::memset(&idef_, 0, sizeof(idef_));
+            idef_.ntypes               = 2;
+            idef_.iparams              = iparams_;
+            idef_.il[F_CONSTR].nr      = iatoms_.size();
+            idef_.il[F_CONSTR].iatoms  = &iatoms_[0];
+
+            std::memset(&molt_, 0, sizeof(molt_));
+            molt_.ilist[F_CONSTR] = idef_.il[F_CONSTR];
+            std::memset(&molb_, 0, sizeof(molb_));
+            molb_.type = 0;
+            molb_.nmol = 1;
+            std::memset(&mtop_, 0, sizeof(mtop_));
+            mtop_.nmoltype  = 1;
+            mtop_.moltype   = &molt_;
+            mtop_.nmolblock = 1;
+            mtop_.molblock  = &molb_;
+
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr      = natoms();
+            md_.homenr  = natoms();
+            md_.invmass = &invmass_[0];
+
+            int      nflexcon;
+            t_blocka at2con = make_at2con(0, natoms(), molt_.ilist, iparams_,
+                                          TRUE, &nflexcon);
+            lincsd_ = init_lincs(NULL, &mtop_, nflexcon, &at2con, FALSE,
+                                 nIter, nOrder);
+            done_blocka(&at2con);
+        }
+
+        int natoms() const
+        {
+            return x_.size()/DIM;
+        }
+
+        int ncons() const
+        {
+            return iatoms_.size()/3;
+        }
+
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        static real uniform()
+        {
+            return rand()/(real)RAND_MAX;
+        }
+
+        static void randomUnit(rvec u)
+        {
+            do
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    u[d] = 2*uniform() - 1;
+                }
+            }
+            while (norm2(u) > 1 || norm2(u) < 0.01);
+            svmul(1/norm(u), u, u);
+        }
+
+        void addConstraint(int type, int a1, int a2)
+        {
+            iatoms_.push_back(type);
+            iatoms_.push_back(a1);
+            iatoms_.push_back(a2);
+        }
+
+        //! Constrains copies of the input coordinates, with or without SIMD.
+        void runLincs(bool bSimd, std::vector<real> *xp, std::vector<real> *v,
+                      tensor vir)
+        {
+            int warncount = 0;
+
+            *xp = xp_;
+            *v  = v_;
+            clear_mat(vir);
+            lincs_set_simd(lincsd_, bSimd);
+            set_lincs(&idef_, &md_, TRUE, &cr_, lincsd_);
+            EXPECT_TRUE(constrain_lincs(NULL, FALSE, FALSE, &ir_, 0, lincsd_, &md_, &cr_,
+                                        as_rvec(&x_), as_rvec(xp), NULL, NULL, NULL,
+                                        0, NULL, 1/ir_.delta_t, as_rvec(v),
+                                        TRUE, vir, econqCoord, &nrnb_, -1, &warncount));
+        }
+
+        //! Projects out the constraint components of the velocities.
+        void runProj(bool bSimd, std::vector<real> *dv, tensor vir)
+        {
+            *dv = v_;
+            clear_mat(vir);
+            lincs_set_simd(lincsd_, bSimd);
+            set_lincs(&idef_, &md_, TRUE, &cr_, lincsd_);
+            constrain_lincs(NULL, FALSE, FALSE, &ir_, 0, lincsd_, &md_, &cr_,
+                            as_rvec(&x_), as_rvec(&v_), as_rvec(dv), NULL, NULL,
+                            0, NULL, 0, NULL,
+                            TRUE, vir, econqVeloc, &nrnb_, -1, NULL);
+        }
+
+        real maxRelativeDeviation(std::vector<real> *x)
+        {
+            rvec *xr = as_rvec(x);
+            real  dmax = 0;
+
+            for (int c = 0; c < ncons(); c++)
+            {
+                rvec dx;
+                rvec_sub(xr[iatoms_[3*c+1]], xr[iatoms_[3*c+2]], dx);
+                dmax = std::max(dmax, std::fabs(norm(dx)/iparams_[iatoms_[3*c]].constr.dA - 1));
+            }
+
+            return dmax;
+        }
+
+        t_commrec            cr_;
+        t_iparams            iparams_[2];
+        t_inputrec           ir_;
+        t_nrnb               nrnb_;
+        t_idef               idef_;
+        gmx_moltype_t        molt_;
+        gmx_molblock_t       molb_;
+        gmx_mtop_t           mtop_;
+        t_mdatoms            md_;
+        gmx_lincsdata_t      lincsd_;
+        std::vector<t_iatom> iatoms_;
+        std::vector<real>    x_, xp_, v_, invmass_;
+};
+
+TEST_F(LincsTest, SatisfiesConstraints)
+{
+    /* An odd number of constraints, so there is a scalar remainder */
+    generate(100, 2, 8);
+    ASSERT_NE(0, ncons() % 2);
+    EXPECT_GT(maxRelativeDeviation(&xp_), 0.001);
+    for (int simd = 0; simd < 2; simd++)
+    {
+        std::vector<real> xp, v;
+        tensor            vir;
+
+        runLincs(simd, &xp, &v, vir);
+        EXPECT_LT(maxRelativeDeviation(&xp), 1e-4) << "simd " << simd;
+    }
+}
+
+TEST_F(LincsTest, SimdMatchesScalar)
+{
+    std::vector<real> xp_ref, v_ref, xp, v;
+    tensor            vir_ref, vir;
+
+    generate(100, 1, 4);
+    runLincs(false, &xp_ref, &v_ref, vir_ref);
+    runLincs(true, &xp, &v, vir);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        EXPECT_NEAR(xp_ref[i], xp[i], 10*GMX_REAL_EPS*(1 + std::fabs(xp_ref[i])))
+        << "element " << i;
+        /* The velocity correction is the position correction over dt */
+        EXPECT_NEAR(v_ref[i], v[i], 10*GMX_REAL_EPS/ir_.delta_t*(1 + std::fabs(xp_ref[i])))
+        << "element " << i;
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(vir_ref[d][d2], vir[d][d2], 1e3*GMX_REAL_EPS*(1 + std::fabs(vir_ref[d][d2])));
+        }
+    }
+}
+
+TEST_F(LincsTest, ProjectionRemovesBondVelocities)
+{
+    std::vector<real> dv_ref, dv;
+    tensor            vir_ref, vir;
+
+    generate(100, 1, 8);
+    runProj(false, &dv_ref, vir_ref);
+    runProj(true, &dv, vir);
+    rvec *x   = as_rvec(&x_);
+    rvec *dvr = as_rvec(&dv);
+    for (int c = 0; c < ncons(); c++)
+    {
+        rvec r, dvab;
+        rvec_sub(x[iatoms_[3*c+1]], x[iatoms_[3*c+2]], r);
+        rvec_sub(dvr[iatoms_[3*c+1]], dvr[iatoms_[3*c+2]], dvab);
+        /* The expansion only converges to about 1e-4 */
+        EXPECT_NEAR(0, iprod(r, dvab)/norm(r), 1e-3) << "constraint " << c;
+    }
+    for (size_t i = 0; i < v_.size(); i++)
+    {
+        EXPECT_NEAR(dv_ref[i], dv[i], 10*GMX_REAL_EPS*(1 + std::fabs(dv_ref[i])))
+        << "element " << i;
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(vir_ref[d][d2], vir[d][d2], 1e3*GMX_REAL_EPS*(1 + std::fabs(vir_ref[d][d2])));
+        }
+    }
+}
+
+TEST_F(LincsTest, Benchmark)
+{
+    const int         nheavy = 12000, nrep = 20;
+    std::vector<real> xp, v;
+    tensor            vir;
+    int               warncount = 0;
+    gmx_cycles_t      c[3];
+
+    if (!gmx::test::simdBenchmarkEnabled("GMX_LINCS_BENCH"))
+    {
+        return;
+    }
+    generate(nheavy, 1, 4);
+    for (int simd = 0; simd < 2; simd++)
+    {
+        lincs_set_simd(lincsd_, simd);
+        set_lincs(&idef_, &md_, TRUE, &cr_, lincsd_);
+        c[simd] = gmx_cycles_read();
+        for (int r = 0; r < nrep; r++)
+        {
+            xp = xp_;
+            v  = v_;
+            clear_mat(vir);
+            constrain_lincs(NULL, FALSE, FALSE, &ir_, 0, lincsd_, &md_, &cr_,
+                            as_rvec(&x_), as_rvec(&xp), NULL, NULL, NULL,
+                            0, NULL, 1/ir_.delta_t, as_rvec(&v),
+                            TRUE, vir, econqCoord, &nrnb_, -1, &warncount);
+        }
+    }
+    c[2] = gmx_cycles_read();
+    gmx::test::recordSimdBenchmark("lincs", c[1] - c[0], c[2] - c[1], nrep*ncons());
+}
+
+} // namespace
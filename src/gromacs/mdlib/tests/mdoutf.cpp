@@ -0,0 +1,332 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests writing trajectory frames and checkpoints with init_mdoutf,
+ * write_traj and done_mdoutf.
+ *
+ * With the output writer thread, the frames are queued and written
+ * asynchronously. The tests check that all queued frames are in the files
+ * after done_mdoutf, that the frames contain the data at the time of
+ * the write_traj call, and that a checkpoint stores the file positions
+ * directly after the frames of the previous steps, as with synchronous
+ * writing.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "testutils/testfilemanager.h"
+
+#include "typedefs.h"
+#include "sim_util.h"
+#include "checkpoint.h"
+#include "smalloc.h"
+#include "gmxfio.h"
+#include "trnio.h"
+#include "xtcio.h"
+
+namespace
+{
+
+using gmx::test::TestFileManager;
+
+//! The environment variable that disables the output writer thread.
+const char *const c_noAsyncEnv = "GMX_NO_ASYNC_OUTPUT";
+
+//! Number of atoms, steps and the step with a checkpoint.
+const int         c_natoms  = 29;
+const int         c_nstep   = 7;
+const int         c_cptStep = 3;
+
+class MdoutfTest : public ::testing::Test
+{
+    public:
+        MdoutfTest()
+        {
+            trrName_ = tempFiles_.getTemporaryFilePath(".trr");
+            xtcName_ = tempFiles_.getTemporaryFilePath(".xtc");
+            edrName_ = tempFiles_.getTemporaryFilePath(".edr");
+            cptName_ = tempFiles_.getTemporaryFilePath(".cpt");
+
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+
+            std::memset(&expanded_, 0, sizeof(expanded_));
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI              = eiMD;
+            ir_.nstxout         = 1;
+            ir_.nstvout         = 1;
+            ir_.nstxtcout       = 1;
+            ir_.xtcprec         = 1000;
+            ir_.simulation_part = 1;
+            ir_.expandedvals    = &expanded_;
+
+            std::memset(&mtop_, 0, sizeof(mtop_));
+            mtop_.natoms = c_natoms;
+        }
+
+        //! Sets the state to values that depend on the step.
+        static void setFrame(int step, t_state *state)
+        {
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    state->x[i][d] = 0.1*i + 0.01*step + 0.3*d;
+                    state->v[i][d] = -0.2*step + 0.05*i - d;
+                }
+            }
+            for (int d = 0; d < DIM; d++)
+            {
+                state->box[d][d] = 3 + 0.001*step;
+            }
+        }
+
+        //! Writes all steps through mdoutf, with or without writer thread.
+        void writeOutput(bool bAsync)
+        {
+#ifdef _MSC_VER
+            _putenv_s(c_noAsyncEnv, bAsync ? "" : "1");
+#else
+            if (bAsync)
+            {
+                unsetenv(c_noAsyncEnv);
+            }
+            else
+            {
+                setenv(c_noAsyncEnv, "1", 1);
+            }
+#endif
+            char     *fns[] = {
+                const_cast<char *>(trrName_.c_str()),
+                const_cast<char *>(xtcName_.c_str()),
+                const_cast<char *>(edrName_.c_str()),
+                const_cast<char *>(cptName_.c_str())
+            };
+            t_filenm  fnm[] = {
+                { efTRN, "-o",     NULL, ffWRITE, 1, &fns[0] },
+                { efXTC, "-x",     NULL, ffWRITE, 1, &fns[1] },
+                { efEDR, "-e",     NULL, ffWRITE, 1, &fns[2] },
+                { efCPT, "-cpo",   NULL, ffWRITE, 1, &fns[3] },
+                { efXVG, "-field", NULL, ffOPTWR, 0, NULL }
+            };
+            const int nfile = sizeof(fnm)/sizeof(fnm[0]);
+
+            gmx_mdoutf_t *of = init_mdoutf(nfile, fnm, 0, &cr_, &ir_, NULL);
+
+            t_state       state;
+            int           n_xtc = -1;
+            rvec         *x_xtc = NULL;
+
+            /* init_state does not initialize all members */
+            std::memset(&state, 0, sizeof(state));
+            init_state(&state, c_natoms, 1, 0, 0, 0);
+            state.flags = (1<<estBOX) | (1<<estX) | (1<<estV);
+            for (int step = 0; step < c_nstep; step++)
+            {
+                /* write_traj should copy or write the data before returning,
+                 * since the state changes at every step.
+                 */
+                setFrame(step, &state);
+                int mdof_flags = (MDOF_X | MDOF_V | MDOF_XTC);
+                if (step == c_cptStep)
+                {
+                    mdof_flags |= MDOF_CPT;
+                }
+                write_traj(NULL, &cr_, of, mdof_flags, &mtop_, step, 0.5*step,
+                           &state, &state, NULL, NULL, &n_xtc, &x_xtc);
+            }
+            /* This should write all queued frames */
+            done_mdoutf(of);
+            done_state(&state);
+        }
+
+        //! Returns the output file offsets stored in the checkpoint.
+        std::map<std::string, long> readCheckpointOffsets()
+        {
+            std::map<std::string, long> offsets;
+            std::string                 name;
+            char                        line[4096], buf[4096];
+            long                        offset;
+
+            FILE *fp = std::tmpfile();
+            list_checkpoint(cptName_.c_str(), fp);
+            std::fseek(fp, 0, SEEK_SET);
+            while (std::fgets(line, sizeof(line), fp) != NULL)
+            {
+                if (std::sscanf(line, "output filename = %4095s", buf) == 1)
+                {
+                    name = buf;
+                }
+                else if (std::sscanf(line, "file_offset_low = %ld", &offset) == 1)
+                {
+                    offsets[name] = offset;
+                }
+            }
+            std::fclose(fp);
+
+            return offsets;
+        }
+
+        //! Checks the trajectory files and the checkpoint.
+        void checkOutput()
+        {
+            t_state   ref, state;
+            gmx_off_t trrOffset = -1, xtcOffset = -1;
+
+            std::memset(&ref, 0, sizeof(ref));
+            std::memset(&state, 0, sizeof(state));
+            init_state(&ref, c_natoms, 1, 0, 0, 0);
+
+            t_fileio *fio = open_trn(trrName_.c_str(), "r");
+            for (int step = 0; step < c_nstep; step++)
+            {
+                int     stepr, natoms;
+                real    t, lambda;
+                matrix  box;
+                rvec    x[c_natoms], v[c_natoms];
+
+                if (step == c_cptStep)
+                {
+                    trrOffset = gmx_fio_ftell(fio);
+                }
+                ASSERT_TRUE(fread_trn(fio, &stepr, &t, &lambda, box, &natoms,
+                                      x, v, NULL)) << "trr frame " << step;
+                EXPECT_EQ(step, stepr);
+                setFrame(step, &ref);
+                for (int i = 0; i < c_natoms; i++)
+                {
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        EXPECT_EQ(ref.x[i][d], x[i][d]);
+                        EXPECT_EQ(ref.v[i][d], v[i][d]);
+                    }
+                }
+            }
+            close_trn(fio);
+
+            fio = open_xtc(xtcName_.c_str(), "r");
+            {
+                int       natoms, stepr;
+                real      t, prec;
+                matrix    box;
+                rvec     *x;
+                gmx_bool  bOK;
+
+                ASSERT_TRUE(read_first_xtc(fio, &natoms, &stepr, &t, box, &x, &prec, &bOK));
+                for (int step = 0; step < c_nstep; step++)
+                {
+                    if (step > 0)
+                    {
+                        if (step == c_cptStep)
+                        {
+                            xtcOffset = gmx_fio_ftell(fio);
+                        }
+                        ASSERT_TRUE(read_next_xtc(fio, natoms, &stepr, &t, box, x, &prec, &bOK))
+                        << "xtc frame " << step;
+                    }
+                    EXPECT_EQ(step, stepr);
+                    setFrame(step, &ref);
+                    for (int i = 0; i < c_natoms; i++)
+                    {
+                        for (int d = 0; d < DIM; d++)
+                        {
+                            EXPECT_NEAR(ref.x[i][d], x[i][d], 1.0/ir_.xtcprec);
+                        }
+                    }
+                }
+                sfree(x);
+            }
+            close_xtc(fio);
+
+            /* The checkpoint contains the state of its step, and the
+             * file positions directly after the frames of the steps before.
+             */
+            int             simulation_part;
+            gmx_large_int_t step;
+            double          t;
+
+            init_state(&state, 0, 0, 0, 0, 0);
+            read_checkpoint_state(cptName_.c_str(), &simulation_part,
+                                  &step, &t, &state);
+            EXPECT_EQ(c_cptStep, step);
+            setFrame(c_cptStep, &ref);
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ(ref.x[i][d], state.x[i][d]);
+                }
+            }
+
+            std::map<std::string, long> offsets = readCheckpointOffsets();
+            ASSERT_EQ(1U, offsets.count(trrName_));
+            ASSERT_EQ(1U, offsets.count(xtcName_));
+            EXPECT_EQ(trrOffset, offsets[trrName_]);
+            EXPECT_EQ(xtcOffset, offsets[xtcName_]);
+
+            done_state(&state);
+            done_state(&ref);
+        }
+
+        TestFileManager tempFiles_;
+        std::string     trrName_, xtcName_, edrName_, cptName_;
+        t_commrec       cr_;
+        t_inputrec      ir_;
+        t_expanded      expanded_;
+        gmx_mtop_t      mtop_;
+};
+
+TEST_F(MdoutfTest, WriterThreadWritesQueuedFramesAndCheckpoint)
+{
+    writeOutput(true);
+    checkOutput();
+}
+
+TEST_F(MdoutfTest, SynchronousWriting)
+{
+    writeOutput(false);
+    checkOutput();
+}
+
+} // namespace
@@ -0,0 +1,222 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that PME with GMX_PME_LOW_MEMORY, where the threads spread
+ * directly on the shared grid, gives the same energy, virial and forces
+ * as PME with thread-local grids.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include "config.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include <gtest/gtest.h>
+#include "typedefs.h"
+#include "vec.h"
+#include "pme.h"
+#include "coulomb.h"
+#include "nrnb.h"
+
+namespace
+{
+
+//! The environment variable that turns on low-memory PME.
+const char *const c_lowMemEnv = "GMX_PME_LOW_MEMORY";
+
+//! The number of atoms, not a multiple of anything relevant.
+const int         c_natoms = 397;
+
+//! The number of threads, the PME order and the grid size along x.
+struct PmeLowMemParams
+{
+    int nthread;
+    int order;
+    int nkx;
+};
+
+//! Prints the parameters in the gtest output.
+std::ostream &operator<<(std::ostream &out, const PmeLowMemParams &p)
+{
+    return out << p.nthread << " threads, order " << p.order << ", nkx " << p.nkx;
+}
+
+/*! \brief Random charges in a rectangular box.
+ *
+ * The grid sizes differ per dimension and are not all multiples
+ * of the number of threads, which tests the thread slab division.
+ */
+class PmeLowMemTest : public ::testing::TestWithParam<PmeLowMemParams>
+{
+    public:
+        PmeLowMemTest() : x_(c_natoms*DIM), q_(c_natoms)
+        {
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.ePBC           = epbcXYZ;
+            ir_.coulombtype    = eelPME;
+            ir_.nkx            = GetParam().nkx;
+            ir_.nky            = 25;
+            ir_.nkz            = 30;
+            ir_.pme_order      = GetParam().order;
+            ir_.epsilon_r      = 1;
+            ir_.ewald_geometry = eewg3D;
+
+            clear_mat(box_);
+            box_[XX][XX] = 3.0;
+            box_[YY][YY] = 2.7;
+            box_[ZZ][ZZ] = 3.2;
+
+            srand(1993);
+            real qsum = 0;
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_[i*DIM + d] = box_[d][d]*rand()/(real)RAND_MAX;
+                }
+                q_[i] = 2*rand()/(real)RAND_MAX - 1;
+                qsum += q_[i];
+            }
+            /* Make the system neutral */
+            for (int i = 0; i < c_natoms; i++)
+            {
+                q_[i] -= qsum/c_natoms;
+            }
+        }
+
+        //! Computes the PME mesh energy, virial and forces.
+        void runPme(bool bLowMem, int nthread,
+                    real *energy, matrix vir, std::vector<real> *f)
+        {
+#ifdef _MSC_VER
+            _putenv_s(c_lowMemEnv, bLowMem ? "1" : "");
+#else
+            if (bLowMem)
+            {
+                setenv(c_lowMemEnv, "1", 1);
+            }
+            else
+            {
+                unsetenv(c_lowMemEnv);
+            }
+#endif
+            gmx_pme_t pme;
+            t_nrnb    nrnb;
+            real      dvdlambda = 0;
+
+            gmx_pme_init(&pme, &cr_, 1, 1, &ir_, c_natoms, FALSE, FALSE, nthread);
+            init_nrnb(&nrnb);
+            f->assign(c_natoms*DIM, 0);
+            clear_mat(vir);
+            *energy = 0;
+            gmx_pme_do(pme, 0, c_natoms, as_rvec(&x_), as_rvec(f),
+                       &q_[0], &q_[0], box_, &cr_, 0, 0, &nrnb, NULL,
+                       vir, calc_ewaldcoeff(0.9, 1e-5), energy, 0, &dvdlambda,
+                       GMX_PME_DO_ALL_F | GMX_PME_CALC_ENER_VIR);
+            gmx_pme_destroy(NULL, &pme);
+#ifdef _MSC_VER
+            _putenv_s(c_lowMemEnv, "");
+#else
+            unsetenv(c_lowMemEnv);
+#endif
+        }
+
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        t_commrec         cr_;
+        t_inputrec        ir_;
+        matrix            box_;
+        std::vector<real> x_, q_;
+};
+
+TEST_P(PmeLowMemTest, MatchesThreadLocalGrids)
+{
+    const int         nthread = GetParam().nthread;
+    real              energyRef, energy, fmax = 0;
+    matrix            virRef, vir;
+    std::vector<real> fRef, f;
+
+    runPme(false, nthread, &energyRef, virRef, &fRef);
+    runPme(true, nthread, &energy, vir, &f);
+
+    /* Only the summation order differs */
+    EXPECT_NEAR(energyRef, energy, 1e-5*std::fabs(energyRef));
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int e = 0; e < DIM; e++)
+        {
+            EXPECT_NEAR(virRef[d][e], vir[d][e], 1e-5*std::fabs(energyRef))
+            << "virial element " << d << " " << e;
+        }
+    }
+    for (int i = 0; i < c_natoms*DIM; i++)
+    {
+        fmax = std::max(fmax, std::fabs(fRef[i]));
+    }
+    ASSERT_GT(fmax, 0);
+    for (int i = 0; i < c_natoms*DIM; i++)
+    {
+        EXPECT_NEAR(fRef[i], f[i], 1e-5*fmax)
+        << "atom " << i/DIM << " dimension " << i % DIM;
+    }
+}
+
+#ifdef GMX_OPENMP
+/* Low-memory PME is only used with more than one thread.
+ * With SIMD, order 4 uses exact unaligned loads, orders 5 and 6
+ * use aligned loads that run beyond the end of z-lines.
+ * The last cases have half-slabs of exactly pme_order x-lines.
+ */
+const PmeLowMemParams c_lowMemParams[] = {
+    { 2, 4, 28 }, { 3, 4, 28 }, { 4, 4, 36 },
+    { 2, 5, 28 }, { 3, 5, 32 }, { 2, 6, 28 }, { 3, 6, 40 },
+    { 4, 4, 32 }, { 3, 5, 30 }, { 2, 6, 24 }, { 4, 6, 48 }
+};
+
+INSTANTIATE_TEST_CASE_P(Threads, PmeLowMemTest, ::testing::ValuesIn(c_lowMemParams));
+#endif
+
+} // namespace
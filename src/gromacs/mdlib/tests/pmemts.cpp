@@ -0,0 +1,440 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for PME mesh multiple time stepping (nstcalcpme > 1).
+ *
+ * Checks the steps at which pme_mesh_step and pme_mesh_impulse_step
+ * compute and apply the mesh forces, and that update_coords applies
+ * the mesh forces as an impulse of nstcalcpme times the force at impulse
+ * steps and ignores them at the other steps. A system of harmonic
+ * oscillators, with the soft spring as slow force, checks that the
+ * impulse integration conserves the energy.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "typedefs.h"
+#include "vec.h"
+#include "force.h"
+#include "sim_util.h"
+#include "update.h"
+#include "nrnb.h"
+#include "gmx_omp_nthreads.h"
+
+namespace
+{
+
+/*! \brief
+ * The schedule of the mesh part for one nstcalcpme/nstcalcenergy setting.
+ *
+ * Character i of schedule is the expected action at step i:
+ * 'F' the mesh forces are part of the normal forces (no MTS),
+ * 'I' the mesh forces are computed and applied as an impulse,
+ * 'E' the mesh part is only computed for the energy and virial,
+ * '.' the mesh part is skipped.
+ */
+struct PmeMtsSchedule
+{
+    int         nstcalcpme;
+    int         nstcalcenergy;
+    const char *schedule;
+};
+
+//! Prints the settings in the name of failing tests.
+std::ostream &operator<<(std::ostream &out, const PmeMtsSchedule &s)
+{
+    return out << "nstcalcpme " << s.nstcalcpme
+    << " nstcalcenergy " << s.nstcalcenergy;
+}
+
+class PmeMtsScheduleTest : public ::testing::TestWithParam<PmeMtsSchedule>
+{
+};
+
+TEST_P(PmeMtsScheduleTest, ComputesAndAppliesMeshAtExpectedSteps)
+{
+    const PmeMtsSchedule &s = GetParam();
+    t_inputrec            ir;
+    t_forcerec            fr;
+
+    std::memset(&ir, 0, sizeof(ir));
+    ir.nstcalcpme    = s.nstcalcpme;
+    ir.nstcalcenergy = s.nstcalcenergy;
+    std::memset(&fr, 0, sizeof(fr));
+    fr.eeltype = eelPME;
+    /* As set by init_forcerec */
+    fr.bPMEMTS = (EEL_PME(fr.eeltype) && ir.nstcalcpme > 1);
+
+    std::string schedule;
+    for (int step = 0; step < static_cast<int>(std::strlen(s.schedule)); step++)
+    {
+        /* The flags do_md uses at energy steps */
+        int flags = GMX_FORCE_STATECHANGED | GMX_FORCE_ALLFORCES;
+        if (do_per_step(step, ir.nstcalcenergy))
+        {
+            flags |= GMX_FORCE_VIRIAL | GMX_FORCE_ENERGY;
+        }
+        bool bMesh    = pme_mesh_step(&fr, &ir, step, flags);
+        bool bImpulse = pme_mesh_impulse_step(&fr, &ir, step);
+        /* A step that applies the impulse should also compute it */
+        EXPECT_TRUE(bMesh || !bImpulse) << "step " << step;
+        if (!fr.bPMEMTS)
+        {
+            schedule += (bMesh ? 'F' : '.');
+        }
+        else
+        {
+            schedule += (bImpulse ? 'I' : (bMesh ? 'E' : '.'));
+        }
+    }
+    EXPECT_EQ(std::string(s.schedule), schedule);
+}
+
+/* grompp rounds nstcalcenergy to a multiple of nstcalcpme,
+ * but energies can also be requested at other steps, e.g. the last step.
+ */
+const PmeMtsSchedule c_schedules[] = {
+    { 1, 3,   "FFFFFFFFFFFF" },
+    { 2, 4,   "I.I.I.I.I.I." },
+    { 4, 100, "I...I...I...I..." },
+    { 3, 5,   "I..I.EI..IE.I..I.." },
+    { 4, 6,   "I...I.E.I...I...I.E." }
+};
+
+INSTANTIATE_TEST_CASE_P(Settings, PmeMtsScheduleTest,
+                        ::testing::ValuesIn(c_schedules));
+
+//! Number of atoms for the update tests.
+const int c_natoms = 11;
+
+/*! \brief
+ * Leap-frog updates with the PME mesh forces passed as in do_md.
+ *
+ * At impulse steps do_force has added the mesh forces to f and they are
+ * also passed separately in fr->f_twin, at other steps f does not
+ * contain them.
+ */
+class PmeMtsUpdateTest : public ::testing::Test
+{
+    public:
+        PmeMtsUpdateTest()
+        {
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+            gmx_omp_nthreads_init(NULL, &cr_, 1, 1, 1, FALSE, TRUE);
+            init_nrnb(&nrnb_);
+
+            clear_ivec(nFreeze_[0]);
+            clear_rvec(acc_[0]);
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI           = eiMD;
+            ir_.delta_t      = 0.002;
+            ir_.etc          = etcNO;
+            ir_.nstcalclr    = 1;
+            ir_.opts.ngtc    = 1;
+            ir_.opts.ngacc   = 1;
+            ir_.opts.nFreeze = nFreeze_;
+            ir_.opts.acc     = acc_;
+
+            std::memset(&fr_, 0, sizeof(fr_));
+            fr_.eeltype = eelPME;
+
+            srand(2013);
+            x_.resize(c_natoms*DIM);
+            v_.resize(c_natoms*DIM);
+            for (int i = 0; i < c_natoms*DIM; i++)
+            {
+                x_[i] = 2*(uniform() - 0.5);
+                v_[i] = 2*(uniform() - 0.5);
+            }
+            massT_.resize(c_natoms);
+            invmass_.resize(c_natoms);
+            massT_dim_.resize(c_natoms*DIM);
+            invmass_dim_.resize(c_natoms*DIM);
+            ptype_.assign(c_natoms, eptAtom);
+            for (int i = 0; i < c_natoms; i++)
+            {
+                massT_[i]   = 1 + 15*uniform();
+                invmass_[i] = 1/massT_[i];
+                for (int d = 0; d < DIM; d++)
+                {
+                    massT_dim_[i*DIM + d]   = massT_[i];
+                    invmass_dim_[i*DIM + d] = invmass_[i];
+                }
+            }
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr          = c_natoms;
+            md_.homenr      = c_natoms;
+            md_.massT       = &massT_[0];
+            md_.invmass     = &invmass_[0];
+            md_.massT_dim   = &massT_dim_[0];
+            md_.invmass_dim = &invmass_dim_[0];
+            md_.ptype       = &ptype_[0];
+
+            std::memset(&tcstat_, 0, sizeof(tcstat_));
+            tcstat_.lambda = 1;
+            std::memset(&grpstat_, 0, sizeof(grpstat_));
+            std::memset(ekin_work_, 0, sizeof(ekin_work_));
+            ekin_work_p_ = ekin_work_;
+            std::memset(&ekind_, 0, sizeof(ekind_));
+            ekind_.ngtc      = 1;
+            ekind_.tcstat    = &tcstat_;
+            ekind_.ekin_work = &ekin_work_p_;
+            ekind_.ngacc     = 1;
+            ekind_.grpstat   = &grpstat_;
+        }
+
+        void setNstcalcpme(int nstcalcpme)
+        {
+            ir_.nstcalcpme = nstcalcpme;
+            fr_.bPMEMTS    = (EEL_PME(fr_.eeltype) && ir_.nstcalcpme > 1);
+            upd_           = init_update(NULL, &ir_);
+        }
+
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        static real uniform()
+        {
+            return rand()/(real)RAND_MAX;
+        }
+
+        static std::vector<real> randomForces()
+        {
+            std::vector<real> f(c_natoms*DIM);
+
+            for (int i = 0; i < c_natoms*DIM; i++)
+            {
+                f[i] = 1000*(uniform() - 0.5);
+            }
+
+            return f;
+        }
+
+        /*! \brief
+         * Does one leap-frog step of x_ and v_, as do_md does.
+         *
+         * fMesh is overwritten by update_coords at impulse steps.
+         */
+        void doStep(gmx_large_int_t step, std::vector<real> *f,
+                    std::vector<real> *fMesh)
+        {
+            t_state  state;
+            matrix   M;
+            tensor   vir_part, vir;
+            gmx_bool bDoLR;
+
+            std::memset(&state, 0, sizeof(state));
+            state.natoms = c_natoms;
+            state.nalloc = c_natoms;
+            state.x      = as_rvec(&x_);
+            state.v      = as_rvec(&v_);
+
+            bDoLR = pme_mesh_impulse_step(&fr_, &ir_, step);
+            clear_mat(M);
+            update_coords(NULL, step, &ir_, &md_, &state, FALSE, as_rvec(f),
+                          bDoLR, as_rvec(fMesh), NULL, &ekind_, M, NULL, upd_,
+                          FALSE, etrtPOSITION, &cr_, &nrnb_, NULL, NULL);
+            update_constraints(NULL, step, NULL, &ir_, &ekind_, &md_, &state,
+                               FALSE, NULL, as_rvec(f), NULL, vir_part, vir,
+                               &cr_, &nrnb_, NULL, upd_, NULL, FALSE, FALSE,
+                               FALSE, 0);
+        }
+
+        /*! \brief
+         * Checks the velocity change of the last step.
+         *
+         * The velocities should have changed by delta_t/m times
+         * fShort + meshFactor times fMesh.
+         */
+        void checkVelocities(const std::vector<real> &v0,
+                             const std::vector<real> &fShort,
+                             const std::vector<real> &fMesh,
+                             int meshFactor)
+        {
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    int  j   = i*DIM + d;
+                    real ref = v0[j] + ir_.delta_t*invmass_[i]*(fShort[j] + meshFactor*fMesh[j]);
+                    EXPECT_NEAR(ref, v_[j], 10*GMX_REAL_EPS*(1 + std::fabs(ref)))
+                    << "atom " << i << " dim " << d;
+                }
+            }
+        }
+
+        t_commrec                   cr_;
+        t_nrnb                      nrnb_;
+        ivec                        nFreeze_[1];
+        rvec                        acc_[1];
+        t_inputrec                  ir_;
+        t_forcerec                  fr_;
+        t_mdatoms                   md_;
+        t_grp_tcstat                tcstat_;
+        t_grp_acc                   grpstat_;
+        tensor                      ekin_work_[2];
+        tensor                     *ekin_work_p_;
+        gmx_ekindata_t              ekind_;
+        gmx_update_t                upd_;
+        std::vector<real>           x_, v_;
+        std::vector<real>           massT_, invmass_, massT_dim_, invmass_dim_;
+        std::vector<unsigned short> ptype_;
+};
+
+TEST_F(PmeMtsUpdateTest, AppliesMeshForcesAsImpulse)
+{
+    const int nstcalcpme[] = { 2, 4 };
+
+    for (int n = 0; n < 2; n++)
+    {
+        int k = nstcalcpme[n];
+
+        setNstcalcpme(k);
+        std::vector<real> fShort = randomForces();
+        std::vector<real> fMesh  = randomForces();
+        std::vector<real> f(fShort), fTwin(fMesh), v0(v_);
+        for (int j = 0; j < c_natoms*DIM; j++)
+        {
+            f[j] += fMesh[j];
+        }
+        gmx_large_int_t step = 2*k;
+        ASSERT_TRUE(pme_mesh_impulse_step(&fr_, &ir_, step));
+        doStep(step, &f, &fTwin);
+        /* f + (k - 1)*f_mesh */
+        checkVelocities(v0, fShort, fMesh, k);
+    }
+}
+
+TEST_F(PmeMtsUpdateTest, IgnoresMeshForcesAtEnergyOnlySteps)
+{
+    setNstcalcpme(4);
+    std::vector<real> fShort = randomForces();
+    std::vector<real> fMesh  = randomForces();
+    std::vector<real> f(fShort), fTwin(fMesh), v0(v_);
+    gmx_large_int_t   step = 6;
+    ASSERT_TRUE(pme_mesh_step(&fr_, &ir_, step, GMX_FORCE_ENERGY));
+    ASSERT_FALSE(pme_mesh_impulse_step(&fr_, &ir_, step));
+    /* do_force computed the mesh forces in f_twin, but did not add them */
+    doStep(step, &f, &fTwin);
+    checkVelocities(v0, fShort, fMesh, 0);
+}
+
+TEST_F(PmeMtsUpdateTest, ConservesEnergyOfHarmonicOscillators)
+{
+    /* The stiff spring has a period of 50 steps, the soft spring,
+     * which is the slow force, is 20 times weaker. Up to nstcalcpme 4
+     * the outer time step is far below half the fast period,
+     * where impulse MTS gets resonances.
+     */
+    const real kFast  = 4*M_PI*M_PI/(50*50*ir_.delta_t*ir_.delta_t);
+    const real kSlow  = kFast/20;
+    const int  nsteps = 4000;
+    const int  nstcalcpme[] = { 1, 2, 4 };
+
+    std::vector<real> x0(x_), v0(v_);
+    for (int n = 0; n < 3; n++)
+    {
+        int k = nstcalcpme[n];
+
+        setNstcalcpme(k);
+        x_ = x0;
+        v_ = v0;
+        std::vector<double> energy;
+        for (int step = 0; step < nsteps; step++)
+        {
+            std::vector<real> f(c_natoms*DIM), fMesh(c_natoms*DIM);
+            for (int j = 0; j < c_natoms*DIM; j++)
+            {
+                f[j] = -kFast*x_[j];
+                if (!fr_.bPMEMTS || pme_mesh_impulse_step(&fr_, &ir_, step))
+                {
+                    f[j] += -kSlow*x_[j];
+                }
+                fMesh[j] = -kSlow*x_[j];
+            }
+            double epot = 0;
+            for (int j = 0; j < c_natoms*DIM; j++)
+            {
+                epot += 0.5*(kFast + kSlow)*x_[j]*x_[j];
+            }
+            std::vector<real> vPrev(v_);
+            doStep(step, &f, &fMesh);
+            /* The leap-frog kinetic energy at the full step */
+            double ekin = 0;
+            for (int i = 0; i < c_natoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    double v = 0.5*(vPrev[i*DIM + d] + v_[i*DIM + d]);
+                    ekin    += 0.5*massT_[i]*v*v;
+                }
+            }
+            energy.push_back(ekin + epot);
+        }
+        /* Compare the average energy over the first and last quarter.
+         * The limits are a few times the drift and the fluctuation
+         * in single precision. Leaving out the mesh force of f at impulse
+         * steps gives a 100 times larger drift and at least a 3 times
+         * larger fluctuation.
+         */
+        double first = 0, last = 0;
+        for (int step = 0; step < nsteps/4; step++)
+        {
+            first += energy[step];
+            last  += energy[nsteps - 1 - step];
+        }
+        first /= nsteps/4;
+        last  /= nsteps/4;
+        EXPECT_NEAR(first, last, 5e-6*first) << "nstcalcpme " << k;
+        for (int step = 0; step < nsteps; step++)
+        {
+            ASSERT_NEAR(first, energy[step], 4e-3*first)
+            << "nstcalcpme " << k << " step " << step;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,305 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the SIMD PME B-spline spreading and gathering against the
+ * scalar reference, and reports their relative cost.
+ *
+ * The timings are recorded in the XML test output when GMX_PME_SIMD_BENCH
+ * is set in the environment, see simdbenchmark.h.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include "config.h"
+#include <cmath>
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+#include <gtest/gtest.h>
+#include "types/simple.h"
+
+#include "simdbenchmark.h"
+
+#include "../pme_simd.h"
+
+#ifdef PME_SIMD
+#define PME_ORDER 4
+#include "../pme_simd.h"
+#define PME_ORDER 5
+#include "../pme_simd.h"
+#define PME_ORDER 6
+#include "../pme_simd.h"
+#define PME_ORDER 7
+#include "../pme_simd.h"
+#define PME_ORDER 8
+#include "../pme_simd.h"
+#define PME_ORDER 9
+#include "../pme_simd.h"
+#define PME_ORDER 10
+#include "../pme_simd.h"
+#define PME_ORDER 11
+#include "../pme_simd.h"
+#define PME_ORDER 12
+#include "../pme_simd.h"
+#endif
+
+namespace
+{
+
+#ifdef PME_SIMD
+
+typedef void (*spread_func_t)(real *, int, int, int, int, int, real,
+                              const real *, const real *, const real *);
+typedef void (*gather_func_t)(const real *, int, int, int, int, int,
+                              const real *, const real *, const real *,
+                              const real *, const real *, const real *,
+                              real *, real *, real *);
+
+//! The SIMD spreading and gathering kernels for one PME order.
+struct PmeSimdKernels
+{
+    int           order;
+    spread_func_t spread;
+    gather_func_t gather;
+};
+
+//! The SIMD kernels for all supported orders.
+const PmeSimdKernels kernels[] = {
+    {  4, pme_spread_simd_4,  pme_gather_simd_4  },
+    {  5, pme_spread_simd_5,  pme_gather_simd_5  },
+    {  6, pme_spread_simd_6,  pme_gather_simd_6  },
+    {  7, pme_spread_simd_7,  pme_gather_simd_7  },
+    {  8, pme_spread_simd_8,  pme_gather_simd_8  },
+    {  9, pme_spread_simd_9,  pme_gather_simd_9  },
+    { 10, pme_spread_simd_10, pme_gather_simd_10 },
+    { 11, pme_spread_simd_11, pme_gather_simd_11 },
+    { 12, pme_spread_simd_12, pme_gather_simd_12 },
+};
+
+//! Scalar reference spreading, as the generic code in pme.c.
+void spread_ref(real *grid, int pny, int pnz, int order,
+                int i0, int j0, int k0, real qn,
+                const real *thx, const real *thy, const real *thz)
+{
+    for (int ithx = 0; ithx < order; ithx++)
+    {
+        real valx = qn*thx[ithx];
+        for (int ithy = 0; ithy < order; ithy++)
+        {
+            real valxy = valx*thy[ithy];
+            int  index = ((i0 + ithx)*pny + j0 + ithy)*pnz + k0;
+            for (int ithz = 0; ithz < order; ithz++)
+            {
+                grid[index + ithz] += valxy*thz[ithz];
+            }
+        }
+    }
+}
+
+//! Scalar reference gathering, as the generic code in pme.c.
+void gather_ref(const real *grid, int pny, int pnz, int order,
+                int i0, int j0, int k0,
+                const real *thx, const real *thy, const real *thz,
+                const real *dthx, const real *dthy, const real *dthz,
+                real *fx, real *fy, real *fz)
+{
+    for (int ithx = 0; ithx < order; ithx++)
+    {
+        for (int ithy = 0; ithy < order; ithy++)
+        {
+            int  index = ((i0 + ithx)*pny + j0 + ithy)*pnz + k0;
+            real fxy1  = 0, fz1 = 0;
+            for (int ithz = 0; ithz < order; ithz++)
+            {
+                real gval = grid[index + ithz];
+                fxy1 += thz[ithz]*gval;
+                fz1  += dthz[ithz]*gval;
+            }
+            *fx += dthx[ithx]*thy[ithy]*fxy1;
+            *fy += thx[ithx]*dthy[ithy]*fxy1;
+            *fz += thx[ithx]*thy[ithy]*fz1;
+        }
+    }
+}
+
+class PmeSimdTest : public ::testing::TestWithParam<PmeSimdKernels>
+{
+    public:
+        PmeSimdTest()
+        {
+            const int order = GetParam().order;
+
+            /* A small grid laid out as the PME grid: z-stride a multiple
+             * of the alignment and one SIMD width of padding.
+             */
+            nx_   = order + 2;
+            ny_   = order + 2;
+            nz_   = ((order + 2*PME_SIMD_ALIGN - 1)/PME_SIMD_ALIGN)*PME_SIMD_ALIGN;
+            size_ = nx_*ny_*nz_ + PME_SIMD_ALIGN;
+            /* Over-allocate so we can align by hand */
+            mem_.resize(size_ + PME_SIMD_ALIGN);
+            grid_ = &mem_[0];
+            while (((size_t)grid_) % (PME_SIMD_ALIGN*sizeof(real)) != 0)
+            {
+                grid_++;
+            }
+            ref_.resize(size_);
+            srand(1993);
+            for (int d = 0; d < 3; d++)
+            {
+                th_[d].resize(order);
+                dth_[d].resize(order);
+                for (int i = 0; i < order; i++)
+                {
+                    th_[d][i]  = rand()/(real)RAND_MAX;
+                    dth_[d][i] = rand()/(real)RAND_MAX - 0.5;
+                }
+            }
+        }
+
+        void fillGrid()
+        {
+            for (int i = 0; i < size_; i++)
+            {
+                grid_[i] = (i < nx_*ny_*nz_ ? rand()/(real)RAND_MAX - 0.5 : 0);
+                ref_[i]  = grid_[i];
+            }
+        }
+
+        int               nx_, ny_, nz_, size_;
+        std::vector<real> mem_, ref_;
+        real             *grid_;
+        std::vector<real> th_[3], dth_[3];
+};
+
+TEST_P(PmeSimdTest, SpreadMatchesReference)
+{
+    const PmeSimdKernels &k = GetParam();
+
+    fillGrid();
+    /* Cover all offsets with respect to the SIMD alignment */
+    for (int k0 = 0; k0 + k.order <= nz_; k0++)
+    {
+        k.spread(grid_, ny_, nz_, 1, 1, k0, 0.7,
+                 &th_[0][0], &th_[1][0], &th_[2][0]);
+        spread_ref(&ref_[0], ny_, nz_, k.order, 1, 1, k0, 0.7,
+                   &th_[0][0], &th_[1][0], &th_[2][0]);
+    }
+    for (int i = 0; i < size_; i++)
+    {
+        EXPECT_NEAR(ref_[i], grid_[i], GMX_REAL_EPS*16*(1 + std::fabs(ref_[i])))
+        << "at grid index " << i;
+    }
+}
+
+TEST_P(PmeSimdTest, GatherMatchesReference)
+{
+    const PmeSimdKernels &k = GetParam();
+
+    fillGrid();
+    for (int k0 = 0; k0 + k.order <= nz_; k0++)
+    {
+        real f[DIM]   = { 0, 0, 0 };
+        real fr[DIM]  = { 0, 0, 0 };
+        real fabs_sum = 0;
+
+        k.gather(grid_, ny_, nz_, 1, 1, k0,
+                 &th_[0][0], &th_[1][0], &th_[2][0],
+                 &dth_[0][0], &dth_[1][0], &dth_[2][0],
+                 &f[XX], &f[YY], &f[ZZ]);
+        gather_ref(&ref_[0], ny_, nz_, k.order, 1, 1, k0,
+                   &th_[0][0], &th_[1][0], &th_[2][0],
+                   &dth_[0][0], &dth_[1][0], &dth_[2][0],
+                   &fr[XX], &fr[YY], &fr[ZZ]);
+        /* The summation order differs, so scale with the number of terms */
+        fabs_sum = k.order*k.order*k.order;
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_NEAR(fr[d], f[d], GMX_REAL_EPS*4*fabs_sum)
+            << "for k0 " << k0 << " dimension " << d;
+        }
+    }
+}
+
+TEST_P(PmeSimdTest, Benchmark)
+{
+    const PmeSimdKernels &k      = GetParam();
+    const int             nrep   = 20000;
+    gmx_cycles_t          c0, c1, c2;
+    real                  f[DIM] = { 0, 0, 0 };
+
+    if (!gmx::test::simdBenchmarkEnabled("GMX_PME_SIMD_BENCH"))
+    {
+        return;
+    }
+    fillGrid();
+    c0 = gmx_cycles_read();
+    for (int r = 0; r < nrep; r++)
+    {
+        int k0 = r % (nz_ - k.order + 1);
+        spread_ref(&ref_[0], ny_, nz_, k.order, 1, 1, k0, 0.7,
+                   &th_[0][0], &th_[1][0], &th_[2][0]);
+        gather_ref(&ref_[0], ny_, nz_, k.order, 1, 1, k0,
+                   &th_[0][0], &th_[1][0], &th_[2][0],
+                   &dth_[0][0], &dth_[1][0], &dth_[2][0],
+                   &f[XX], &f[YY], &f[ZZ]);
+    }
+    c1 = gmx_cycles_read();
+    for (int r = 0; r < nrep; r++)
+    {
+        int k0 = r % (nz_ - k.order + 1);
+        k.spread(grid_, ny_, nz_, 1, 1, k0, 0.7,
+                 &th_[0][0], &th_[1][0], &th_[2][0]);
+        k.gather(grid_, ny_, nz_, 1, 1, k0,
+                 &th_[0][0], &th_[1][0], &th_[2][0],
+                 &dth_[0][0], &dth_[1][0], &dth_[2][0],
+                 &f[XX], &f[YY], &f[ZZ]);
+    }
+    c2 = gmx_cycles_read();
+    gmx::test::recordSimdBenchmark("spreadGather", c1 - c0, c2 - c1, nrep);
+}
+
+//! Makes gtest print the order instead of the raw bytes.
+void PrintTo(const PmeSimdKernels &k, std::ostream *os)
+{
+    *os << "order " << k.order;
+}
+
+INSTANTIATE_TEST_CASE_P(AllOrders, PmeSimdTest, ::testing::ValuesIn(kernels));
+
+#endif
+
+} // namespace
@@ -0,0 +1,319 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests the SIMD SETTLE kernels against the scalar ones,
+ * and reports their relative cost.
+ *
+ * The timings are recorded in the XML test output when GMX_SETTLE_BENCH
+ * is set in the environment, see simdbenchmark.h.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <gtest/gtest.h>
+#include "typedefs.h"
+#include "vec.h"
+#include "constr.h"
+#include "smalloc.h"
+
+#include "simdbenchmark.h"
+
+namespace
+{
+
+//! SPC water geometry and masses.
+const real dOH = 0.1, dHH = 0.1633, mO = 15.9994, mH = 1.008;
+
+class SettleTest : public ::testing::Test
+{
+    public:
+        SettleTest() : settled_(NULL)
+        {
+            settled_ = settle_init(mO, mH, 1/mO, 1/mH, dOH, dHH);
+            vscale_nhc_      = 1;
+            vetavar_.veta    = 0;
+            vetavar_.rscale  = 1;
+            vetavar_.vscale  = 1;
+            vetavar_.rvscale = 1;
+            vetavar_.alpha   = 1;
+            vetavar_.vscale_nhc = &vscale_nhc_;
+        }
+        ~SettleTest()
+        {
+            sfree(settled_);
+        }
+
+        /*! \brief Generates nwater randomly oriented waters at random positions,
+         * with unconstrained updated positions and velocities.
+         */
+        void generate(int nwater)
+        {
+            srand(1993);
+            iatoms_.resize(nwater*4);
+            x_.resize(nwater*3*DIM);
+            xp_.resize(nwater*3*DIM);
+            v_.resize(nwater*3*DIM);
+            for (int w = 0; w < nwater; w++)
+            {
+                /* A water in the xy-plane, rotated randomly */
+                real h    = std::sqrt(dOH*dOH - 0.25*dHH*dHH);
+                rvec r[3] = { { 0, 0, 0 }, { h, 0.5*dHH, 0 }, { h, -0.5*dHH, 0 } };
+                rvec axis, com;
+                real phi  = 2*M_PI*uniform(), c, s, len;
+
+                for (int d = 0; d < DIM; d++)
+                {
+                    axis[d] = uniform() - 0.5;
+                    com[d]  = 3*uniform();
+                }
+                len = norm(axis);
+                svmul(1/len, axis, axis);
+                c   = std::cos(phi);
+                s   = std::sin(phi);
+                for (int a = 0; a < 3; a++)
+                {
+                    /* Rodrigues rotation */
+                    rvec cr, rr;
+                    real dot = iprod(axis, r[a]);
+                    cprod(axis, r[a], cr);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        rr[d] = r[a][d]*c + cr[d]*s + axis[d]*dot*(1 - c);
+                    }
+                    int i = w*3 + a;
+                    iatoms_[w*4 + 1 + a] = i;
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        x_[i*DIM+d]  = com[d] + rr[d];
+                        v_[i*DIM+d]  = uniform() - 0.5;
+                        xp_[i*DIM+d] = x_[i*DIM+d] + 0.002*v_[i*DIM+d];
+                    }
+                }
+                iatoms_[w*4] = 0;
+            }
+        }
+
+        int natoms() const
+        {
+            return x_.size()/DIM;
+        }
+
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        static real uniform()
+        {
+            return rand()/(real)RAND_MAX;
+        }
+
+        //! Runs csettle, with or without SIMD, on copies of the input.
+        void runSettle(bool bSimd, std::vector<real> *xp, std::vector<real> *v,
+                       tensor vir, int *error)
+        {
+            *xp = xp_;
+            *v  = v_;
+            clear_mat(vir);
+            settle_set_simd(settled_, bSimd);
+            csettle(settled_, iatoms_.size()/4, &iatoms_[0], NULL,
+                    &x_[0], &(*xp)[0], 1/0.002, &(*v)[0], natoms(),
+                    vir, error, &vetavar_);
+        }
+
+        //! Runs settle_proj, with or without SIMD, on copies of the input.
+        void runProj(bool bSimd, std::vector<real> *derp, tensor vir)
+        {
+            *derp = v_;
+            clear_mat(vir);
+            settle_set_simd(settled_, bSimd);
+            settle_proj(NULL, settled_, econqVeloc,
+                        iatoms_.size()/4, &iatoms_[0], NULL,
+                        as_rvec(&x_), as_rvec(&v_), as_rvec(derp),
+                        natoms(), vir, &vetavar_);
+        }
+
+        gmx_settledata_t     settled_;
+        double               vscale_nhc_;
+        t_vetavars           vetavar_;
+        std::vector<t_iatom> iatoms_;
+        std::vector<real>    x_, xp_, v_;
+};
+
+TEST_F(SettleTest, SatisfiesConstraints)
+{
+    /* Not a multiple of any SIMD width */
+    generate(37);
+    for (int simd = 0; simd < 2; simd++)
+    {
+        std::vector<real> xp, v;
+        tensor            vir;
+        int               error;
+
+        runSettle(simd, &xp, &v, vir, &error);
+        EXPECT_EQ(-1, error);
+        rvec *x = as_rvec(&xp);
+        for (int w = 0; w < natoms()/3; w++)
+        {
+            rvec d;
+            rvec_sub(x[3*w], x[3*w+1], d);
+            EXPECT_NEAR(dOH, norm(d), 10*GMX_REAL_EPS) << "water " << w << " simd " << simd;
+            rvec_sub(x[3*w], x[3*w+2], d);
+            EXPECT_NEAR(dOH, norm(d), 10*GMX_REAL_EPS) << "water " << w << " simd " << simd;
+            rvec_sub(x[3*w+1], x[3*w+2], d);
+            EXPECT_NEAR(dHH, norm(d), 10*GMX_REAL_EPS) << "water " << w << " simd " << simd;
+        }
+    }
+}
+
+TEST_F(SettleTest, SimdMatchesScalar)
+{
+    std::vector<real> xp_ref, v_ref, xp, v;
+    tensor            vir_ref, vir;
+    int               error_ref, error;
+
+    generate(37);
+    runSettle(false, &xp_ref, &v_ref, vir_ref, &error_ref);
+    runSettle(true, &xp, &v, vir, &error);
+    EXPECT_EQ(error_ref, error);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        EXPECT_NEAR(xp_ref[i], xp[i], 10*GMX_REAL_EPS*(1 + std::fabs(xp_ref[i])))
+        << "element " << i;
+        /* The velocity correction is the position correction over dt */
+        EXPECT_NEAR(v_ref[i], v[i], 10*GMX_REAL_EPS/0.002*(1 + std::fabs(xp_ref[i])))
+        << "element " << i;
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(vir_ref[d][d2], vir[d][d2], 1e3*GMX_REAL_EPS*(1 + std::fabs(vir_ref[d][d2])));
+        }
+    }
+}
+
+TEST_F(SettleTest, ProjectionRemovesBondVelocities)
+{
+    std::vector<real> derp_ref, derp;
+    tensor            vir_ref, vir;
+
+    generate(37);
+    for (int simd = 0; simd < 2; simd++)
+    {
+        runProj(simd, &derp, vir);
+        rvec *x  = as_rvec(&x_);
+        rvec *dv = as_rvec(&derp);
+        for (int w = 0; w < natoms()/3; w++)
+        {
+            const int pairs[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+            for (int p = 0; p < 3; p++)
+            {
+                int  a = 3*w + pairs[p][0], b = 3*w + pairs[p][1];
+                rvec r, dvab;
+                rvec_sub(x[a], x[b], r);
+                rvec_sub(dv[a], dv[b], dvab);
+                EXPECT_NEAR(0, iprod(r, dvab), 100*GMX_REAL_EPS)
+                << "water " << w << " pair " << p << " simd " << simd;
+            }
+        }
+    }
+
+    runProj(false, &derp_ref, vir_ref);
+    runProj(true, &derp, vir);
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        EXPECT_NEAR(derp_ref[i], derp[i], 10*GMX_REAL_EPS*(1 + std::fabs(derp_ref[i])))
+        << "element " << i;
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(vir_ref[d][d2], vir[d][d2], 1e3*GMX_REAL_EPS*(1 + std::fabs(vir_ref[d][d2])));
+        }
+    }
+}
+
+TEST_F(SettleTest, Benchmark)
+{
+    const int         nwater = 4096, nrep = 20;
+    std::vector<real> xp, v, derp;
+    tensor            vir;
+    int               error;
+    gmx_cycles_t      c[2][2];
+
+    if (!gmx::test::simdBenchmarkEnabled("GMX_SETTLE_BENCH"))
+    {
+        return;
+    }
+    generate(nwater);
+    xp   = xp_;
+    v    = v_;
+    derp = v_;
+    for (int simd = 0; simd < 2; simd++)
+    {
+        settle_set_simd(settled_, simd);
+        /* After the first repeat we settle settled coordinates,
+         * which costs the same.
+         */
+        c[simd][0] = gmx_cycles_read();
+        for (int r = 0; r < nrep; r++)
+        {
+            clear_mat(vir);
+            csettle(settled_, nwater, &iatoms_[0], NULL,
+                    &x_[0], &xp[0], 1/0.002, &v[0], natoms(),
+                    vir, &error, &vetavar_);
+        }
+        c[simd][1] = gmx_cycles_read();
+        for (int r = 0; r < nrep; r++)
+        {
+            clear_mat(vir);
+            settle_proj(NULL, settled_, econqVeloc, nwater, &iatoms_[0], NULL,
+                        as_rvec(&x_), as_rvec(&v_), as_rvec(&derp),
+                        natoms(), vir, &vetavar_);
+        }
+        c[simd][0] = c[simd][1] - c[simd][0];
+        c[simd][1] = gmx_cycles_read() - c[simd][1];
+    }
+    gmx::test::recordSimdBenchmark("settle", c[0][0], c[1][0], nrep*nwater);
+    gmx::test::recordSimdBenchmark("settleProj", c[0][1], c[1][1], nrep*nwater);
+}
+
+} // namespace
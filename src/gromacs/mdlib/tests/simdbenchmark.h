@@ -0,0 +1,82 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares helpers for timing the SIMD kernels against the scalar ones.
+ *
+ * \ingroup module_mdlibs
+ */
+#ifndef GMX_MDLIB_TESTS_SIMDBENCHMARK_H
+#define GMX_MDLIB_TESTS_SIMDBENCHMARK_H
+
+#include "gmx_cyclecounter.h"
+
+namespace gmx
+{
+namespace test
+{
+
+/*! \internal \brief
+ * Returns whether the kernels should be timed.
+ *
+ * \param[in] envVariable  Environment variable that enables the timing.
+ *
+ * The timing also needs a cycle counter.
+ *
+ * \ingroup module_mdlibs
+ */
+bool simdBenchmarkEnabled(const char *envVariable);
+
+/*! \internal \brief
+ * Records the cycles of a scalar and a SIMD kernel with the current test.
+ *
+ * \param[in] name          Name of the kernel, used as the property name.
+ * \param[in] scalarCycles  Cycles of the scalar kernel.
+ * \param[in] simdCycles    Cycles of the SIMD kernel.
+ * \param[in] count         Number of items processed by each kernel.
+ *
+ * The cycles per item and the speedup are recorded as a test property,
+ * which is written with the XML output of gtest (--gtest_output=xml).
+ *
+ * \ingroup module_mdlibs
+ */
+void recordSimdBenchmark(const char *name,
+                         gmx_cycles_t scalarCycles, gmx_cycles_t simdCycles,
+                         double count);
+
+} // namespace test
+} // namespace gmx
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2012, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the leap-frog update with fused half-step kinetic energy
+ * gives the same coordinates, velocities and kinetic energy tensor
+ * as the plain update followed by calc_ke_part.
+ *
+ * The plain path is selected with GMX_UPDATE_NO_SIMD.
+ *
+ * \ingroup module_mdlibs
+ */
+
+#include "config.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+#include "typedefs.h"
+#include "vec.h"
+#include "update.h"
+#include "nrnb.h"
+#include "gmx_omp_nthreads.h"
+
+namespace
+{
+
+//! The environment variable that turns off the fused update.
+const char *const c_noSimdEnv = "GMX_UPDATE_NO_SIMD";
+
+/*! \brief Random atoms with random masses, velocities and forces.
+ *
+ * The test parameter is the number of atoms. Counts that are not
+ * a multiple of the SIMD width check the plain C remainder loop
+ * of the fused update.
+ */
+class UpdateEkinhTest : public ::testing::TestWithParam<int>
+{
+    public:
+        UpdateEkinhTest()
+        {
+            int natoms = GetParam();
+
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+            cr_.duty   = (DUTY_PP | DUTY_PME);
+            gmx_omp_nthreads_init(NULL, &cr_, 1, 1, 1, FALSE, TRUE);
+            init_nrnb(&nrnb_);
+
+            clear_ivec(nFreeze_[0]);
+            clear_rvec(acc_[0]);
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI           = eiMD;
+            ir_.delta_t      = 0.002;
+            ir_.etc          = etcBERENDSEN;
+            ir_.opts.ngtc    = 1;
+            ir_.opts.ngacc   = 1;
+            ir_.opts.nFreeze = nFreeze_;
+            ir_.opts.acc     = acc_;
+
+            srand(1993);
+            x_.resize(natoms*DIM);
+            v_.resize(natoms*DIM);
+            f_.resize(natoms*DIM);
+            for (int i = 0; i < natoms*DIM; i++)
+            {
+                x_[i] = 3*uniform();
+                v_[i] = 2*(uniform() - 0.5);
+                f_[i] = 1000*(uniform() - 0.5);
+            }
+            massT_.resize(natoms);
+            invmass_.resize(natoms);
+            massT_dim_.resize(natoms*DIM);
+            invmass_dim_.resize(natoms*DIM);
+            ptype_.assign(natoms, eptAtom);
+            for (int i = 0; i < natoms; i++)
+            {
+                massT_[i]   = 1 + 15*uniform();
+                invmass_[i] = 1/massT_[i];
+                for (int d = 0; d < DIM; d++)
+                {
+                    massT_dim_[i*DIM + d]   = massT_[i];
+                    invmass_dim_[i*DIM + d] = invmass_[i];
+                }
+            }
+
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr          = natoms;
+            md_.homenr      = natoms;
+            md_.massT       = &massT_[0];
+            md_.invmass     = &invmass_[0];
+            md_.massT_dim   = &massT_dim_[0];
+            md_.invmass_dim = &invmass_dim_[0];
+            md_.ptype       = &ptype_[0];
+        }
+
+        static rvec *as_rvec(std::vector<real> *x)
+        {
+            return reinterpret_cast<rvec *>(&(*x)[0]);
+        }
+
+        static real uniform()
+        {
+            return rand()/(real)RAND_MAX;
+        }
+
+        /*! \brief Does one leap-frog step on copies of the input.
+         *
+         * The call sequence is the one of do_md: update_coords,
+         * update_constraints without constraints, which copies
+         * the new coordinates to the state, and calc_ke_part.
+         */
+        void runUpdate(bool bSimd, std::vector<real> *x, std::vector<real> *v,
+                       tensor ekinh, gmx_bool *bEkinhUpdate)
+        {
+            t_state        state;
+            gmx_ekindata_t ekind;
+            t_grp_tcstat   tcstat;
+            t_grp_acc      grpstat;
+            tensor         ekin_work[2];
+            tensor        *ekin_work_p = ekin_work;
+            gmx_update_t   upd;
+            matrix         M;
+            tensor         vir_part, vir;
+
+#ifdef _MSC_VER
+            _putenv_s(c_noSimdEnv, bSimd ? "" : "1");
+#else
+            if (bSimd)
+            {
+                unsetenv(c_noSimdEnv);
+            }
+            else
+            {
+                setenv(c_noSimdEnv, "1", 1);
+            }
+#endif
+            upd = init_update(NULL, &ir_);
+
+            *x = x_;
+            *v = v_;
+            std::memset(&state, 0, sizeof(state));
+            state.natoms = md_.nr;
+            state.nalloc = md_.nr;
+            state.x      = as_rvec(x);
+            state.v      = as_rvec(v);
+
+            std::memset(&tcstat, 0, sizeof(tcstat));
+            /* Berendsen scaling is applied in the update */
+            tcstat.lambda = 0.97;
+            std::memset(&grpstat, 0, sizeof(grpstat));
+            std::memset(ekin_work, 0, sizeof(ekin_work));
+            std::memset(&ekind, 0, sizeof(ekind));
+            ekind.ngtc      = 1;
+            ekind.tcstat    = &tcstat;
+            ekind.ekin_work = &ekin_work_p;
+            ekind.ngacc     = 1;
+            ekind.grpstat   = &grpstat;
+
+            clear_mat(M);
+            update_coords(NULL, 0, &ir_, &md_, &state, FALSE, as_rvec(&f_),
+                          FALSE, NULL, NULL, &ekind, M, NULL, upd, FALSE,
+                          etrtPOSITION, &cr_, &nrnb_, NULL, NULL);
+            *bEkinhUpdate = ekind.bEkinhUpdate;
+            update_constraints(NULL, 0, NULL, &ir_, &ekind, &md_, &state,
+                               FALSE, NULL, as_rvec(&f_), NULL, vir_part, vir,
+                               &cr_, &nrnb_, NULL, upd, NULL, FALSE, FALSE,
+                               FALSE, 0);
+            calc_ke_part(&state, &ir_.opts, &md_, &ekind, &nrnb_, FALSE, FALSE);
+            copy_mat(tcstat.ekinh, ekinh);
+        }
+
+        t_commrec                   cr_;
+        t_nrnb                      nrnb_;
+        ivec                        nFreeze_[1];
+        rvec                        acc_[1];
+        t_inputrec                  ir_;
+        t_mdatoms                   md_;
+        std::vector<real>           x_, v_, f_;
+        std::vector<real>           massT_, invmass_, massT_dim_, invmass_dim_;
+        std::vector<unsigned short> ptype_;
+};
+
+TEST_P(UpdateEkinhTest, FusedMatchesPlain)
+{
+    std::vector<real> x_ref, v_ref, x, v;
+    tensor            ekinh_ref, ekinh;
+    gmx_bool          bFused_ref, bFused;
+    real              ekin_scale;
+
+    runUpdate(false, &x_ref, &v_ref, ekinh_ref, &bFused_ref);
+    runUpdate(true, &x, &v, ekinh, &bFused);
+    EXPECT_FALSE(bFused_ref);
+#ifdef GMX_X86_SSE2
+    /* Otherwise the build has no SIMD update and both runs are plain */
+    EXPECT_TRUE(bFused);
+#endif
+    for (size_t i = 0; i < x_.size(); i++)
+    {
+        EXPECT_NEAR(v_ref[i], v[i], 10*GMX_REAL_EPS*(1 + std::fabs(v_ref[i])))
+        << "element " << i;
+        EXPECT_NEAR(x_ref[i], x[i], 10*GMX_REAL_EPS*(1 + std::fabs(x_ref[i])))
+        << "element " << i;
+    }
+    /* The off-diagonal elements are sums of terms with random signs,
+     * so we compare all elements relative to the trace.
+     */
+    ekin_scale = trace(ekinh_ref);
+    EXPECT_GT(ekin_scale, 0);
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            EXPECT_NEAR(ekinh_ref[d][d2], ekinh[d][d2], 1e2*GMX_REAL_EPS*ekin_scale)
+            << "element " << d << " " << d2;
+        }
+    }
+}
+
+/* 203 = 25*8 + 3 atoms is not a multiple of any SIMD width,
+ * 16 atoms fill whole SIMD iterations and 3 atoms are all done
+ * in the remainder loop.
+ */
+INSTANTIATE_TEST_CASE_P(AtomCounts, UpdateEkinhTest,
+                        ::testing::Values(3, 16, 203));
+
+} // namespace
@@ -137,6 +137,7 @@ void init_ekindata(FILE *log, gmx_mtop_t *mtop, t_grpopts *opts,
         snew(ekind->ekin_work_alloc[thread], ekind->ngtc+4);
         ekind->ekin_work[thread] = ekind->ekin_work_alloc[thread] + 2;
     }
+    ekind->bEkinhUpdate = FALSE;
 
     ekind->ngacc = opts->ngacc;
     snew(ekind->grpstat, opts->ngacc);
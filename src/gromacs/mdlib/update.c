@@ -70,6 +70,11 @@
 #include "gmx_omp_nthreads.h"
 #include "gmx_omp.h"
 
+#ifdef GMX_X86_SSE2
+#define UPDATE_SIMD
+#include "gmx_simd_widest.h"
+#endif
+
 /*For debugging, start at v(-dt/2) for velolcity verlet -- uncomment next line */
 /*#define STARTFROMDT2*/
 
@@ -91,12 +96,16 @@ typedef struct {
 } gmx_sd_sigma_t;
 
 typedef struct {
-    /* The random state for ngaussrand threads.
-     * Normal thermostats need just 1 random number generator,
-     * but SD and BD with OpenMP parallelization need 1 for each thread.
+    /* The seed for the counter-based random numbers. The random numbers
+     * for an atom only depend on the seed, the step and the global atom
+     * index, so they are independent of the parallelization and there is
+     * no random state that needs to be stored in checkpoint files.
      */
+    unsigned int    seed;
+    /* Buffers for the Gaussian random numbers of SD and BD, per thread */
     int             ngaussrand;
-    gmx_rng_t      *gaussrand;
+    real          **gaussrand;
+    int            *gaussrand_nalloc;
     /* BD stuff */
     real           *bd_rf;
     /* SD stuff */
@@ -116,6 +125,9 @@ typedef struct gmx_update
     rvec         *xp;
     int           xp_nalloc;
 
+    /* Use the SIMD leap-frog update with fused kinetic energy accumulation */
+    gmx_bool      bSimdEkinh;
+
     /* variable size arrays for andersen */
     gmx_bool *randatom;
     int      *randatom_list;
@@ -271,6 +283,134 @@ static void do_update_md(int start, int nrend, double dt,
     }
 }
 
+/* Leap-frog update for a single T-coupling group without acceleration,
+ * freeze groups, virtual sites and shells, which also computes
+ * the half-step kinetic energy tensor of the updated velocities.
+ * This saves calc_ke_part a pass over all velocities.
+ */
+static void do_update_md_ekinh(int start, int nrend, double dt, real lg,
+                               const real invmass[], const real massT[],
+                               const real invmass_dim[], const real massT_dim[],
+                               rvec x[], rvec xprime[], rvec v[], rvec f[],
+                               tensor ekin)
+{
+    double w_dt, hm;
+    real   vn;
+    int    n, d, m;
+#ifdef UPDATE_SIMD
+    real      *xr, *xpr, *vr, *fr;
+    int        i, r, l, c;
+    gmx_mm_pr  lg_S, dt_S, v_S, mv_S[DIM];
+    gmx_mm_pr  dd_S[DIM], s1_S[DIM], s2_S[DIM];
+    real       buf_array[3*GMX_SIMD_WIDTH_HERE+GMX_SIMD_WIDTH_HERE], *buf;
+#endif
+
+    clear_mat(ekin);
+
+    n = start;
+
+#ifdef UPDATE_SIMD
+    /* We treat x, v and f as flat real arrays and process
+     * GMX_SIMD_WIDTH_HERE atoms, i.e. DIM SIMD registers, per iteration.
+     * The lane of register r at index l then holds dimension
+     * (r*GMX_SIMD_WIDTH_HERE + l) % DIM, so the diagonal of the tensor
+     * is accumulated in dd_S and the off-diagonal elements are obtained
+     * from products with the velocities shifted by 1 and 2 reals.
+     */
+    xr  = x[0];
+    xpr = xprime[0];
+    vr  = v[0];
+    fr  = f[0];
+
+    lg_S = gmx_set1_pr(lg);
+    dt_S = gmx_set1_pr(dt);
+    for (r = 0; r < DIM; r++)
+    {
+        dd_S[r] = gmx_setzero_pr();
+        s1_S[r] = gmx_setzero_pr();
+        s2_S[r] = gmx_setzero_pr();
+    }
+
+    /* The shifted loads read up to two reals beyond the last atom
+     * of an iteration, so we leave at least one atom for the plain C loop.
+     */
+    for (; n + GMX_SIMD_WIDTH_HERE < nrend; n += GMX_SIMD_WIDTH_HERE)
+    {
+        for (r = 0; r < DIM; r++)
+        {
+            i    = n*DIM + r*GMX_SIMD_WIDTH_HERE;
+
+            v_S  = gmx_add_pr(gmx_mul_pr(lg_S, gmx_loadu_pr(vr+i)),
+                              gmx_mul_pr(gmx_loadu_pr(fr+i),
+                                         gmx_mul_pr(gmx_loadu_pr(invmass_dim+i), dt_S)));
+            gmx_storeu_pr(vr+i, v_S);
+            gmx_storeu_pr(xpr+i, gmx_add_pr(gmx_loadu_pr(xr+i),
+                                            gmx_mul_pr(v_S, dt_S)));
+
+            mv_S[r] = gmx_mul_pr(gmx_loadu_pr(massT_dim+i), v_S);
+            dd_S[r] = gmx_add_pr(dd_S[r], gmx_mul_pr(mv_S[r], v_S));
+        }
+        /* All velocities of this iteration have been stored, the shifted
+         * loads only pick up not yet updated values in unused lanes.
+         */
+        for (r = 0; r < DIM; r++)
+        {
+            i       = n*DIM + r*GMX_SIMD_WIDTH_HERE;
+
+            s1_S[r] = gmx_add_pr(s1_S[r], gmx_mul_pr(mv_S[r], gmx_loadu_pr(vr+i+1)));
+            s2_S[r] = gmx_add_pr(s2_S[r], gmx_mul_pr(mv_S[r], gmx_loadu_pr(vr+i+2)));
+        }
+    }
+
+    buf = (real *)(((size_t)(buf_array+GMX_SIMD_WIDTH_HERE-1)) & (~((size_t)(GMX_SIMD_WIDTH_HERE*sizeof(real)-1))));
+
+    for (r = 0; r < DIM; r++)
+    {
+        gmx_store_pr(buf, dd_S[r]);
+        gmx_store_pr(buf+GMX_SIMD_WIDTH_HERE, s1_S[r]);
+        gmx_store_pr(buf+2*GMX_SIMD_WIDTH_HERE, s2_S[r]);
+        for (l = 0; l < GMX_SIMD_WIDTH_HERE; l++)
+        {
+            c           = (r*GMX_SIMD_WIDTH_HERE + l) % DIM;
+            ekin[c][c] += 0.5*buf[l];
+            if (c == XX)
+            {
+                ekin[XX][YY] += 0.5*buf[GMX_SIMD_WIDTH_HERE+l];
+                ekin[XX][ZZ] += 0.5*buf[2*GMX_SIMD_WIDTH_HERE+l];
+            }
+            else if (c == YY)
+            {
+                ekin[YY][ZZ] += 0.5*buf[GMX_SIMD_WIDTH_HERE+l];
+            }
+        }
+    }
+#endif
+
+    for (; n < nrend; n++)
+    {
+        w_dt = invmass[n]*dt;
+        hm   = 0.5*massT[n];
+
+        for (d = 0; d < DIM; d++)
+        {
+            vn           = lg*v[n][d] + f[n][d]*w_dt;
+            v[n][d]      = vn;
+            xprime[n][d] = x[n][d] + vn*dt;
+        }
+        for (d = 0; d < DIM; d++)
+        {
+            for (m = d; m < DIM; m++)
+            {
+                ekin[d][m] += hm*v[n][d]*v[n][m];
+            }
+        }
+    }
+
+    ekin[YY][XX] = ekin[XX][YY];
+    ekin[ZZ][XX] = ekin[XX][ZZ];
+    ekin[ZZ][YY] = ekin[YY][ZZ];
+}
+
 static void do_update_vv_vel(int start, int nrend, double dt,
                              t_grp_tcstat *tcstat, t_grp_acc *gstat,
                              rvec accel[], ivec nFreeze[], real invmass[],
@@ -478,37 +618,6 @@ static void do_update_visc(int start, int nrend, double dt,
     }
 }
 
-/* Allocates and initializes sd->gaussrand[i] for i=1, i<sd->ngaussrand,
- * Using seeds generated from sd->gaussrand[0].
- */
-static void init_multiple_gaussrand(gmx_stochd_t *sd)
-{
-    int           ngr, i;
-    unsigned int *seed;
-
-    ngr = sd->ngaussrand;
-    snew(seed, ngr);
-
-    for (i = 1; i < ngr; i++)
-    {
-        seed[i] = gmx_rng_uniform_uint32(sd->gaussrand[0]);
-    }
-
-#pragma omp parallel num_threads(ngr)
-    {
-        int th;
-
-        th = gmx_omp_get_thread_num();
-        if (th > 0)
-        {
-            /* Initialize on each thread to have thread-local memory alloced */
-            sd->gaussrand[th] = gmx_rng_init(seed[th]);
-        }
-    }
-
-    sfree(seed);
-}
-
 static gmx_stochd_t *init_stochd(FILE *fplog, t_inputrec *ir, int nthreads)
 {
     gmx_stochd_t   *sd;
@@ -518,28 +627,16 @@ static gmx_stochd_t *init_stochd(FILE *fplog, t_inputrec *ir, int nthreads)
 
     snew(sd, 1);
 
-    /* Initiate random number generator for langevin type dynamics,
-     * for BD, SD or velocity rescaling temperature coupling.
+    /* The random numbers for langevin type dynamics, for BD, SD,
+     * velocity rescaling and Andersen temperature coupling.
      */
+    sd->seed = ir->ld_seed;
+
     if (ir->eI == eiBD || EI_SD(ir->eI))
     {
         sd->ngaussrand = nthreads;
-    }
-    else
-    {
-        sd->ngaussrand = 1;
-    }
-    snew(sd->gaussrand, sd->ngaussrand);
-
-    /* Initialize the first random generator */
-    sd->gaussrand[0] = gmx_rng_init(ir->ld_seed);
-
-    if (sd->ngaussrand > 1)
-    {
-        /* Initialize the rest of the random number generators,
-         * using the first one to generate seeds.
-         */
-        init_multiple_gaussrand(sd);
+        snew(sd->gaussrand, sd->ngaussrand);
+        snew(sd->gaussrand_nalloc, sd->ngaussrand);
     }
 
     ngtc = ir->opts.ngtc;
@@ -625,40 +722,32 @@ static gmx_stochd_t *init_stochd(FILE *fplog, t_inputrec *ir, int nthreads)
     return sd;
 }
 
-void get_stochd_state(gmx_update_t upd, t_state *state)
-{
-    /* Note that we only get the state of the first random generator,
-     * even if there are multiple. This avoids repetition.
-     */
-    gmx_rng_get_state(upd->sd->gaussrand[0], state->ld_rng, state->ld_rngi);
-}
-
-void set_stochd_state(gmx_update_t upd, t_state *state)
+/* Returns Gaussian random numbers for the home atoms start to end
+ * of thread th, 4 for each of the nsub sub counters sub0 to sub0+nsub-1,
+ * stored as rnd[((n - start)*nsub + s)*4 + d].
+ * The SD and BD integrators use only 3 of each 4, one for each dimension.
+ */
+static const real *get_gaussrand(gmx_stochd_t *sd, int th,
+                                 gmx_large_int_t step, const t_commrec *cr,
+                                 int start, int end, int sub0, int nsub)
 {
-    gmx_stochd_t *sd;
-    int           i;
+    int n;
 
-    sd = upd->sd;
-
-    gmx_rng_set_state(sd->gaussrand[0], state->ld_rng, state->ld_rngi[0]);
-
-    if (sd->ngaussrand > 1)
+    n = (end - start)*nsub*4;
+    if (n > sd->gaussrand_nalloc[th])
     {
-        /* We only end up here with SD or BD with OpenMP.
-         * Destroy and reinitialize the rest of the random number generators,
-         * using seeds generated from the first one.
-         * Although this doesn't recover the previous state,
-         * it at least avoids repetition, which is most important.
-         * Exaclty restoring states with all MPI+OpenMP setups is difficult
-         * and as the integrator is random to start with, doesn't gain us much.
-         */
-        for (i = 1; i < sd->ngaussrand; i++)
-        {
-            gmx_rng_destroy(sd->gaussrand[i]);
-        }
-
-        init_multiple_gaussrand(sd);
+        /* Allocate on the thread to have thread-local memory */
+        sd->gaussrand_nalloc[th] = over_alloc_dd(n);
+        srenew(sd->gaussrand[th], sd->gaussrand_nalloc[th]);
     }
+
+    /* Without DD the local atom index is the global index */
+    gmx_rng_cycle_gaussian_table_batch(sd->seed, RND_SEED_UPDATE, step,
+                                       end - start,
+                                       DOMAINDECOMP(cr) ? cr->dd->gatindex + start : NULL,
+                                       start, sub0, nsub, sd->gaussrand[th]);
+
+    return sd->gaussrand[th];
 }
 
 gmx_update_t init_update(FILE *fplog, t_inputrec *ir)
@@ -678,11 +767,20 @@ gmx_update_t init_update(FILE *fplog, t_inputrec *ir)
     upd->randatom_list      = NULL;
     upd->randatom_list_init = FALSE; /* we have not yet cleared the data structure at this point */
 
+#ifdef UPDATE_SIMD
+    /* GMX_UPDATE_NO_SIMD selects the plain C update followed
+     * by a separate kinetic energy pass in calc_ke_part.
+     */
+    upd->bSimdEkinh = (ir->eI == eiMD && getenv("GMX_UPDATE_NO_SIMD") == NULL);
+#else
+    upd->bSimdEkinh = FALSE;
+#endif
+
     return upd;
 }
 
 static void do_update_sd1(gmx_stochd_t *sd,
-                          gmx_rng_t gaussrand,
+                          const real *rnd,
                           int start, int nrend, double dt,
                           rvec accel[], ivec nFreeze[],
                           real invmass[], unsigned short ptype[],
@@ -729,7 +827,7 @@ static void do_update_sd1(gmx_stochd_t *sd,
         {
             if ((ptype[n] != eptVSite) && (ptype[n] != eptShell) && !nFreeze[gf][d])
             {
-                sd_V = ism*sig[gt].V*gmx_rng_gaussian_table(gaussrand);
+                sd_V = ism*sig[gt].V*rnd[(n - start)*4 + d];
 
                 v[n][d] = v[n][d]*sdc[gt].em
                     + (invmass[n]*f[n][d] + accel[ga][d])*tau_t[gt]*(1 - sdc[gt].em)
@@ -755,8 +853,14 @@ static void check_sd2_work_data_allocation(gmx_stochd_t *sd, int nrend)
     }
 }
 
+/* The SD2 integrator uses for each atom and step Gaussian random numbers
+ * with sub counter 0 for the initial sd_X, 1 and 2 for Vmh and sd_V
+ * in the first half and 3 and 4 for Xmh and sd_X in the second half.
+ * Thus rnd should contain sub counters 0 (or 1) to 2 for the first half
+ * and 3 to 4 for the second half.
+ */
 static void do_update_sd2(gmx_stochd_t *sd,
-                          gmx_rng_t gaussrand,
+                          const real *rnd,
                           gmx_bool bInitStep,
                           int start, int nrend,
                           rvec accel[], ivec nFreeze[],
@@ -778,12 +882,15 @@ static void do_update_sd2(gmx_stochd_t *sd,
     int    gf = 0, ga = 0, gt = 0;
     real   vn = 0, Vmh, Xmh;
     real   ism;
-    int    n, d;
+    int    nsub, n, d;
+    const real *rnd_n;
 
     sdc  = sd->sdc;
     sig  = sd->sdsig;
     sd_V = sd->sd_V;
 
+    nsub = ((bFirstHalf && bInitStep) ? 3 : 2);
+
     if (bFirstHalf)
     {
         for (n = 0; n < ngtc; n++)
@@ -812,6 +919,10 @@ static void do_update_sd2(gmx_stochd_t *sd,
         {
             gt  = cTC[n];
         }
+        /* The last two sub counters of this atom, with the initial sd_X
+         * at rnd_n[-4+d] on the initial step.
+         */
+        rnd_n = rnd + ((n - start)*nsub + nsub - 2)*4;
 
         for (d = 0; d < DIM; d++)
         {
@@ -825,11 +936,11 @@ static void do_update_sd2(gmx_stochd_t *sd,
                 {
                     if (bInitStep)
                     {
-                        sd_X[n][d] = ism*sig[gt].X*gmx_rng_gaussian_table(gaussrand);
+                        sd_X[n][d] = ism*sig[gt].X*rnd_n[-4 + d];
                     }
                     Vmh = sd_X[n][d]*sdc[gt].d/(tau_t[gt]*sdc[gt].c)
-                        + ism*sig[gt].Yv*gmx_rng_gaussian_table(gaussrand);
-                    sd_V[n][d] = ism*sig[gt].V*gmx_rng_gaussian_table(gaussrand);
+                        + ism*sig[gt].Yv*rnd_n[d];
+                    sd_V[n][d] = ism*sig[gt].V*rnd_n[4 + d];
 
                     v[n][d] = vn*sdc[gt].em
                         + (invmass[n]*f[n][d] + accel[ga][d])*tau_t[gt]*(1 - sdc[gt].em)
@@ -848,8 +959,8 @@ static void do_update_sd2(gmx_stochd_t *sd,
                         (xprime[n][d] - x[n][d])/(tau_t[gt]*(sdc[gt].eph - sdc[gt].emh));
 
                     Xmh = sd_V[n][d]*tau_t[gt]*sdc[gt].d/(sdc[gt].em-1)
-                        + ism*sig[gt].Yx*gmx_rng_gaussian_table(gaussrand);
-                    sd_X[n][d] = ism*sig[gt].X*gmx_rng_gaussian_table(gaussrand);
+                        + ism*sig[gt].Yx*rnd_n[d];
+                    sd_X[n][d] = ism*sig[gt].X*rnd_n[4 + d];
 
                     xprime[n][d] += sd_X[n][d] - Xmh;
 
@@ -874,7 +985,7 @@ static void do_update_bd(int start, int nrend, double dt,
                          rvec x[], rvec xprime[], rvec v[],
                          rvec f[], real friction_coefficient,
                          int ngtc, real tau_t[], real ref_t[],
-                         real *rf, gmx_rng_t gaussrand)
+                         real *rf, const real *rnd)
 {
     /* note -- these appear to be full step velocities . . .  */
     int    gf = 0, gt = 0;
@@ -913,13 +1024,13 @@ static void do_update_bd(int start, int nrend, double dt,
             {
                 if (friction_coefficient != 0)
                 {
-                    vn = invfr*f[n][d] + rf[gt]*gmx_rng_gaussian_table(gaussrand);
+                    vn = invfr*f[n][d] + rf[gt]*rnd[(n - start)*4 + d];
                 }
                 else
                 {
                     /* NOTE: invmass = 2/(mass*friction_constant*dt) */
                     vn = 0.5*invmass[n]*f[n][d]*dt
-                        + sqrt(0.5*invmass[n])*rf[gt]*gmx_rng_gaussian_table(gaussrand);
+                        + sqrt(0.5*invmass[n])*rf[gt]*rnd[(n - start)*4 + d];
                 }
 
                 v[n][d]      = vn;
@@ -993,58 +1104,64 @@ static void calc_ke_part_normal(rvec v[], t_grpopts *opts, t_mdatoms *md,
 
     nthread = gmx_omp_nthreads_get(emntUpdate);
 
-#pragma omp parallel for num_threads(nthread) schedule(static)
-    for (thread = 0; thread < nthread; thread++)
+    /* With the fused leap-frog update, ekin_work already contains
+     * the half-step kinetic energy of the current velocities.
+     */
+    if (!(ekind->bEkinhUpdate && !bEkinAveVel))
     {
-        int     start_t, end_t, n;
-        int     ga, gt;
-        rvec    v_corrt;
-        real    hm;
-        int     d, m;
-        matrix *ekin_sum;
-        real   *dekindl_sum;
-
-        start_t = md->start + ((thread+0)*md->homenr)/nthread;
-        end_t   = md->start + ((thread+1)*md->homenr)/nthread;
+#pragma omp parallel for num_threads(nthread) schedule(static)
+        for (thread = 0; thread < nthread; thread++)
+        {
+            int     start_t, end_t, n;
+            int     ga, gt;
+            rvec    v_corrt;
+            real    hm;
+            int     d, m;
+            matrix *ekin_sum;
+            real   *dekindl_sum;
 
-        ekin_sum    = ekind->ekin_work[thread];
-        dekindl_sum = &ekind->ekin_work[thread][opts->ngtc][0][0];
+            start_t = md->start + ((thread+0)*md->homenr)/nthread;
+            end_t   = md->start + ((thread+1)*md->homenr)/nthread;
 
-        for (gt = 0; gt < opts->ngtc; gt++)
-        {
-            clear_mat(ekin_sum[gt]);
-        }
+            ekin_sum    = ekind->ekin_work[thread];
+            dekindl_sum = &ekind->ekin_work[thread][opts->ngtc][0][0];
 
-        ga = 0;
-        gt = 0;
-        for (n = start_t; n < end_t; n++)
-        {
-            if (md->cACC)
+            for (gt = 0; gt < opts->ngtc; gt++)
             {
-                ga = md->cACC[n];
+                clear_mat(ekin_sum[gt]);
             }
-            if (md->cTC)
-            {
-                gt = md->cTC[n];
-            }
-            hm   = 0.5*md->massT[n];
 
-            for (d = 0; (d < DIM); d++)
-            {
-                v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
-            }
-            for (d = 0; (d < DIM); d++)
+            ga = 0;
+            gt = 0;
+            for (n = start_t; n < end_t; n++)
             {
-                for (m = 0; (m < DIM); m++)
+                if (md->cACC)
                 {
-                    /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
-                    ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
+                    ga = md->cACC[n];
+                }
+                if (md->cTC)
+                {
+                    gt = md->cTC[n];
+                }
+                hm   = 0.5*md->massT[n];
+
+                for (d = 0; (d < DIM); d++)
+                {
+                    v_corrt[d]  = v[n][d]  - grpstat[ga].u[d];
+                }
+                for (d = 0; (d < DIM); d++)
+                {
+                    for (m = 0; (m < DIM); m++)
+                    {
+                        /* if we're computing a full step velocity, v_corrt[d] has v(t).  Otherwise, v(t+dt/2) */
+                        ekin_sum[gt][m][d] += hm*v_corrt[m]*v_corrt[d];
+                    }
+                }
+                if (md->nMassPerturbed && md->bPerturbed[n])
+                {
+                    *dekindl_sum -=
+                        0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
                 }
-            }
-            if (md->nMassPerturbed && md->bPerturbed[n])
-            {
-                *dekindl_sum -=
-                    0.5*(md->massB[n] - md->massA[n])*iprod(v_corrt, v_corrt);
             }
         }
     }
@@ -1151,6 +1268,9 @@ void calc_ke_part(t_state *state, t_grpopts *opts, t_mdatoms *md,
     {
         calc_ke_part_visc(state->box, state->x, state->v, opts, md, ekind, nrnb, bEkinAveVel, bSaveEkinOld);
     }
+
+    /* The kinetic energy from the update has been used or is outdated */
+    ekind->bEkinhUpdate = FALSE;
 }
 
 extern void init_ekinstate(ekinstate_t *ekinstate, const t_inputrec *ir)
@@ -1395,8 +1515,8 @@ void update_tcouple(FILE             *fplog,
                                   state->nosehoover_xi, state->nosehoover_vxi, MassQ);
                 break;
             case etcVRESCALE:
-                vrescale_tcoupl(inputrec, ekind, dttc,
-                                state->therm_integral, upd->sd->gaussrand[0]);
+                vrescale_tcoupl(inputrec, step, ekind, dttc,
+                                state->therm_integral);
                 break;
         }
         /* rescale in place here */
@@ -1630,7 +1750,9 @@ void update_constraints(FILE             *fplog,
             end_th   = start + ((nrend-start)*(th+1))/nth;
 
             /* The second part of the SD integration */
-            do_update_sd2(upd->sd, upd->sd->gaussrand[th],
+            do_update_sd2(upd->sd,
+                          get_gaussrand(upd->sd, th, step, cr,
+                                        start_th, end_th, 3, 2),
                           FALSE, start_th, end_th,
                           inputrec->opts.acc, inputrec->opts.nFreeze,
                           md->invmass, md->ptype,
@@ -1817,7 +1939,7 @@ void update_coords(FILE             *fplog,
                    gmx_constr_t      constr,
                    t_idef           *idef)
 {
-    gmx_bool          bNH, bPR, bLastStep, bLog = FALSE, bEner = FALSE;
+    gmx_bool          bNH, bPR, bEkinh, bLastStep, bLog = FALSE, bEner = FALSE;
     double            dt, alpha;
     real             *imass, *imassin;
     rvec             *force;
@@ -1827,7 +1949,7 @@ void update_coords(FILE             *fplog,
     int              *icom = NULL;
     tensor            vir_con;
     rvec             *vcom, *xcom, *vall, *xall, *xin, *vin, *forcein, *fall, *xpall, *xprimein, *xprime;
-    int               nth, th;
+    int               nth, th, nstlr;
 
     /* Running the velocity half does nothing except for velocity verlet */
     if ((UpdatePart == etrtVELOCITY1 || UpdatePart == etrtVELOCITY2) &&
@@ -1859,14 +1981,19 @@ void update_coords(FILE             *fplog,
     bNH = inputrec->etc == etcNOSEHOOVER;
     bPR = ((inputrec->epc == epcPARRINELLORAHMAN) || (inputrec->epc == epcMTTK));
 
-    if (bDoLR && inputrec->nstcalclr > 1 && !EI_VV(inputrec->eI))  /* get this working with VV? */
+    /* With PME multiple time stepping f_lr contains the PME mesh forces,
+     * which are applied as an impulse every nstcalcpme steps (r-RESPA).
+     */
+    nstlr = (inputrec->nstcalcpme > 1 ? inputrec->nstcalcpme : inputrec->nstcalclr);
+
+    if (bDoLR && nstlr > 1 && !EI_VV(inputrec->eI))  /* get this working with VV? */
     {
-        /* Store the total force + nstcalclr-1 times the LR force
+        /* Store the total force + nstlr-1 times the LR force
          * in forces_lr, so it can be used in a normal update algorithm
          * to produce twin time stepping.
          */
         /* is this correct in the new construction? MRS */
-        combine_forces(inputrec->nstcalclr, constr, inputrec, md, idef, cr,
+        combine_forces(nstlr, constr, inputrec, md, idef, cr,
                        step, state, bMolPBC,
                        start, nrend, f, f_lr, nrnb);
         force = f_lr;
@@ -1898,6 +2025,23 @@ void update_coords(FILE             *fplog,
         check_sd2_work_data_allocation(upd->sd, nrend);
     }
 
+    /* When nothing changes the velocities between the update
+     * and calc_ke_part, we can accumulate the half-step kinetic energy
+     * in the update loop. This requires plain leap-frog with one
+     * T-coupling group and no constraints, freezing, acceleration,
+     * mass perturbation, virtual sites or shells.
+     */
+    bEkinh = (upd->bSimdEkinh && inputrec->eI == eiMD &&
+              !bNH && !bPR && constr == NULL &&
+              inputrec->opts.ngtc == 1 &&
+              ekind->cosacc.cos_accel == 0 && !ekind->bNEMD &&
+              md->cFREEZE == NULL &&
+              !inputrec->opts.nFreeze[0][XX] &&
+              !inputrec->opts.nFreeze[0][YY] &&
+              !inputrec->opts.nFreeze[0][ZZ] &&
+              md->nMassPerturbed == 0 && md->nVsiteShell == 0 &&
+              md->invmass_dim != NULL);
+
 #pragma omp parallel for num_threads(nth) schedule(static) private(alpha)
     for (th = 0; th < nth; th++)
     {
@@ -1909,7 +2053,18 @@ void update_coords(FILE             *fplog,
         switch (inputrec->eI)
         {
             case (eiMD):
-                if (ekind->cosacc.cos_accel == 0)
+                if (bEkinh)
+                {
+                    do_update_md_ekinh(start_th, end_th, dt,
+                                       ekind->tcstat[0].lambda,
+                                       md->invmass, md->massT,
+                                       md->invmass_dim, md->massT_dim,
+                                       state->x, xprime, state->v, force,
+                                       ekind->ekin_work[th][0]);
+                    /* Mass perturbation is excluded, so dEkin/dlambda=0 */
+                    ekind->ekin_work[th][inputrec->opts.ngtc][0][0] = 0;
+                }
+                else if (ekind->cosacc.cos_accel == 0)
                 {
                     do_update_md(start_th, end_th, dt,
                                  ekind->tcstat, state->nosehoover_vxi,
@@ -1933,7 +2088,9 @@ void update_coords(FILE             *fplog,
                 }
                 break;
             case (eiSD1):
-                do_update_sd1(upd->sd, upd->sd->gaussrand[th],
+                do_update_sd1(upd->sd,
+                              get_gaussrand(upd->sd, th, step, cr,
+                                            start_th, end_th, 0, 1),
                               start_th, end_th, dt,
                               inputrec->opts.acc, inputrec->opts.nFreeze,
                               md->invmass, md->ptype,
@@ -1945,7 +2102,10 @@ void update_coords(FILE             *fplog,
                 /* The SD update is done in 2 parts, because an extra constraint step
                  * is needed
                  */
-                do_update_sd2(upd->sd, upd->sd->gaussrand[th],
+                do_update_sd2(upd->sd,
+                              get_gaussrand(upd->sd, th, step, cr,
+                                            start_th, end_th,
+                                            bInitStep ? 0 : 1, bInitStep ? 3 : 2),
                               bInitStep, start_th, end_th,
                               inputrec->opts.acc, inputrec->opts.nFreeze,
                               md->invmass, md->ptype,
@@ -1961,7 +2121,9 @@ void update_coords(FILE             *fplog,
                              state->x, xprime, state->v, force,
                              inputrec->bd_fric,
                              inputrec->opts.ngtc, inputrec->opts.tau_t, inputrec->opts.ref_t,
-                             upd->sd->bd_rf, upd->sd->gaussrand[th]);
+                             upd->sd->bd_rf,
+                             get_gaussrand(upd->sd, th, step, cr,
+                                           start_th, end_th, 0, 1));
                 break;
             case (eiVV):
             case (eiVVAK):
@@ -1994,6 +2156,7 @@ void update_coords(FILE             *fplog,
         }
     }
 
+    ekind->bEkinhUpdate = bEkinh;
 }
 
 
@@ -2051,7 +2214,7 @@ void correct_ekin(FILE *log, int start, int end, rvec v[], rvec vcm, real mass[]
             mv[XX], mv[YY], mv[ZZ]);
 }
 
-extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_large_int_t step, t_mdatoms *md, t_state *state, gmx_update_t upd, t_idef *idef, gmx_constr_t constr)
+extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_large_int_t step, const t_commrec *cr, t_mdatoms *md, t_state *state, gmx_update_t upd, t_idef *idef, gmx_constr_t constr)
 {
 
     int  i;
@@ -2071,7 +2234,7 @@ extern gmx_bool update_randomize_velocities(t_inputrec *ir, gmx_large_int_t step
             }
             upd->randatom_list_init = TRUE;
         }
-        andersen_tcoupl(ir, md, state, upd->sd->gaussrand[0], rate,
+        andersen_tcoupl(ir, step, cr, md, state, rate,
                         (ir->etc == etcANDERSEN) ? idef : NULL,
                         constr ? get_nblocks(constr) : 0,
                         constr ? get_sblock(constr) : NULL,
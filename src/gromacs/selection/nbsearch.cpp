@@ -42,18 +42,29 @@
  * Searches can then be performed with gmx_ana_nbsearch_is_within() and
  * gmx_ana_nbsearch_mindist(), or with versions that take the \c gmx_ana_pos_t
  * data structure.
+ * When many test positions are available at once,
+ * gmx_ana_nbsearch_all_within(), gmx_ana_nbsearch_all_mindist() and
+ * gmx_ana_nbsearch_find_pairs() process all of them in one call, which is
+ * considerably faster for large numbers of positions.
  * When the data structure is no longer required, it can be freed with
  * gmx_ana_nbsearch_free().
  *
  * \internal
  *
+ * The reference positions are sorted into grid cells, and the coordinates
+ * are stored cell by cell in separate x, y and z arrays.  The PBC shift
+ * required for a pair of cells is computed once outside the inner loop, so
+ * that the distances to all positions in a cell can be computed with a
+ * branchless loop that the compiler can vectorize.  The batched searches
+ * additionally sort the test positions into the same grid and process all
+ * test positions in a cell against each neighboring cell in turn.
+ *
  * \todo
  * The grid implementation could still be optimized in several different ways:
  *   - Triclinic grid cells are not the most efficient shape, but make PBC
- *     handling easier.
- *   - Precalculating the required PBC shift for a pair of cells outside the
- *     inner loop. After this is done, it should be quite straightforward to
- *     move to rectangular cells.
+ *     handling easier.  Now that the PBC shift is precalculated for each
+ *     pair of cells, it should be quite straightforward to move to
+ *     rectangular cells.
  *   - Pruning grid cells from the search list if they are completely outside
  *     the sphere that is being considered.
  *   - A better heuristic could be added for falling back to simple loops for a
@@ -76,6 +87,8 @@
 
 #include <math.h>
 
+#include <algorithm>
+
 #include "gromacs/legacyheaders/smalloc.h"
 #include "gromacs/legacyheaders/typedefs.h"
 #include "gromacs/legacyheaders/pbc.h"
@@ -126,14 +139,31 @@ struct gmx_ana_nbsearch_t
     ivec           ncelldim;
     /** Total number of cells. */
     int            ncells;
-    /** Number of reference positions in each cell. */
-    int           *ncatoms;
-    /** List of reference positions in each cell. */
-    atom_id      **catom;
-    /** Allocation counts for each \p catom[i]. */
-    int           *catom_nalloc;
-    /** Allocation count for the per-cell arrays. */
+    /*! \brief
+     * Index of the first reference position in each cell.
+     *
+     * The positions in cell \c ci are \c cellstart[ci] to
+     * \c cellstart[ci+1]-1 in \p xs, \p ys, \p zs and \p sortind.
+     */
+    int           *cellstart;
+    /** Allocation count for \p cellstart. */
     int            cells_nalloc;
+    /** Cell-sorted x coordinates of the reference positions. */
+    real          *xs;
+    /** Cell-sorted y coordinates of the reference positions. */
+    real          *ys;
+    /** Cell-sorted z coordinates of the reference positions. */
+    real          *zs;
+    /** Original index of each cell-sorted reference position. */
+    int           *sortind;
+    /** Cell index of each reference position (in original order). */
+    int           *refcell;
+    /** Number of positions in the largest cell. */
+    int            maxcellsize;
+    /** Squared distances to the positions of one cell. */
+    real          *r2buf;
+    /** Allocation count for \p r2buf. */
+    int            r2buf_nalloc;
     /** Number of neighboring cells to consider. */
     int            ngridnb;
     /** Offsets of the neighboring cells to consider. */
@@ -141,6 +171,17 @@ struct gmx_ana_nbsearch_t
     /** Allocation count for \p gnboffs. */
     int            gnboffs_nalloc;
 
+    /** Cell index of each test position in a batched search. */
+    int           *tcell;
+    /** Test position indices sorted by cell in a batched search. */
+    int           *tsortind;
+    /** Allocation count for \p tcell and \p tsortind. */
+    int            test_nalloc;
+    /** Index of the first test position in each cell in a batched search. */
+    int           *tcellstart;
+    /** Allocation count for \p tcellstart. */
+    int            tcells_nalloc;
+
     /** Stores test position during a pair loop. */
     rvec           xtest;
     /** Stores the previous returned position during a pair loop. */
@@ -183,15 +224,27 @@ gmx_ana_nbsearch_create(real cutoff, int maxn)
 
     d->xref_alloc   = NULL;
     d->ncells       = 0;
-    d->ncatoms      = NULL;
-    d->catom        = NULL;
-    d->catom_nalloc = 0;
+    d->cellstart    = NULL;
     d->cells_nalloc = 0;
+    d->xs           = NULL;
+    d->ys           = NULL;
+    d->zs           = NULL;
+    d->sortind      = NULL;
+    d->refcell      = NULL;
+    d->maxcellsize  = 0;
+    d->r2buf        = NULL;
+    d->r2buf_nalloc = 0;
 
     d->ngridnb        = 0;
     d->gnboffs        = NULL;
     d->gnboffs_nalloc = 0;
 
+    d->tcell         = NULL;
+    d->tsortind      = NULL;
+    d->test_nalloc   = 0;
+    d->tcellstart    = NULL;
+    d->tcells_nalloc = 0;
+
     return d;
 }
 
@@ -204,19 +257,17 @@ void
 gmx_ana_nbsearch_free(gmx_ana_nbsearch_t *d)
 {
     sfree(d->xref_alloc);
-    sfree(d->ncatoms);
-    if (d->catom)
-    {
-        int ci;
-
-        for (ci = 0; ci < d->ncells; ++ci)
-        {
-            sfree(d->catom[ci]);
-        }
-        sfree(d->catom);
-    }
-    sfree(d->catom_nalloc);
+    sfree(d->cellstart);
+    sfree(d->xs);
+    sfree(d->ys);
+    sfree(d->zs);
+    sfree(d->sortind);
+    sfree(d->refcell);
+    sfree(d->r2buf);
     sfree(d->gnboffs);
+    sfree(d->tcell);
+    sfree(d->tsortind);
+    sfree(d->tcellstart);
     sfree(d);
 }
 
@@ -299,19 +350,10 @@ grid_setup_cells(gmx_ana_nbsearch_t *d, t_pbc *pbc)
         }
     }
     /* Reallocate if necessary */
-    if (d->cells_nalloc < d->ncells)
+    if (d->cells_nalloc < d->ncells + 1)
     {
-        int  i;
-
-        srenew(d->ncatoms, d->ncells);
-        srenew(d->catom, d->ncells);
-        srenew(d->catom_nalloc, d->ncells);
-        for (i = d->cells_nalloc; i < d->ncells; ++i)
-        {
-            d->catom[i]        = NULL;
-            d->catom_nalloc[i] = 0;
-        }
-        d->cells_nalloc = d->ncells;
+        d->cells_nalloc = d->ncells + 1;
+        srenew(d->cellstart, d->cells_nalloc);
     }
     return true;
 }
@@ -328,6 +370,12 @@ grid_set_box(gmx_ana_nbsearch_t *d, t_pbc *pbc)
 {
     int dd;
 
+    /* The cell shifts below assume full 3D periodicity. */
+    /* TODO: Support for 2D and screw PBC */
+    if (pbc->ndim_ePBC != DIM)
+    {
+        return false;
+    }
     /* TODO: This check could be improved. */
     if (0.5*pbc->max_cutoff2 < d->cutoff2)
     {
@@ -391,6 +439,18 @@ grid_map_onto(gmx_ana_nbsearch_t *d, const rvec x, ivec cell)
             cell[dd] = (int)(x[dd] * d->recipcell[dd][dd]);
         }
     }
+    /* Rounding can put points on the upper box edge just outside the grid. */
+    for (dd = 0; dd < DIM; ++dd)
+    {
+        if (cell[dd] >= d->ncelldim[dd])
+        {
+            cell[dd] = d->ncelldim[dd] - 1;
+        }
+        else if (cell[dd] < 0)
+        {
+            cell[dd] = 0;
+        }
+    }
 }
 
 /*! \brief
@@ -401,46 +461,142 @@ grid_map_onto(gmx_ana_nbsearch_t *d, const rvec x, ivec cell)
  * \returns    Linear index of \p cell.
  */
 static int
-grid_index(gmx_ana_nbsearch_t *d, const ivec cell)
+grid_index(const gmx_ana_nbsearch_t *d, const ivec cell)
 {
     return cell[XX] + cell[YY] * d->ncelldim[XX]
            + cell[ZZ] * d->ncelldim[XX] * d->ncelldim[YY];
 }
 
 /*! \brief
- * Clears all grid cells.
+ * Finds a neighboring cell and the PBC shift needed to reach it.
  *
- * \param[in,out] d    Grid information.
+ * \param[in]  d        Grid information.
+ * \param[in]  testcell Cell of the test position.
+ * \param[in]  offset   Offset of the neighboring cell from \p testcell.
+ * \param[in]  x        Test position.
+ * \param[out] xshift   \p x shifted such that the reference positions in the
+ *     returned cell can be used without further PBC corrections.
+ * \returns    Linear index of the neighboring cell.
+ *
+ * The shift only depends on the pair of cells, so it is computed once for
+ * each cell instead of once for each reference position.
+ */
+static int
+grid_shifted_cell(const gmx_ana_nbsearch_t *d, const ivec testcell,
+                  const ivec offset, const rvec x, rvec xshift)
+{
+    ivec cell;
+    int  dd, m, n, shift;
+
+    copy_rvec(x, xshift);
+    for (dd = 0; dd < DIM; ++dd)
+    {
+        n        = d->ncelldim[dd];
+        cell[dd] = testcell[dd] + offset[dd];
+        shift    = (cell[dd] >= 0 ? cell[dd] / n : -((n - 1 - cell[dd]) / n));
+        if (shift != 0)
+        {
+            cell[dd] -= shift * n;
+            for (m = 0; m <= dd; ++m)
+            {
+                xshift[m] -= shift * d->pbc->box[dd][m];
+            }
+        }
+    }
+    return grid_index(d, cell);
+}
+
+/*! \brief
+ * Calculates squared distances from a point to all positions in a cell.
+ *
+ * \param[in]  d   Grid information.
+ * \param[in]  ci  Linear index of the cell.
+ * \param[in]  x   Test position, shifted with grid_shifted_cell().
+ * \param[out] r2  Squared distances to each position in the cell.
+ *
+ * The loop operates on the contiguous coordinate arrays without any
+ * branches, so that the compiler can vectorize it.
  */
 static void
-grid_clear_cells(gmx_ana_nbsearch_t *d)
+grid_cell_distances(const gmx_ana_nbsearch_t *d, int ci, const rvec x,
+                    real * gmx_restrict r2)
 {
-    int  ci;
+    const int                  start = d->cellstart[ci];
+    const int                  n     = d->cellstart[ci+1] - start;
+    const real * gmx_restrict  xs    = d->xs + start;
+    const real * gmx_restrict  ys    = d->ys + start;
+    const real * gmx_restrict  zs    = d->zs + start;
+    const real                 tx    = x[XX];
+    const real                 ty    = x[YY];
+    const real                 tz    = x[ZZ];
+    int                        j;
 
-    for (ci = 0; ci < d->ncells; ++ci)
+    for (j = 0; j < n; ++j)
     {
-        d->ncatoms[ci] = 0;
+        const real dx = tx - xs[j];
+        const real dy = ty - ys[j];
+        const real dz = tz - zs[j];
+        r2[j] = dx*dx + dy*dy + dz*dz;
     }
 }
 
 /*! \brief
- * Adds an index into a grid cell.
+ * Sorts the reference positions into the grid cells.
  *
  * \param[in,out] d    Grid information.
- * \param[in]     cell Cell into which \p i should be added.
- * \param[in]     i    Index to add.
+ *
+ * Stores the positions in \p d->xref into the cell-sorted coordinate arrays.
+ * A counting sort is used, so positions within each cell remain in
+ * increasing index order, which the exclusion handling relies on.
  */
 static void
-grid_add_to_cell(gmx_ana_nbsearch_t *d, const ivec cell, int i)
+grid_sort_positions(gmx_ana_nbsearch_t *d)
 {
-    int ci = grid_index(d, cell);
+    int  i, ci;
 
-    if (d->ncatoms[ci] == d->catom_nalloc[ci])
+    for (ci = 0; ci <= d->ncells; ++ci)
     {
-        d->catom_nalloc[ci] += 10;
-        srenew(d->catom[ci], d->catom_nalloc[ci]);
+        d->cellstart[ci] = 0;
+    }
+    for (i = 0; i < d->nref; ++i)
+    {
+        ivec refcell;
+
+        grid_map_onto(d, d->xref[i], refcell);
+        d->refcell[i] = grid_index(d, refcell);
+        ++d->cellstart[d->refcell[i] + 1];
+    }
+    d->maxcellsize = 0;
+    for (ci = 0; ci < d->ncells; ++ci)
+    {
+        if (d->cellstart[ci+1] > d->maxcellsize)
+        {
+            d->maxcellsize = d->cellstart[ci+1];
+        }
+        d->cellstart[ci+1] += d->cellstart[ci];
+    }
+    for (i = 0; i < d->nref; ++i)
+    {
+        /* cellstart[ci] is used as the insertion point for cell ci-1. */
+        const int j = d->cellstart[d->refcell[i]]++;
+
+        d->xs[j]      = d->xref[i][XX];
+        d->ys[j]      = d->xref[i][YY];
+        d->zs[j]      = d->xref[i][ZZ];
+        d->sortind[j] = i;
+    }
+    /* Restore the start indices that were advanced during insertion. */
+    for (ci = d->ncells; ci > 0; --ci)
+    {
+        d->cellstart[ci] = d->cellstart[ci-1];
+    }
+    d->cellstart[0] = 0;
+
+    if (d->r2buf_nalloc < d->maxcellsize)
+    {
+        d->r2buf_nalloc = d->maxcellsize;
+        srenew(d->r2buf, d->r2buf_nalloc);
     }
-    d->catom[ci][d->ncatoms[ci]++] = i;
 }
 
 /*!
@@ -472,22 +628,20 @@ gmx_ana_nbsearch_init(gmx_ana_nbsearch_t *d, t_pbc *pbc, int n, const rvec x[])
         if (!d->xref_alloc)
         {
             snew(d->xref_alloc, d->maxnref);
+            snew(d->xs, d->maxnref);
+            snew(d->ys, d->maxnref);
+            snew(d->zs, d->maxnref);
+            snew(d->sortind, d->maxnref);
+            snew(d->refcell, d->maxnref);
         }
         d->xref = d->xref_alloc;
-        grid_clear_cells(d);
 
         for (i = 0; i < n; ++i)
         {
             copy_rvec(x[i], d->xref[i]);
         }
         put_atoms_in_triclinic_unitcell(ecenterTRIC, pbc->box, n, d->xref);
-        for (i = 0; i < n; ++i)
-        {
-            ivec refcell;
-
-            grid_map_onto(d, d->xref[i], refcell);
-            grid_add_to_cell(d, refcell, i);
-        }
+        grid_sort_positions(d);
     }
     else
     {
@@ -519,6 +673,8 @@ gmx_ana_nbsearch_pos_init(gmx_ana_nbsearch_t *d, t_pbc *pbc, const gmx_ana_pos_t
  * \param[in]     excl  Indices of reference positions to exclude.
  *
  * The set exclusions remain in effect until the next call of this function.
+ * The exclusions are not used by the batched searches
+ * (gmx_ana_nbsearch_all_within() etc.).
  */
 void
 gmx_ana_nbsearch_set_excl(gmx_ana_nbsearch_t *d, int nexcl, int excl[])
@@ -538,7 +694,7 @@ is_excluded(gmx_ana_nbsearch_t *d, int j)
     {
         if (d->refid)
         {
-            while (d->exclind < d->nexcl &&d->refid[j] > d->excl[d->exclind])
+            while (d->exclind < d->nexcl && d->refid[j] > d->excl[d->exclind])
             {
                 ++d->exclind;
             }
@@ -554,7 +710,7 @@ is_excluded(gmx_ana_nbsearch_t *d, int j)
             {
                 ++d->exclind;
             }
-            if (d->excl[d->exclind] == j)
+            if (d->exclind < d->nexcl && d->excl[d->exclind] == j)
             {
                 ++d->exclind;
                 return true;
@@ -587,10 +743,20 @@ grid_search_start(gmx_ana_nbsearch_t *d, const rvec x)
 
 /*! \brief
  * Does a grid search.
+ *
+ * \param[in,out] d        Neighborhood search data structure.
+ * \param[in]     bMinDist If true, the whole neighborhood is searched and
+ *     \p d->cutoff2 is reduced to the smallest squared distance found.
+ *     If false, the search stops at the next reference position within
+ *     the cutoff.
+ * \returns  true if the search stopped at a reference position (only
+ *     possible with \p bMinDist false).
+ *
+ * With \p bMinDist false, the search can be continued from where it stopped
+ * with another call.
  */
 static bool
-grid_search(gmx_ana_nbsearch_t *d,
-            bool (*action)(gmx_ana_nbsearch_t *d, int i, real r2))
+grid_search(gmx_ana_nbsearch_t *d, bool bMinDist)
 {
     int  i;
     rvec dx;
@@ -598,34 +764,39 @@ grid_search(gmx_ana_nbsearch_t *d,
 
     if (d->bGrid)
     {
-        int  nbi, ci, cai;
+        int  nbi, ci, cai, ncai;
 
         nbi = d->prevnbi;
         cai = d->prevcai + 1;
 
         for (; nbi < d->ngridnb; ++nbi)
         {
-            ivec cell;
-
-            ivec_add(d->testcell, d->gnboffs[nbi], cell);
-            /* TODO: Support for 2D and screw PBC */
-            cell[XX] = (cell[XX] + d->ncelldim[XX]) % d->ncelldim[XX];
-            cell[YY] = (cell[YY] + d->ncelldim[YY]) % d->ncelldim[YY];
-            cell[ZZ] = (cell[ZZ] + d->ncelldim[ZZ]) % d->ncelldim[ZZ];
-            ci       = grid_index(d, cell);
-            /* TODO: Calculate the required PBC shift outside the inner loop */
-            for (; cai < d->ncatoms[ci]; ++cai)
+            rvec xshift;
+
+            ci   = grid_shifted_cell(d, d->testcell, d->gnboffs[nbi],
+                                     d->xtest, xshift);
+            ncai = d->cellstart[ci+1] - d->cellstart[ci];
+            /* When continuing within a cell, the distances are still in the
+             * buffer from the previous call. */
+            if (cai == 0 && ncai > 0)
             {
-                i = d->catom[ci][cai];
-                if (is_excluded(d, i))
-                {
-                    continue;
-                }
-                pbc_dx_aiuc(d->pbc, d->xtest, d->xref[i], dx);
-                r2 = norm2(dx);
+                grid_cell_distances(d, ci, xshift, d->r2buf);
+            }
+            for (; cai < ncai; ++cai)
+            {
+                r2 = d->r2buf[cai];
                 if (r2 <= d->cutoff2)
                 {
-                    if (action(d, i, r2))
+                    i = d->sortind[d->cellstart[ci] + cai];
+                    if (is_excluded(d, i))
+                    {
+                        continue;
+                    }
+                    if (bMinDist)
+                    {
+                        d->cutoff2 = r2;
+                    }
+                    else
                     {
                         d->prevnbi = nbi;
                         d->prevcai = cai;
@@ -637,6 +808,7 @@ grid_search(gmx_ana_nbsearch_t *d,
             d->exclind = 0;
             cai        = 0;
         }
+        d->prevnbi = d->ngridnb;
     }
     else
     {
@@ -658,38 +830,22 @@ grid_search(gmx_ana_nbsearch_t *d,
             r2 = norm2(dx);
             if (r2 <= d->cutoff2)
             {
-                if (action(d, i, r2))
+                if (bMinDist)
+                {
+                    d->cutoff2 = r2;
+                }
+                else
                 {
                     d->previ = i;
                     return true;
                 }
             }
         }
+        d->previ = d->nref;
     }
     return false;
 }
 
-/*! \brief
- * Helper function to use with grid_search() to find the next neighbor.
- *
- * Simply breaks the loop on the first found neighbor.
- */
-static bool
-within_action(gmx_ana_nbsearch_t *d, int i, real r2)
-{
-    return true;
-}
-
-/*! \brief
- * Helper function to use with grid_search() to find the minimum distance.
- */
-static bool
-mindist_action(gmx_ana_nbsearch_t *d, int i, real r2)
-{
-    d->cutoff2 = r2;
-    return false;
-}
-
 /*!
  * \param[in] d   Neighborhood search data structure.
  * \param[in] x   Test position.
@@ -700,7 +856,7 @@ bool
 gmx_ana_nbsearch_is_within(gmx_ana_nbsearch_t *d, const rvec x)
 {
     grid_search_start(d, x);
-    return grid_search(d, &within_action);
+    return grid_search(d, false);
 }
 
 /*!
@@ -728,7 +884,7 @@ gmx_ana_nbsearch_mindist(gmx_ana_nbsearch_t *d, const rvec x)
     real mind;
 
     grid_search_start(d, x);
-    grid_search(d, &mindist_action);
+    grid_search(d, true);
     mind       = sqrt(d->cutoff2);
     d->cutoff2 = sqr(d->cutoff);
     return mind;
@@ -782,7 +938,7 @@ gmx_ana_nbsearch_pos_first_within(gmx_ana_nbsearch_t *d, const gmx_ana_pos_t *p,
 bool
 gmx_ana_nbsearch_next_within(gmx_ana_nbsearch_t *d, int *jp)
 {
-    if (grid_search(d, &within_action))
+    if (grid_search(d, false))
     {
         *jp = d->previ;
         return true;
@@ -790,3 +946,337 @@ gmx_ana_nbsearch_next_within(gmx_ana_nbsearch_t *d, int *jp)
     *jp = -1;
     return false;
 }
+
+/*! \brief
+ * Sorts a set of test positions into the grid cells.
+ *
+ * \param[in,out] d   Grid information.
+ * \param[in]     n   Number of test positions.
+ * \param[in]     x   Test positions; put into the unit cell on return.
+ *
+ * After the call, \p d->tsortind lists the test positions cell by cell,
+ * with the positions of cell \c ci starting at \c d->tcellstart[ci].
+ */
+static void
+grid_sort_test_positions(gmx_ana_nbsearch_t *d, int n, rvec x[])
+{
+    int  i, ci;
+
+    if (d->test_nalloc < n)
+    {
+        d->test_nalloc = over_alloc_large(n);
+        srenew(d->tcell, d->test_nalloc);
+        srenew(d->tsortind, d->test_nalloc);
+    }
+    if (d->tcells_nalloc < d->ncells + 1)
+    {
+        d->tcells_nalloc = d->ncells + 1;
+        srenew(d->tcellstart, d->tcells_nalloc);
+    }
+    put_atoms_in_triclinic_unitcell(ecenterTRIC, d->pbc->box, n, x);
+    for (ci = 0; ci <= d->ncells; ++ci)
+    {
+        d->tcellstart[ci] = 0;
+    }
+    for (i = 0; i < n; ++i)
+    {
+        ivec cell;
+
+        grid_map_onto(d, x[i], cell);
+        d->tcell[i] = grid_index(d, cell);
+        ++d->tcellstart[d->tcell[i] + 1];
+    }
+    for (ci = 0; ci < d->ncells; ++ci)
+    {
+        d->tcellstart[ci+1] += d->tcellstart[ci];
+    }
+    for (i = 0; i < n; ++i)
+    {
+        d->tsortind[d->tcellstart[d->tcell[i]]++] = i;
+    }
+    for (ci = d->ncells; ci > 0; --ci)
+    {
+        d->tcellstart[ci] = d->tcellstart[ci-1];
+    }
+    d->tcellstart[0] = 0;
+}
+
+/*! \brief
+ * Types of batched searches supported by grid_search_all().
+ */
+enum e_batch_t
+{
+    ebatchWITHIN,  //!< Find whether each test position has a neighbor.
+    ebatchMINDIST, //!< Find the minimum distance for each test position.
+    ebatchPAIRS    //!< Find all pairs within the cutoff.
+};
+
+/*! \brief
+ * Output of a batched search; the field that is used depends on the type.
+ */
+struct t_batch_output
+{
+    //! For \ref ebatchWITHIN: whether each test position has a neighbor.
+    bool                      *bWithin;
+    //! For \ref ebatchMINDIST: squared minimum distances.
+    real                      *mindist2;
+    //! For \ref ebatchPAIRS: the pair list.
+    gmx_ana_nbsearch_pairs_t  *pairs;
+};
+
+/*! \brief
+ * Appends a pair to a pair list, reallocating if necessary.
+ */
+static void
+pairs_append(gmx_ana_nbsearch_pairs_t *pairs, int testi, int refj)
+{
+    if (pairs->npairs == pairs->nalloc)
+    {
+        pairs->nalloc = over_alloc_large(pairs->npairs + 1);
+        srenew(pairs->testi, pairs->nalloc);
+        srenew(pairs->refj, pairs->nalloc);
+    }
+    pairs->testi[pairs->npairs] = testi;
+    pairs->refj[pairs->npairs]  = refj;
+    ++pairs->npairs;
+}
+
+/*! \brief
+ * Performs a batched grid search.
+ *
+ * \param[in,out] d     Neighborhood search data structure with a grid.
+ * \param[in]     n     Number of test positions.
+ * \param[in]     x     Test positions.
+ * \param[in]     type  Type of the search.
+ * \param[out]    out   Output; initialized by the caller.
+ *
+ * The test positions are sorted into the same grid as the reference
+ * positions, and each pair of cells is then processed once for all test
+ * positions in the cell: the PBC shift is computed once per cell pair, and
+ * the reference positions of a cell stay in cache while they are compared
+ * against all the test positions.
+ */
+static void
+grid_search_all(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                e_batch_t type, t_batch_output *out)
+{
+    rvec *xtest;
+    int   tci, nbi, ti, cai;
+
+    snew(xtest, n);
+    for (ti = 0; ti < n; ++ti)
+    {
+        copy_rvec(x[ti], xtest[ti]);
+    }
+    grid_sort_test_positions(d, n, xtest);
+    for (tci = 0; tci < d->ncells; ++tci)
+    {
+        const int tstart = d->tcellstart[tci];
+        const int tend   = d->tcellstart[tci+1];
+        ivec      testcell;
+
+        if (tstart == tend)
+        {
+            continue;
+        }
+        testcell[XX] = tci % d->ncelldim[XX];
+        testcell[YY] = (tci / d->ncelldim[XX]) % d->ncelldim[YY];
+        testcell[ZZ] = tci / (d->ncelldim[XX] * d->ncelldim[YY]);
+        for (nbi = 0; nbi < d->ngridnb; ++nbi)
+        {
+            rvec zero, shift;
+            int  ci, ncai, start;
+
+            clear_rvec(zero);
+            ci    = grid_shifted_cell(d, testcell, d->gnboffs[nbi], zero, shift);
+            start = d->cellstart[ci];
+            ncai  = d->cellstart[ci+1] - start;
+            if (ncai == 0)
+            {
+                continue;
+            }
+            for (ti = tstart; ti < tend; ++ti)
+            {
+                const int i = d->tsortind[ti];
+                rvec      xshift;
+
+                if (type == ebatchWITHIN && out->bWithin[i])
+                {
+                    continue;
+                }
+                rvec_add(xtest[i], shift, xshift);
+                grid_cell_distances(d, ci, xshift, d->r2buf);
+                switch (type)
+                {
+                    case ebatchWITHIN:
+                        for (cai = 0; cai < ncai; ++cai)
+                        {
+                            if (d->r2buf[cai] <= d->cutoff2)
+                            {
+                                out->bWithin[i] = true;
+                                break;
+                            }
+                        }
+                        break;
+                    case ebatchMINDIST:
+                    {
+                        real mind2 = out->mindist2[i];
+                        for (cai = 0; cai < ncai; ++cai)
+                        {
+                            mind2 = std::min(mind2, d->r2buf[cai]);
+                        }
+                        out->mindist2[i] = mind2;
+                        break;
+                    }
+                    case ebatchPAIRS:
+                        for (cai = 0; cai < ncai; ++cai)
+                        {
+                            if (d->r2buf[cai] <= d->cutoff2)
+                            {
+                                pairs_append(out->pairs, i, d->sortind[start + cai]);
+                            }
+                        }
+                        break;
+                }
+            }
+        }
+    }
+    sfree(xtest);
+}
+
+/*!
+ * \param[in]  d       Neighborhood search data structure.
+ * \param[in]  n       Number of test positions.
+ * \param[in]  x       Test positions.
+ * \param[out] bWithin Set to true for each test position that is within the
+ *     cutoff of any reference position, false otherwise.
+ *
+ * Equivalent to calling gmx_ana_nbsearch_is_within() for each position in
+ * \p x, but processes the positions cell by cell when a grid is used.
+ * Exclusions are not taken into account.
+ */
+void
+gmx_ana_nbsearch_all_within(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                            bool bWithin[])
+{
+    int i;
+
+    if (!d->bGrid)
+    {
+        const int nexcl = d->nexcl;
+
+        d->nexcl = 0;
+        for (i = 0; i < n; ++i)
+        {
+            bWithin[i] = gmx_ana_nbsearch_is_within(d, x[i]);
+        }
+        d->nexcl = nexcl;
+        return;
+    }
+    t_batch_output out;
+    out.bWithin = bWithin;
+    for (i = 0; i < n; ++i)
+    {
+        bWithin[i] = false;
+    }
+    grid_search_all(d, n, x, ebatchWITHIN, &out);
+}
+
+/*!
+ * \param[in]  d       Neighborhood search data structure.
+ * \param[in]  n       Number of test positions.
+ * \param[in]  x       Test positions.
+ * \param[out] mindist For each test position, the distance to the nearest
+ *     reference position, or the cutoff if there are no reference positions
+ *     within the cutoff.
+ *
+ * Equivalent to calling gmx_ana_nbsearch_mindist() for each position in
+ * \p x, but processes the positions cell by cell when a grid is used.
+ * Exclusions are not taken into account.
+ */
+void
+gmx_ana_nbsearch_all_mindist(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                             real mindist[])
+{
+    int i;
+
+    if (!d->bGrid)
+    {
+        const int nexcl = d->nexcl;
+
+        d->nexcl = 0;
+        for (i = 0; i < n; ++i)
+        {
+            mindist[i] = gmx_ana_nbsearch_mindist(d, x[i]);
+        }
+        d->nexcl = nexcl;
+        return;
+    }
+    t_batch_output out;
+    out.mindist2 = mindist;
+    for (i = 0; i < n; ++i)
+    {
+        mindist[i] = d->cutoff2;
+    }
+    grid_search_all(d, n, x, ebatchMINDIST, &out);
+    for (i = 0; i < n; ++i)
+    {
+        mindist[i] = sqrt(mindist[i]);
+    }
+}
+
+/*!
+ * \param[in]     d     Neighborhood search data structure.
+ * \param[in]     n     Number of test positions.
+ * \param[in]     x     Test positions.
+ * \param[in,out] pairs Pair list to fill; existing pairs are cleared, but
+ *     allocated memory is reused.
+ *
+ * Finds all pairs of a test position and a reference position that are
+ * within the cutoff.  The order of the pairs is unspecified.
+ * Exclusions are not taken into account.
+ */
+void
+gmx_ana_nbsearch_find_pairs(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                            gmx_ana_nbsearch_pairs_t *pairs)
+{
+    int i, j;
+
+    pairs->npairs = 0;
+    if (!d->bGrid)
+    {
+        const int nexcl = d->nexcl;
+
+        d->nexcl = 0;
+        for (i = 0; i < n; ++i)
+        {
+            if (gmx_ana_nbsearch_first_within(d, x[i], &j))
+            {
+                do
+                {
+                    pairs_append(pairs, i, j);
+                }
+                while (gmx_ana_nbsearch_next_within(d, &j));
+            }
+        }
+        d->nexcl = nexcl;
+        return;
+    }
+    t_batch_output out;
+    out.pairs = pairs;
+    grid_search_all(d, n, x, ebatchPAIRS, &out);
+}
+
+/*!
+ * \param[in,out] pairs Pair list to free.
+ *
+ * Frees the memory allocated for the pairs, but not \p pairs itself.
+ */
+void
+gmx_ana_nbsearch_pairs_free(gmx_ana_nbsearch_pairs_t *pairs)
+{
+    sfree(pairs->testi);
+    sfree(pairs->refj);
+    pairs->npairs = 0;
+    pairs->nalloc = 0;
+}
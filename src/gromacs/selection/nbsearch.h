@@ -57,6 +57,24 @@ struct gmx_ana_pos_t;
 /** Data structure for neighborhood searches. */
 typedef struct gmx_ana_nbsearch_t gmx_ana_nbsearch_t;
 
+/*! \brief
+ * List of pairs found by gmx_ana_nbsearch_find_pairs().
+ *
+ * Should be zero-initialized before first use, and freed with
+ * gmx_ana_nbsearch_pairs_free().
+ */
+typedef struct gmx_ana_nbsearch_pairs_t
+{
+    /** Number of pairs. */
+    int                 npairs;
+    /** Index of the test position for each pair. */
+    int                *testi;
+    /** Index of the reference position for each pair. */
+    int                *refj;
+    /** Allocation count for \p testi and \p refj. */
+    int                 nalloc;
+} gmx_ana_nbsearch_pairs_t;
+
 /** Create a new neighborhood search data structure. */
 gmx_ana_nbsearch_t *
 gmx_ana_nbsearch_create(real cutoff, int maxn);
@@ -98,6 +116,21 @@ gmx_ana_nbsearch_pos_first_within(gmx_ana_nbsearch_t *d,
 /** Finds the next reference position within the cutoff. */
 bool
 gmx_ana_nbsearch_next_within(gmx_ana_nbsearch_t *d, int *jp);
+/** Checks for a set of points whether each is within a neighborhood. */
+void
+gmx_ana_nbsearch_all_within(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                            bool bWithin[]);
+/** Calculates the minimum distances for a set of points. */
+void
+gmx_ana_nbsearch_all_mindist(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                             real mindist[]);
+/** Finds all pairs of test and reference positions within the cutoff. */
+void
+gmx_ana_nbsearch_find_pairs(gmx_ana_nbsearch_t *d, int n, const rvec x[],
+                            gmx_ana_nbsearch_pairs_t *pairs);
+/** Frees memory allocated for a pair list. */
+void
+gmx_ana_nbsearch_pairs_free(gmx_ana_nbsearch_pairs_t *pairs);
 
 namespace gmx
 {
@@ -146,6 +179,15 @@ class NeighborhoodSearch
         bool nextWithin(int *jp)
         { return gmx_ana_nbsearch_next_within(d_, jp); }
 
+        void allWithin(int n, const rvec x[], bool bWithin[])
+        { gmx_ana_nbsearch_all_within(d_, n, x, bWithin); }
+
+        void allMinimumDistances(int n, const rvec x[], real mindist[])
+        { gmx_ana_nbsearch_all_mindist(d_, n, x, mindist); }
+
+        void findPairs(int n, const rvec x[], gmx_ana_nbsearch_pairs_t *pairs)
+        { gmx_ana_nbsearch_find_pairs(d_, n, x, pairs); }
+
     private:
         gmx_ana_nbsearch_t  *d_;
 };
@@ -41,6 +41,8 @@
  */
 #include "selection.h"
 
+#include <algorithm>
+
 #include "position.h"
 #include "selelem.h"
 #include "selvalue.h"
@@ -51,6 +53,59 @@ namespace gmx
 namespace internal
 {
 
+namespace
+{
+
+/*! \brief
+ * Reserves memory in \p dest for copying the index mapping from \p source.
+ *
+ * \throws std::bad_alloc if out of memory.
+ */
+void reserveMapping(gmx_ana_pos_t *dest, const gmx_ana_pos_t &source)
+{
+    // gmx_ana_pos_copy() only reserves space for the mapping blocks, but
+    // e.g. references to position variables have more positions than blocks.
+    gmx_ana_indexmap_reserve(&dest->m,
+                             std::max(source.m.nr, source.m.b.nr),
+                             source.m.b.nra);
+}
+
+/*! \internal \brief
+ * Frees positions and an index group when going out of scope.
+ *
+ * Both are cleared on construction. release() passes the ownership of
+ * the memory to the caller.
+ */
+class PositionsGuard
+{
+    public:
+        PositionsGuard(gmx_ana_pos_t *pos, gmx_ana_index_t *group)
+            : pos_(pos), group_(group)
+        {
+            gmx_ana_pos_clear(pos_);
+            gmx_ana_index_clear(group_);
+        }
+        ~PositionsGuard()
+        {
+            if (pos_ != NULL)
+            {
+                gmx_ana_pos_deinit(pos_);
+                gmx_ana_index_deinit(group_);
+            }
+        }
+
+        //! Stops the guard from freeing the memory.
+        void release() { pos_ = NULL; }
+
+    private:
+        gmx_ana_pos_t   *pos_;
+        gmx_ana_index_t *group_;
+
+        GMX_DISALLOW_COPY_AND_ASSIGN(PositionsGuard);
+};
+
+} // namespace
+
 SelectionData::SelectionData(SelectionTreeElement *elem,
                              const char           *selstr)
     : name_(elem->name()), selectionText_(selstr),
@@ -97,12 +152,80 @@ SelectionData::SelectionData(SelectionTreeElement *elem,
         bDynamic_ = (child->child->flags & SEL_DYNAMIC);
     }
     initCoveredFraction(CFRAC_NONE);
+    gmx_ana_index_clear(&groupCopy_);
+}
+
+
+SelectionData::SelectionData(const SelectionData *source)
+    : name_(source->name_), selectionText_(source->selectionText_),
+      posMass_(source->posMass_), posCharge_(source->posCharge_),
+      flags_(source->flags_), rootElement_(source->rootElement_),
+      coveredFractionType_(source->coveredFractionType_),
+      coveredFraction_(source->coveredFraction_),
+      averageCoveredFraction_(source->averageCoveredFraction_),
+      bDynamic_(source->bDynamic_),
+      bDynamicCoveredFraction_(source->bDynamicCoveredFraction_)
+{
+    gmx_ana_pos_t   *src = const_cast<gmx_ana_pos_t *>(&source->rawPositions_);
+    gmx_ana_pos_t    positions;
+    gmx_ana_index_t  group;
+    PositionsGuard   guard(&positions, &group);
+
+    reserveMapping(&positions, *src);
+    gmx_ana_pos_copy(&positions, src, true);
+    if (src->g != NULL)
+    {
+        gmx_ana_index_copy(&group, src->g, true);
+    }
+
+    // Nothing below throws.
+    guard.release();
+    rawPositions_ = positions;
+    groupCopy_    = group;
+    if (src->g != NULL)
+    {
+        rawPositions_.g = &groupCopy_;
+    }
 }
 
 
 SelectionData::~SelectionData()
 {
     gmx_ana_pos_deinit(&rawPositions_);
+    gmx_ana_index_deinit(&groupCopy_);
+}
+
+
+void
+SelectionData::copyValuesFrom(const SelectionData &source)
+{
+    gmx_ana_pos_t *src = const_cast<gmx_ana_pos_t *>(&source.rawPositions_);
+
+    // Only the dynamic parts need to be copied, but the positions always
+    // change with the frame.
+    gmx_ana_pos_reserve(&rawPositions_, src->nr, 0);
+    if (src->v != NULL)
+    {
+        gmx_ana_pos_reserve_velocities(&rawPositions_);
+    }
+    if (src->f != NULL)
+    {
+        gmx_ana_pos_reserve_forces(&rawPositions_);
+    }
+    reserveMapping(&rawPositions_, *src);
+    gmx_ana_pos_copy(&rawPositions_, src, false);
+    if (src->g != NULL)
+    {
+        gmx_ana_index_reserve(&groupCopy_, src->g->isize);
+        gmx_ana_index_copy(&groupCopy_, src->g, false);
+        rawPositions_.g = &groupCopy_;
+    }
+    if (bDynamic_)
+    {
+        posMass_   = source.posMass_;
+        posCharge_ = source.posCharge_;
+    }
+    coveredFraction_ = source.coveredFraction_;
 }
 
 
@@ -216,6 +339,16 @@ SelectionData::computeAverageCoveredFraction(int nframes)
 }
 
 
+void
+SelectionData::mergeCoveredFraction(const SelectionData &copy)
+{
+    if (isCoveredFractionDynamic())
+    {
+        averageCoveredFraction_ += copy.averageCoveredFraction_;
+    }
+}
+
+
 void
 SelectionData::restoreOriginalPositions(const t_topology *top)
 {
@@ -60,6 +60,7 @@ namespace gmx
 {
 
 class SelectionOptionStorage;
+class SelectionSnapshot;
 class SelectionTreeElement;
 
 class Selection;
@@ -93,6 +94,20 @@ class SelectionData
          * \throws    std::bad_alloc if out of memory.
          */
         SelectionData(SelectionTreeElement *elem, const char *selstr);
+        /*! \brief
+         * Creates a copy for keeping the values of a selection.
+         *
+         * \param[in] source Selection whose values will be kept.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * The copy is not connected to the evaluation tree: it is not
+         * updated when \p source is evaluated, but only when
+         * copyValuesFrom() is called.  This allows the values for one frame
+         * to be accessed while \p source is evaluated for another frame.
+         *
+         * Used by SelectionSnapshot.
+         */
+        explicit SelectionData(const SelectionData *source);
         ~SelectionData();
 
         //! Returns the string that was parsed to produce this selection.
@@ -112,9 +127,14 @@ class SelectionData
 
         //! Returns true if the given flag is set.
         bool hasFlag(SelectionFlag flag) const { return flags_.test(flag); }
+        //! Returns the flags for this selection.
+        SelectionFlags flags() const { return flags_; }
         //! Sets the flags for this selection.
         void setFlags(SelectionFlags flags) { flags_ = flags; }
 
+        //! Returns the type of the covered fraction.
+        e_coverfrac_t coveredFractionType() const { return coveredFractionType_; }
+
         //! \copydoc Selection::initCoveredFraction()
         bool initCoveredFraction(e_coverfrac_t type);
 
@@ -158,6 +178,16 @@ class SelectionData
          * Called by SelectionEvaluator::evaluateFinal().
          */
         void computeAverageCoveredFraction(int nframes);
+        /*! \brief
+         * Adds the covered fractions accumulated in an evaluation copy.
+         *
+         * \param[in] copy  Corresponding selection in an evaluation copy.
+         *
+         * Should be called before computeAverageCoveredFraction(), with
+         * \p nframes including the frames evaluated with \p copy.
+         * Called by SelectionCollection::mergeEvaluationCopy().
+         */
+        void mergeCoveredFraction(const SelectionData &copy);
         /*! \brief
          * Restores position information to state it was in after compilation.
          *
@@ -168,6 +198,17 @@ class SelectionData
          * Called by SelectionEvaluator::evaluateFinal().
          */
         void restoreOriginalPositions(const t_topology *top);
+        /*! \brief
+         * Copies the current values of another selection.
+         *
+         * \param[in] source  Selection to copy the values from.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * Should only be called for objects created with the copy
+         * constructor, with the same \p source or the corresponding
+         * selection in an evaluation copy of its collection.
+         */
+        void copyValuesFrom(const SelectionData &source);
 
     private:
         //! Name of the selection.
@@ -193,6 +234,13 @@ class SelectionData
         bool                      bDynamic_;
         //! true if the covered fraction depends on the frame.
         bool                      bDynamicCoveredFraction_;
+        /*! \brief
+         * Storage for the atoms in \a rawPositions_ in copies.
+         *
+         * In copies created for a SelectionSnapshot, \a rawPositions_.g
+         * points here, in other selections it points to the evaluation tree.
+         */
+        gmx_ana_index_t           groupCopy_;
 
         /*! \brief
          * Needed to wrap access to information.
@@ -500,6 +548,10 @@ class Selection
          * Needed to access the data to adjust flags.
          */
         friend class SelectionOptionStorage;
+        /*! \brief
+         * Needed to find the copy of the data.
+         */
+        friend class SelectionSnapshot;
 };
 
 /*! \brief
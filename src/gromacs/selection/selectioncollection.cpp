@@ -315,10 +315,12 @@ void SelectionCollection::Impl::resolveExternalGroups(
         }
         else if (root->u.gref.name != NULL)
         {
+            // u.gref and u.cgrp share storage, so the name needs to be
+            // cleared before the group is stored.
             char *name = root->u.gref.name;
+            root->u.gref.name = NULL;
             bOk = gmx_ana_indexgrps_find(&root->u.cgrp, &foundName, grps_, name);
             sfree(name);
-            root->u.gref.name = NULL;
             if (!bOk)
             {
                 // TODO: Improve error messages
@@ -661,6 +663,64 @@ SelectionCollection::evaluateFinal(int nframes)
 }
 
 
+void
+SelectionCollection::initEvaluationCopy(const SelectionCollection &source)
+{
+    const gmx_ana_selcollection_t &src = source.impl_->sc_;
+    gmx_ana_selcollection_t       &sc  = impl_->sc_;
+    GMX_RELEASE_ASSERT(sc.sel.empty() && sc.nvars == 0,
+                       "Evaluation copy should be initialized for an empty collection");
+    GMX_RELEASE_ASSERT(src.gall.isize > 0,
+                       "Topology should be set before creating evaluation copies");
+
+    impl_->rpost_ = source.impl_->rpost_;
+    impl_->spost_ = source.impl_->spost_;
+    setTopology(src.top, src.gall.isize);
+    setIndexGroups(source.impl_->grps_);
+
+    // Variables can only reference earlier variables, and selections only
+    // variables, so parsing all the variables first gives the same result as
+    // the original input.
+    std::string text;
+    for (int i = 0; i < src.nvars; ++i)
+    {
+        text.append(src.varstrs[i]);
+        text.append(";");
+    }
+    for (size_t i = 0; i < src.sel.size(); ++i)
+    {
+        text.append(src.sel[i]->selectionText());
+        text.append(";");
+    }
+    parseFromString(text);
+    GMX_RELEASE_ASSERT(sc.sel.size() == src.sel.size(),
+                       "Reparsing selections resulted in a different number of selections");
+    for (size_t i = 0; i < sc.sel.size(); ++i)
+    {
+        sc.sel[i]->setFlags(src.sel[i]->flags());
+    }
+    compile();
+    for (size_t i = 0; i < sc.sel.size(); ++i)
+    {
+        sc.sel[i]->initCoveredFraction(src.sel[i]->coveredFractionType());
+    }
+}
+
+
+void
+SelectionCollection::mergeEvaluationCopy(const SelectionCollection &copy)
+{
+    gmx_ana_selcollection_t       &sc  = impl_->sc_;
+    const gmx_ana_selcollection_t &src = copy.impl_->sc_;
+    GMX_RELEASE_ASSERT(sc.sel.size() == src.sel.size(),
+                       "Merged collection is not a copy of this collection");
+    for (size_t i = 0; i < sc.sel.size(); ++i)
+    {
+        sc.sel[i]->mergeCoveredFraction(*src.sel[i]);
+    }
+}
+
+
 void
 SelectionCollection::printTree(FILE *fp, bool bValues) const
 {
@@ -60,6 +60,7 @@ namespace gmx
 class Options;
 class SelectionCompiler;
 class SelectionEvaluator;
+class SelectionSnapshot;
 
 /*! \brief
  * Collection of selections.
@@ -92,6 +93,11 @@ class SelectionEvaluator;
  * processed to restore the selection values back to the ones they were after
  * compile().
  *
+ * A collection holds the evaluation state of its selections, and can only be
+ * evaluated for one frame at a time.  To evaluate the same selections for
+ * several frames concurrently, create an evaluation copy for each thread with
+ * initEvaluationCopy().
+ *
  * At any point, requiresTopology() can be called to see whether the
  * information provided so far requires loading the topology.
  * printTree() can be used to print the internal representation of the
@@ -331,6 +337,45 @@ class SelectionCollection
          */
         void evaluateFinal(int nframes);
 
+        /*! \brief
+         * Initializes an empty collection as an evaluation copy of another.
+         *
+         * \param[in] source  Collection to copy.
+         * \throws    std::bad_alloc if out of memory.
+         * \throws    unspecified  Any exception thrown by compile().
+         *
+         * The copy contains the same selections and variables as \p source,
+         * with the same flags and covered fraction types, but compiled into
+         * a separate evaluation tree with its own position calculations and
+         * memory pool.  evaluate() can then be called for the copy while
+         * \p source or other copies of it are evaluated for other frames in
+         * other threads.  Selection objects obtained from \p source do not
+         * see the values of the copy; SelectionSnapshot can be used to copy
+         * the values of a copy into a snapshot of \p source.
+         *
+         * All selections of \p source should have been parsed, and its
+         * topology set.  If \p source references external index groups, the
+         * groups passed to setIndexGroups() should still be valid.
+         * The selections are reparsed from their text, so the copy is
+         * initialized as if the same input had been parsed again, and is
+         * compiled before this function returns.
+         */
+        void initEvaluationCopy(const SelectionCollection &source);
+        /*! \brief
+         * Adds per-frame statistics accumulated in an evaluation copy.
+         *
+         * \param[in] copy  Collection initialized with initEvaluationCopy()
+         *      from this collection.
+         *
+         * Should be called for each evaluation copy that has been used for
+         * evaluation before evaluateFinal() is called for this collection.
+         * \p nframes passed to evaluateFinal() should then be the total
+         * number of frames evaluated in this collection and all the copies.
+         *
+         * Does not throw.
+         */
+        void mergeEvaluationCopy(const SelectionCollection &copy);
+
         /*! \brief
          * Prints a human-readable version of the internal selection element
          * tree.
@@ -367,6 +412,10 @@ class SelectionCollection
          * Needed for the evaluator to freely modify the collection.
          */
         friend class SelectionEvaluator;
+        /*! \brief
+         * Needed for copying the selection values.
+         */
+        friend class SelectionSnapshot;
 };
 
 } // namespace gmx
@@ -0,0 +1,123 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::SelectionSnapshot.
+ *
+ * \ingroup module_selection
+ */
+#include "selectionsnapshot.h"
+
+#include <map>
+
+#include "selection.h"
+#include "selectioncollection-impl.h"
+
+namespace gmx
+{
+
+/*! \internal \brief
+ * Private implementation class for SelectionSnapshot.
+ *
+ * \ingroup module_selection
+ */
+class SelectionSnapshot::Impl
+{
+    public:
+        //! Maps selections in the collection to their copies.
+        typedef std::map<const internal::SelectionData *,
+                         internal::SelectionData *> CopyMap;
+
+        //! Copies of the selections, in the order of the collection.
+        SelectionDataList       copies_;
+        //! Index for finding the copy for a selection.
+        CopyMap                 copyMap_;
+};
+
+SelectionSnapshot::SelectionSnapshot()
+    : impl_(new Impl)
+{
+}
+
+SelectionSnapshot::~SelectionSnapshot()
+{
+}
+
+void
+SelectionSnapshot::init(const SelectionCollection &selections)
+{
+    if (!impl_->copies_.empty())
+    {
+        return;
+    }
+    const SelectionDataList &sel = selections.impl_->sc_.sel;
+    impl_->copies_.reserve(sel.size());
+    for (size_t i = 0; i < sel.size(); ++i)
+    {
+        SelectionDataPointer copy(new internal::SelectionData(sel[i].get()));
+        impl_->copyMap_[sel[i].get()] = copy.get();
+        impl_->copies_.push_back(move(copy));
+    }
+}
+
+void
+SelectionSnapshot::update(const SelectionCollection &selections)
+{
+    const SelectionDataList &sel = selections.impl_->sc_.sel;
+    if (impl_->copies_.empty())
+    {
+        init(selections);
+        return;
+    }
+    GMX_RELEASE_ASSERT(impl_->copies_.size() == sel.size(),
+                       "Snapshot updated from a different selection collection");
+    for (size_t i = 0; i < sel.size(); ++i)
+    {
+        impl_->copies_[i]->copyValuesFrom(*sel[i]);
+    }
+}
+
+Selection
+SelectionSnapshot::selection(const Selection &selection) const
+{
+    Impl::CopyMap::const_iterator i = impl_->copyMap_.find(selection.sel_);
+    if (i == impl_->copyMap_.end())
+    {
+        return selection;
+    }
+    return Selection(i->second);
+}
+
+} // namespace gmx
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares gmx::SelectionSnapshot.
+ *
+ * \inlibraryapi
+ * \ingroup module_selection
+ */
+#ifndef GMX_SELECTION_SELECTIONSNAPSHOT_H
+#define GMX_SELECTION_SELECTIONSNAPSHOT_H
+
+#include "../utility/common.h"
+
+namespace gmx
+{
+
+class Selection;
+class SelectionCollection;
+
+/*! \libinternal \brief
+ * Keeps a copy of the values of selections for one frame.
+ *
+ * A SelectionCollection can only hold the values of its selections for the
+ * frame that was last evaluated.  This class makes it possible to analyze
+ * several frames concurrently: after the selections have been evaluated for
+ * a frame, update() copies their values, and selection() then provides
+ * access to the copied values while the collection is evaluated for other
+ * frames.  The values can also be copied from an evaluation copy of the
+ * collection, which allows the frames to also be evaluated concurrently.
+ *
+ * \inlibraryapi
+ * \ingroup module_selection
+ */
+class SelectionSnapshot
+{
+    public:
+        //! Creates an empty snapshot.
+        SelectionSnapshot();
+        ~SelectionSnapshot();
+
+        /*! \brief
+         * Creates copies of all selections in a collection.
+         *
+         * \param[in] selections  Collection whose selections to copy.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * selection() returns copies for the selections of \p selections.
+         * Does nothing if the copies have already been created.
+         */
+        void init(const SelectionCollection &selections);
+        /*! \brief
+         * Copies the current values of all selections in a collection.
+         *
+         * \param[in] selections  Collection whose selections to copy.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * \p selections should be the collection passed to init(), or an
+         * evaluation copy of it (see
+         * SelectionCollection::initEvaluationCopy()).
+         * If init() has not been called, calls it with \p selections.
+         */
+        void update(const SelectionCollection &selections);
+        /*! \brief
+         * Returns a selection that accesses the copied values.
+         *
+         * \param[in] selection  Selection from the collection.
+         * \returns   Selection that accesses the values of \p selection
+         *      at the time of the last update(), or \p selection itself if
+         *      update() has not been called.
+         *
+         * Does not throw.
+         */
+        Selection selection(const Selection &selection) const;
+
+    private:
+        class Impl;
+
+        PrivateImplPointer<Impl> impl_;
+};
+
+} // namespace gmx
+
+#endif
@@ -42,6 +42,8 @@
  * \author Teemu Murtola <teemu.murtola@gmail.com>
  * \ingroup module_selection
  */
+#include <algorithm>
+
 #include "gromacs/legacyheaders/macros.h"
 #include "gromacs/legacyheaders/pbc.h"
 #include "gromacs/legacyheaders/smalloc.h"
@@ -65,11 +67,64 @@ typedef struct
     gmx_ana_pos_t       p;
     /** Neighborhood search data. */
     gmx_ana_nbsearch_t *nb;
+    /** Buffer for the results of batched \c within searches. */
+    bool               *bWithin;
+    /** Buffer for the results of batched distance searches. */
+    real               *mindist;
+    /** Allocation count for \p bWithin and \p mindist. */
+    int                 nalloc;
+
+    /*! \brief
+     * Verlet buffer for incremental \p within evaluation.
+     *
+     * If positive, candidate pairs within \p cutoff + \p skin are stored,
+     * and only they are tested until the positions have moved too much.
+     */
+    real                skin;
+    /** Neighborhood search with the cutoff extended by \p skin. */
+    gmx_ana_nbsearch_t *nbskin;
+    /** Whether the candidate lists are valid. */
+    bool                bListValid;
+    /** Whether PBC was used when the candidate lists were built. */
+    bool                bListPBC;
+    /** Box for which the candidate lists were built. */
+    matrix              listbox;
+    /** Number of reference positions when the candidate lists were built. */
+    int                 nlistref;
+    /** Reference positions when the candidate lists were built. */
+    rvec               *xlistref;
+    /** Reference position ids when the candidate lists were built. */
+    int                *listrefid;
+    /** Allocation count for \p xlistref and \p listrefid. */
+    int                 listref_nalloc;
+    /** Number of blocks in the test position group. */
+    int                 nlisttest;
+    /** Test positions (indexed by block) when the lists were built. */
+    rvec               *xlisttest;
+    /** Whether each test position block has a candidate list. */
+    bool               *bListTested;
+    /*! \brief
+     * Start of the candidates for each test position block in \p cand.
+     *
+     * Has \p nlisttest + 1 elements.
+     */
+    int                *candstart;
+    /** Allocation count for the per-block arrays. */
+    int                 listtest_nalloc;
+    /** Candidate reference positions (indices into \p p). */
+    int                *cand;
+    /** Allocation count for \p cand. */
+    int                 cand_nalloc;
+    /** Pair list used when building the candidate lists. */
+    gmx_ana_nbsearch_pairs_t pairs;
 } t_methoddata_distance;
 
 /** Allocates data for distance-based selection methods. */
 static void *
 init_data_common(int npar, gmx_ana_selparam_t *param);
+/** Allocates data for the \p within selection method. */
+static void *
+init_data_within(int npar, gmx_ana_selparam_t *param);
 /** Initializes a distance-based selection method. */
 static void
 init_common(t_topology *top, int npar, gmx_ana_selparam_t *param, void *data);
@@ -104,6 +159,7 @@ static gmx_ana_selparam_t smparams_mindistance[] = {
 static gmx_ana_selparam_t smparams_within[] = {
     {NULL, {REAL_VALUE,  1, {NULL}}, NULL, 0},
     {"of", {POS_VALUE,  -1, {NULL}}, NULL, SPAR_DYNAMIC | SPAR_VARNUM},
+    {"skin", {REAL_VALUE, 1, {NULL}}, NULL, SPAR_OPTIONAL},
 };
 
 /** Help text for the distance selection methods. */
@@ -112,7 +168,7 @@ static const char *help_distance[] = {
 
     "[TT]distance from POS [cutoff REAL][tt][BR]",
     "[TT]mindistance from POS_EXPR [cutoff REAL][tt][BR]",
-    "[TT]within REAL of POS_EXPR[tt][PAR]",
+    "[TT]within REAL of POS_EXPR [skin REAL][tt][PAR]",
 
     "[TT]distance[tt] and [TT]mindistance[tt] calculate the distance from the",
     "given position(s), the only difference being in that [TT]distance[tt]",
@@ -124,7 +180,14 @@ static const char *help_distance[] = {
 
     "For the first two keywords, it is possible to specify a cutoff to speed",
     "up the evaluation: all distances above the specified cutoff are",
-    "returned as equal to the cutoff.",
+    "returned as equal to the cutoff.[PAR]",
+
+    "For [TT]within[tt], a positive [TT]skin[tt] speeds up the evaluation",
+    "for trajectories where the selected set changes slowly: the pairs that",
+    "are within the cutoff plus the skin are stored, and only these pairs are",
+    "checked in subsequent frames until the positions have moved more than",
+    "the skin in total.  The result is the same as without the skin.",
+    "The stored pairs are recomputed whenever the box changes.",
 };
 
 /** \internal Selection method data for the \p distance method. */
@@ -161,7 +224,7 @@ gmx_ana_selmethod_t sm_mindistance = {
 gmx_ana_selmethod_t sm_within = {
     "within", GROUP_VALUE, SMETH_DYNAMIC,
     asize(smparams_within), smparams_within,
-    &init_data_common,
+    &init_data_within,
     NULL,
     &init_common,
     NULL,
@@ -169,7 +232,7 @@ gmx_ana_selmethod_t sm_within = {
     &init_frame_common,
     NULL,
     &evaluate_within,
-    {"within REAL of POS_EXPR", asize(help_distance), help_distance},
+    {"within REAL of POS_EXPR [skin REAL]", asize(help_distance), help_distance},
 };
 
 /*!
@@ -197,6 +260,25 @@ init_data_common(int npar, gmx_ana_selparam_t *param)
     return data;
 }
 
+/*!
+ * \param[in]     npar  Not used (should be 3).
+ * \param[in,out] param Method parameters (should point to
+ *   \ref smparams_within).
+ * \returns       Pointer to the allocated data (\c t_methoddata_distance).
+ *
+ * Same as init_data_common(), but additionally initializes the third
+ * parameter to define \c t_methoddata_distance::skin.
+ */
+static void *
+init_data_within(int npar, gmx_ana_selparam_t *param)
+{
+    t_methoddata_distance *data;
+
+    data             = (t_methoddata_distance *)init_data_common(npar, param);
+    param[2].val.u.r = &data->skin;
+    return data;
+}
+
 /*!
  * \param   top   Not used.
  * \param   npar  Not used (should be 2).
@@ -218,7 +300,15 @@ init_common(t_topology *top, int npar, gmx_ana_selparam_t *param, void *data)
     {
         GMX_THROW(gmx::InvalidInputError("Distance cutoff should be > 0"));
     }
+    if (d->skin < 0)
+    {
+        GMX_THROW(gmx::InvalidInputError("Distance skin should be >= 0"));
+    }
     d->nb = gmx_ana_nbsearch_create(d->cutoff, d->p.nr);
+    if (d->skin > 0)
+    {
+        d->nbskin = gmx_ana_nbsearch_create(d->cutoff + d->skin, d->p.nr);
+    }
 }
 
 /*!
@@ -236,6 +326,19 @@ free_data_common(void *data)
     {
         gmx_ana_nbsearch_free(d->nb);
     }
+    if (d->nbskin)
+    {
+        gmx_ana_nbsearch_free(d->nbskin);
+    }
+    sfree(d->bWithin);
+    sfree(d->mindist);
+    sfree(d->xlistref);
+    sfree(d->listrefid);
+    sfree(d->xlisttest);
+    sfree(d->bListTested);
+    sfree(d->candstart);
+    sfree(d->cand);
+    gmx_ana_nbsearch_pairs_free(&d->pairs);
     sfree(d);
 }
 
@@ -247,13 +350,32 @@ free_data_common(void *data)
  * \returns    0 on success, a non-zero error code on error.
  *
  * Initializes the neighborhood search for the current frame.
+ * With a Verlet skin, the search is initialized only if it is needed (see
+ * evaluate_within()).
  */
 static void
 init_frame_common(t_topology *top, t_trxframe *fr, t_pbc *pbc, void *data)
 {
     t_methoddata_distance *d = (t_methoddata_distance *)data;
 
-    gmx_ana_nbsearch_pos_init(d->nb, pbc, &d->p);
+    if (d->skin <= 0)
+    {
+        gmx_ana_nbsearch_pos_init(d->nb, pbc, &d->p);
+    }
+}
+
+/*! \brief
+ * Ensures that the buffers for batched searches can hold \p n positions.
+ */
+static void
+reserve_buffers(t_methoddata_distance *d, int n)
+{
+    if (d->nalloc < n)
+    {
+        d->nalloc = n;
+        srenew(d->bWithin, d->nalloc);
+        srenew(d->mindist, d->nalloc);
+    }
 }
 
 /*!
@@ -269,15 +391,238 @@ evaluate_distance(t_topology *top, t_trxframe *fr, t_pbc *pbc,
 {
     t_methoddata_distance *d = (t_methoddata_distance *)data;
     int                    b, i;
-    real                   n;
 
     out->nr = pos->g->isize;
+    reserve_buffers(d, pos->nr);
+    gmx_ana_nbsearch_all_mindist(d->nb, pos->nr, pos->x, d->mindist);
     for (b = 0; b < pos->nr; ++b)
     {
-        n = gmx_ana_nbsearch_pos_mindist(d->nb, pos, b);
         for (i = pos->m.mapb.index[b]; i < pos->m.mapb.index[b+1]; ++i)
         {
-            out->u.r[i] = n;
+            out->u.r[i] = d->mindist[b];
+        }
+    }
+}
+
+/*! \brief
+ * Computes the distance vector between two positions.
+ */
+static void
+distance_vector(t_pbc *pbc, const rvec x1, const rvec x2, rvec dx)
+{
+    if (pbc)
+    {
+        pbc_dx(pbc, x1, x2, dx);
+    }
+    else
+    {
+        rvec_sub(x1, x2, dx);
+    }
+}
+
+/*! \brief
+ * Checks whether candidate lists can be used for a set of test positions.
+ *
+ * The candidates are stored per block of the test position group, so this
+ * requires that each position maps to a block.
+ */
+static bool
+can_use_candidates(const gmx_ana_pos_t *pos)
+{
+    int b;
+
+    if (!pos->m.refid)
+    {
+        return false;
+    }
+    for (b = 0; b < pos->nr; ++b)
+    {
+        if (pos->m.refid[b] < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*! \brief
+ * Checks whether the stored candidate lists are still valid.
+ *
+ * \param[in] d    Method data.
+ * \param[in] pbc  PBC information for the current frame.
+ * \param[in] pos  Current test positions.
+ * \returns   true if every pair within the cutoff is guaranteed to be in the
+ *   candidate lists.
+ *
+ * The lists are valid if the box and the set of reference positions have not
+ * changed, all test positions have a list, and the largest displacement of
+ * a reference position plus that of a test position is less than the skin.
+ */
+static bool
+are_candidates_valid(t_methoddata_distance *d, t_pbc *pbc,
+                     const gmx_ana_pos_t *pos)
+{
+    real maxdisp2, refdisp, testdisp;
+    rvec dx;
+    int  i, j, b, blk;
+
+    if (!d->bListValid || d->bListPBC != (pbc != NULL))
+    {
+        return false;
+    }
+    if (pbc)
+    {
+        for (i = 0; i < DIM; ++i)
+        {
+            for (j = 0; j < DIM; ++j)
+            {
+                if (d->listbox[i][j] != pbc->box[i][j])
+                {
+                    return false;
+                }
+            }
+        }
+    }
+    if (d->p.nr != d->nlistref || pos->m.b.nr != d->nlisttest)
+    {
+        return false;
+    }
+    maxdisp2 = 0;
+    for (i = 0; i < d->p.nr; ++i)
+    {
+        if (d->p.m.refid && d->p.m.refid[i] != d->listrefid[i])
+        {
+            return false;
+        }
+        distance_vector(pbc, d->p.x[i], d->xlistref[i], dx);
+        maxdisp2 = std::max(maxdisp2, norm2(dx));
+    }
+    refdisp  = sqrt(maxdisp2);
+    maxdisp2 = 0;
+    for (b = 0; b < pos->nr; ++b)
+    {
+        blk = pos->m.refid[b];
+        if (!d->bListTested[blk])
+        {
+            return false;
+        }
+        distance_vector(pbc, pos->x[b], d->xlisttest[blk], dx);
+        maxdisp2 = std::max(maxdisp2, norm2(dx));
+    }
+    testdisp = sqrt(maxdisp2);
+    return refdisp + testdisp < d->skin;
+}
+
+/*! \brief
+ * Builds the candidate lists for the current positions.
+ *
+ * \param[in,out] d    Method data.
+ * \param[in]     pbc  PBC information for the current frame.
+ * \param[in]     pos  Current test positions.
+ */
+static void
+build_candidates(t_methoddata_distance *d, t_pbc *pbc,
+                 const gmx_ana_pos_t *pos)
+{
+    int i, b, p, blk;
+
+    d->bListPBC = (pbc != NULL);
+    if (pbc)
+    {
+        copy_mat(pbc->box, d->listbox);
+    }
+    d->nlistref = d->p.nr;
+    if (d->listref_nalloc < d->nlistref)
+    {
+        d->listref_nalloc = d->nlistref;
+        srenew(d->xlistref, d->listref_nalloc);
+        srenew(d->listrefid, d->listref_nalloc);
+    }
+    for (i = 0; i < d->nlistref; ++i)
+    {
+        copy_rvec(d->p.x[i], d->xlistref[i]);
+        d->listrefid[i] = (d->p.m.refid ? d->p.m.refid[i] : i);
+    }
+    d->nlisttest = pos->m.b.nr;
+    if (d->listtest_nalloc < d->nlisttest)
+    {
+        d->listtest_nalloc = d->nlisttest;
+        srenew(d->xlisttest, d->listtest_nalloc);
+        srenew(d->bListTested, d->listtest_nalloc);
+        srenew(d->candstart, d->listtest_nalloc + 1);
+    }
+    for (blk = 0; blk <= d->nlisttest; ++blk)
+    {
+        if (blk < d->nlisttest)
+        {
+            d->bListTested[blk] = false;
+        }
+        d->candstart[blk] = 0;
+    }
+
+    gmx_ana_nbsearch_pos_init(d->nbskin, pbc, &d->p);
+    gmx_ana_nbsearch_find_pairs(d->nbskin, pos->nr, pos->x, &d->pairs);
+
+    /* Sort the pairs by test position block. */
+    for (b = 0; b < pos->nr; ++b)
+    {
+        blk = pos->m.refid[b];
+        copy_rvec(pos->x[b], d->xlisttest[blk]);
+        d->bListTested[blk] = true;
+    }
+    for (p = 0; p < d->pairs.npairs; ++p)
+    {
+        ++d->candstart[pos->m.refid[d->pairs.testi[p]] + 1];
+    }
+    for (blk = 0; blk < d->nlisttest; ++blk)
+    {
+        d->candstart[blk+1] += d->candstart[blk];
+    }
+    if (d->cand_nalloc < d->pairs.npairs)
+    {
+        d->cand_nalloc = over_alloc_large(d->pairs.npairs);
+        srenew(d->cand, d->cand_nalloc);
+    }
+    for (p = 0; p < d->pairs.npairs; ++p)
+    {
+        blk = pos->m.refid[d->pairs.testi[p]];
+        d->cand[d->candstart[blk]++] = d->pairs.refj[p];
+    }
+    for (blk = d->nlisttest; blk > 0; --blk)
+    {
+        d->candstart[blk] = d->candstart[blk-1];
+    }
+    d->candstart[0] = 0;
+    d->bListValid   = true;
+}
+
+/*! \brief
+ * Evaluates \p within using the stored candidate lists.
+ *
+ * \param[in]  d    Method data with valid candidate lists.
+ * \param[in]  pbc  PBC information for the current frame.
+ * \param[in]  pos  Current test positions.
+ * \param[out] out  Output group.
+ */
+static void
+evaluate_within_candidates(t_methoddata_distance *d, t_pbc *pbc,
+                           gmx_ana_pos_t *pos, gmx_ana_selvalue_t *out)
+{
+    const real cutoff2 = sqr(d->cutoff);
+    rvec       dx;
+    int        b, k, blk;
+
+    for (b = 0; b < pos->nr; ++b)
+    {
+        blk = pos->m.refid[b];
+        for (k = d->candstart[blk]; k < d->candstart[blk+1]; ++k)
+        {
+            distance_vector(pbc, pos->x[b], d->p.x[d->cand[k]], dx);
+            if (norm2(dx) <= cutoff2)
+            {
+                gmx_ana_pos_append(NULL, out->u.g, pos, b, 0);
+                break;
+            }
         }
     }
 }
@@ -297,9 +642,24 @@ evaluate_within(t_topology *top, t_trxframe *fr, t_pbc *pbc,
     int                    b;
 
     out->u.g->isize = 0;
+    if (d->skin > 0)
+    {
+        if (can_use_candidates(pos))
+        {
+            if (!are_candidates_valid(d, pbc, pos))
+            {
+                build_candidates(d, pbc, pos);
+            }
+            evaluate_within_candidates(d, pbc, pos, out);
+            return;
+        }
+        gmx_ana_nbsearch_pos_init(d->nb, pbc, &d->p);
+    }
+    reserve_buffers(d, pos->nr);
+    gmx_ana_nbsearch_all_within(d->nb, pos->nr, pos->x, d->bWithin);
     for (b = 0; b < pos->nr; ++b)
     {
-        if (gmx_ana_nbsearch_pos_is_within(d->nb, pos, b))
+        if (d->bWithin[b])
         {
             gmx_ana_pos_append(NULL, out->u.g, pos, b, 0);
         }
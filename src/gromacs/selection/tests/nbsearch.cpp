@@ -0,0 +1,228 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2013, by the GROMACS development team, led by
+ * David van der Spoel, Berk Hess, Erik Lindahl, and including many
+ * others, as listed in the AUTHORS file in the top-level source
+ * directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests neighborhood searching.
+ *
+ * The results are compared against a brute-force loop over all pairs.
+ *
+ * \ingroup module_selection
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "gromacs/legacyheaders/pbc.h"
+#include "gromacs/legacyheaders/smalloc.h"
+#include "gromacs/legacyheaders/vec.h"
+
+#include "gromacs/selection/nbsearch.h"
+
+namespace
+{
+
+/********************************************************************
+ * Test fixture with random reference and test positions.
+ */
+
+class NeighborhoodSearchTest : public ::testing::Test
+{
+    public:
+        NeighborhoodSearchTest()
+            : nref_(0), xref_(NULL), ntest_(0), xtest_(NULL), seed_(1234)
+        {
+        }
+        ~NeighborhoodSearchTest()
+        {
+            sfree(xref_);
+            sfree(xtest_);
+        }
+
+        void generatePositions(matrix box, int nref, int ntest);
+        //! Finds the minimum distance to the reference positions.
+        real refMinDist(const rvec x, real cutoff);
+        void testSearch(real cutoff);
+
+        t_pbc                pbc_;
+        int                  nref_;
+        rvec                *xref_;
+        int                  ntest_;
+        rvec                *xtest_;
+
+    private:
+        //! Returns a uniform random number in [0,1).
+        real random();
+
+        unsigned int         seed_;
+};
+
+real NeighborhoodSearchTest::random()
+{
+    // Simple linear congruential generator; the tests only need
+    // reproducible, roughly uniform numbers.
+    seed_ = seed_ * 1103515245u + 12345u;
+    return ((seed_ >> 8) & 0xFFFFFF) / (real)0x1000000;
+}
+
+void NeighborhoodSearchTest::generatePositions(matrix box, int nref, int ntest)
+{
+    set_pbc(&pbc_, epbcXYZ, box);
+    nref_  = nref;
+    ntest_ = ntest;
+    srenew(xref_, nref);
+    srenew(xtest_, ntest);
+    // Generate positions also outside the unit cell to test the wrapping.
+    for (int i = 0; i < nref + ntest; ++i)
+    {
+        rvec x;
+        clear_rvec(x);
+        for (int d = 0; d < DIM; ++d)
+        {
+            const real f = 1.4*random() - 0.2;
+            for (int m = 0; m <= d; ++m)
+            {
+                x[m] += f * box[d][m];
+            }
+        }
+        copy_rvec(x, i < nref ? xref_[i] : xtest_[i - nref]);
+    }
+}
+
+real NeighborhoodSearchTest::refMinDist(const rvec x, real cutoff)
+{
+    real mind2 = cutoff*cutoff;
+    for (int j = 0; j < nref_; ++j)
+    {
+        rvec dx;
+        pbc_dx(&pbc_, x, xref_[j], dx);
+        mind2 = std::min(mind2, norm2(dx));
+    }
+    return sqrt(mind2);
+}
+
+void NeighborhoodSearchTest::testSearch(real cutoff)
+{
+    const int               nref  = nref_;
+    const int               ntest = ntest_;
+    const rvec             *xref  = xref_;
+    const rvec             *xtest = xtest_;
+    gmx::NeighborhoodSearch nb(cutoff, nref);
+    nb.init(&pbc_, nref, xref);
+
+    std::vector<std::pair<int, int> > refPairs;
+    for (int i = 0; i < ntest; ++i)
+    {
+        for (int j = 0; j < nref; ++j)
+        {
+            rvec dx;
+            pbc_dx(&pbc_, xtest[i], xref[j], dx);
+            if (norm2(dx) <= cutoff*cutoff)
+            {
+                refPairs.push_back(std::make_pair(i, j));
+            }
+        }
+    }
+    ASSERT_FALSE(refPairs.empty());
+
+    std::vector<std::pair<int, int> > pairs;
+    for (int i = 0; i < ntest; ++i)
+    {
+        const real mind = refMinDist(xtest[i], cutoff);
+        EXPECT_NEAR(mind, nb.minimumDistance(xtest[i]), 1e-4) << "i = " << i;
+        EXPECT_EQ(mind < cutoff, nb.isWithin(xtest[i])) << "i = " << i;
+        int  j;
+        if (nb.firstWithin(xtest[i], &j))
+        {
+            do
+            {
+                pairs.push_back(std::make_pair(i, j));
+            }
+            while (nb.nextWithin(&j));
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    EXPECT_TRUE(pairs == refPairs);
+
+    bool                 *bWithin;
+    real                 *mindist;
+    snew(bWithin, ntest);
+    snew(mindist, ntest);
+    nb.allWithin(ntest, xtest, bWithin);
+    nb.allMinimumDistances(ntest, xtest, mindist);
+    for (int i = 0; i < ntest; ++i)
+    {
+        const real mind = refMinDist(xtest[i], cutoff);
+        EXPECT_NEAR(mind, mindist[i], 1e-4) << "i = " << i;
+        EXPECT_EQ(mind < cutoff, bWithin[i]) << "i = " << i;
+    }
+    sfree(bWithin);
+    sfree(mindist);
+
+    gmx_ana_nbsearch_pairs_t pairlist = {0, NULL, NULL, 0};
+    nb.findPairs(ntest, xtest, &pairlist);
+    pairs.clear();
+    for (int p = 0; p < pairlist.npairs; ++p)
+    {
+        pairs.push_back(std::make_pair(pairlist.testi[p], pairlist.refj[p]));
+    }
+    gmx_ana_nbsearch_pairs_free(&pairlist);
+    std::sort(pairs.begin(), pairs.end());
+    EXPECT_TRUE(pairs == refPairs);
+}
+
+TEST_F(NeighborhoodSearchTest, HandlesRectangularBox)
+{
+    matrix box = {{5, 0, 0}, {0, 4, 0}, {0, 0, 6}};
+    generatePositions(box, 1000, 200);
+    testSearch(0.6);
+}
+
+TEST_F(NeighborhoodSearchTest, HandlesTriclinicBox)
+{
+    matrix box = {{5, 0, 0}, {1.5, 4.5, 0}, {-1, 1.2, 5}};
+    generatePositions(box, 1000, 200);
+    testSearch(0.6);
+}
+
+TEST_F(NeighborhoodSearchTest, HandlesSmallSystemWithoutGrid)
+{
+    matrix box = {{3, 0, 0}, {0, 3, 0}, {0, 0, 3}};
+    generatePositions(box, 10, 50);
+    testSearch(1.0);
+}
+
+} // namespace
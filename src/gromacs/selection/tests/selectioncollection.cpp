@@ -50,6 +50,7 @@
 #include "gromacs/options/options.h"
 #include "gromacs/selection/selectioncollection.h"
 #include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionsnapshot.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/flags.h"
 #include "gromacs/utility/gmxregex.h"
@@ -209,6 +210,8 @@ class SelectionCollectionDataTest : public SelectionCollectionTest
         void runParser(const char *const *selections, size_t count);
 
         void checkCompiled();
+        void checkEvaluationCopy(const gmx::SelectionCollection &copy,
+                                 bool                            bCoordinates);
 
         gmx::test::TestReferenceData    data_;
         gmx::test::TestReferenceChecker checker_;
@@ -360,6 +363,44 @@ SelectionCollectionDataTest::runEvaluate()
 }
 
 
+void
+SelectionCollectionDataTest::checkEvaluationCopy(
+        const gmx::SelectionCollection &copy, bool bCoordinates)
+{
+    gmx::SelectionSnapshot snapshot;
+    ASSERT_NO_THROW_GMX(snapshot.init(sc_));
+    ASSERT_NO_THROW_GMX(snapshot.update(copy));
+    for (size_t i = 0; i < count_; ++i)
+    {
+        SCOPED_TRACE(std::string("Checking copy of selection \"") +
+                     sel_[i].selectionText() + "\"");
+        const gmx::Selection    &sel    = sel_[i];
+        const gmx::Selection     copied = snapshot.selection(sel);
+        gmx::ConstArrayRef<int>  atoms  = sel.atomIndices();
+        gmx::ConstArrayRef<int>  copiedAtoms = copied.atomIndices();
+        ASSERT_EQ(atoms.size(), copiedAtoms.size());
+        for (size_t j = 0; j < atoms.size(); ++j)
+        {
+            EXPECT_EQ(atoms[j], copiedAtoms[j]);
+        }
+        ASSERT_EQ(sel.posCount(), copied.posCount());
+        for (int j = 0; j < sel.posCount(); ++j)
+        {
+            const gmx::SelectionPosition &p       = sel.position(j);
+            const gmx::SelectionPosition &copiedp = copied.position(j);
+            EXPECT_EQ(p.refId(), copiedp.refId());
+            EXPECT_EQ(p.mappedId(), copiedp.mappedId());
+            if (bCoordinates)
+            {
+                EXPECT_EQ(p.x()[XX], copiedp.x()[XX]);
+                EXPECT_EQ(p.x()[YY], copiedp.x()[YY]);
+                EXPECT_EQ(p.x()[ZZ], copiedp.x()[ZZ]);
+            }
+        }
+    }
+}
+
+
 void
 SelectionCollectionDataTest::runEvaluateFinal()
 {
@@ -378,6 +419,10 @@ SelectionCollectionDataTest::runTest(int natoms, const char * const *selections,
     ASSERT_NO_FATAL_FAILURE(runParser(selections, count));
     ASSERT_NO_FATAL_FAILURE(setAtomCount(natoms));
     ASSERT_NO_FATAL_FAILURE(runCompiler());
+
+    gmx::SelectionCollection copy;
+    ASSERT_NO_THROW_GMX(copy.initEvaluationCopy(sc_));
+    ASSERT_NO_FATAL_FAILURE(checkEvaluationCopy(copy, false));
 }
 
 
@@ -389,9 +434,15 @@ SelectionCollectionDataTest::runTest(const char         *filename,
     ASSERT_NO_FATAL_FAILURE(runParser(selections, count));
     ASSERT_NO_FATAL_FAILURE(loadTopology(filename));
     ASSERT_NO_FATAL_FAILURE(runCompiler());
+
+    gmx::SelectionCollection copy;
+    ASSERT_NO_THROW_GMX(copy.initEvaluationCopy(sc_));
+    ASSERT_NO_FATAL_FAILURE(checkEvaluationCopy(copy, false));
     if (flags_.test(efTestEvaluation))
     {
         ASSERT_NO_FATAL_FAILURE(runEvaluate());
+        ASSERT_NO_THROW_GMX(copy.evaluate(frame_, NULL));
+        ASSERT_NO_FATAL_FAILURE(checkEvaluationCopy(copy, true));
         ASSERT_NO_FATAL_FAILURE(runEvaluateFinal());
     }
 }
@@ -531,6 +582,58 @@ TEST_F(SelectionCollectionTest, RecoversFromInvalidPermutation3)
     EXPECT_THROW_GMX(sc_.evaluate(frame_, NULL), gmx::InconsistentInputError);
 }
 
+TEST_F(SelectionCollectionTest, EvaluatesCopiesIndependently)
+{
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString("within 1 of resnr 2"));
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    gmx::SelectionCollection copy;
+    ASSERT_NO_THROW_GMX(copy.initEvaluationCopy(sc_));
+    gmx::SelectionSnapshot   snapshot;
+    ASSERT_NO_THROW_GMX(snapshot.init(sc_));
+
+    ASSERT_NO_THROW_GMX(sc_.evaluate(frame_, NULL));
+    const int atomCount = sel_[0].atomCount();
+    // Spread the atoms out such that only the reference atoms are selected.
+    for (int i = 0; i < frame_->natoms; ++i)
+    {
+        svmul(3.0, frame_->x[i], frame_->x[i]);
+    }
+    ASSERT_NO_THROW_GMX(copy.evaluate(frame_, NULL));
+    ASSERT_NO_THROW_GMX(snapshot.update(copy));
+
+    EXPECT_EQ(atomCount, sel_[0].atomCount());
+    EXPECT_EQ(3, snapshot.selection(sel_[0]).atomCount());
+    EXPECT_LT(3, atomCount);
+}
+
+TEST_F(SelectionCollectionTest, EvaluatesWithinSkinConsistently)
+{
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString(
+                                    "within 1 of resnr 2;"
+                                    "within 1 of resnr 2 skin 0.3"));
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_EQ(2U, sel_.size());
+    for (int frame = 0; frame < 8; ++frame)
+    {
+        SCOPED_TRACE(gmx::formatString("Frame %d", frame));
+        // Move the atoms a little, such that the candidate lists are reused
+        // for some frames, and rebuilt when the displacement grows.
+        for (int i = 0; i < frame_->natoms; ++i)
+        {
+            frame_->x[i][XX] += (i % 2 == 0 ? 0.07 : -0.05);
+            frame_->x[i][YY] += (i % 3 == 0 ? 0.04 : -0.02);
+        }
+        ASSERT_NO_THROW_GMX(sc_.evaluate(frame_, NULL));
+        ASSERT_EQ(sel_[0].atomCount(), sel_[1].atomCount());
+        for (int i = 0; i < sel_[0].atomCount(); ++i)
+        {
+            EXPECT_EQ(sel_[0].atomIndices()[i], sel_[1].atomIndices()[i]);
+        }
+    }
+}
+
 // TODO: Tests for evaluation errors
 
 
@@ -756,6 +859,16 @@ TEST_F(SelectionCollectionDataTest, HandlesWithinKeyword)
 }
 
 
+TEST_F(SelectionCollectionDataTest, HandlesWithinKeywordWithSkin)
+{
+    static const char * const selections[] = {
+        "within 1 of resnr 2 skin 0.5"
+    };
+    setFlags(TestFlags() | efTestEvaluation | efTestPositionCoordinates);
+    runTest("simple.gro", selections);
+}
+
+
 TEST_F(SelectionCollectionDataTest, HandlesInSolidAngleKeyword)
 {
     // Both of these should evaluate to empty on a correct implementation.
@@ -45,6 +45,7 @@
 
 #include "gromacs/analysisdata/analysisdata.h"
 #include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectionsnapshot.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
 
@@ -115,6 +116,8 @@ class TrajectoryAnalysisModuleData::Impl
         HandleContainer            handles_;
         //! Stores thread-local selections.
         const SelectionCollection &selections_;
+        //! Thread-local copies of the selection values, if requested.
+        SelectionSnapshot          snapshot_;
 };
 
 TrajectoryAnalysisModuleData::Impl::Impl(
@@ -174,8 +177,7 @@ TrajectoryAnalysisModuleData::dataHandle(const AnalysisData &data)
 
 Selection TrajectoryAnalysisModuleData::parallelSelection(const Selection &selection)
 {
-    // TODO: Implement properly.
-    return selection;
+    return impl_->snapshot_.selection(selection);
 }
 
 
@@ -194,6 +196,14 @@ TrajectoryAnalysisModuleData::parallelSelections(const SelectionList &selections
 }
 
 
+void TrajectoryAnalysisModuleData::copySelectionValues(
+        const SelectionCollection &selections)
+{
+    impl_->snapshot_.init(impl_->selections_);
+    impl_->snapshot_.update(selections);
+}
+
+
 /********************************************************************
  * TrajectoryAnalysisModuleDataBasic
  */
@@ -137,6 +137,23 @@ class TrajectoryAnalysisModuleData
          */
         SelectionList parallelSelections(const SelectionList &selections);
 
+        /*! \brief
+         * Copies the current selection values into this thread-local data.
+         *
+         * \param[in] selections  Collection to copy the values from.
+         * \throws std::bad_alloc if out of memory.
+         *
+         * \p selections should be the collection passed to the constructor,
+         * or an evaluation copy of it (see
+         * SelectionCollection::initEvaluationCopy()).
+         * After the first call, parallelSelection() returns selections that
+         * keep the values from the last call, also while the selection
+         * collections are evaluated for other frames.
+         * Called by the runner before analyzeFrame() when several frames are
+         * analyzed concurrently; modules do not need to call this.
+         */
+        void copySelectionValues(const SelectionCollection &selections);
+
     protected:
         /*! \brief
          * Initializes thread-local storage for data handles and selections.
@@ -114,6 +114,16 @@ class TrajectoryAnalysisSettings
              * \see setRmPBC()
              */
             efNoUserRmPBC    = 1<<5,
+            /*! \brief
+             * Allows several frames to be analyzed concurrently.
+             *
+             * If this flag is specified, the module promises that its
+             * TrajectoryAnalysisModule::analyzeFrame() only accesses
+             * frame-local data through the \p pdata parameter, such that
+             * it can be called for different frames in different threads.
+             * Multipoint data sets are not supported in this mode.
+             */
+            efParallelFrames = 1<<6,
         };
 
         //! Initializes default settings.
@@ -45,9 +45,14 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/legacyheaders/copyrite.h"
+#include "gromacs/legacyheaders/gmx_omp.h"
 #include "gromacs/legacyheaders/pbc.h"
 #include "gromacs/legacyheaders/rmpbc.h"
+#include "gromacs/legacyheaders/smalloc.h"
 #include "gromacs/legacyheaders/statutil.h"
 
 #include "gromacs/analysisdata/paralleloptions.h"
@@ -63,10 +68,80 @@
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/file.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/uniqueptr.h"
 
 namespace gmx
 {
 
+namespace
+{
+
+/*! \internal \brief
+ * Copy of a trajectory frame, for analyzing several frames concurrently.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+class TrajectoryFrameCopy
+{
+    public:
+        TrajectoryFrameCopy() : nalloc_(0), x_(NULL), v_(NULL), f_(NULL)
+        {
+        }
+        ~TrajectoryFrameCopy()
+        {
+            sfree(x_);
+            sfree(v_);
+            sfree(f_);
+        }
+
+        //! Copies \p fr, including coordinates, velocities and forces.
+        void copyFrom(const t_trxframe &fr)
+        {
+            if (fr.natoms > nalloc_)
+            {
+                nalloc_ = fr.natoms;
+                srenew(x_, nalloc_);
+                srenew(v_, nalloc_);
+                srenew(f_, nalloc_);
+            }
+            fr_   = fr;
+            fr_.x = copyArray(fr.bX ? fr.x : NULL, x_, fr.natoms);
+            fr_.v = copyArray(fr.bV ? fr.v : NULL, v_, fr.natoms);
+            fr_.f = copyArray(fr.bF ? fr.f : NULL, f_, fr.natoms);
+        }
+
+        //! Returns the copied frame.
+        t_trxframe &frame() { return fr_; }
+        //! Returns storage for the PBC information of the frame.
+        t_pbc *pbc() { return &pbc_; }
+
+    private:
+        //! Copies \p n vectors from \p src to \p dest if \p src is not NULL.
+        static rvec *copyArray(const rvec *src, rvec *dest, int n)
+        {
+            if (src == NULL)
+            {
+                return NULL;
+            }
+            std::copy(src[0], src[0] + n*DIM, dest[0]);
+            return dest;
+        }
+
+        t_trxframe              fr_;
+        t_pbc                   pbc_;
+        int                     nalloc_;
+        rvec                   *x_;
+        rvec                   *v_;
+        rvec                   *f_;
+
+        GMX_DISALLOW_COPY_AND_ASSIGN(TrajectoryFrameCopy);
+};
+
+//! Smart pointer to manage a TrajectoryFrameCopy object.
+typedef gmx_unique_ptr<TrajectoryFrameCopy>::type TrajectoryFrameCopyPointer;
+
+}   // namespace
+
 /********************************************************************
  * TrajectoryAnalysisCommandLineRunner::Impl
  */
@@ -84,6 +159,10 @@ class TrajectoryAnalysisCommandLineRunner::Impl
                           TrajectoryAnalysisRunnerCommon *common,
                           SelectionCollection *selections,
                           int *argc, char *argv[]);
+        int runParallelFrames(int nthreads,
+                              TrajectoryAnalysisRunnerCommon *common,
+                              SelectionCollection *selections,
+                              bool bPBC);
 
         TrajectoryAnalysisModule *module_;
         int                       debugLevel_;
@@ -172,12 +251,92 @@ TrajectoryAnalysisCommandLineRunner::Impl::parseOptions(
     // TODO: Check whether the input is a pipe.
     bool bInteractive = true;
     seloptManager.parseRequestedFromStdin(bInteractive);
-    common->doneIndexGroups(selections);
 
     return true;
 }
 
 
+/*! \brief
+ * Analyzes the frames of the trajectory, \p nthreads frames at a time.
+ *
+ * The frames are read in the main thread, and a copy of each frame is
+ * evaluated and analyzed in its own thread, using a separate evaluation copy
+ * of \p selections for each thread.  The selection values are copied to the
+ * thread-local data for the frame, and the analysis data objects pass the
+ * results on to the data modules in the order of the frames.
+ *
+ * Returns the number of frames analyzed.
+ */
+int
+TrajectoryAnalysisCommandLineRunner::Impl::runParallelFrames(
+        int nthreads, TrajectoryAnalysisRunnerCommon *common,
+        SelectionCollection *selections, bool bPBC)
+{
+    typedef gmx_unique_ptr<SelectionCollection>::type SelectionCollectionPointer;
+
+    const TopologyInformation                       &topology = common->topologyInformation();
+    AnalysisDataParallelOptions                      dataOptions(nthreads);
+    std::vector<TrajectoryAnalysisModuleDataPointer> pdata;
+    std::vector<TrajectoryFrameCopyPointer>          frames;
+    std::vector<SelectionCollectionPointer>          threadSelections;
+    int                                              nframes = 0;
+
+    pdata.reserve(nthreads);
+    frames.reserve(nthreads);
+    threadSelections.reserve(nthreads);
+    for (int i = 0; i < nthreads; ++i)
+    {
+        pdata.push_back(module_->startFrames(dataOptions, *selections));
+        frames.push_back(TrajectoryFrameCopyPointer(new TrajectoryFrameCopy));
+        threadSelections.push_back(
+                SelectionCollectionPointer(new SelectionCollection));
+        threadSelections.back()->initEvaluationCopy(*selections);
+    }
+    bool bMore = true;
+    while (bMore)
+    {
+        int nbatch = 0;
+        while (nbatch < nthreads && bMore)
+        {
+            common->initFrame();
+            TrajectoryFrameCopy &copy = *frames[nbatch];
+            copy.copyFrom(common->frame());
+            if (bPBC)
+            {
+                set_pbc(copy.pbc(), topology.ePBC(), copy.frame().box);
+            }
+            ++nbatch;
+            bMore = common->readNextFrame();
+        }
+#pragma omp parallel for num_threads(nthreads) schedule(static, 1)
+        for (int i = 0; i < nbatch; ++i)
+        {
+            try
+            {
+                t_pbc *ppbc = bPBC ? frames[i]->pbc() : NULL;
+                threadSelections[i]->evaluate(&frames[i]->frame(), ppbc);
+                pdata[i]->copySelectionValues(*threadSelections[i]);
+                module_->analyzeFrame(nframes + i, frames[i]->frame(),
+                                      ppbc, pdata[i].get());
+            }
+            GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+        }
+        nframes += nbatch;
+    }
+    for (int i = 0; i < nthreads; ++i)
+    {
+        module_->finishFrames(pdata[i].get());
+        if (pdata[i].get() != NULL)
+        {
+            pdata[i]->finish();
+        }
+        pdata[i].reset();
+        selections->mergeEvaluationCopy(*threadSelections[i]);
+    }
+    return nframes;
+}
+
+
 /********************************************************************
  * TrajectoryAnalysisCommandLineRunner
  */
@@ -242,31 +401,45 @@ TrajectoryAnalysisCommandLineRunner::run(int argc, char *argv[])
     t_pbc  pbc;
     t_pbc *ppbc = settings.hasPBC() ? &pbc : NULL;
 
-    int    nframes = 0;
-    AnalysisDataParallelOptions         dataOptions;
-    TrajectoryAnalysisModuleDataPointer pdata(
-            module->startFrames(dataOptions, selections));
-    do
+    int nframes  = 0;
+    int nthreads = 1;
+    if (settings.hasFlag(TrajectoryAnalysisSettings::efParallelFrames)
+        && common.hasTrajectory())
+    {
+        nthreads = gmx_omp_get_max_threads();
+    }
+    if (nthreads > 1)
+    {
+        nframes = impl_->runParallelFrames(nthreads, &common, &selections,
+                                           settings.hasPBC());
+    }
+    else
     {
-        common.initFrame();
-        t_trxframe &frame = common.frame();
-        if (ppbc != NULL)
+        AnalysisDataParallelOptions         dataOptions;
+        TrajectoryAnalysisModuleDataPointer pdata(
+                module->startFrames(dataOptions, selections));
+        do
         {
-            set_pbc(ppbc, topology.ePBC(), frame.box);
-        }
+            common.initFrame();
+            t_trxframe &frame = common.frame();
+            if (ppbc != NULL)
+            {
+                set_pbc(ppbc, topology.ePBC(), frame.box);
+            }
 
-        selections.evaluate(&frame, ppbc);
-        module->analyzeFrame(nframes, frame, ppbc, pdata.get());
+            selections.evaluate(&frame, ppbc);
+            module->analyzeFrame(nframes, frame, ppbc, pdata.get());
 
-        nframes++;
-    }
-    while (common.readNextFrame());
-    module->finishFrames(pdata.get());
-    if (pdata.get() != NULL)
-    {
-        pdata->finish();
+            nframes++;
+        }
+        while (common.readNextFrame());
+        module->finishFrames(pdata.get());
+        if (pdata.get() != NULL)
+        {
+            pdata->finish();
+        }
+        pdata.reset();
     }
-    pdata.reset();
 
     if (common.hasTrajectory())
     {
@@ -278,6 +451,10 @@ TrajectoryAnalysisCommandLineRunner::run(int argc, char *argv[])
         fprintf(stderr, "Analyzed topology coordinates\n");
     }
 
+    // The index groups are kept until here, as creating evaluation copies of
+    // the selections for parallel analysis needs them.
+    common.doneIndexGroups(&selections);
+
     // Restore the maximal groups for dynamic selections.
     selections.evaluateFinal(nframes);
 
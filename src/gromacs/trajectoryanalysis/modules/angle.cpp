@@ -225,6 +225,10 @@ Angle::optionsFinished(Options *options, TrajectoryAnalysisSettings *settings)
     {
         GMX_THROW(InconsistentInputError("Cannot provide a second selection (-group2) with -g2 t0 or z"));
     }
+    // With -g2 t0, the reference vectors are taken from the first frame and
+    // stored in the module, so frames cannot be analyzed out of order.
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames,
+                      g2type_[0] != 't');
 }
 
 
@@ -404,7 +408,7 @@ Angle::analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
                 clear_rvec(c2);
                 break;
             case 's':
-                copy_rvec(sel2_[g].position(0).x(), c2);
+                copy_rvec(sel2[g].position(0).x(), c2);
                 break;
         }
         for (int i = 0, j = 0, n = 0;
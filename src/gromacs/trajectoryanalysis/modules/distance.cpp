@@ -80,7 +80,7 @@ Distance::~Distance()
 
 
 void
-Distance::initOptions(Options *options, TrajectoryAnalysisSettings * /*settings*/)
+Distance::initOptions(Options *options, TrajectoryAnalysisSettings *settings)
 {
     static const char *const desc[] = {
         "g_dist can calculate the distance between two positions as",
@@ -95,6 +95,8 @@ Distance::initOptions(Options *options, TrajectoryAnalysisSettings * /*settings*
                            .description("Computed distances"));
     options->addOption(SelectionOption("select").required().valueCount(2)
                            .store(sel_));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
 }
 
 
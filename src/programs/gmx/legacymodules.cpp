@@ -189,6 +189,8 @@ void registerLegacyModules(gmx::CommandLineModuleManager *manager)
                                          "Calculate and diagonalize the covariance matrix");
     LegacyCmdLineWrapper::registerModule(manager, &gmx_current, "current",
                                          "Calculate dielectric constants and charge autocorrelation function");
+    LegacyCmdLineWrapper::registerModule(manager, &gmx_ddreplay, "ddreplay",
+                                         "Predict the DD load balance for other grids from mdrun -ddload output");
     LegacyCmdLineWrapper::registerModule(manager, &gmx_density, "density",
                                          "Calculate the density of the system");
     LegacyCmdLineWrapper::registerModule(manager, &gmx_densmap, "densmap",
@@ -529,6 +529,8 @@ int cmain(int argc, char *argv[])
         "and prints that to standard output in a readable format.",
         "This program is essential for checking your run input file in case of",
         "problems.[PAR]",
+        "A distributed checkpoint, written by [TT]mdrun -cpparts[tt], is",
+        "converted to a single checkpoint file when [TT]-ocp[tt] is given.[PAR]",
         "The program can also preprocess a topology to help finding problems.",
         "Note that currently setting [TT]GMXLIB[tt] is the only way to customize",
         "directories used for searching include files.",
@@ -541,6 +543,7 @@ int cmain(int argc, char *argv[])
         { efTRX, "-f", NULL, ffOPTRD },
         { efEDR, "-e", NULL, ffOPTRD },
         { efCPT, NULL, NULL, ffOPTRD },
+        { efCPT, "-ocp", "state_single", ffOPTWR },
         { efTOP, "-p", NULL, ffOPTRD },
         { efMTX, "-mtx", "hessian", ffOPTRD },
         { efMDP, "-om", NULL, ffOPTWR }
@@ -576,9 +579,17 @@ int cmain(int argc, char *argv[])
     {
         list_ene(ftp2fn(efEDR, NFILE, fnm));
     }
-    else if (ftp2bSet(efCPT, NFILE, fnm))
+    else if (opt2bSet("-cp", NFILE, fnm))
     {
-        list_checkpoint(ftp2fn(efCPT, NFILE, fnm), stdout);
+        if (opt2bSet("-ocp", NFILE, fnm))
+        {
+            convert_checkpoint(opt2fn("-cp", NFILE, fnm),
+                               opt2fn("-ocp", NFILE, fnm));
+        }
+        else
+        {
+            list_checkpoint(opt2fn("-cp", NFILE, fnm), stdout);
+        }
     }
     else if (ftp2bSet(efTOP, NFILE, fnm))
     {
@@ -476,12 +476,6 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
         update_energyhistory(&state_global->enerhist, mdebin);
     }
 
-    if ((state->flags & (1<<estLD_RNG)) && (Flags & MD_READ_RNG))
-    {
-        /* Set the random state if we read a checkpoint file */
-        set_stochd_state(upd, state);
-    }
-
     if (state->flags & (1<<estMC_RNG))
     {
         set_mc_state(mcrng, state);
@@ -529,9 +523,10 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
 
     /* PME tuning is only supported with GPUs or PME nodes and not with rerun.
      * With perturbed charges with soft-core we should not change the cut-off.
+     * With PME multiple time stepping the step cost varies between steps.
      */
     if ((Flags & MD_TUNEPME) &&
-        EEL_PME(fr->eeltype) &&
+        EEL_PME(fr->eeltype) && !fr->bPMEMTS &&
         ( (fr->cutoff_scheme == ecutsVERLET && fr->nbv->bUseGPU) || !(cr->duty & DUTY_PME)) &&
         !(ir->efep != efepNO && mdatoms->nChargePerturbed > 0 && ir->fepvals->bScCoul) &&
         !bRerunMD)
@@ -1211,7 +1206,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
              * For nstcalclr=1 this is not done, since the forces would have been added
              * directly to the short-range forces already.
              */
-            bUpdateDoLR = (fr->bTwinRange && do_per_step(step, ir->nstcalclr));
+            bUpdateDoLR = ((fr->bTwinRange && do_per_step(step, ir->nstcalclr)) ||
+                           pme_mesh_impulse_step(fr, ir, step));
 
             update_coords(fplog, step, ir, mdatoms, state, fr->bMolPBC,
                           f, bUpdateDoLR, fr->f_twin, fcd,
@@ -1464,10 +1460,6 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             wallcycle_start(wcycle, ewcTRAJ);
             if (bCPT)
             {
-                if (state->flags & (1<<estLD_RNG))
-                {
-                    get_stochd_state(upd, state);
-                }
                 if (state->flags  & (1<<estMC_RNG))
                 {
                     get_mc_state(mcrng, state);
@@ -1502,6 +1494,14 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                 bCPT = FALSE;
             }
             debug_gmx();
+            if (bLastStep && step_rel == ir->nsteps &&
+                (Flags & MD_CONFOUT) && DOMAINDECOMP(cr) && outf->bCPTParts &&
+                !bRerunMD && !bFFscan)
+            {
+                /* The distributed checkpoint did not collect x and v */
+                dd_collect_vec(cr->dd, state, state->x, state_global->x);
+                dd_collect_vec(cr->dd, state, state->v, state_global->v);
+            }
             if (bLastStep && step_rel == ir->nsteps &&
                 (Flags & MD_CONFOUT) && MASTER(cr) &&
                 !bRerunMD && !bFFscan)
@@ -1637,7 +1637,7 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             if (ETC_ANDERSEN(ir->etc)) /* keep this outside of update_tcouple because of the extra info required to pass */
             {
                 gmx_bool bIfRandomize;
-                bIfRandomize = update_randomize_velocities(ir, step, mdatoms, state, upd, &top->idef, constr);
+                bIfRandomize = update_randomize_velocities(ir, step, cr, mdatoms, state, upd, &top->idef, constr);
                 /* if we have constraints, we have to remove the kinetic energy parallel to the bonds */
                 if (constr && bIfRandomize)
                 {
@@ -1716,7 +1716,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
 
                 if (bVV)
                 {
-                    bUpdateDoLR = (fr->bTwinRange && do_per_step(step, ir->nstcalclr));
+                    bUpdateDoLR = ((fr->bTwinRange && do_per_step(step, ir->nstcalclr)) ||
+                                   pme_mesh_impulse_step(fr, ir, step));
 
                     /* velocity half-step update */
                     update_coords(fplog, step, ir, mdatoms, state, fr->bMolPBC, f,
@@ -1734,7 +1735,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                 {
                     copy_rvecn(state->x, cbuf, 0, state->natoms);
                 }
-                bUpdateDoLR = (fr->bTwinRange && do_per_step(step, ir->nstcalclr));
+                bUpdateDoLR = ((fr->bTwinRange && do_per_step(step, ir->nstcalclr)) ||
+                               pme_mesh_impulse_step(fr, ir, step));
 
                 update_coords(fplog, step, ir, mdatoms, state, fr->bMolPBC, f,
                               bUpdateDoLR, fr->f_twin, fcd,
@@ -1762,7 +1764,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                     /* now we know the scaling, we can compute the positions again again */
                     copy_rvecn(cbuf, state->x, 0, state->natoms);
 
-                    bUpdateDoLR = (fr->bTwinRange && do_per_step(step, ir->nstcalclr));
+                    bUpdateDoLR = ((fr->bTwinRange && do_per_step(step, ir->nstcalclr)) ||
+                                   pme_mesh_impulse_step(fr, ir, step));
 
                     update_coords(fplog, step, ir, mdatoms, state, fr->bMolPBC, f,
                                   bUpdateDoLR, fr->f_twin, fcd,
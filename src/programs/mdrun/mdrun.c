@@ -238,6 +238,14 @@ int cmain(int argc, char *argv[])
         "the value of [TT]-dds[tt] might need to be adjusted to account for",
         "high or low spatial inhomogeneity of the system.",
         "[PAR]",
+        "With option [TT]-ddload[tt] the DD master writes, at every",
+        "neighbor search step, a line per DD node with the cell index,",
+        "physical node number, home, halo and sent atom counts,",
+        "the force, step, PME and PME wait cycles and the cell boundaries.",
+        "These files can be used with [TT]g_ddreplay[tt] to predict",
+        "the load imbalance for other DD grids and [TT]-dds[tt] and",
+        "[TT]-rdd[tt] settings.",
+        "[PAR]",
         "The option [TT]-gcom[tt] can be used to only do global communication",
         "every n steps.",
         "This can improve performance for highly parallel simulations",
@@ -318,6 +326,13 @@ int cmain(int argc, char *argv[])
         "even when the simulation is terminated while writing a checkpoint.",
         "With [TT]-cpnum[tt] all checkpoint files are kept and appended",
         "with the step number.",
+        "With domain decomposition, option [TT]-cpparts[tt] lets each node",
+        "write the coordinates and velocities of its home atoms to a separate",
+        "file [TT]state_step<step>_part<node>.cpt[tt], instead of collecting",
+        "them on the master node. The checkpoint file then references",
+        "these part files, which should be kept in the same directory.",
+        "Such a checkpoint can be read with any number of nodes and can",
+        "be converted to a single file with [TT]gmxdump -cp -ocp[tt].",
         "A simulation can be continued by reading the full state from file",
         "with option [TT]-cpi[tt]. This option is intelligent in the way that",
         "if no checkpoint file is found, Gromacs just assumes a normal run and",
@@ -398,6 +413,7 @@ int cmain(int argc, char *argv[])
         { efLOG, "-rt",     "rottorque", ffOPTWR },
         { efMTX, "-mtx",    "nm",       ffOPTWR },
         { efNDX, "-dn",     "dipole",   ffOPTWR },
+        { efDAT, "-ddload", "ddload",   ffOPTWR },
         { efRND, "-multidir", NULL,      ffOPTRDMULT},
         { efDAT, "-membed", "membed",   ffOPTRD },
         { efTOP, "-mp",     "membed",   ffOPTRD },
@@ -445,6 +461,7 @@ int cmain(int argc, char *argv[])
     real          cpt_period            = 15.0, max_hours = -1;
     gmx_bool      bAppendFiles          = TRUE;
     gmx_bool      bKeepAndNumCPT        = FALSE;
+    gmx_bool      bCptParts             = FALSE;
     gmx_bool      bResetCountersHalfWay = FALSE;
     output_env_t  oenv                  = NULL;
     const char   *deviceOptions         = "";
@@ -517,6 +534,8 @@ int cmain(int argc, char *argv[])
           "Checkpoint interval (minutes)" },
         { "-cpnum",   FALSE, etBOOL, {&bKeepAndNumCPT},
           "Keep and number checkpoint files" },
+        { "-cpparts", FALSE, etBOOL, {&bCptParts},
+          "Write the atom state of each domain to a separate checkpoint part file" },
         { "-append",  FALSE, etBOOL, {&bAppendFiles},
           "Append to previous output files when continuing from checkpoint instead of adding the simulation part number to all file names" },
         { "-nsteps",  FALSE, etINT, {&nsteps},
@@ -702,6 +721,7 @@ int cmain(int argc, char *argv[])
     Flags = Flags | (bAppendFiles  ? MD_APPENDFILES  : 0);
     Flags = Flags | (opt2parg_bSet("-append", asize(pa), pa) ? MD_APPENDFILESSET : 0);
     Flags = Flags | (bKeepAndNumCPT ? MD_KEEPANDNUMCPT : 0);
+    Flags = Flags | (bCptParts ? MD_CPTPARTS : 0);
     Flags = Flags | (sim_part > 1    ? MD_STARTFROMCPT : 0);
     Flags = Flags | (bResetCountersHalfWay ? MD_RESETCOUNTERSHALFWAY : 0);
 
@@ -41,6 +41,7 @@
 #include "repl_ex.h"
 #include "network.h"
 #include "random.h"
+#include "gmx_random.h"
 #include "smalloc.h"
 #include "physics.h"
 #include "copyrite.h"
@@ -891,15 +892,16 @@ test_for_replica_exchange(FILE                 *fplog,
                           gmx_large_int_t       step,
                           real                  time)
 {
-    int       m, i, j, a, b, ap, bp, i0, i1, tmp;
-    real      ediff = 0, delta = 0, dpV = 0;
-    gmx_bool  bPrint, bMultiEx;
-    gmx_bool *bEx      = re->bEx;
-    real     *prob     = re->prob;
-    int      *pind     = re->destinations; /* permuted index */
-    gmx_bool  bEpot    = FALSE;
-    gmx_bool  bDLambda = FALSE;
-    gmx_bool  bVol     = FALSE;
+    int              m, i, j, a, b, ap, bp, i0, i1, tmp;
+    real             ediff = 0, delta = 0, dpV = 0;
+    gmx_bool         bPrint, bMultiEx;
+    gmx_bool        *bEx      = re->bEx;
+    real            *prob     = re->prob;
+    int             *pind     = re->destinations; /* permuted index */
+    gmx_bool         bEpot    = FALSE;
+    gmx_bool         bDLambda = FALSE;
+    gmx_bool         bVol     = FALSE;
+    gmx_rng_cycle_t  rng;
 
     bMultiEx = (re->nex > 1);  /* multiple exchanges at each state */
     fprintf(fplog, "Replica exchange at step " gmx_large_int_pfmt " time %g\n", step, time);
@@ -970,6 +972,11 @@ test_for_replica_exchange(FILE                 *fplog,
         }
     }
 
+    /* The random numbers only depend on the seed and the step, so all
+     * replicas draw the same numbers, also after a restart.
+     */
+    gmx_rng_cycle_init(&rng, re->seed, RND_SEED_REPLEX, step, 0);
+
     /* make a duplicate set of indices for shuffling */
     for (i = 0; i < re->nrepl; i++)
     {
@@ -986,8 +993,8 @@ test_for_replica_exchange(FILE                 *fplog,
                probability of occurring (log p > -100) and only operate on those switches */
             /* find out which state it is from, and what label that state currently has. Likely
                more work that useful. */
-            i0 = (int)(re->nrepl*rando(&(re->seed)));
-            i1 = (int)(re->nrepl*rando(&(re->seed)));
+            i0 = (int)(re->nrepl*gmx_rng_cycle_uniform_real(&rng));
+            i1 = (int)(re->nrepl*gmx_rng_cycle_uniform_real(&rng));
             if (i0 == i1)
             {
                 i--;
@@ -1026,7 +1033,7 @@ test_for_replica_exchange(FILE                 *fplog,
                     prob[0] = exp(-delta);
                 }
                 /* roll a number to determine if accepted */
-                bEx[0] = (rando(&(re->seed)) < prob[0]);
+                bEx[0] = (gmx_rng_cycle_uniform_real(&rng) < prob[0]);
             }
             re->prob_sum[0] += prob[0];
 
@@ -1071,7 +1078,7 @@ test_for_replica_exchange(FILE                 *fplog,
                         prob[i] = exp(-delta);
                     }
                     /* roll a number to determine if accepted */
-                    bEx[i] = (rando(&(re->seed)) < prob[i]);
+                    bEx[i] = (gmx_rng_cycle_uniform_real(&rng) < prob[i]);
                 }
                 re->prob_sum[i] += prob[i];
 
@@ -931,7 +931,7 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
     int             i, m, nChargePerturbed = -1, status, nalloc;
     char           *gro;
     gmx_wallcycle_t wcycle;
-    gmx_bool        bReadRNG, bReadEkin;
+    gmx_bool        bReadEkin;
     int             list;
     gmx_runtime_t   runtime;
     int             rc;
@@ -1260,14 +1260,10 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
         {
             load_checkpoint(opt2fn_master("-cpi", nfile, fnm, cr), &fplog,
                             cr, Flags & MD_PARTDEC, ddxyz,
-                            inputrec, state, &bReadRNG, &bReadEkin,
+                            inputrec, state, &bReadEkin,
                             (Flags & MD_APPENDFILES),
                             (Flags & MD_APPENDFILESSET));
 
-            if (bReadRNG)
-            {
-                Flags |= MD_READ_RNG;
-            }
             if (bReadEkin)
             {
                 Flags |= MD_READ_EKIN;
@@ -1567,6 +1563,13 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
             set_dd_parameters(fplog, cr->dd, dlb_scale, inputrec, fr, &ddbox);
 
             setup_dd_grid(fplog, cr->dd);
+
+            if (opt2bSet("-ddload", nfile, fnm))
+            {
+                dd_init_load_stats(fplog, cr->dd,
+                                   opt2fn("-ddload", nfile, fnm),
+                                   (Flags & MD_APPENDFILES));
+            }
         }
 
         /* Now do whatever the user wants us to do (how flexible...) */